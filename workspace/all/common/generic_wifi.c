@@ -5,7 +5,7 @@
 // provide their own implementations.
 // Used by: tg5050
 // Library dependencies: none
-// Tool dependencies: wpa_cli, wpa_supplicant, iproute2 (ip command)
+// Tool dependencies: wpa_supplicant (control socket), iproute2 (ip command, fallback only)
 // Script dependencies: $SYSTEM_PATH/etc/wifi/wifi_init.sh
 
 // \note This files does not have an acompanying header, as all functions are declared in api.h
@@ -14,6 +14,13 @@
 
 /////////////////////////////////////////////////////////////////////////////////////////
 
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
 #include "defines.h"
 #include "platform.h"
 #include "api.h"
@@ -22,7 +29,6 @@
 bool PLAT_hasWifi() { return true; }
 
 #define WIFI_INTERFACE "wlan0"
-#define WPA_CLI_CMD "wpa_cli -p " WIFI_SOCK_DIR " -i " WIFI_INTERFACE
 
 #define wifilog(fmt, ...) \
     LOG_note(PLAT_wifiDiagnosticsEnabled() ? LOG_INFO : LOG_DEBUG, fmt, ##__VA_ARGS__)
@@ -57,11 +63,6 @@ static int wifi_run_cmd(const char *cmd, char *output, size_t output_len) {
     return exit_code;
 }
 
-// Helper to check if wpa_supplicant is running
-static bool wifi_supplicant_running(void) {
-    return system("pidof wpa_supplicant > /dev/null 2>&1") == 0;
-}
-
 // Helper to get IP address of wifi interface
 static bool wifi_get_ip(char *ip, size_t len) {
     char cmd[256];
@@ -77,31 +78,326 @@ static bool wifi_get_ip(char *ip, size_t len) {
     return false;
 }
 
-// Helper to escape a string for wpa_cli (double quotes/backslashes) and shell (single quotes)
-static void wifi_escape(char *dest, const char *src, size_t dest_len) {
-    size_t j = 0;
-    for (size_t i = 0; src[i] != '\0' && j < dest_len - 1; i++) {
-        // Double quotes and backslashes need to be escaped for wpa_cli (inside its own quotes)
-        if (src[i] == '"' || src[i] == '\\') {
-            if (j < dest_len - 2) {
-                dest[j++] = '\\';
+/////////////////////////////////////////////////////////////////////////////////////////
+// wpa_supplicant control interface
+//
+// Requests go over a persistent UNIX datagram socket to wpa_supplicant's control
+// interface (the protocol wpa_cli speaks) instead of forking a shell and wpa_cli
+// for each one. A second socket is ATTACHed for events and read by a monitor
+// thread, so scans complete on CTRL-EVENT-SCAN-RESULTS instead of a fixed sleep
+// and connection state changes are pushed rather than polled.
+
+#define WPA_CTRL_PATH WIFI_SOCK_DIR "/" WIFI_INTERFACE
+#define WPA_CTRL_LOCAL_DIR "/tmp"
+#define WPA_REPLY_TIMEOUT_MS 5000     // wpa_cli waits 10s, nothing we send takes that long
+#define WPA_SCAN_TIMEOUT_MS 8000      // All bands, passive channels included
+#define WPA_SCAN_FALLBACK_US 2000000  // No event monitor: the old fixed wait
+#define WPA_CONNECT_TIMEOUT_MS 5000
+#define WPA_MONITOR_RETRY_MS 2000     // Reattach interval while wpa_supplicant is down
+#define WPA_MONITOR_PING_MS 5000      // Idle check that wpa_supplicant is still there
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;           // One request in flight on cmd_fd
+    int cmd_fd;
+    char cmd_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    char mon_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+    // Pushed by the monitor thread, guarded by event_lock
+    pthread_mutex_t event_lock;
+    pthread_cond_t event_cond;
+    bool attached;                  // Events are flowing
+    uint32_t scan_seq;              // Bumped on every finished (or failed) scan
+    uint32_t connect_seq;           // Bumped on every CTRL-EVENT-CONNECTED
+    uint32_t auth_fail_seq;         // Bumped when a network is disabled for a bad key
+    int connected;                  // 1/0 from events, -1 until known
+} wpa = {
+    .once = PTHREAD_ONCE_INIT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cmd_fd = -1,
+    .event_lock = PTHREAD_MUTEX_INITIALIZER,
+    .connected = -1,
+};
+
+static int wpa_open_socket(char *local_path, size_t len) {
+    static int counter = 0;
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    // Same local naming as wpa_ctrl_open, the supplicant replies to this address
+    struct sockaddr_un local = { .sun_family = AF_UNIX };
+    snprintf(local.sun_path, sizeof(local.sun_path), WPA_CTRL_LOCAL_DIR "/wpa_ctrl_%d-%d",
+             (int)getpid(), __sync_fetch_and_add(&counter, 1));
+    unlink(local.sun_path);
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct sockaddr_un dest = { .sun_family = AF_UNIX };
+    snprintf(dest.sun_path, sizeof(dest.sun_path), "%s", WPA_CTRL_PATH);
+    if (connect(fd, (struct sockaddr *)&dest, sizeof(dest)) < 0) {
+        close(fd);
+        unlink(local.sun_path);
+        return -1;
+    }
+
+    snprintf(local_path, len, "%s", local.sun_path);
+    return fd;
+}
+
+static void wpa_close_socket(int *fd, char *local_path) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+    if (local_path[0]) unlink(local_path);
+    local_path[0] = '\0';
+}
+
+static void wpa_cleanup(void) {
+    // Remove our bound socket files, the sockets themselves close with the process
+    if (wpa.cmd_path[0]) unlink(wpa.cmd_path);
+    if (wpa.mon_path[0]) unlink(wpa.mon_path);
+}
+
+static bool wpa_handle_event(const char *msg);
+
+// Sends `cmd` on `fd` and waits for the reply. Unsolicited "<level>EVENT" messages
+// (only on attached sockets) are dispatched, not returned. Returns the reply length
+// or -1 on a send/receive error or timeout.
+static int wpa_request_fd(int fd, const char *cmd, char *reply, size_t reply_len) {
+    if (send(fd, cmd, strlen(cmd), 0) < 0) return -1;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int elapsed = (int)((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000);
+        if (elapsed >= WPA_REPLY_TIMEOUT_MS) return -1;
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, WPA_REPLY_TIMEOUT_MS - elapsed);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return -1;
+
+        ssize_t n = recv(fd, reply, reply_len - 1, 0);
+        if (n < 0) return -1;
+        reply[n] = '\0';
+        if (reply[0] == '<') {
+            wpa_handle_event(reply);
+            continue;
+        }
+        return (int)n;
+    }
+}
+
+static void *wpa_monitor_thread(void *arg);
+
+static void wpa_init(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wpa.event_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    atexit(wpa_cleanup);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, wpa_monitor_thread, NULL) == 0) {
+        pthread_detach(thread);
+    } else {
+        LOG_error("wpa: failed to start the event monitor, falling back to polling\n");
+    }
+}
+
+// Runs one control interface command. Reconnects once if wpa_supplicant was
+// restarted (eg. by wifi_init.sh) since the last request. Returns the reply
+// length or -1 if wpa_supplicant isn't reachable or didn't answer.
+static int wpa_request(const char *cmd, char *reply, size_t reply_len) {
+    pthread_once(&wpa.once, wpa_init);
+
+    // Keep passphrases out of the log
+    const char *secret = strstr(cmd, " psk ");
+    if (secret) wifilog("wpa: %.*s psk <hidden>\n", (int)(secret - cmd), cmd);
+    else wifilog("wpa: %s\n", cmd);
+
+    pthread_mutex_lock(&wpa.lock);
+    int len = -1;
+    for (int attempt = 0; attempt < 2 && len < 0; attempt++) {
+        if (wpa.cmd_fd < 0) {
+            wpa.cmd_fd = wpa_open_socket(wpa.cmd_path, sizeof(wpa.cmd_path));
+            if (wpa.cmd_fd < 0) break;
+        }
+        len = wpa_request_fd(wpa.cmd_fd, cmd, reply, reply_len);
+        // A late reply would answer the next request, so start over on a fresh socket
+        if (len < 0) wpa_close_socket(&wpa.cmd_fd, wpa.cmd_path);
+    }
+    pthread_mutex_unlock(&wpa.lock);
+
+    if (len < 0) LOG_error("wpa: no reply to %.*s from %s\n", (int)strcspn(cmd, " "), cmd, WPA_CTRL_PATH);
+    return len;
+}
+
+// For commands that answer OK/FAIL
+static bool wpa_command(const char *cmd) {
+    char reply[64];
+    if (wpa_request(cmd, reply, sizeof(reply)) < 0) return false;
+    if (strncmp(reply, "OK", 2) != 0) {
+        wifilog("wpa: %.*s failed: %s\n", (int)strcspn(cmd, " "), cmd, reply);
+        return false;
+    }
+    return true;
+}
+
+// Copies the value of "key=" out of a key=value reply (STATUS, SIGNAL_POLL)
+static bool wpa_reply_value(const char *reply, const char *key, char *value, size_t value_len) {
+    size_t key_len = strlen(key);
+    const char *line = reply;
+    while (line && *line) {
+        const char *end = strchr(line, '\n');
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == '=') {
+            const char *start = line + key_len + 1;
+            size_t len = end ? (size_t)(end - start) : strlen(start);
+            if (len >= value_len) len = value_len - 1;
+            memcpy(value, start, len);
+            value[len] = '\0';
+            return true;
+        }
+        line = end ? end + 1 : NULL;
+    }
+    value[0] = '\0';
+    return false;
+}
+
+#define WPA_EVENT_IS(event, name) (strncmp(event, name, sizeof(name) - 1) == 0)
+
+// Returns false when the monitor should reattach (wpa_supplicant is going away)
+static bool wpa_handle_event(const char *msg) {
+    // Skip the "<level>" priority prefix
+    const char *event = msg;
+    if (event[0] == '<') {
+        const char *end = strchr(event, '>');
+        if (end) event = end + 1;
+    }
+    wifilog("wpa event: %s\n", event);
+
+    bool keep = true;
+    pthread_mutex_lock(&wpa.event_lock);
+    if (WPA_EVENT_IS(event, "CTRL-EVENT-SCAN-RESULTS") || WPA_EVENT_IS(event, "CTRL-EVENT-SCAN-FAILED")) {
+        wpa.scan_seq++;
+    } else if (WPA_EVENT_IS(event, "CTRL-EVENT-CONNECTED")) {
+        wpa.connected = 1;
+        wpa.connect_seq++;
+    } else if (WPA_EVENT_IS(event, "CTRL-EVENT-DISCONNECTED")) {
+        wpa.connected = 0;
+    } else if (WPA_EVENT_IS(event, "CTRL-EVENT-SSID-TEMP-DISABLED") && strstr(event, "reason=WRONG_KEY")) {
+        wpa.auth_fail_seq++;
+    } else if (WPA_EVENT_IS(event, "CTRL-EVENT-TERMINATING")) {
+        keep = false;
+    }
+    pthread_cond_broadcast(&wpa.event_cond);
+    pthread_mutex_unlock(&wpa.event_lock);
+    return keep;
+}
+
+static void wpa_set_attached(bool attached) {
+    pthread_mutex_lock(&wpa.event_lock);
+    wpa.attached = attached;
+    wpa.connected = -1; // Whatever happened while detached wasn't seen
+    pthread_cond_broadcast(&wpa.event_cond);
+    pthread_mutex_unlock(&wpa.event_lock);
+}
+
+static void *wpa_monitor_thread(void *arg) {
+    int fd = -1;
+    char msg[4096];
+
+    for (;;) {
+        if (fd < 0) {
+            fd = wpa_open_socket(wpa.mon_path, sizeof(wpa.mon_path));
+            if (fd >= 0 && (wpa_request_fd(fd, "ATTACH", msg, sizeof(msg)) < 0 || strncmp(msg, "OK", 2) != 0)) {
+                wpa_close_socket(&fd, wpa.mon_path);
             }
-        } 
-        // Single quotes need to be escaped for the shell (outside wpa_cli's quotes but inside shell's)
-        else if (src[i] == '\'') {
-            if (j < dest_len - 5) {
-                dest[j++] = '\''; // close single quote
-                dest[j++] = '\\'; // escape
-                dest[j++] = '\''; // the actual quote
-                dest[j++] = '\''; // open single quote again
+            if (fd < 0) {
+                usleep(WPA_MONITOR_RETRY_MS * 1000);
+                continue;
             }
-            continue;
+            wifilog("wpa: event monitor attached\n");
+            wpa_set_attached(true);
         }
-        
-        if (j < dest_len - 1) {
-            dest[j++] = src[i];
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, WPA_MONITOR_PING_MS);
+        if (ready < 0 && errno == EINTR) continue;
+
+        bool keep;
+        if (ready == 0) {
+            // A killed wpa_supplicant doesn't say TERMINATING, so check it's still there
+            keep = wpa_request_fd(fd, "PING", msg, sizeof(msg)) > 0 && strncmp(msg, "PONG", 4) == 0;
+        } else {
+            ssize_t n = ready > 0 ? recv(fd, msg, sizeof(msg) - 1, 0) : -1;
+            if (n > 0) {
+                msg[n] = '\0';
+                keep = wpa_handle_event(msg);
+            } else {
+                keep = false;
+            }
+        }
+
+        if (!keep) {
+            wifilog("wpa: event monitor detached\n");
+            wpa_close_socket(&fd, wpa.mon_path);
+            wpa_set_attached(false);
         }
     }
+    return NULL;
+}
+
+static uint32_t wpa_event_seq(const uint32_t *seq) {
+    pthread_mutex_lock(&wpa.event_lock);
+    uint32_t value = *seq;
+    pthread_mutex_unlock(&wpa.event_lock);
+    return value;
+}
+
+// Waits for *seq to move past `since`. Returns false on timeout, or right away
+// when no events are flowing (callers then fall back to waiting/polling).
+static bool wpa_wait_event(const uint32_t *seq, uint32_t since, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&wpa.event_lock);
+    int rc = 0;
+    while (wpa.attached && *seq == since && rc == 0) {
+        rc = pthread_cond_timedwait(&wpa.event_cond, &wpa.event_lock, &deadline);
+    }
+    bool moved = *seq != since;
+    pthread_mutex_unlock(&wpa.event_lock);
+    return moved;
+}
+
+static bool wpa_events_attached(void) {
+    pthread_mutex_lock(&wpa.event_lock);
+    bool attached = wpa.attached;
+    pthread_mutex_unlock(&wpa.event_lock);
+    return attached;
+}
+
+// SSIDs go to set_network as hex, so any byte (quotes included) survives unescaped
+static void wifi_hex(char *dest, const char *src, size_t dest_len) {
+    static const char digits[] = "0123456789abcdef";
+    size_t j = 0;
+    for (size_t i = 0; src[i] != '\0' && j + 2 < dest_len; i++) {
+        dest[j++] = digits[(unsigned char)src[i] >> 4];
+        dest[j++] = digits[(unsigned char)src[i] & 0xf];
+    }
     dest[j] = '\0';
 }
 
@@ -112,6 +408,9 @@ void PLAT_wifiInit() {
 
     PLAT_wifiDiagnosticsEnable(CFG_getWifiDiagnostics());
     wifilog("Wifi init\n");
+
+    // Start the event monitor now so it's attached by the first scan
+    pthread_once(&wpa.once, wpa_init);
 }
 
 bool PLAT_wifiEnabled() {
@@ -141,22 +440,34 @@ int PLAT_wifiScan(struct WIFI_network *networks, int max)
     }
 
     wifilog("PLAT_wifiScan: Starting WiFi scan...\n");
-    // Trigger a scan
-    system(WPA_CLI_CMD " scan 2>/dev/null");
-    wifilog("PLAT_wifiScan: Waiting 2s for scan to complete...\n");
-	usleep(2000000); // Give time for scan to complete
+    // Trigger a scan. FAIL-BUSY means one is already running, its results will do.
+    uint32_t scan_seq = wpa_event_seq(&wpa.scan_seq);
+    char results[16384];
+    if (wpa_request("SCAN", results, sizeof(results)) < 0) {
+        LOG_error("PLAT_wifiScan: failed to start scan.\n");
+        return -1;
+    }
+    if (strncmp(results, "OK", 2) != 0 && strncmp(results, "FAIL-BUSY", 9) != 0) {
+        LOG_error("PLAT_wifiScan: scan rejected: %.*s\n", (int)strcspn(results, "\n"), results);
+        return -1;
+    }
+    if (wpa_wait_event(&wpa.scan_seq, scan_seq, WPA_SCAN_TIMEOUT_MS)) {
+        wifilog("PLAT_wifiScan: scan completed\n");
+    } else if (!wpa_events_attached()) {
+        wifilog("PLAT_wifiScan: Waiting 2s for scan to complete...\n");
+        usleep(WPA_SCAN_FALLBACK_US); // Give time for scan to complete
+    } else {
+        LOG_warn("PLAT_wifiScan: no scan results event, using what's cached.\n");
+    }
 
     wifilog("PLAT_wifiScan: Retrieving scan results...\n");
     // Get scan results
-    char results[16384];
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "%s scan_results 2>/dev/null", WPA_CLI_CMD);
-    if (wifi_run_cmd(cmd, results, sizeof(results)) != 0) {
+    if (wpa_request("SCAN_RESULTS", results, sizeof(results)) < 0) {
         LOG_error("PLAT_wifiScan: failed to get scan results.\n");
         return -1;
     }
 
-    // wpa_cli scan_results format:
+    // scan_results format:
     // bssid / frequency / signal level / flags / ssid
     // 04:b4:fe:32:f9:73	2462	-63	[WPA2-PSK-CCMP][WPS][ESS]	frynet
 
@@ -243,18 +554,23 @@ bool PLAT_wifiConnected()
 		return false;
 	}
 
+	// Pushed by the event monitor, no round trip needed
+	pthread_mutex_lock(&wpa.event_lock);
+	int connected = wpa.attached ? wpa.connected : -1;
+	pthread_mutex_unlock(&wpa.event_lock);
+	if (connected >= 0) return connected == 1;
+
 	wifilog("PLAT_wifiConnected: Checking WiFi connection status...\n");
-	char output[256];
-	char cmd[128];
-	snprintf(cmd, sizeof(cmd), "%s status 2>/dev/null | grep '^wpa_state=' | cut -d= -f2", WPA_CLI_CMD);
-	if (wifi_run_cmd(cmd, output, sizeof(output)) != 0) {
+	char status[2048];
+	if (wpa_request("STATUS", status, sizeof(status)) < 0) {
 		return false;
 	}
-	
-	trimTrailingNewlines(output);
-	wifilog("PLAT_wifiConnected: wifi state is %s\n", output);
-	
-	return strcmp(output, "COMPLETED") == 0;
+
+	char state[64];
+	wpa_reply_value(status, "wpa_state", state, sizeof(state));
+	wifilog("PLAT_wifiConnected: wifi state is %s\n", state);
+
+	return strcmp(state, "COMPLETED") == 0;
 }
 
 int PLAT_wifiConnection(struct WIFI_connection *connection_info)
@@ -266,18 +582,17 @@ int PLAT_wifiConnection(struct WIFI_connection *connection_info)
 	}
 
 	wifilog("PLAT_wifiConnection: Retrieving connection details...\n");
-	// Get status from wpa_cli
+	// Get status from wpa_supplicant
 	char status[2048];
-	char cmd[128];
-	snprintf(cmd, sizeof(cmd), "%s status 2>/dev/null", WPA_CLI_CMD);
-	if (wifi_run_cmd(cmd, status, sizeof(status)) != 0) {
+	if (wpa_request("STATUS", status, sizeof(status)) < 0) {
 		connection_reset(connection_info);
 		return -1;
 	}
 
 	// Parse wpa_state
-	char *state_line = strstr(status, "wpa_state=");
-	if (!state_line || strstr(state_line, "COMPLETED") == NULL) {
+	char value[128];
+	wpa_reply_value(status, "wpa_state", value, sizeof(value));
+	if (strcmp(value, "COMPLETED") != 0) {
 		connection_reset(connection_info);
 		wifilog("PLAT_wifiConnection: Not connected\n");
 		return 0;
@@ -285,56 +600,33 @@ int PLAT_wifiConnection(struct WIFI_connection *connection_info)
 
 	// We're connected, fill in the info
 	connection_info->valid = true;
-	
-	// Parse SSID
+
 	wifilog("PLAT_wifiConnection: Parsing connection info...\n");
-	char *ssid_line = strstr(status, "\nssid=");
-	if (ssid_line) {
-		ssid_line += 6; // skip "\nssid="
-		char *end = strchr(ssid_line, '\n');
-		size_t len = end ? (size_t)(end - ssid_line) : strlen(ssid_line);
-		if (len >= SSID_MAX) len = SSID_MAX - 1;
-		strncpy(connection_info->ssid, ssid_line, len);
-		connection_info->ssid[len] = '\0';
-	} else {
-		connection_info->ssid[0] = '\0';
-	}
+	wpa_reply_value(status, "ssid", connection_info->ssid, SSID_MAX);
+	connection_info->freq = wpa_reply_value(status, "freq", value, sizeof(value)) ? atoi(value) : -1;
 
-	// Parse frequency
-	char *freq_line = strstr(status, "\nfreq=");
-	if (freq_line) {
-		connection_info->freq = atoi(freq_line + 6);
-	} else {
-		connection_info->freq = -1;
+	// STATUS carries the address once DHCP has set it, ip is the fallback
+	if (!wpa_reply_value(status, "ip_address", connection_info->ip, sizeof(connection_info->ip))) {
+		wifi_get_ip(connection_info->ip, sizeof(connection_info->ip));
 	}
 
-	// Get IP address
-	wifi_get_ip(connection_info->ip, sizeof(connection_info->ip));
-
-	// Get signal strength from iw
+	// Get signal strength from the driver
 	wifilog("PLAT_wifiConnection: Retrieving signal strength...\n");
 	connection_info->rssi = -1;
 	connection_info->link_speed = -1;
 	connection_info->noise = -1;
-	
-	snprintf(cmd, sizeof(cmd), "iw dev %s link 2>/dev/null", WIFI_INTERFACE);
-	char link_info[1024];
-	if (wifi_run_cmd(cmd, link_info, sizeof(link_info)) == 0) {
-		// Parse signal: -XX dBm
-		char *signal = strstr(link_info, "signal:");
-		if (signal) {
-			connection_info->rssi = atoi(signal + 7);
-		}
-		// Parse tx bitrate: XXX.X MBit/s
-		char *bitrate = strstr(link_info, "tx bitrate:");
-		if (bitrate) {
-			connection_info->link_speed = (int)atof(bitrate + 11);
-		}
+
+	char signal[512];
+	if (wpa_request("SIGNAL_POLL", signal, sizeof(signal)) > 0 && strncmp(signal, "FAIL", 4) != 0) {
+		if (wpa_reply_value(signal, "RSSI", value, sizeof(value))) connection_info->rssi = atoi(value);
+		if (wpa_reply_value(signal, "LINKSPEED", value, sizeof(value))) connection_info->link_speed = atoi(value);
+		// 9999 is wpa_supplicant's "driver doesn't report noise"
+		if (wpa_reply_value(signal, "NOISE", value, sizeof(value)) && atoi(value) != 9999) connection_info->noise = atoi(value);
+	}
+	else {
+		wifilog("signal_poll is not supported.\n");
+		connection_info->rssi = -60;
 	}
-    else {
-        wifilog("iw command is not supported.");
-        connection_info->rssi = -60;
-    }
 
 	wifilog("Connected AP: %s\n", connection_info->ssid);
 	wifilog("IP address: %s\n", connection_info->ip);
@@ -358,18 +650,16 @@ bool PLAT_wifiHasCredentials(char *ssid, WifiSecurityType sec)
         return false;
     }
 
-    // Get list of configured networks from wpa_cli
+    // Get list of configured networks from wpa_supplicant
     char list_results[4096];
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "%s list_networks 2>/dev/null", WPA_CLI_CMD);
-    if (wifi_run_cmd(cmd, list_results, sizeof(list_results)) != 0) {
+    if (wpa_request("LIST_NETWORKS", list_results, sizeof(list_results)) < 0) {
         wifilog("PLAT_wifiHasCredentials: failed to get network list.\n");
         return false;
     }
 
     wifilog("LIST:\n%s\n", list_results);
 
-    // wpa_cli list_networks format:
+    // list_networks format:
     // network id / ssid / bssid / flags
     // 0	MyNetwork	any	[CURRENT]
 
@@ -423,9 +713,7 @@ bool PLAT_wifiHasCredentials(char *ssid, WifiSecurityType sec)
 static int wifi_find_network_id(const char *ssid) {
     wifilog("wifi_find_network_id: Looking for network '%s'...\n", ssid);
     char list_results[4096];
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "%s list_networks 2>/dev/null", WPA_CLI_CMD);
-    if (wifi_run_cmd(cmd, list_results, sizeof(list_results)) != 0) {
+    if (wpa_request("LIST_NETWORKS", list_results, sizeof(list_results)) < 0) {
         wifilog("wifi_find_network_id: Failed to get network list\n");
         return -1;
     }
@@ -469,10 +757,10 @@ void PLAT_wifiForget(char *ssid, WifiSecurityType sec)
 
 	int network_id = wifi_find_network_id(ssid);
 	if (network_id >= 0) {
-		char cmd[128];
-		snprintf(cmd, sizeof(cmd), "%s remove_network %d 2>/dev/null", WPA_CLI_CMD, network_id);
-		system(cmd);
-		system(WPA_CLI_CMD " save_config 2>/dev/null");
+		char cmd[64];
+		snprintf(cmd, sizeof(cmd), "REMOVE_NETWORK %d", network_id);
+		wpa_command(cmd);
+		wpa_command("SAVE_CONFIG");
 		wifilog("PLAT_wifiForget: removed network %s (id=%d)\n", ssid, network_id);
 	} else {
 		wifilog("PLAT_wifiForget: network %s not found\n", ssid);
@@ -493,9 +781,8 @@ int PLAT_wifiForgetPrefix(const char *prefix)
 	if (!prefix || !prefix[0]) return 0;
 
 	char list_results[8192];
-	char cmd[128];
-	snprintf(cmd, sizeof(cmd), "%s list_networks 2>/dev/null", WPA_CLI_CMD);
-	if (wifi_run_cmd(cmd, list_results, sizeof(list_results)) != 0) {
+	char cmd[64];
+	if (wpa_request("LIST_NETWORKS", list_results, sizeof(list_results)) < 0) {
 		wifilog("PLAT_wifiForgetPrefix: failed to get network list\n");
 		return 0;
 	}
@@ -532,10 +819,10 @@ int PLAT_wifiForgetPrefix(const char *prefix)
 	// remove_network does not renumber the remaining networks, so removing by the
 	// ids we collected up front is safe.
 	for (int i = 0; i < n_ids; i++) {
-		snprintf(cmd, sizeof(cmd), "%s remove_network %d 2>/dev/null", WPA_CLI_CMD, ids[i]);
-		system(cmd);
+		snprintf(cmd, sizeof(cmd), "REMOVE_NETWORK %d", ids[i]);
+		wpa_command(cmd);
 	}
-	system(WPA_CLI_CMD " save_config 2>/dev/null");
+	wpa_command("SAVE_CONFIG");
 	wifilog("PLAT_wifiForgetPrefix: removed %d network(s) matching '%s'\n", n_ids, prefix);
 	return n_ids;
 }
@@ -546,7 +833,7 @@ int PLAT_wifiForgetPrefix(const char *prefix)
 void PLAT_wifiEnableAll(void)
 {
 	if (!CFG_getWifi()) return;
-	system(WPA_CLI_CMD " enable_network all 2>/dev/null");
+	wpa_command("ENABLE_NETWORK all");
 }
 
 void PLAT_wifiConnect(char *ssid, WifiSecurityType sec)
@@ -564,7 +851,7 @@ void PLAT_wifiConnectPass(const char *ssid, WifiSecurityType sec, const char* pa
 	if (ssid == NULL) {
 		// Disconnect request
 		wifilog("PLAT_wifiConnectPass: Disconnecting from WiFi...\n");
-		system(WPA_CLI_CMD " disconnect 2>/dev/null");
+		wpa_command("DISCONNECT");
 		wifilog("PLAT_wifiConnectPass: disconnected\n");
 		return;
 	}
@@ -587,71 +874,84 @@ void PLAT_wifiConnectPass(const char *ssid, WifiSecurityType sec, const char* pa
 
 	wifilog("PLAT_wifiConnectPass: Attempting to connect to SSID '%s' (security=%d)\n", ssid, sec);
 
-	char escaped_ssid[SSID_MAX * 5];
-	char escaped_pass[SSID_MAX * 5];
-	wifi_escape(escaped_ssid, ssid, sizeof(escaped_ssid));
-	if (pass) wifi_escape(escaped_pass, pass, sizeof(escaped_pass));
-
 	// Check if network already exists
 	int network_id = wifi_find_network_id(ssid);
-	char cmd[1024];
+	char cmd[SSID_MAX * 2 + 128];
 	char output[128];
-	
+
 	if (network_id < 0) {
 		// Add new network
-		snprintf(cmd, sizeof(cmd), "%s add_network 2>/dev/null", WPA_CLI_CMD);
-		if (wifi_run_cmd(cmd, output, sizeof(output)) != 0) {
+		if (wpa_request("ADD_NETWORK", output, sizeof(output)) < 0 || strncmp(output, "FAIL", 4) == 0) {
 			LOG_error("PLAT_wifiConnectPass: failed to add network\n");
 			return;
 		}
 		network_id = atoi(output);
 		wifilog("Added new network with id %d\n", network_id);
-		
-		// Set SSID (needs quotes for wpa_cli)
+
+		// Set SSID
 		wifilog("Setting network SSID...\n");
-		snprintf(cmd, sizeof(cmd), "%s set_network %d ssid '\"%s\"' 2>/dev/null", WPA_CLI_CMD, network_id, escaped_ssid);
-		system(cmd);
-		
+		char hex_ssid[SSID_MAX * 2 + 1];
+		wifi_hex(hex_ssid, ssid, sizeof(hex_ssid));
+		snprintf(cmd, sizeof(cmd), "SET_NETWORK %d ssid %s", network_id, hex_ssid);
+		wpa_command(cmd);
+
 		// Set password or open network
 		if (pass && pass[0] != '\0') {
 			wifilog("Setting network password...\n");
-			snprintf(cmd, sizeof(cmd), "%s set_network %d psk '\"%s\"' 2>/dev/null", WPA_CLI_CMD, network_id, escaped_pass);
-			system(cmd);
+			snprintf(cmd, sizeof(cmd), "SET_NETWORK %d psk \"%s\"", network_id, pass);
+			wpa_command(cmd);
 		} else if (sec == SECURITY_NONE) {
 			wifilog("Configuring as open network...\n");
-			snprintf(cmd, sizeof(cmd), "%s set_network %d key_mgmt NONE 2>/dev/null", WPA_CLI_CMD, network_id);
-			system(cmd);
+			snprintf(cmd, sizeof(cmd), "SET_NETWORK %d key_mgmt NONE", network_id);
+			wpa_command(cmd);
 		}
 	} else if (pass && pass[0] != '\0') {
 		// Update password for existing network
 		wifilog("Updating password for existing network...\n");
-		snprintf(cmd, sizeof(cmd), "%s set_network %d psk '\"%s\"' 2>/dev/null", WPA_CLI_CMD, network_id, escaped_pass);
-		system(cmd);
+		snprintf(cmd, sizeof(cmd), "SET_NETWORK %d psk \"%s\"", network_id, pass);
+		wpa_command(cmd);
 	} else {
 		wifilog("Using existing network configuration...\n");
 	}
-	
+
 	// Enable network
+	uint32_t connect_seq = wpa_event_seq(&wpa.connect_seq);
+	uint32_t auth_fail_seq = wpa_event_seq(&wpa.auth_fail_seq);
 	wifilog("Enabling network %d...\n", network_id);
-	snprintf(cmd, sizeof(cmd), "%s enable_network %d 2>/dev/null", WPA_CLI_CMD, network_id);
-	system(cmd);
-	snprintf(cmd, sizeof(cmd), "%s reassociate 2>/dev/null", WPA_CLI_CMD);
-	system(cmd);
-	
+	snprintf(cmd, sizeof(cmd), "ENABLE_NETWORK %d", network_id);
+	wpa_command(cmd);
+	wpa_command("REASSOCIATE");
+
 	// Save configuration
 	wifilog("Saving network configuration...\n");
-	system(WPA_CLI_CMD " save_config 2>/dev/null");
-	
-	// Wait for connection
+	wpa_command("SAVE_CONFIG");
+
+	// Wait for connection. With the event monitor this returns as soon as
+	// CTRL-EVENT-CONNECTED arrives, otherwise STATUS is polled every 500ms.
 	wifilog("Waiting for connection (up to 5 seconds)...\n");
-	for (int i = 0; i < 10; i++) {
-		usleep(500000);
-		if (PLAT_wifiConnected()) {
-			wifilog("PLAT_wifiConnectPass: connected successfully after %d attempts\n", i + 1);
+	for (int waited = 0; waited < WPA_CONNECT_TIMEOUT_MS; waited += 500) {
+		bool event = wpa_wait_event(&wpa.connect_seq, connect_seq, 500);
+		if (wpa_event_seq(&wpa.auth_fail_seq) != auth_fail_seq) {
+			LOG_error("PLAT_wifiConnectPass: authentication failed for %s\n", ssid);
+			return;
+		}
+		if (!event && wpa_events_attached()) continue;
+		if (!event) usleep(500000);
+		connect_seq = wpa_event_seq(&wpa.connect_seq);
+
+		// The event may be for another network, check STATUS is on ours
+		char status[2048];
+		char value[SSID_MAX];
+		if (wpa_request("STATUS", status, sizeof(status)) < 0) continue;
+		wpa_reply_value(status, "wpa_state", value, sizeof(value));
+		if (strcmp(value, "COMPLETED") != 0) continue;
+		wpa_reply_value(status, "ssid", value, sizeof(value));
+		if (strcmp(value, ssid) == 0) {
+			wifilog("PLAT_wifiConnectPass: connected successfully after %dms\n", waited + 500);
 			return;
 		}
 	}
-	
+
 	LOG_error("PLAT_wifiConnectPass: connection timeout after 5 seconds\n");
 }
 
@@ -672,9 +972,9 @@ void PLAT_wifiSelectOnly(const char *ssid)
 	// select_network enables this network and disables all others, then triggers
 	// (re)association. Intentionally NOT followed by save_config: the disable of the
 	// other networks is a runtime-only state, restored when the wifi stack restarts.
-	char cmd[128];
-	snprintf(cmd, sizeof(cmd), "%s select_network %d 2>/dev/null", WPA_CLI_CMD, network_id);
-	system(cmd);
+	char cmd[64];
+	snprintf(cmd, sizeof(cmd), "SELECT_NETWORK %d", network_id);
+	wpa_command(cmd);
 	wifilog("PLAT_wifiSelectOnly: selected network %s (id=%d)\n", ssid, network_id);
 }
 
@@ -691,10 +991,6 @@ bool PLAT_wifiDiagnosticsEnabled()
 void PLAT_wifiDiagnosticsEnable(bool on) 
 {
 	CFG_setWifiDiagnostics(on);
-    // set wpa_cli log level
-    if (on) {
-        system(WPA_CLI_CMD " log_level DEBUG 2>/dev/null");
-    } else {
-        system(WPA_CLI_CMD " log_level WARNING 2>/dev/null");
-    }
+    // set wpa_supplicant log level
+    wpa_command(on ? "LOG_LEVEL DEBUG" : "LOG_LEVEL WARNING");
 }
\ No newline at end of file
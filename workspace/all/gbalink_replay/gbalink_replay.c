@@ -0,0 +1,499 @@
+/*
+ * NextUI GBA Link Replay
+ * Feeds a GBA Link packet trace (see netplay/gbalink_trace.h) into a libretro
+ * core's netpacket interface on a headless Linux host, so link sessions can be
+ * reproduced and stressed without two devices.
+ *
+ * The received (RX) side of the trace is delivered to the core at the recorded
+ * frame, either as captured, time-compressed, or with injected jitter. The
+ * core's own sends are compared against the trace's TX side and summarised:
+ * divergence, per-frame delivery burst (queue depth), and response latency.
+ *
+ * usage: gbalink_replay [options] <core.so> <rom> <trace>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include "libretro-common/include/libretro.h"
+#include "gbalink_trace.h"
+
+// Same per-call delivery cap as gbalink.c (GBALINK_MAX_PACKETS_PER_FRAME)
+#define MAX_PACKETS_PER_POLL 64
+
+typedef enum {
+    TIMING_ORIGINAL = 0,  // Deliver at the captured frame, paced at the core's fps
+    TIMING_COMPRESSED,    // Captured frame / compress factor, unpaced
+    TIMING_JITTER         // Captured frame +/- random frames, order preserved
+} ReplayTiming;
+
+typedef struct {
+    GBALinkTraceRecord rec;
+    uint32_t due_frame;       // Frame at which the replay delivers it (RX only)
+    uint8_t* data;
+} TracePacket;
+
+//////////////////////////////////////////////////////////////////////////////
+// State
+//////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    // Options
+    ReplayTiming timing;
+    uint32_t compress;
+    uint32_t jitter;
+    uint32_t tail_frames;     // Frames to keep running after the last delivery
+    const char* system_dir;
+    const char* out_path;
+    bool verbose;
+
+    // Trace
+    GBALinkTraceHeader header;
+    TracePacket* rx;
+    size_t rx_count;
+    size_t rx_next;
+    TracePacket* tx;          // Expected core output
+    size_t tx_count;
+    size_t tx_next;
+
+    // Core
+    void* handle;
+    struct retro_netpacket_callback netpacket;
+    bool has_netpacket;
+    FILE* out_file;
+
+    // Run
+    uint32_t frame;
+    bool delivering;
+    uint32_t last_rx_frame;   // Frame of the oldest delivery awaiting a reply
+    bool awaiting_reply;
+
+    // Stats
+    uint32_t core_sent;
+    uint32_t matched;
+    int64_t first_divergence; // Index into tx of the first mismatch, -1 if none
+    uint32_t max_burst;       // Most packets delivered in one frame
+    uint32_t frame_burst;
+    uint32_t reply_count;
+    uint64_t reply_frames_total;
+    uint32_t reply_frames_max;
+} rp = {
+    .timing = TIMING_ORIGINAL,
+    .compress = 4,
+    .jitter = 2,
+    .tail_frames = 300,
+    .system_dir = ".",
+    .first_divergence = -1,
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Trace Loading
+//////////////////////////////////////////////////////////////////////////////
+
+static bool load_trace(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open trace %s\n", path);
+        return false;
+    }
+
+    if (fread(&rp.header, sizeof(rp.header), 1, file) != 1 ||
+        rp.header.magic != GBALINK_TRACE_MAGIC ||
+        rp.header.version != GBALINK_TRACE_VERSION) {
+        fprintf(stderr, "%s is not a version %d GBA Link trace\n", path, GBALINK_TRACE_VERSION);
+        fclose(file);
+        return false;
+    }
+    rp.header.link_mode[sizeof(rp.header.link_mode) - 1] = '\0';
+
+    size_t rx_cap = 0, tx_cap = 0;
+    GBALinkTraceRecord rec;
+    while (fread(&rec, sizeof(rec), 1, file) == 1) {
+        uint8_t* data = malloc(rec.size ? rec.size : 1);
+        if (!data || fread(data, 1, rec.size, file) != rec.size) {
+            free(data);
+            fprintf(stderr, "truncated record at frame %u, stopping there\n", rec.frame);
+            break;
+        }
+
+        TracePacket** list = rec.dir == GBALINK_TRACE_RX ? &rp.rx : &rp.tx;
+        size_t* count = rec.dir == GBALINK_TRACE_RX ? &rp.rx_count : &rp.tx_count;
+        size_t* cap = rec.dir == GBALINK_TRACE_RX ? &rx_cap : &tx_cap;
+        if (*count == *cap) {
+            *cap = *cap ? *cap * 2 : 256;
+            *list = realloc(*list, *cap * sizeof(TracePacket));
+            if (!*list) {
+                fclose(file);
+                return false;
+            }
+        }
+        (*list)[(*count)++] = (TracePacket){ .rec = rec, .due_frame = rec.frame, .data = data };
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Work out when each RX packet is handed to the core for the chosen timing
+static void schedule_deliveries(void) {
+    uint32_t prev = 0;
+    for (size_t i = 0; i < rp.rx_count; i++) {
+        uint32_t frame = rp.rx[i].rec.frame;
+        if (rp.timing == TIMING_COMPRESSED) {
+            frame /= rp.compress;
+        } else if (rp.timing == TIMING_JITTER && rp.jitter > 0) {
+            int offset = (rand() % (2 * (int)rp.jitter + 1)) - (int)rp.jitter;
+            frame = (offset < 0 && (uint32_t)-offset > frame) ? 0 : frame + offset;
+        }
+        // TCP never reorders, so neither does the replay
+        if (frame < prev) frame = prev;
+        rp.rx[i].due_frame = frame;
+        prev = frame;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Netpacket Bridge
+//////////////////////////////////////////////////////////////////////////////
+
+static void write_record(uint8_t dir, int flags, uint16_t client_id, const void* buf, size_t len) {
+    if (!rp.out_file) return;
+
+    GBALinkTraceRecord rec = {
+        .frame = rp.frame,
+        .time_ms = 0,  // Replays have no meaningful wall clock
+        .client_id = client_id,
+        .dir = dir,
+        .flags = (uint8_t)flags,
+        .size = (uint16_t)len
+    };
+    fwrite(&rec, sizeof(rec), 1, rp.out_file);
+    fwrite(buf, 1, len, rp.out_file);
+}
+
+static void replay_send(int flags, const void* buf, size_t len, uint16_t client_id) {
+    if (!buf || len == 0) return;  // Flush-only request
+
+    rp.core_sent++;
+    write_record(GBALINK_TRACE_TX, flags, client_id, buf, len);
+
+    if (rp.awaiting_reply) {
+        uint32_t frames = rp.frame - rp.last_rx_frame;
+        rp.reply_count++;
+        rp.reply_frames_total += frames;
+        if (frames > rp.reply_frames_max) rp.reply_frames_max = frames;
+        rp.awaiting_reply = false;
+    }
+
+    // Compare against what the core sent during the capture
+    if (rp.tx_next < rp.tx_count) {
+        const TracePacket* expected = &rp.tx[rp.tx_next];
+        bool same = expected->rec.size == len && expected->rec.client_id == client_id &&
+                    memcmp(expected->data, buf, len) == 0;
+        if (same) {
+            rp.matched++;
+        } else if (rp.first_divergence < 0) {
+            rp.first_divergence = (int64_t)rp.tx_next;
+            fprintf(stderr, "frame %u: core output diverges from trace (packet %zu, captured at frame %u)\n",
+                    rp.frame, rp.tx_next, expected->rec.frame);
+        }
+        rp.tx_next++;
+    }
+}
+
+static void deliver_due(void) {
+    if (rp.delivering || !rp.netpacket.receive) return;
+    rp.delivering = true;
+
+    int delivered = 0;
+    while (rp.rx_next < rp.rx_count && delivered < MAX_PACKETS_PER_POLL &&
+           rp.rx[rp.rx_next].due_frame <= rp.frame) {
+        const TracePacket* pkt = &rp.rx[rp.rx_next++];
+        write_record(GBALINK_TRACE_RX, 0, pkt->rec.client_id, pkt->data, pkt->rec.size);
+        // Latency runs from the oldest delivery the core hasn't answered yet
+        if (!rp.awaiting_reply) {
+            rp.last_rx_frame = rp.frame;
+            rp.awaiting_reply = true;
+        }
+        rp.netpacket.receive(pkt->data, pkt->rec.size, pkt->rec.client_id);
+        delivered++;
+        rp.frame_burst++;
+    }
+
+    rp.delivering = false;
+}
+
+static void replay_poll_receive(void) {
+    deliver_due();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Libretro Frontend Stubs
+//////////////////////////////////////////////////////////////////////////////
+
+static void log_callback(enum retro_log_level level, const char* fmt, ...) {
+    if (!rp.verbose && level < RETRO_LOG_WARN) return;
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+static bool environment_callback(unsigned cmd, void* data) {
+    switch (cmd) {
+    case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+    case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+        *(const char**)data = rp.system_dir;
+        return true;
+    case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+    case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+        if (cmd == RETRO_ENVIRONMENT_GET_CAN_DUPE) *(bool*)data = true;
+        return true;
+    case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+        ((struct retro_log_callback*)data)->log = log_callback;
+        return true;
+    case RETRO_ENVIRONMENT_GET_VARIABLE: {
+        // Only the link mode matters - everything else keeps the core default
+        struct retro_variable* var = data;
+        if (var->key && strcmp(var->key, "gpsp_serial") == 0 && rp.header.link_mode[0]) {
+            var->value = rp.header.link_mode;
+            return true;
+        }
+        var->value = NULL;
+        return false;
+    }
+    case RETRO_ENVIRONMENT_SET_NETPACKET_INTERFACE: {
+        const struct retro_netpacket_callback* cb = data;
+        if (cb) {
+            rp.netpacket = *cb;
+            rp.has_netpacket = true;
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static void video_callback(const void* data, unsigned width, unsigned height, size_t pitch) {
+    (void)data; (void)width; (void)height; (void)pitch;
+}
+
+static void audio_sample_callback(int16_t left, int16_t right) {
+    (void)left; (void)right;
+}
+
+static size_t audio_batch_callback(const int16_t* data, size_t frames) {
+    (void)data;
+    return frames;
+}
+
+static void input_poll_callback(void) {
+}
+
+static int16_t input_state_callback(unsigned port, unsigned device, unsigned index, unsigned id) {
+    (void)port; (void)device; (void)index; (void)id;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Main
+//////////////////////////////////////////////////////////////////////////////
+
+#define LOAD_SYM(name) \
+    name = dlsym(rp.handle, #name); \
+    if (!name) { fprintf(stderr, "core is missing %s\n", #name); return 1; }
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [options] <core.so> <rom> <trace>\n"
+            "  -m original|compressed|jitter  delivery timing (default original)\n"
+            "  -c N     compression factor for -m compressed (default 4)\n"
+            "  -j N     max jitter in frames for -m jitter (default 2)\n"
+            "  -S SEED  random seed for -m jitter\n"
+            "  -t N     frames to run after the last delivery (default 300)\n"
+            "  -d DIR   system/save directory (default .)\n"
+            "  -o FILE  write this run as a trace, for diffing against the input\n"
+            "  -v       show core log output\n", argv0);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = (unsigned)time(NULL);
+    int opt;
+    while ((opt = getopt(argc, argv, "m:c:j:S:t:d:o:v")) != -1) {
+        switch (opt) {
+        case 'm':
+            if (strcmp(optarg, "original") == 0) rp.timing = TIMING_ORIGINAL;
+            else if (strcmp(optarg, "compressed") == 0) rp.timing = TIMING_COMPRESSED;
+            else if (strcmp(optarg, "jitter") == 0) rp.timing = TIMING_JITTER;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'c': rp.compress = (uint32_t)atoi(optarg); break;
+        case 'j': rp.jitter = (uint32_t)atoi(optarg); break;
+        case 'S': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 't': rp.tail_frames = (uint32_t)atoi(optarg); break;
+        case 'd': rp.system_dir = optarg; break;
+        case 'o': rp.out_path = optarg; break;
+        case 'v': rp.verbose = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (argc - optind != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (rp.compress == 0) rp.compress = 1;
+
+    const char* core_path = argv[optind];
+    const char* rom_path = argv[optind + 1];
+    const char* trace_path = argv[optind + 2];
+
+    if (!load_trace(trace_path)) return 1;
+    srand(seed);
+    schedule_deliveries();
+    printf("trace: client %u, link mode \"%s\", %zu rx / %zu tx packets\n",
+           rp.header.local_client_id, rp.header.link_mode, rp.rx_count, rp.tx_count);
+
+    rp.handle = dlopen(core_path, RTLD_LAZY | RTLD_LOCAL);
+    if (!rp.handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        return 1;
+    }
+
+    void (*retro_set_environment)(retro_environment_t);
+    void (*retro_set_video_refresh)(retro_video_refresh_t);
+    void (*retro_set_audio_sample)(retro_audio_sample_t);
+    void (*retro_set_audio_sample_batch)(retro_audio_sample_batch_t);
+    void (*retro_set_input_poll)(retro_input_poll_t);
+    void (*retro_set_input_state)(retro_input_state_t);
+    void (*retro_init)(void);
+    void (*retro_deinit)(void);
+    bool (*retro_load_game)(const struct retro_game_info*);
+    void (*retro_unload_game)(void);
+    void (*retro_get_system_av_info)(struct retro_system_av_info*);
+    void (*retro_run)(void);
+    LOAD_SYM(retro_set_environment);
+    LOAD_SYM(retro_set_video_refresh);
+    LOAD_SYM(retro_set_audio_sample);
+    LOAD_SYM(retro_set_audio_sample_batch);
+    LOAD_SYM(retro_set_input_poll);
+    LOAD_SYM(retro_set_input_state);
+    LOAD_SYM(retro_init);
+    LOAD_SYM(retro_deinit);
+    LOAD_SYM(retro_load_game);
+    LOAD_SYM(retro_unload_game);
+    LOAD_SYM(retro_get_system_av_info);
+    LOAD_SYM(retro_run);
+
+    retro_set_environment(environment_callback);
+    retro_set_video_refresh(video_callback);
+    retro_set_audio_sample(audio_sample_callback);
+    retro_set_audio_sample_batch(audio_batch_callback);
+    retro_set_input_poll(input_poll_callback);
+    retro_set_input_state(input_state_callback);
+    retro_init();
+
+    if (!rp.has_netpacket) {
+        fprintf(stderr, "core does not implement the netpacket interface\n");
+        return 1;
+    }
+
+    FILE* rom = fopen(rom_path, "rb");
+    if (!rom) {
+        fprintf(stderr, "cannot open rom %s\n", rom_path);
+        return 1;
+    }
+    fseek(rom, 0, SEEK_END);
+    long rom_size = ftell(rom);
+    fseek(rom, 0, SEEK_SET);
+    void* rom_data = malloc(rom_size);
+    if (!rom_data || fread(rom_data, 1, rom_size, rom) != (size_t)rom_size) {
+        fprintf(stderr, "cannot read rom %s\n", rom_path);
+        fclose(rom);
+        return 1;
+    }
+    fclose(rom);
+
+    struct retro_game_info game = { .path = rom_path, .data = rom_data, .size = (size_t)rom_size };
+    if (!retro_load_game(&game)) {
+        fprintf(stderr, "core failed to load %s\n", rom_path);
+        return 1;
+    }
+
+    struct retro_system_av_info av_info = {0};
+    retro_get_system_av_info(&av_info);
+    double fps = av_info.timing.fps > 0 ? av_info.timing.fps : 60.0;
+
+    if (rp.out_path) {
+        rp.out_file = fopen(rp.out_path, "wb");
+        if (rp.out_file) fwrite(&rp.header, sizeof(rp.header), 1, rp.out_file);
+    }
+
+    // Same session order as gbalink.c: start, then announce the remote peers
+    if (rp.netpacket.start) {
+        rp.netpacket.start(rp.header.local_client_id, replay_send, replay_poll_receive);
+    }
+    if (rp.netpacket.connected) {
+        bool seen[GBALINK_TRACE_MAX_CLIENT_ID + 1] = {0};
+        if (rp.header.local_client_id != 0) seen[0] = true;  // Clients only talk to the host
+        for (size_t i = 0; i < rp.rx_count; i++) {
+            uint16_t id = rp.rx[i].rec.client_id;
+            if (id <= GBALINK_TRACE_MAX_CLIENT_ID && id != rp.header.local_client_id) seen[id] = true;
+        }
+        for (uint16_t id = 0; id <= GBALINK_TRACE_MAX_CLIENT_ID; id++) {
+            if (seen[id]) rp.netpacket.connected(id);
+        }
+    }
+
+    uint32_t last_due = rp.rx_count ? rp.rx[rp.rx_count - 1].due_frame : 0;
+    uint32_t end_frame = last_due + rp.tail_frames;
+    long frame_ns = (long)(1000000000.0 / fps);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (rp.frame = 0; rp.frame <= end_frame || rp.rx_next < rp.rx_count; rp.frame++) {
+        rp.frame_burst = 0;
+        deliver_due();
+        retro_run();
+        if (rp.netpacket.poll) rp.netpacket.poll();
+        if (rp.frame_burst > rp.max_burst) rp.max_burst = rp.frame_burst;
+
+        if (rp.timing == TIMING_ORIGINAL) {
+            next.tv_nsec += frame_ns;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        }
+    }
+
+    if (rp.netpacket.stop) rp.netpacket.stop();
+    if (rp.out_file) fclose(rp.out_file);
+
+    printf("frames run:        %u\n", rp.frame);
+    printf("rx delivered:      %zu / %zu\n", rp.rx_next, rp.rx_count);
+    printf("max rx burst:      %u packets in one frame\n", rp.max_burst);
+    printf("core sent:         %u (trace had %zu)\n", rp.core_sent, rp.tx_count);
+    printf("matching trace:    %u\n", rp.matched);
+    if (rp.first_divergence >= 0) {
+        printf("first divergence:  packet %lld\n", (long long)rp.first_divergence);
+    }
+    if (rp.reply_count > 0) {
+        printf("reply latency:     avg %.2f / max %u frames\n",
+               (double)rp.reply_frames_total / rp.reply_count, rp.reply_frames_max);
+    }
+
+    retro_unload_game();
+    retro_deinit();
+    dlclose(rp.handle);
+    free(rom_data);
+    return rp.first_divergence >= 0 ? 2 : 0;
+}
@@ -0,0 +1,902 @@
+/*
+ * NextUI Link Harness
+ * Loads two independent instances of a libretro core into one process and
+ * wires their netpacket interfaces (GBA Link, and GB Link on the patched
+ * gambatte) to each other through in-memory queues, so link sessions can be
+ * regression tested and benchmarked without two devices or a network.
+ *
+ * Each instance gets its own link namespace (dlmopen), the same entry points
+ * Core_open resolves and the same session order as gbalink.c: start, then
+ * connected() for the peer. Both run headless in lockstep with scripted
+ * inputs; packets are delivered at frame start and from poll_receive, with an
+ * optional fixed latency in frames. Zero latency is the baseline to compare
+ * the network path against.
+ *
+ * Reported per direction: packets and bytes, per-frame peaks, queue backlog
+ * and frames the core's RFU queue was full (the link's throughput limit).
+ * Each side can be written as a GBA Link trace (see netplay/gbalink_trace.h),
+ * which is deterministic and can be diffed or fed to gbalink_replay.
+ *
+ * With -S the harness needs no ROM: both instances of the patched gambatte
+ * boot a small built-in test ROM and exchange bytes over the serial port,
+ * host clocking and client answering, and the run passes only if every byte
+ * on both sides is the one a real cable would have delivered.
+ *
+ * usage: link_harness [options] <core.so> <rom> [client rom]
+ *        link_harness -S [options] <gambatte core.so>
+ */
+
+#define _GNU_SOURCE  // dlmopen
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include "libretro-common/include/libretro.h"
+#include "gbalink_trace.h"
+
+// Same per-call delivery cap as gbalink.c (GBALINK_MAX_PACKETS_PER_FRAME)
+#define MAX_PACKETS_PER_POLL 64
+#define MAX_OPTIONS 32
+#define HOST 0
+#define CLIENT 1
+
+typedef struct Packet {
+    struct Packet* next;
+    uint32_t due_frame;
+    uint16_t size;
+    uint8_t data[];
+} Packet;
+
+typedef struct {
+    int frame;
+    uint32_t buttons;
+} ScriptEvent;
+
+typedef struct {
+    const char* name;          // "host" / "client"
+    uint16_t client_id;        // Netpacket ID: host 0, client 1
+    const char* rom_path;
+    const char* sram_path;
+    const char* input_path;
+
+    // Core (the set of entry points Core_open resolves that a link run needs)
+    void* handle;
+    void (*init)(void);
+    void (*deinit)(void);
+    void (*get_system_info)(struct retro_system_info* info);
+    void (*get_system_av_info)(struct retro_system_av_info* info);
+    void (*run)(void);
+    size_t (*serialize_size)(void);
+    bool (*serialize)(void* data, size_t size);
+    bool (*load_game)(const struct retro_game_info* game);
+    void (*unload_game)(void);
+    void* (*get_memory_data)(unsigned id);
+    size_t (*get_memory_size)(unsigned id);
+    unsigned (*queue_free)(void);  // gpSP's RFU queue probe, like GBALink_setCoreQueueProbe
+    bool (*waiting)(void);         // gambatte's serial reply probe, like GBALink_setCoreReplyProbe
+    struct retro_netpacket_callback netpacket;
+    bool has_netpacket;
+    bool initialized;
+    bool loaded;
+    void* rom_data;
+
+    // Scripted input
+    ScriptEvent* script;
+    int script_count;
+    int script_next;
+    uint32_t buttons;
+
+    // Packets waiting for this instance
+    Packet* head;
+    Packet* tail;
+    uint32_t queued;
+    bool delivering;
+
+    FILE* trace;
+
+    // Stats for packets this instance received
+    uint64_t packets;
+    uint64_t bytes;
+    uint32_t frame_packets;
+    uint32_t frame_bytes;
+    uint32_t max_frame_packets;
+    uint32_t max_frame_bytes;
+    uint32_t max_queued;
+    uint32_t queue_full_frames;
+    bool queue_full;
+    uint32_t held_frames;      // Frames held for the core's reply
+} Instance;
+
+static struct {
+    // Options
+    uint32_t frames;
+    uint32_t latency;          // Frames between a send and its delivery
+    bool paced;
+    bool verbose;
+    bool serial_test;
+    const char* system_dir;
+    const char* trace_prefix;
+    const char* option_keys[MAX_OPTIONS];
+    const char* option_values[MAX_OPTIONS];
+    int option_count;
+
+    Instance inst[2];
+    Instance* current;         // Instance whose code is running (callbacks have no context)
+    uint32_t frame;
+} lh = {
+    .frames = 3600,
+    .system_dir = ".",
+    .inst = {
+        { .name = "host", .client_id = 0 },
+        { .name = "client", .client_id = 1 },
+    },
+};
+
+static Instance* peer_of(Instance* inst) {
+    return inst == &lh.inst[HOST] ? &lh.inst[CLIENT] : &lh.inst[HOST];
+}
+
+static const char* option_value(const char* key) {
+    for (int i = 0; i < lh.option_count; i++) {
+        if (strcmp(lh.option_keys[i], key) == 0) return lh.option_values[i];
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Input Scripts
+//////////////////////////////////////////////////////////////////////////////
+
+static const char* button_names[] = {
+    [RETRO_DEVICE_ID_JOYPAD_B] = "B",
+    [RETRO_DEVICE_ID_JOYPAD_Y] = "Y",
+    [RETRO_DEVICE_ID_JOYPAD_SELECT] = "SELECT",
+    [RETRO_DEVICE_ID_JOYPAD_START] = "START",
+    [RETRO_DEVICE_ID_JOYPAD_UP] = "UP",
+    [RETRO_DEVICE_ID_JOYPAD_DOWN] = "DOWN",
+    [RETRO_DEVICE_ID_JOYPAD_LEFT] = "LEFT",
+    [RETRO_DEVICE_ID_JOYPAD_RIGHT] = "RIGHT",
+    [RETRO_DEVICE_ID_JOYPAD_A] = "A",
+    [RETRO_DEVICE_ID_JOYPAD_X] = "X",
+    [RETRO_DEVICE_ID_JOYPAD_L] = "L",
+    [RETRO_DEVICE_ID_JOYPAD_R] = "R",
+    [RETRO_DEVICE_ID_JOYPAD_L2] = "L2",
+    [RETRO_DEVICE_ID_JOYPAD_R2] = "R2",
+    [RETRO_DEVICE_ID_JOYPAD_L3] = "L3",
+    [RETRO_DEVICE_ID_JOYPAD_R3] = "R3",
+};
+
+// "A+RIGHT", "0x0101" or "-" (nothing held) - same format as the headless minarch
+static bool parse_buttons(char* spec, uint32_t* out) {
+    if (strcmp(spec, "-") == 0) {
+        *out = 0;
+        return true;
+    }
+    if (spec[0] == '0' && (spec[1] == 'x' || spec[1] == 'X')) {
+        char* end;
+        *out = (uint32_t)strtoul(spec, &end, 16);
+        return *end == '\0';
+    }
+
+    uint32_t mask = 0;
+    for (char* name = strtok(spec, "+"); name; name = strtok(NULL, "+")) {
+        int id = -1;
+        for (int i = 0; i < (int)(sizeof(button_names) / sizeof(button_names[0])); i++) {
+            if (button_names[i] && strcasecmp(name, button_names[i]) == 0) {
+                id = i;
+                break;
+            }
+        }
+        if (id < 0) return false;
+        mask |= 1u << id;
+    }
+    *out = mask;
+    return true;
+}
+
+// One "<frame> <buttons>" per line, held until the next line; # starts a comment
+static bool load_script(Instance* inst) {
+    FILE* file = fopen(inst->input_path, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open input script %s\n", inst->input_path);
+        return false;
+    }
+
+    int cap = 0;
+    int last_frame = -1;
+    int line_number = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        int frame;
+        char spec[128];
+        int fields = sscanf(line, "%d %127s", &frame, spec);
+        if (fields <= 0) continue;
+
+        uint32_t mask;
+        if (fields != 2 || frame <= last_frame || !parse_buttons(spec, &mask)) {
+            fprintf(stderr, "%s:%d: expected \"<frame> <buttons>\" in frame order\n", inst->input_path, line_number);
+            fclose(file);
+            return false;
+        }
+        last_frame = frame;
+
+        if (inst->script_count == cap) {
+            cap = cap ? cap * 2 : 64;
+            inst->script = realloc(inst->script, cap * sizeof(ScriptEvent));
+            if (!inst->script) {
+                fclose(file);
+                return false;
+            }
+        }
+        inst->script[inst->script_count++] = (ScriptEvent){ frame, mask };
+    }
+    fclose(file);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Netpacket Bridge
+//////////////////////////////////////////////////////////////////////////////
+
+static void write_record(Instance* inst, uint8_t dir, int flags, uint16_t client_id, const void* buf, size_t len) {
+    if (!inst->trace) return;
+
+    GBALinkTraceRecord rec = {
+        .frame = lh.frame,
+        .time_ms = 0,  // No wall clock in a lockstep run, keeps traces diffable
+        .client_id = client_id,
+        .dir = dir,
+        .flags = (uint8_t)flags,
+        .size = (uint16_t)len
+    };
+    fwrite(&rec, sizeof(rec), 1, inst->trace);
+    fwrite(buf, 1, len, inst->trace);
+}
+
+static void deliver_due(Instance* inst) {
+    if (inst->delivering || !inst->netpacket.receive) return;
+    inst->delivering = true;
+
+    int delivered = 0;
+    while (inst->head && inst->head->due_frame <= lh.frame && delivered < MAX_PACKETS_PER_POLL) {
+        // Core queue full: hold the packet like gbalink.c does until the game reads
+        if (inst->queue_free && inst->queue_free() == 0) {
+            inst->queue_full = true;
+            break;
+        }
+
+        Packet* pkt = inst->head;
+        inst->head = pkt->next;
+        if (!inst->head) inst->tail = NULL;
+        inst->queued--;
+
+        uint16_t source_id = peer_of(inst)->client_id;
+        write_record(inst, GBALINK_TRACE_RX, 0, source_id, pkt->data, pkt->size);
+        inst->packets++;
+        inst->bytes += pkt->size;
+        inst->frame_packets++;
+        inst->frame_bytes += pkt->size;
+        inst->netpacket.receive(pkt->data, pkt->size, source_id);
+        free(pkt);
+        delivered++;
+    }
+
+    inst->delivering = false;
+}
+
+static void bridge_send(int flags, const void* buf, size_t len, uint16_t client_id) {
+    if (!buf || len == 0) return;  // Flush-only request
+    if (len > UINT16_MAX) {
+        fprintf(stderr, "frame %u: %s sent an oversized packet (%zu bytes), dropped\n", lh.frame, lh.current->name, len);
+        return;
+    }
+
+    Instance* from = lh.current;
+    Instance* to = peer_of(from);
+    write_record(from, GBALINK_TRACE_TX, flags, client_id, buf, len);
+    if (client_id != to->client_id && client_id != RETRO_NETPACKET_BROADCAST) return;
+
+    Packet* pkt = malloc(sizeof(Packet) + len);
+    if (!pkt) return;
+    pkt->next = NULL;
+    pkt->due_frame = lh.frame + lh.latency;
+    pkt->size = (uint16_t)len;
+    memcpy(pkt->data, buf, len);
+
+    if (to->tail) to->tail->next = pkt;
+    else to->head = pkt;
+    to->tail = pkt;
+    to->queued++;
+    if (to->queued > to->max_queued) to->max_queued = to->queued;
+}
+
+// The core is waiting on a reply: hand over whatever is due now
+static void bridge_poll_receive(void) {
+    deliver_due(lh.current);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Libretro Frontend Stubs
+//////////////////////////////////////////////////////////////////////////////
+
+static void log_callback(enum retro_log_level level, const char* fmt, ...) {
+    if (!lh.verbose && level < RETRO_LOG_WARN) return;
+    fprintf(stderr, "[%s] ", lh.current ? lh.current->name : "?");
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+static bool environment_callback(unsigned cmd, void* data) {
+    Instance* inst = lh.current;
+    switch (cmd) {
+    case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+    case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+        *(const char**)data = lh.system_dir;
+        return true;
+    case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+    case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+        if (cmd == RETRO_ENVIRONMENT_GET_CAN_DUPE) *(bool*)data = true;
+        return true;
+    case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS:
+        return true;
+    case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+        ((struct retro_log_callback*)data)->log = log_callback;
+        return true;
+    case RETRO_ENVIRONMENT_GET_VARIABLE: {
+        // Options given with -o, everything else keeps the core default
+        struct retro_variable* var = data;
+        var->value = var->key ? option_value(var->key) : NULL;
+        return var->value != NULL;
+    }
+    case RETRO_ENVIRONMENT_SET_NETPACKET_INTERFACE: {
+        const struct retro_netpacket_callback* cb = data;
+        if (cb) {
+            inst->netpacket = *cb;
+            inst->has_netpacket = true;
+            inst->queue_free = (unsigned (*)(void))dlsym(inst->handle, "retro_gpsp_rfu_queue_free");
+            inst->waiting = (bool (*)(void))dlsym(inst->handle, "retro_gambatte_serial_waiting");
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static void video_callback(const void* data, unsigned width, unsigned height, size_t pitch) {
+    (void)data; (void)width; (void)height; (void)pitch;
+}
+
+static void audio_sample_callback(int16_t left, int16_t right) {
+    (void)left; (void)right;
+}
+
+static size_t audio_batch_callback(const int16_t* data, size_t frames) {
+    (void)data;
+    return frames;
+}
+
+static void input_poll_callback(void) {
+    Instance* inst = lh.current;
+    while (inst->script_next < inst->script_count &&
+           inst->script[inst->script_next].frame <= (int)lh.frame) {
+        inst->buttons = inst->script[inst->script_next++].buttons;
+    }
+}
+
+static int16_t input_state_callback(unsigned port, unsigned device, unsigned index, unsigned id) {
+    (void)index;
+    if (port != 0 || device != RETRO_DEVICE_JOYPAD) return 0;
+    if (id == RETRO_DEVICE_ID_JOYPAD_MASK) return (int16_t)lh.current->buttons;
+    return (lh.current->buttons >> id) & 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// GB Serial Test (-S)
+//////////////////////////////////////////////////////////////////////////////
+
+// Both sides run the same ROM. Holding A at boot makes it the master (host):
+// after a second to let the slave arm, it clocks out 1, 2, ... 64, one per
+// frame. The slave answers the first with 0xA0 and each later one with the
+// complement of the byte it took before. Each side logs the bytes it shifted
+// in to cart RAM (MBC1 + RAM): role, transfers done, then the log.
+#define SERIAL_TEST_ROLE  0x00
+#define SERIAL_TEST_DONE  0x01
+#define SERIAL_TEST_LOG   0x10
+#define SERIAL_TEST_BYTES 64
+
+static const uint8_t serial_test_code[] = {
+    0xF3,                       // 0150 start: di
+    0x31, 0xFF, 0xDF,           // 0151 ld sp, $DFFF
+    0x3E, 0x0A,                 // 0154 ld a, $0A
+    0xEA, 0x00, 0x00,           // 0156 ld [$0000], a
+    0xAF,                       // 0159 xor a
+    0xE0, 0xFF,                 // 015A ldh [rIE], a
+    0xE0, 0x0F,                 // 015C ldh [rIF], a
+    0x21, 0x10, 0xA0,           // 015E ld hl, $A010
+    0x3E, 0x10,                 // 0161 ld a, $10
+    0xE0, 0x00,                 // 0163 ldh [rP1], a
+    0xF0, 0x00,                 // 0165 ldh a, [rP1]
+    0xF0, 0x00,                 // 0167 ldh a, [rP1]
+    0xCB, 0x47,                 // 0169 bit 0, a
+    0x28, 0x23,                 // 016B jr z, master
+    0x3E, 0x53,                 // 016D slave: ld a, 'S'
+    0xEA, 0x00, 0xA0,           // 016F ld [$A000], a
+    0x3E, 0xA0,                 // 0172 ld a, $A0
+    0xE0, 0x01,                 // 0174 ldh [rSB], a
+    0x06, 0x40,                 // 0176 ld b, 64
+    0x3E, 0x80,                 // 0178 s_loop: ld a, $80
+    0xE0, 0x02,                 // 017A ldh [rSC], a
+    0xF0, 0x0F,                 // 017C s_wait: ldh a, [rIF]
+    0xCB, 0x5F,                 // 017E bit 3, a
+    0x28, 0xFA,                 // 0180 jr z, s_wait
+    0xAF,                       // 0182 xor a
+    0xE0, 0x0F,                 // 0183 ldh [rIF], a
+    0xF0, 0x01,                 // 0185 ldh a, [rSB]
+    0x22,                       // 0187 ld [hl+], a
+    0x2F,                       // 0188 cpl
+    0xE0, 0x01,                 // 0189 ldh [rSB], a
+    0x05,                       // 018B dec b
+    0x20, 0xEA,                 // 018C jr nz, s_loop
+    0x18, 0x2A,                 // 018E jr done
+    0x3E, 0x4D,                 // 0190 master: ld a, 'M'
+    0xEA, 0x00, 0xA0,           // 0192 ld [$A000], a
+    0x06, 0x3C,                 // 0195 ld b, 60
+    0xCD, 0xC2, 0x01,           // 0197 m_settle: call vblank
+    0x05,                       // 019A dec b
+    0x20, 0xFA,                 // 019B jr nz, m_settle
+    0x01, 0x01, 0x40,           // 019D ld bc, $4001
+    0xCD, 0xC2, 0x01,           // 01A0 m_loop: call vblank
+    0x79,                       // 01A3 ld a, c
+    0xE0, 0x01,                 // 01A4 ldh [rSB], a
+    0x3E, 0x81,                 // 01A6 ld a, $81
+    0xE0, 0x02,                 // 01A8 ldh [rSC], a
+    0xF0, 0x0F,                 // 01AA m_wait: ldh a, [rIF]
+    0xCB, 0x5F,                 // 01AC bit 3, a
+    0x28, 0xFA,                 // 01AE jr z, m_wait
+    0xAF,                       // 01B0 xor a
+    0xE0, 0x0F,                 // 01B1 ldh [rIF], a
+    0xF0, 0x01,                 // 01B3 ldh a, [rSB]
+    0x22,                       // 01B5 ld [hl+], a
+    0x0C,                       // 01B6 inc c
+    0x05,                       // 01B7 dec b
+    0x20, 0xE6,                 // 01B8 jr nz, m_loop
+    0x7D,                       // 01BA done: ld a, l
+    0xD6, 0x10,                 // 01BB sub $10
+    0xEA, 0x01, 0xA0,           // 01BD ld [$A001], a
+    0x18, 0xFE,                 // 01C0 halt: jr halt
+    0xF0, 0x44,                 // 01C2 vblank: ldh a, [rLY]
+    0xFE, 0x90,                 // 01C4 cp 144
+    0x28, 0xFA,                 // 01C6 jr z, vblank
+    0xF0, 0x44,                 // 01C8 vb_in: ldh a, [rLY]
+    0xFE, 0x90,                 // 01CA cp 144
+    0x20, 0xFA,                 // 01CC jr nz, vb_in
+    0xC9,                       // 01CE ret
+};
+
+static const uint8_t nintendo_logo[] = {
+    0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+    0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+    0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
+};
+
+static void* serial_test_rom(size_t* size) {
+    uint8_t* rom = calloc(1, 0x8000);
+    if (!rom) return NULL;
+
+    static const uint8_t entry[] = { 0x00, 0xC3, 0x50, 0x01 };  // nop; jp $0150
+    memcpy(rom + 0x100, entry, sizeof(entry));
+    memcpy(rom + 0x104, nintendo_logo, sizeof(nintendo_logo));
+    memcpy(rom + 0x134, "LINKTEST", 8);
+    rom[0x147] = 0x03;  // MBC1 + RAM + battery
+    rom[0x148] = 0x00;  // 32 KB
+    rom[0x149] = 0x02;  // 8 KB RAM
+    uint8_t check = 0;
+    for (int i = 0x134; i <= 0x14C; i++) check = check - rom[i] - 1;
+    rom[0x14D] = check;
+    memcpy(rom + 0x150, serial_test_code, sizeof(serial_test_code));
+
+    *size = 0x8000;
+    return rom;
+}
+
+static const uint8_t* serial_test_log(Instance* inst) {
+    lh.current = inst;
+    uint8_t* ram = inst->get_memory_data ? inst->get_memory_data(RETRO_MEMORY_SAVE_RAM) : NULL;
+    size_t size = inst->get_memory_size ? inst->get_memory_size(RETRO_MEMORY_SAVE_RAM) : 0;
+    return ram && size >= SERIAL_TEST_LOG + SERIAL_TEST_BYTES ? ram : NULL;
+}
+
+static bool serial_test_done(void) {
+    for (int i = 0; i < 2; i++) {
+        const uint8_t* log = serial_test_log(&lh.inst[i]);
+        if (!log || log[SERIAL_TEST_DONE] != SERIAL_TEST_BYTES) return false;
+    }
+    return true;
+}
+
+// Compare both logs with what a cable delivers, returns the mismatch count
+static int serial_test_check(void) {
+    int bad = 0;
+    for (int i = 0; i < 2; i++) {
+        Instance* inst = &lh.inst[i];
+        const uint8_t* log = serial_test_log(inst);
+        uint8_t role = i == HOST ? 'M' : 'S';
+        if (!log) {
+            printf("%-6s no cart RAM, is this gambatte?\n", inst->name);
+            return SERIAL_TEST_BYTES * 2;
+        }
+        if (log[SERIAL_TEST_ROLE] != role) {
+            printf("%-6s ran as %02x, expected '%c'\n", inst->name, log[SERIAL_TEST_ROLE], role);
+            return SERIAL_TEST_BYTES * 2;
+        }
+        if (log[SERIAL_TEST_DONE] != SERIAL_TEST_BYTES) {
+            printf("%-6s did not finish its %d transfers\n", inst->name, SERIAL_TEST_BYTES);
+            bad++;
+        }
+        for (int n = 0; n < SERIAL_TEST_BYTES; n++) {
+            uint8_t want = i == CLIENT ? (uint8_t)(n + 1) : n == 0 ? 0xA0 : (uint8_t)~n;
+            uint8_t got = log[SERIAL_TEST_LOG + n];
+            if (got == want) continue;
+            if (bad < 8) printf("%-6s byte %2d: %02x, expected %02x\n", inst->name, n, got, want);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Instances
+//////////////////////////////////////////////////////////////////////////////
+
+#define LOAD_SYM(field, name) \
+    inst->field = dlsym(inst->handle, #name); \
+    if (!inst->field) { fprintf(stderr, "core is missing %s\n", #name); return false; }
+
+static uint64_t state_hash(const uint8_t* p, size_t len) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static void* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void* data = len > 0 ? malloc(len) : NULL;
+    if (data && fread(data, 1, len, file) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)len : 0;
+    return data;
+}
+
+static bool open_instance(Instance* inst, const char* core_path) {
+    // A fresh link namespace gives this instance its own copy of the core's
+    // globals (a second plain dlopen of the same path would share them)
+    inst->handle = dlmopen(LM_ID_NEWLM, core_path, RTLD_NOW | RTLD_LOCAL);
+    if (!inst->handle) {
+        fprintf(stderr, "%s: %s\n", inst->name, dlerror());
+        return false;
+    }
+
+    void (*retro_set_environment)(retro_environment_t);
+    void (*retro_set_video_refresh)(retro_video_refresh_t);
+    void (*retro_set_audio_sample)(retro_audio_sample_t);
+    void (*retro_set_audio_sample_batch)(retro_audio_sample_batch_t);
+    void (*retro_set_input_poll)(retro_input_poll_t);
+    void (*retro_set_input_state)(retro_input_state_t);
+    retro_set_environment = dlsym(inst->handle, "retro_set_environment");
+    retro_set_video_refresh = dlsym(inst->handle, "retro_set_video_refresh");
+    retro_set_audio_sample = dlsym(inst->handle, "retro_set_audio_sample");
+    retro_set_audio_sample_batch = dlsym(inst->handle, "retro_set_audio_sample_batch");
+    retro_set_input_poll = dlsym(inst->handle, "retro_set_input_poll");
+    retro_set_input_state = dlsym(inst->handle, "retro_set_input_state");
+    if (!retro_set_environment || !retro_set_video_refresh || !retro_set_audio_sample ||
+        !retro_set_audio_sample_batch || !retro_set_input_poll || !retro_set_input_state) {
+        fprintf(stderr, "%s is not a libretro core\n", core_path);
+        return false;
+    }
+    LOAD_SYM(init, retro_init);
+    LOAD_SYM(deinit, retro_deinit);
+    LOAD_SYM(get_system_info, retro_get_system_info);
+    LOAD_SYM(get_system_av_info, retro_get_system_av_info);
+    LOAD_SYM(run, retro_run);
+    LOAD_SYM(load_game, retro_load_game);
+    LOAD_SYM(unload_game, retro_unload_game);
+    inst->serialize_size = dlsym(inst->handle, "retro_serialize_size");
+    inst->serialize = dlsym(inst->handle, "retro_serialize");
+    inst->get_memory_data = dlsym(inst->handle, "retro_get_memory_data");
+    inst->get_memory_size = dlsym(inst->handle, "retro_get_memory_size");
+
+    lh.current = inst;
+    retro_set_environment(environment_callback);
+    retro_set_video_refresh(video_callback);
+    retro_set_audio_sample(audio_sample_callback);
+    retro_set_audio_sample_batch(audio_batch_callback);
+    retro_set_input_poll(input_poll_callback);
+    retro_set_input_state(input_state_callback);
+    inst->init();
+    inst->initialized = true;
+
+    struct retro_system_info info = {0};
+    inst->get_system_info(&info);
+
+    size_t rom_size = 0;
+    if (lh.serial_test && info.need_fullpath) {
+        fprintf(stderr, "-S needs a core that loads the ROM from memory (gambatte)\n");
+        return false;
+    }
+    if (!info.need_fullpath) {
+        inst->rom_data = lh.serial_test ? serial_test_rom(&rom_size) : read_file(inst->rom_path, &rom_size);
+        if (!inst->rom_data) {
+            fprintf(stderr, "cannot read rom %s\n", inst->rom_path);
+            return false;
+        }
+    }
+    struct retro_game_info game = { .path = inst->rom_path, .data = inst->rom_data, .size = rom_size };
+    if (!inst->load_game(&game)) {
+        fprintf(stderr, "%s: core failed to load %s\n", inst->name, inst->rom_path);
+        return false;
+    }
+    inst->loaded = true;
+
+    // Save data goes straight into the core's SRAM, like SRAM_read
+    if (inst->sram_path) {
+        size_t sram_size = 0;
+        void* sram = read_file(inst->sram_path, &sram_size);
+        void* dst = inst->get_memory_data ? inst->get_memory_data(RETRO_MEMORY_SAVE_RAM) : NULL;
+        size_t dst_size = inst->get_memory_size ? inst->get_memory_size(RETRO_MEMORY_SAVE_RAM) : 0;
+        if (!sram || !dst) {
+            fprintf(stderr, "%s: cannot load save %s\n", inst->name, inst->sram_path);
+        } else {
+            memcpy(dst, sram, sram_size < dst_size ? sram_size : dst_size);
+        }
+        free(sram);
+    }
+
+    if (!inst->has_netpacket) {
+        fprintf(stderr, "%s: core does not implement the netpacket interface\n", inst->name);
+        return false;
+    }
+
+    if (lh.trace_prefix) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s.%s.trace", lh.trace_prefix, inst->name);
+        inst->trace = fopen(path, "wb");
+        if (!inst->trace) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return false;
+        }
+        GBALinkTraceHeader header = {
+            .magic = GBALINK_TRACE_MAGIC,
+            .version = GBALINK_TRACE_VERSION,
+            .local_client_id = inst->client_id,
+        };
+        const char* link_mode = option_value("gpsp_serial");
+        if (link_mode) snprintf(header.link_mode, sizeof(header.link_mode), "%s", link_mode);
+        fwrite(&header, sizeof(header), 1, inst->trace);
+    }
+    return true;
+}
+
+static void close_instance(Instance* inst) {
+    if (!inst->handle) return;
+    lh.current = inst;
+    if (inst->loaded) inst->unload_game();
+    if (inst->initialized) inst->deinit();
+    dlclose(inst->handle);
+    while (inst->head) {
+        Packet* next = inst->head->next;
+        free(inst->head);
+        inst->head = next;
+    }
+    if (inst->trace) fclose(inst->trace);
+    free(inst->rom_data);
+    free(inst->script);
+}
+
+static void run_frame(Instance* inst) {
+    lh.current = inst;
+    inst->frame_packets = 0;
+    inst->frame_bytes = 0;
+    inst->queue_full = false;
+
+    deliver_due(inst);
+    // The core clocked a transfer and waits on the peer's reply: hold the
+    // frame like gbalink.c does (the poll still runs, the frame still ends)
+    if (inst->waiting && inst->waiting()) {
+        inst->held_frames++;
+    } else {
+        inst->run();
+    }
+    if (inst->netpacket.poll) inst->netpacket.poll();
+
+    if (inst->frame_packets > inst->max_frame_packets) inst->max_frame_packets = inst->frame_packets;
+    if (inst->frame_bytes > inst->max_frame_bytes) inst->max_frame_bytes = inst->frame_bytes;
+    if (inst->queue_full) inst->queue_full_frames++;
+}
+
+static void print_stats(Instance* to) {
+    Instance* from = peer_of(to);
+    printf("%s -> %s:\n", from->name, to->name);
+    printf("  delivered:       %llu packets, %llu bytes (%.1f bytes/frame)\n",
+           (unsigned long long)to->packets, (unsigned long long)to->bytes,
+           lh.frame ? (double)to->bytes / lh.frame : 0.0);
+    printf("  per-frame peak:  %u packets, %u bytes\n", to->max_frame_packets, to->max_frame_bytes);
+    printf("  queue backlog:   max %u, %u left at the end\n", to->max_queued, to->queued);
+    if (to->queue_free) printf("  core queue full: %u frames\n", to->queue_full_frames);
+    if (to->waiting) printf("  held for reply:  %u frames\n", to->held_frames);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Main
+//////////////////////////////////////////////////////////////////////////////
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [options] <core.so> <rom> [client rom]\n"
+            "       %s -S [options] <gambatte core.so>\n"
+            "  -n N        frames to run (default 3600)\n"
+            "  -l N        link latency in frames (default 0)\n"
+            "  -o KEY=VAL  core option for both instances, eg. gpsp_serial=rfu (repeatable)\n"
+            "  -1 FILE     host input script, \"<frame> <buttons>\" per line\n"
+            "  -2 FILE     client input script\n"
+            "  -a FILE     host save (SRAM) to load\n"
+            "  -b FILE     client save (SRAM) to load\n"
+            "  -T PREFIX   write PREFIX.host.trace and PREFIX.client.trace\n"
+            "  -d DIR      system/save directory (default .)\n"
+            "  -p          pace to the core's fps (default: as fast as possible)\n"
+            "  -S          GB serial test: run the built-in ROM, check every byte exchanged\n"
+            "  -v          show core log output\n", argv0, argv0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:o:1:2:a:b:T:d:pSv")) != -1) {
+        switch (opt) {
+        case 'n': lh.frames = (uint32_t)atoi(optarg); break;
+        case 'l': lh.latency = (uint32_t)atoi(optarg); break;
+        case 'o': {
+            char* eq = strchr(optarg, '=');
+            if (!eq || lh.option_count == MAX_OPTIONS) { usage(argv[0]); return 1; }
+            *eq = '\0';
+            lh.option_keys[lh.option_count] = optarg;
+            lh.option_values[lh.option_count++] = eq + 1;
+            break;
+        }
+        case '1': lh.inst[HOST].input_path = optarg; break;
+        case '2': lh.inst[CLIENT].input_path = optarg; break;
+        case 'a': lh.inst[HOST].sram_path = optarg; break;
+        case 'b': lh.inst[CLIENT].sram_path = optarg; break;
+        case 'T': lh.trace_prefix = optarg; break;
+        case 'd': lh.system_dir = optarg; break;
+        case 'p': lh.paced = true; break;
+        case 'S': lh.serial_test = true; break;
+        case 'v': lh.verbose = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    int roms = lh.serial_test ? 0 : 1;
+    if (argc - optind < 1 + roms || argc - optind > 1 + roms * 2 || lh.frames == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char* core_path = argv[optind];
+    if (lh.serial_test) {
+        lh.inst[HOST].rom_path = lh.inst[CLIENT].rom_path = "serial_test.gb";
+        lh.inst[HOST].buttons = 1u << RETRO_DEVICE_ID_JOYPAD_A;  // Boot the host as the master
+    } else {
+        lh.inst[HOST].rom_path = argv[optind + 1];
+        lh.inst[CLIENT].rom_path = argc - optind == 3 ? argv[optind + 2] : argv[optind + 1];
+    }
+
+    int status = 1;
+    for (int i = 0; i < 2; i++) {
+        Instance* inst = &lh.inst[i];
+        if (inst->input_path && !load_script(inst)) goto finish;
+        if (!open_instance(inst, core_path)) goto finish;
+    }
+
+    struct retro_system_av_info av_info = {0};
+    lh.current = &lh.inst[HOST];
+    lh.inst[HOST].get_system_av_info(&av_info);
+    double fps = av_info.timing.fps > 0 ? av_info.timing.fps : 60.0;
+
+    // Same session order as gbalink.c: start, then announce the peer
+    for (int i = 0; i < 2; i++) {
+        Instance* inst = &lh.inst[i];
+        lh.current = inst;
+        if (inst->netpacket.start) inst->netpacket.start(inst->client_id, bridge_send, bridge_poll_receive);
+    }
+    for (int i = 0; i < 2; i++) {
+        Instance* inst = &lh.inst[i];
+        lh.current = inst;
+        if (inst->netpacket.connected) inst->netpacket.connected(peer_of(inst)->client_id);
+    }
+
+    long frame_ns = (long)(1000000000.0 / fps);
+    struct timespec start, next, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+
+    // Lockstep: the host's frame N sends reach the client in its frame N,
+    // the client's reach the host in frame N+1 (plus -l latency either way)
+    for (lh.frame = 0; lh.frame < lh.frames; lh.frame++) {
+        run_frame(&lh.inst[HOST]);
+        run_frame(&lh.inst[CLIENT]);
+        if (lh.serial_test && serial_test_done()) {
+            lh.frame++;
+            break;
+        }
+
+        if (lh.paced) {
+            next.tv_nsec += frame_ns;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < 2; i++) {
+        Instance* inst = &lh.inst[i];
+        lh.current = inst;
+        if (inst->netpacket.stop) inst->netpacket.stop();
+    }
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("frames run:        %u at latency %u (%.1f fps for both instances)\n",
+           lh.frame, lh.latency, seconds > 0 ? lh.frame / seconds : 0.0);
+    print_stats(&lh.inst[CLIENT]);
+    print_stats(&lh.inst[HOST]);
+
+    // Final states, for comparing runs (the two instances differ by design)
+    for (int i = 0; i < 2; i++) {
+        Instance* inst = &lh.inst[i];
+        lh.current = inst;
+        size_t size = inst->serialize_size ? inst->serialize_size() : 0;
+        uint8_t* state = size ? malloc(size) : NULL;
+        if (state && inst->serialize(state, size)) {
+            printf("%-6s state:      %016llx (%zu bytes)\n", inst->name,
+                   (unsigned long long)state_hash(state, size), size);
+        }
+        free(state);
+    }
+    status = 0;
+
+    if (lh.serial_test) {
+        int bad = serial_test_check();
+        printf("serial test:       %s (%d bytes each way, %d wrong)\n",
+               bad ? "FAIL" : "pass", SERIAL_TEST_BYTES, bad);
+        status = bad ? 1 : 0;
+    }
+
+finish:
+    for (int i = 0; i < 2; i++) close_instance(&lh.inst[i]);
+    return status;
+}
@@ -0,0 +1,567 @@
+/*
+ * NextUI Link Impairment Shim
+ * LD_PRELOAD library that puts a bad network between two link sessions on one
+ * Linux box: latency, jitter, loss, reordering and a bandwidth cap on what the
+ * process sends over IPv4 (netplay/GB Link TCP, GBA Link TCP or reliable UDP).
+ *
+ * Only the sending side is impaired - preload it into both ends for a
+ * symmetric link. send() returns at once; a scheduler thread hands the data to
+ * the kernel when it is due. Datagrams can be lost or overtaken. Streams keep
+ * their order: a "lost" segment holds everything behind it for a retransmit
+ * timeout, which is the stall TCP shows on lossy WiFi. Each socket has its own
+ * queue, so a full window on one never holds up another, and close() only
+ * closes the real socket once its queue has drained (like a graceful TCP close).
+ *
+ * Configuration (LINK_IMPAIR, or key=value lines in the LINK_IMPAIR_FILE file):
+ *   LINK_IMPAIR="bad_wifi"                       named profile
+ *   LINK_IMPAIR="delay=30,jitter=10,loss=2"      or explicit values
+ *   LINK_IMPAIR="wifi,loss=5"                    profile with overrides
+ *
+ *   delay=MS     one-way latency             jitter=MS   +/- random latency
+ *   loss=PCT     packet loss (0-100)         reorder=PCT datagrams held back
+ *   rate=KBIT    bandwidth cap in kbit/s     ports=A:B   only these ports
+ *   seed=N       random seed (reproducible runs)
+ *
+ * A summary goes to stderr at exit (LINK_IMPAIR_QUIET=1 turns it off).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+#define IMPAIR_MAX_FD 1024
+#define IMPAIR_MAX_PORTS 8
+#define IMPAIR_TCP_RTO_MS 200     // Linux minimum RTO - what a lost segment costs
+#define IMPAIR_QUEUE_LIMIT_MS 250 // Rate-capped backlog before datagrams drop / streams block
+
+typedef struct {
+    const char* name;
+    const char* values;
+} ImpairProfile;
+
+// Rough figures for the networks handhelds end up on
+static const ImpairProfile profiles[] = {
+    { "lan",       "delay=1" },
+    { "wifi",      "delay=4,jitter=3,loss=0.2" },
+    { "bad_wifi",  "delay=15,jitter=15,loss=3,reorder=2" },
+    { "congested", "delay=40,jitter=30,loss=5,reorder=5,rate=1000" },
+    { "hotspot",   "delay=8,jitter=8,loss=1,rate=4000" },
+};
+
+typedef struct Packet {
+    struct Packet* next;
+    uint64_t due_us;
+    bool stream;
+    struct sockaddr_storage addr; // Datagram destination (addr_len 0 = connected)
+    socklen_t addr_len;
+    size_t len;
+    size_t offset;                // Stream bytes already handed to the kernel
+    uint8_t data[];
+} Packet;
+
+typedef enum {
+    FD_UNKNOWN = 0,
+    FD_PASSTHROUGH,
+    FD_STREAM,
+    FD_DGRAM
+} FdKind;
+
+//////////////////////////////////////////////////////////////////////////////
+// State
+//////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    // Options
+    bool enabled;
+    char profile[32];
+    uint32_t delay_ms;
+    uint32_t jitter_ms;
+    double loss_pct;
+    double reorder_pct;
+    uint32_t rate_kbit;
+    uint16_t ports[IMPAIR_MAX_PORTS];
+    int port_count;
+    unsigned seed;
+    bool quiet;
+
+    // Real libc entry points
+    ssize_t (*real_send)(int, const void*, size_t, int);
+    ssize_t (*real_sendto)(int, const void*, size_t, int, const struct sockaddr*, socklen_t);
+    ssize_t (*real_sendmsg)(int, const struct msghdr*, int);
+    int (*real_close)(int);
+
+    // Scheduler
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool thread_started;
+    uint64_t link_free_us;        // Rate cap: when the "wire" is free again
+    int fd_limit;                 // Highest fd with a queue + 1
+    FdKind kind[IMPAIR_MAX_FD];
+    Packet* queue[IMPAIR_MAX_FD];         // Per fd, sorted by due_us, FIFO among equals
+    uint64_t last_due_us[IMPAIR_MAX_FD];  // Streams never overtake themselves
+    uint64_t retry_us[IMPAIR_MAX_FD];     // Stream window full: next attempt
+    bool closing[IMPAIR_MAX_FD];          // App closed it, real close once drained
+
+    // Stats
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t dropped;
+    uint64_t reordered;
+    uint64_t retransmits;
+    uint64_t queue_full;
+    uint64_t delay_total_us;
+    uint64_t delay_max_us;
+} im = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// Uniform in [0, 1) from a private generator, so the app's rand() is untouched
+static double random_unit(void) {
+    im.seed = im.seed * 1103515245u + 12345u;
+    return (double)((im.seed >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Configuration
+//////////////////////////////////////////////////////////////////////////////
+
+static void apply_option(const char* key, const char* value) {
+    if (strcmp(key, "delay") == 0) im.delay_ms = (uint32_t)atoi(value);
+    else if (strcmp(key, "jitter") == 0) im.jitter_ms = (uint32_t)atoi(value);
+    else if (strcmp(key, "loss") == 0) im.loss_pct = atof(value);
+    else if (strcmp(key, "reorder") == 0) im.reorder_pct = atof(value);
+    else if (strcmp(key, "rate") == 0) im.rate_kbit = (uint32_t)atoi(value);
+    else if (strcmp(key, "seed") == 0) im.seed = (unsigned)strtoul(value, NULL, 10);
+    else if (strcmp(key, "ports") == 0) {
+        const char* p = value;
+        im.port_count = 0;
+        while (*p && im.port_count < IMPAIR_MAX_PORTS) {
+            im.ports[im.port_count++] = (uint16_t)atoi(p);
+            p = strchr(p, ':');
+            if (!p) break;
+            p++;
+        }
+    }
+    else fprintf(stderr, "link_impair: unknown option %s\n", key);
+}
+
+static void parse_options(const char* spec);
+
+// One item: "name" (profile) or "key=value"
+static void parse_item(char* item) {
+    while (*item == ' ' || *item == '\t') item++;
+    char* end = item + strlen(item);
+    while (end > item && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    if (!*item || *item == '#') return;
+
+    char* eq = strchr(item, '=');
+    if (eq) {
+        *eq = '\0';
+        apply_option(item, eq + 1);
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        if (strcmp(item, profiles[i].name) == 0) {
+            snprintf(im.profile, sizeof(im.profile), "%s", item);
+            parse_options(profiles[i].values);
+            return;
+        }
+    }
+    fprintf(stderr, "link_impair: unknown profile %s\n", item);
+}
+
+static void parse_options(const char* spec) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char* save = NULL;
+    for (char* item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        parse_item(item);
+    }
+}
+
+static void print_summary(void);
+
+__attribute__((constructor))
+static void impair_init(void) {
+    im.real_send = dlsym(RTLD_NEXT, "send");
+    im.real_sendto = dlsym(RTLD_NEXT, "sendto");
+    im.real_sendmsg = dlsym(RTLD_NEXT, "sendmsg");
+    im.real_close = dlsym(RTLD_NEXT, "close");
+    im.seed = (unsigned)getpid() ^ (unsigned)time(NULL);
+    im.quiet = getenv("LINK_IMPAIR_QUIET") != NULL;
+
+    const char* spec = getenv("LINK_IMPAIR");
+    const char* path = getenv("LINK_IMPAIR_FILE");
+    if (path) {
+        FILE* f = fopen(path, "r");
+        if (!f) {
+            fprintf(stderr, "link_impair: cannot open %s\n", path);
+        } else {
+            char line[256];
+            while (fgets(line, sizeof(line), f)) parse_item(line);
+            fclose(f);
+            im.enabled = true;
+        }
+    }
+    if (spec && *spec) {
+        parse_options(spec);  // Environment overrides the file
+        im.enabled = true;
+    }
+    if (!im.enabled) return;
+
+    if (!im.quiet) {
+        fprintf(stderr, "link_impair: %s delay=%ums jitter=%ums loss=%.1f%% reorder=%.1f%% rate=%ukbit\n",
+                im.profile[0] ? im.profile : "custom", im.delay_ms, im.jitter_ms,
+                im.loss_pct, im.reorder_pct, im.rate_kbit);
+    }
+    atexit(print_summary);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Socket Classification
+//////////////////////////////////////////////////////////////////////////////
+
+static bool port_matches(int fd, const struct sockaddr* dest) {
+    if (im.port_count == 0) return true;
+
+    uint16_t candidates[3] = {0};
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    if (getsockname(fd, (struct sockaddr*)&sa, &len) == 0) candidates[0] = ntohs(sa.sin_port);
+    len = sizeof(sa);
+    if (getpeername(fd, (struct sockaddr*)&sa, &len) == 0) candidates[1] = ntohs(sa.sin_port);
+    if (dest && dest->sa_family == AF_INET) {
+        candidates[2] = ntohs(((const struct sockaddr_in*)dest)->sin_port);
+    }
+
+    for (int i = 0; i < im.port_count; i++) {
+        for (int c = 0; c < 3; c++) {
+            if (candidates[c] && candidates[c] == im.ports[i]) return true;
+        }
+    }
+    return false;
+}
+
+// Lock held. Decided once per fd - close() forgets it for the next socket.
+static FdKind classify(int fd, const struct sockaddr* dest) {
+    if (fd < 0 || fd >= IMPAIR_MAX_FD) return FD_PASSTHROUGH;
+    if (im.kind[fd] != FD_UNKNOWN) return im.kind[fd];
+
+    FdKind kind = FD_PASSTHROUGH;
+    int type = 0;
+    socklen_t len = sizeof(type);
+    struct sockaddr_storage local;
+    socklen_t local_len = sizeof(local);
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 &&
+        getsockname(fd, (struct sockaddr*)&local, &local_len) == 0 &&
+        local.ss_family == AF_INET && port_matches(fd, dest)) {
+        if (type == SOCK_STREAM) kind = FD_STREAM;
+        else if (type == SOCK_DGRAM) kind = FD_DGRAM;
+    }
+
+    // With a port filter an unconnected datagram socket is judged per destination
+    if (!(dest && im.port_count)) im.kind[fd] = kind;
+    return kind;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Scheduler
+//////////////////////////////////////////////////////////////////////////////
+
+static void enqueue(int fd, Packet* pkt) {
+    Packet** link = &im.queue[fd];
+    while (*link && (*link)->due_us <= pkt->due_us) link = &(*link)->next;
+    pkt->next = *link;
+    *link = pkt;
+    if (fd >= im.fd_limit) im.fd_limit = fd + 1;
+    pthread_cond_signal(&im.cond);
+}
+
+// Lock held. Forget everything about fd, the number may come back as a new socket.
+static void forget_fd(int fd) {
+    while (im.queue[fd]) {
+        Packet* dead = im.queue[fd];
+        im.queue[fd] = dead->next;
+        free(dead);
+    }
+    im.kind[fd] = FD_UNKNOWN;
+    im.last_due_us[fd] = 0;
+    im.retry_us[fd] = 0;
+    if (im.closing[fd]) {
+        im.closing[fd] = false;
+        im.real_close(fd);
+    }
+}
+
+// Lock held. Hand fd's head packet to the kernel. Returns true if it made progress.
+static bool deliver_head(int fd, uint64_t now) {
+    Packet* pkt = im.queue[fd];
+    if (pkt->stream) {
+        ssize_t sent = im.real_send(fd, pkt->data + pkt->offset, pkt->len - pkt->offset,
+                                    MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Peer's window is full - try again shortly, keeping the head so
+            // nothing on this stream can overtake it (other fds carry on)
+            im.retry_us[fd] = now + 1000;
+            return false;
+        }
+        if (sent < 0) {
+            // Connection is gone - nothing behind this segment can arrive either
+            forget_fd(fd);
+            return true;
+        }
+        pkt->offset += sent;
+        if (pkt->offset < pkt->len) return true;
+    } else {
+        im.real_sendto(fd, pkt->data, pkt->len, MSG_NOSIGNAL | MSG_DONTWAIT,
+                       pkt->addr_len ? (struct sockaddr*)&pkt->addr : NULL, pkt->addr_len);
+    }
+
+    im.queue[fd] = pkt->next;
+    free(pkt);
+    if (!im.queue[fd] && im.closing[fd]) forget_fd(fd);  // Drained: now really close it
+    return true;
+}
+
+static void* scheduler_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&im.lock);
+    for (;;) {
+        uint64_t now = now_us();
+        uint64_t next = UINT64_MAX;
+        bool progress = false;
+        for (int fd = 0; fd < im.fd_limit; fd++) {
+            Packet* pkt = im.queue[fd];
+            if (!pkt) continue;
+            uint64_t ready = pkt->due_us > im.retry_us[fd] ? pkt->due_us : im.retry_us[fd];
+            if (ready > now) {
+                if (ready < next) next = ready;
+                continue;
+            }
+            if (deliver_head(fd, now)) progress = true;
+            else if (im.retry_us[fd] < next) next = im.retry_us[fd];
+        }
+        if (progress) continue;
+
+        if (next == UINT64_MAX) {
+            pthread_cond_wait(&im.cond, &im.lock);
+            continue;
+        }
+        uint64_t wait = next - now;
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += wait / 1000000;
+        until.tv_nsec += (wait % 1000000) * 1000;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_nsec -= 1000000000L;
+            until.tv_sec++;
+        }
+        pthread_cond_timedwait(&im.cond, &im.lock, &until);
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Impaired Send
+//////////////////////////////////////////////////////////////////////////////
+
+static bool is_nonblocking(int fd, int flags) {
+    if (flags & MSG_DONTWAIT) return true;
+    int fl = fcntl(fd, F_GETFL);
+    return fl >= 0 && (fl & O_NONBLOCK);
+}
+
+// Queue one send. Lock held. Returns the byte count the caller sees.
+static ssize_t impair_send(int fd, FdKind kind, const struct iovec* iov, int iov_count,
+                           int flags, const struct sockaddr* dest, socklen_t dest_len) {
+    size_t len = 0;
+    for (int i = 0; i < iov_count; i++) len += iov[i].iov_len;
+
+    uint64_t now = now_us();
+    bool stream = kind == FD_STREAM;
+
+    // Rate cap: a full link buffer drops datagrams and pushes back on streams
+    while (im.rate_kbit && im.link_free_us > now + IMPAIR_QUEUE_LIMIT_MS * 1000ULL) {
+        im.queue_full++;
+        if (!stream) {
+            im.packets++;
+            im.bytes += len;
+            im.dropped++;
+            return (ssize_t)len;
+        }
+        if (is_nonblocking(fd, flags)) {
+            errno = EAGAIN;
+            return -1;
+        }
+        pthread_mutex_unlock(&im.lock);
+        usleep(1000);
+        pthread_mutex_lock(&im.lock);
+        now = now_us();
+    }
+
+    im.packets++;
+    im.bytes += len;
+
+    bool lost = im.loss_pct > 0 && random_unit() * 100.0 < im.loss_pct;
+    if (lost && !stream) {
+        im.dropped++;
+        return (ssize_t)len;
+    }
+
+    int64_t delay = (int64_t)im.delay_ms * 1000;
+    if (im.jitter_ms) {
+        delay += (int64_t)((random_unit() * 2.0 - 1.0) * im.jitter_ms * 1000.0);
+        if (delay < 0) delay = 0;
+    }
+    if (lost) {
+        // The retransmit is what arrives, one RTO later
+        delay += IMPAIR_TCP_RTO_MS * 1000;
+        im.retransmits++;
+    } else if (!stream && im.reorder_pct > 0 && random_unit() * 100.0 < im.reorder_pct) {
+        // Held back long enough for the next datagram to overtake it
+        delay += (im.jitter_ms * 2 + 10) * 1000;
+        im.reordered++;
+    }
+
+    uint64_t due = now + (uint64_t)delay;
+    if (im.rate_kbit) {
+        if (im.link_free_us < now) im.link_free_us = now;
+        im.link_free_us += (uint64_t)len * 8 * 1000 / im.rate_kbit;
+        if (due < im.link_free_us) due = im.link_free_us;
+    }
+    if (stream) {
+        if (due < im.last_due_us[fd]) due = im.last_due_us[fd];
+        im.last_due_us[fd] = due;
+    }
+
+    Packet* pkt = malloc(sizeof(Packet) + len);
+    if (!pkt) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->due_us = due;
+    pkt->stream = stream;
+    pkt->len = len;
+    if (dest && dest_len && dest_len <= sizeof(pkt->addr)) {
+        memcpy(&pkt->addr, dest, dest_len);
+        pkt->addr_len = dest_len;
+    }
+    size_t off = 0;
+    for (int i = 0; i < iov_count; i++) {
+        memcpy(pkt->data + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+
+    im.delay_total_us += due - now;
+    if (due - now > im.delay_max_us) im.delay_max_us = due - now;
+
+    if (!im.thread_started) {
+        im.thread_started = pthread_create(&im.thread, NULL, scheduler_thread, NULL) == 0;
+        if (im.thread_started) pthread_detach(im.thread);
+    }
+    enqueue(fd, pkt);
+    return (ssize_t)len;
+}
+
+// Common entry for the send family: pass through or impair
+static ssize_t route_send(int fd, const struct iovec* iov, int iov_count, int flags,
+                          const struct sockaddr* dest, socklen_t dest_len, bool* handled) {
+    *handled = false;
+    if (!im.enabled) return 0;
+
+    pthread_mutex_lock(&im.lock);
+    FdKind kind = classify(fd, dest);
+    ssize_t result = 0;
+    if (kind == FD_STREAM || kind == FD_DGRAM) {
+        *handled = true;
+        result = impair_send(fd, kind, iov, iov_count, flags, dest, dest_len);
+    }
+    pthread_mutex_unlock(&im.lock);
+    return result;
+}
+
+ssize_t send(int fd, const void* buf, size_t len, int flags) {
+    struct iovec iov = { (void*)buf, len };
+    bool handled;
+    ssize_t result = route_send(fd, &iov, 1, flags, NULL, 0, &handled);
+    return handled ? result : im.real_send(fd, buf, len, flags);
+}
+
+ssize_t sendto(int fd, const void* buf, size_t len, int flags,
+               const struct sockaddr* dest, socklen_t dest_len) {
+    struct iovec iov = { (void*)buf, len };
+    bool handled;
+    ssize_t result = route_send(fd, &iov, 1, flags, dest, dest_len, &handled);
+    return handled ? result : im.real_sendto(fd, buf, len, flags, dest, dest_len);
+}
+
+ssize_t sendmsg(int fd, const struct msghdr* msg, int flags) {
+    bool handled = false;
+    ssize_t result = 0;
+    if (!msg->msg_controllen) {
+        result = route_send(fd, msg->msg_iov, (int)msg->msg_iovlen, flags,
+                            msg->msg_name, msg->msg_namelen, &handled);
+    }
+    return handled ? result : im.real_sendmsg(fd, msg, flags);
+}
+
+int close(int fd) {
+    if (im.enabled && fd >= 0 && fd < IMPAIR_MAX_FD) {
+        pthread_mutex_lock(&im.lock);
+        if (im.queue[fd]) {
+            // Data still in flight goes out first, as after a graceful TCP
+            // close; the scheduler closes the real socket once it drains.
+            // Until then the kernel keeps the number, so it can't be reused.
+            im.closing[fd] = true;
+            pthread_mutex_unlock(&im.lock);
+            return 0;
+        }
+        forget_fd(fd);
+        pthread_mutex_unlock(&im.lock);
+    }
+    return im.real_close(fd);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Summary
+//////////////////////////////////////////////////////////////////////////////
+
+static void print_summary(void) {
+    if (im.quiet) return;
+    pthread_mutex_lock(&im.lock);
+    uint64_t delivered = im.packets - im.dropped;
+    fprintf(stderr, "link_impair: %llu sends (%llu bytes), %llu dropped, %llu reordered, "
+                    "%llu retransmitted, %llu over the rate cap\n",
+            (unsigned long long)im.packets, (unsigned long long)im.bytes,
+            (unsigned long long)im.dropped, (unsigned long long)im.reordered,
+            (unsigned long long)im.retransmits, (unsigned long long)im.queue_full);
+    if (delivered) {
+        fprintf(stderr, "link_impair: added delay avg %.2fms / max %.2fms\n",
+                im.delay_total_us / 1000.0 / delivered, im.delay_max_us / 1000.0);
+    }
+    pthread_mutex_unlock(&im.lock);
+}
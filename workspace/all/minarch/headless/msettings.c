@@ -0,0 +1,29 @@
+#include "msettings.h"
+
+void InitSettings(void) {}
+void QuitSettings(void) {}
+
+int GetBrightness(void) { return 5; }
+int GetColortemp(void) { return 20; }
+int GetContrast(void) { return 0; }
+int GetSaturation(void) { return 0; }
+int GetExposure(void) { return 0; }
+int GetVolume(void) { return 0; }
+
+void SetRawBrightness(int value) {}
+void SetRawVolume(int value) {}
+
+void SetBrightness(int value) {}
+void SetColortemp(int value) {}
+void SetContrast(int value) {}
+void SetSaturation(int value) {}
+void SetExposure(int value) {}
+void SetVolume(int value) {}
+
+int GetJack(void) { return 0; }
+void SetJack(int value) {}
+
+int GetHDMI(void) { return 0; }
+void SetHDMI(int value) {}
+
+int GetMute(void) { return 0; }
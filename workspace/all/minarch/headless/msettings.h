@@ -0,0 +1,35 @@
+#ifndef __msettings_h__
+#define __msettings_h__
+
+// Headless stand-in for the platform libmsettings: nothing to persist and
+// no hardware to drive, so getters return fixed values and setters do nothing
+
+void InitSettings(void);
+void QuitSettings(void);
+
+int GetBrightness(void);
+int GetColortemp(void);
+int GetContrast(void);
+int GetSaturation(void);
+int GetExposure(void);
+int GetVolume(void);
+
+void SetRawBrightness(int value);
+void SetRawVolume(int value);
+
+void SetBrightness(int value);
+void SetColortemp(int value);
+void SetContrast(int value);
+void SetSaturation(int value);
+void SetExposure(int value);
+void SetVolume(int value);
+
+int GetJack(void);
+void SetJack(int value);
+
+int GetHDMI(void);
+void SetHDMI(int value);
+
+int GetMute(void);
+
+#endif  // __msettings_h__
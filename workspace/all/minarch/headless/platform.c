@@ -0,0 +1,245 @@
+// headless (HEADLESS=1 host builds, see minarch makefile)
+//
+// Null platform: no display, audio device, pad, battery, radios or LEDs.
+// Everything is FALLBACK_IMPLEMENTATION so whatever api.c implements
+// itself takes precedence.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <msettings.h>
+
+#include "defines.h"
+#include "platform.h"
+#include "api.h"
+#include "utils.h"
+
+///////////////////////////////
+
+FALLBACK_IMPLEMENTATION void PLAT_initPlatform(void) {
+	mkdir(SDCARD_PATH, 0755);
+	mkdir(SDCARD_PATH "/.userdata", 0755);
+	mkdir(SHARED_USERDATA_PATH, 0755);
+}
+
+FALLBACK_IMPLEMENTATION FILE *PLAT_OpenSettings(const char *filename) {
+	char diskfilename[256];
+	snprintf(diskfilename, sizeof(diskfilename), SHARED_USERDATA_PATH "/%s", filename);
+	return fopen(diskfilename, "r");
+}
+FALLBACK_IMPLEMENTATION FILE *PLAT_WriteSettings(const char *filename) {
+	char diskfilename[256];
+	snprintf(diskfilename, sizeof(diskfilename), SHARED_USERDATA_PATH "/%s", filename);
+	return fopen(diskfilename, "w");
+}
+
+///////////////////////////////
+
+FALLBACK_IMPLEMENTATION void PLAT_initInput(void) {}
+FALLBACK_IMPLEMENTATION void PLAT_updateInput(const SDL_Event *event) {}
+FALLBACK_IMPLEMENTATION void PLAT_quitInput(void) {}
+FALLBACK_IMPLEMENTATION void PLAT_pollInput(void) {}
+FALLBACK_IMPLEMENTATION int PLAT_shouldWake(void) { return 0; }
+
+FALLBACK_IMPLEMENTATION void PLAT_initLid(void) {}
+FALLBACK_IMPLEMENTATION int PLAT_lidChanged(int* state) { return 0; }
+
+///////////////////////////////
+
+// Offscreen stand-in for the display; ma_headless.c makes its own for the
+// frame loop, this only covers code that goes through GFX_init
+
+static SDL_Surface* video_screen;
+
+FALLBACK_IMPLEMENTATION SDL_Surface* PLAT_initVideo(void) {
+	video_screen = SDL_CreateRGBSurfaceWithFormat(0, FIXED_WIDTH, FIXED_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888);
+	return video_screen;
+}
+FALLBACK_IMPLEMENTATION void PLAT_quitVideo(void) {
+	if (video_screen) SDL_FreeSurface(video_screen);
+	video_screen = NULL;
+}
+FALLBACK_IMPLEMENTATION SDL_Surface* PLAT_resizeVideo(int w, int h, int pitch) {
+	if (video_screen) SDL_FreeSurface(video_screen);
+	video_screen = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA8888);
+	return video_screen;
+}
+FALLBACK_IMPLEMENTATION void PLAT_clearVideo(SDL_Surface* screen) {
+	if (screen) SDL_FillRect(screen, NULL, 0);
+}
+FALLBACK_IMPLEMENTATION void PLAT_clearAll(void) {
+	PLAT_clearVideo(video_screen);
+}
+FALLBACK_IMPLEMENTATION void PLAT_setVsync(int vsync) {}
+FALLBACK_IMPLEMENTATION void PLAT_setSharpness(int sharpness) {}
+FALLBACK_IMPLEMENTATION void PLAT_setEffectColor(int color) {}
+FALLBACK_IMPLEMENTATION void PLAT_setEffect(int effect) {}
+FALLBACK_IMPLEMENTATION void PLAT_setOverlay(const char* filename, const char* tag) {}
+FALLBACK_IMPLEMENTATION void PLAT_setOffsetX(int x) {}
+FALLBACK_IMPLEMENTATION void PLAT_setOffsetY(int y) {}
+FALLBACK_IMPLEMENTATION void PLAT_drawOnLayer(SDL_Surface *inputSurface, int x, int y, int w, int h, float brightness, bool maintainAspectRatio, int layer) {}
+FALLBACK_IMPLEMENTATION void PLAT_clearLayers(int layer) {}
+FALLBACK_IMPLEMENTATION SDL_Surface* PLAT_captureRendererToSurface() { return NULL; }
+
+FALLBACK_IMPLEMENTATION void PLAT_setNotificationSurface(SDL_Surface* surface, int x, int y) {}
+FALLBACK_IMPLEMENTATION void PLAT_clearNotificationSurface(void) {}
+FALLBACK_IMPLEMENTATION void PLAT_initNotificationTexture(void) {}
+
+FALLBACK_IMPLEMENTATION void PLAT_animateSurface(SDL_Surface *inputSurface, int x, int y, int target_x, int target_y, int w, int h,
+		int duration_ms, int start_opacity, int target_opacity, int layer) {}
+FALLBACK_IMPLEMENTATION void PLAT_animateAndFadeSurface(SDL_Surface *inputSurface,
+		int x, int y, int target_x, int target_y, int w, int h, int duration_ms,
+		SDL_Surface *fadeSurface,
+		int fade_x, int fade_y, int fade_target_x, int fade_target_y, int fade_w, int fade_h,
+		int start_opacity, int target_opacity, int layer,
+		int input_easing, int fade_easing, int intensity) {}
+FALLBACK_IMPLEMENTATION void PLAT_animateSurfaceOpacity(SDL_Surface *inputSurface, int x, int y, int w, int h,
+		int start_opacity, int target_opacity, int duration_ms, int layer) {}
+FALLBACK_IMPLEMENTATION void PLAT_scrollTextTexture(TTF_Font* font, const char* in_name, int x, int y, int w, int h,
+		SDL_Color color, float transparency, SDL_mutex* fontMutex) {}
+FALLBACK_IMPLEMENTATION int PLAT_textShouldScroll(TTF_Font* font, const char* in_name, int max_width, SDL_mutex* fontMutex) { return 0; }
+FALLBACK_IMPLEMENTATION void PLAT_resetScrollText(void) {}
+
+FALLBACK_IMPLEMENTATION void PLAT_vsync(int remaining) {}
+FALLBACK_IMPLEMENTATION scaler_t PLAT_getScaler(GFX_Renderer* renderer) { return NULL; }
+FALLBACK_IMPLEMENTATION void PLAT_blitRenderer(GFX_Renderer* renderer) {}
+FALLBACK_IMPLEMENTATION void PLAT_flip(SDL_Surface* screen, int sync) {}
+FALLBACK_IMPLEMENTATION void PLAT_flipHidden() {}
+FALLBACK_IMPLEMENTATION void PLAT_GL_Swap() {}
+FALLBACK_IMPLEMENTATION void PLAT_GPU_Flip() {}
+FALLBACK_IMPLEMENTATION unsigned char* PLAT_GL_screenCapture(int* outWidth, int* outHeight) {
+	if (outWidth) *outWidth = 0;
+	if (outHeight) *outHeight = 0;
+	return NULL;
+}
+FALLBACK_IMPLEMENTATION void PLAT_setClearColor(uint32_t color) {}
+
+FALLBACK_IMPLEMENTATION void PLAT_setShaders(int nr) {}
+FALLBACK_IMPLEMENTATION void PLAT_resetShaders() {}
+FALLBACK_IMPLEMENTATION void PLAT_clearShaders() {}
+FALLBACK_IMPLEMENTATION void PLAT_updateShader(int i, const char *filename, int *scale, int *filter, int *scaletype, int *inputtype) {}
+FALLBACK_IMPLEMENTATION void PLAT_initShaders() {}
+FALLBACK_IMPLEMENTATION ShaderParam* PLAT_getShaderPragmas(int i) { return NULL; }
+FALLBACK_IMPLEMENTATION int PLAT_supportsOverscan(void) { return 0; }
+
+///////////////////////////////
+
+FALLBACK_IMPLEMENTATION void PLAT_audioDeviceWatchRegister(void (*cb)(int, int)) {}
+FALLBACK_IMPLEMENTATION void PLAT_audioDeviceWatchUnregister(void) {}
+FALLBACK_IMPLEMENTATION void PLAT_overrideMute(int mute) {}
+FALLBACK_IMPLEMENTATION int PLAT_pickSampleRate(int requested, int max) {
+	return requested<max ? requested : max;
+}
+
+///////////////////////////////
+
+FALLBACK_IMPLEMENTATION void PLAT_getBatteryStatus(int* is_charging, int* charge) {
+	PLAT_getBatteryStatusFine(is_charging, charge);
+}
+FALLBACK_IMPLEMENTATION void PLAT_getBatteryStatusFine(int* is_charging, int* charge) {
+	*is_charging = 1;
+	*charge = 100;
+}
+FALLBACK_IMPLEMENTATION void PLAT_enableBacklight(int enable) {}
+FALLBACK_IMPLEMENTATION int PLAT_supportsDeepSleep(void) { return 0; }
+FALLBACK_IMPLEMENTATION int PLAT_deepSleep(void) { return -1; }
+FALLBACK_IMPLEMENTATION void PLAT_powerOff(int reboot) {
+	exit(0);
+}
+
+// Leave clocks and affinity to the host, benchmarks pin with taskset
+FALLBACK_IMPLEMENTATION void *PLAT_cpu_monitor(void *arg) { return NULL; }
+FALLBACK_IMPLEMENTATION void PLAT_setCPUSpeed(int speed) {}
+FALLBACK_IMPLEMENTATION void PLAT_pinToCores(int core_type) {}
+FALLBACK_IMPLEMENTATION void PLAT_getCPUTemp() {}
+FALLBACK_IMPLEMENTATION void PLAT_getCPUSpeed() {}
+FALLBACK_IMPLEMENTATION void PLAT_getGPUUsage() {}
+FALLBACK_IMPLEMENTATION void PLAT_getGPUSpeed() {}
+FALLBACK_IMPLEMENTATION void PLAT_getGPUTemp() {}
+FALLBACK_IMPLEMENTATION void PLAT_setRumble(int strength) {}
+
+FALLBACK_IMPLEMENTATION char* PLAT_getModel(void) {
+	return "Headless";
+}
+FALLBACK_IMPLEMENTATION void PLAT_getOsVersionInfo(char *output_str, size_t max_len) {
+	snprintf(output_str, max_len, "headless");
+}
+FALLBACK_IMPLEMENTATION void PLAT_getNetworkStatus(int* is_online) {
+	*is_online = 0;
+}
+FALLBACK_IMPLEMENTATION bool PLAT_btIsConnected(void) { return false; }
+FALLBACK_IMPLEMENTATION ConnectionStrength PLAT_connectionStrength(void) { return SIGNAL_STRENGTH_OFF; }
+FALLBACK_IMPLEMENTATION int PLAT_setDateTime(int y, int m, int d, int h, int i, int s) { return -1; }
+
+FALLBACK_IMPLEMENTATION void PLAT_initLeds(LightSettings *lights) {}
+FALLBACK_IMPLEMENTATION void PLAT_setLedEffect(LightSettings *led) {}
+FALLBACK_IMPLEMENTATION void PLAT_setLedColor(LightSettings *led) {}
+FALLBACK_IMPLEMENTATION void PLAT_setLedBrightness(LightSettings *led) {}
+FALLBACK_IMPLEMENTATION void PLAT_setLedInbrightness(LightSettings *led) {}
+FALLBACK_IMPLEMENTATION void PLAT_setLedEffectSpeed(LightSettings *led) {}
+FALLBACK_IMPLEMENTATION void PLAT_setLedEffectCycles(LightSettings *led) {}
+
+FALLBACK_IMPLEMENTATION bool PLAT_canTurbo(void) { return false; }
+FALLBACK_IMPLEMENTATION int PLAT_toggleTurbo(int btn_id) { return 0; }
+FALLBACK_IMPLEMENTATION void PLAT_clearTurbo() {}
+
+///////////////////////////////
+
+FALLBACK_IMPLEMENTATION void PLAT_initTimezones() {}
+FALLBACK_IMPLEMENTATION void PLAT_getTimezones(char timezones[MAX_TIMEZONES][MAX_TZ_LENGTH], int *tz_count) {
+	*tz_count = 0;
+}
+FALLBACK_IMPLEMENTATION char *PLAT_getCurrentTimezone() {
+	return "UTC";
+}
+FALLBACK_IMPLEMENTATION void PLAT_setCurrentTimezone(const char* tz) {}
+FALLBACK_IMPLEMENTATION bool PLAT_getNetworkTimeSync(void) { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_setNetworkTimeSync(bool on) {}
+
+///////////////////////////////
+
+// Netplay and link sessions use plain sockets over the host's network, there
+// is no radio to manage
+
+FALLBACK_IMPLEMENTATION void PLAT_wifiInit() {}
+FALLBACK_IMPLEMENTATION bool PLAT_hasWifi() { return false; }
+FALLBACK_IMPLEMENTATION bool PLAT_wifiEnabled() { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_wifiEnable(bool on) {}
+FALLBACK_IMPLEMENTATION int PLAT_wifiScan(struct WIFI_network *networks, int max) { return 0; }
+FALLBACK_IMPLEMENTATION bool PLAT_wifiConnected() { return false; }
+FALLBACK_IMPLEMENTATION int PLAT_wifiConnection(struct WIFI_connection *connection_info) { return -1; }
+FALLBACK_IMPLEMENTATION bool PLAT_wifiHasCredentials(char *ssid, WifiSecurityType sec) { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_wifiForget(char *ssid, WifiSecurityType sec) {}
+FALLBACK_IMPLEMENTATION int PLAT_wifiForgetPrefix(const char *prefix) { return 0; }
+FALLBACK_IMPLEMENTATION void PLAT_wifiEnableAll(void) {}
+FALLBACK_IMPLEMENTATION void PLAT_wifiConnect(char *ssid, WifiSecurityType sec) {}
+FALLBACK_IMPLEMENTATION void PLAT_wifiConnectPass(const char *ssid, WifiSecurityType sec, const char* pass) {}
+FALLBACK_IMPLEMENTATION void PLAT_wifiSelectOnly(const char *ssid) {}
+FALLBACK_IMPLEMENTATION void PLAT_wifiDisconnect() {}
+FALLBACK_IMPLEMENTATION bool PLAT_wifiDiagnosticsEnabled() { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_wifiDiagnosticsEnable(bool on) {}
+
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothInit() {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothDeinit() {}
+FALLBACK_IMPLEMENTATION bool PLAT_hasBluetooth() { return false; }
+FALLBACK_IMPLEMENTATION bool PLAT_bluetoothEnabled() { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothEnable(bool on) {}
+FALLBACK_IMPLEMENTATION bool PLAT_bluetoothDiagnosticsEnabled() { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothDiagnosticsEnable(bool on) {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothDiscovery(int on) {}
+FALLBACK_IMPLEMENTATION bool PLAT_bluetoothDiscovering() { return false; }
+FALLBACK_IMPLEMENTATION int PLAT_bluetoothScan(struct BT_device *devices, int max) { return 0; }
+FALLBACK_IMPLEMENTATION int PLAT_bluetoothPaired(struct BT_devicePaired *devices, int max) { return 0; }
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothPair(char *addr) {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothUnpair(char *addr) {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothConnect(char *addr) {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothDisconnect(char *addr) {}
+FALLBACK_IMPLEMENTATION bool PLAT_bluetoothConnected() { return false; }
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothStreamInit(int ch, int samplerate) {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothStreamBegin(int buffersize) {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothStreamEnd() {}
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothStreamQuit() {}
+FALLBACK_IMPLEMENTATION int PLAT_bluetoothVolume() { return 0; }
+FALLBACK_IMPLEMENTATION void PLAT_bluetoothSetVolume(int vol) {}
@@ -0,0 +1,134 @@
+// headless (HEADLESS=1 host builds, see minarch makefile)
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+///////////////////////////////
+
+// No physical input: ma_headless.c feeds scripted buttons straight
+// into input_poll_callback, so every mapping is unavailable
+
+#define	BUTTON_UP		BUTTON_NA
+#define	BUTTON_RIGHT	BUTTON_NA
+#define	BUTTON_DOWN		BUTTON_NA
+#define	BUTTON_LEFT		BUTTON_NA
+
+#define	BUTTON_SELECT	BUTTON_NA
+#define	BUTTON_START	BUTTON_NA
+
+#define	BUTTON_A		BUTTON_NA
+#define	BUTTON_B		BUTTON_NA
+#define	BUTTON_X		BUTTON_NA
+#define	BUTTON_Y		BUTTON_NA
+
+#define	BUTTON_L1		BUTTON_NA
+#define	BUTTON_R1		BUTTON_NA
+#define	BUTTON_L2		BUTTON_NA
+#define	BUTTON_R2		BUTTON_NA
+#define BUTTON_L3		BUTTON_NA
+#define BUTTON_R3		BUTTON_NA
+
+#define	BUTTON_MENU		BUTTON_NA
+#define	BUTTON_MENU_ALT	BUTTON_NA
+#define	BUTTON_POWER	BUTTON_NA
+#define	BUTTON_PLUS		BUTTON_NA
+#define	BUTTON_MINUS	BUTTON_NA
+
+///////////////////////////////
+
+#define CODE_UP			CODE_NA
+#define CODE_DOWN		CODE_NA
+#define CODE_LEFT		CODE_NA
+#define CODE_RIGHT		CODE_NA
+
+#define CODE_SELECT		CODE_NA
+#define CODE_START		CODE_NA
+
+#define CODE_A			CODE_NA
+#define CODE_B			CODE_NA
+#define CODE_X			CODE_NA
+#define CODE_Y			CODE_NA
+
+#define CODE_L1			CODE_NA
+#define CODE_R1			CODE_NA
+#define CODE_L2			CODE_NA
+#define CODE_R2			CODE_NA
+#define CODE_L3			CODE_NA
+#define CODE_R3			CODE_NA
+
+#define CODE_MENU		CODE_NA
+#define CODE_MENU_ALT	CODE_NA
+#define CODE_POWER		CODE_NA
+#define CODE_POWEROFF	CODE_NA
+
+#define CODE_PLUS		CODE_NA
+#define CODE_MINUS		CODE_NA
+
+///////////////////////////////
+
+#define JOY_UP			JOY_NA
+#define JOY_DOWN		JOY_NA
+#define JOY_LEFT		JOY_NA
+#define JOY_RIGHT		JOY_NA
+
+#define JOY_SELECT		JOY_NA
+#define JOY_START		JOY_NA
+
+#define JOY_A			JOY_NA
+#define JOY_B			JOY_NA
+#define JOY_X			JOY_NA
+#define JOY_Y			JOY_NA
+
+#define JOY_L1			JOY_NA
+#define JOY_R1			JOY_NA
+#define JOY_L2			JOY_NA
+#define JOY_R2			JOY_NA
+#define JOY_L3			JOY_NA
+#define JOY_R3			JOY_NA
+
+#define JOY_MENU		JOY_NA
+#define JOY_POWER		JOY_NA
+#define JOY_PLUS		JOY_NA
+#define JOY_MINUS		JOY_NA
+
+#define AXIS_L2			2
+#define AXIS_R2			5
+
+#define AXIS_LX			0
+#define AXIS_LY			1
+#define AXIS_RX			3
+#define AXIS_RY			4
+
+///////////////////////////////
+
+#define BTN_RESUME			BTN_X
+#define BTN_SLEEP			BTN_POWER
+#define BTN_WAKE			BTN_POWER
+#define BTN_MOD_VOLUME		BTN_NONE
+#define BTN_MOD_BRIGHTNESS	BTN_NONE
+#define BTN_MOD_PLUS		BTN_PLUS
+#define BTN_MOD_MINUS		BTN_MINUS
+
+///////////////////////////////
+
+// Same geometry as tg5040 so video_refresh_callback scales and converts
+// the way it does on device
+
+#define FIXED_SCALE		2
+#define FIXED_WIDTH		1280
+#define FIXED_HEIGHT	720
+#define FIXED_BPP		2
+#define FIXED_DEPTH		(FIXED_BPP * 8)
+#define FIXED_PITCH		(FIXED_WIDTH * FIXED_BPP)
+#define FIXED_SIZE		(FIXED_PITCH * FIXED_HEIGHT)
+
+///////////////////////////////
+
+// Configs, saves and states land here (SDCARD_PATH=... make to move them)
+#ifndef SDCARD_PATH
+#define SDCARD_PATH "/tmp/minarch_headless"
+#endif
+#define MUTE_VOLUME_RAW 0
+
+///////////////////////////////
+
+#endif
@@ -10,6 +10,9 @@
 #include "ma_cheats.h"
 #include "ma_core.h"
 #include "netplay_helper.h" // CoreLinkSupport / checkCoreLinkSupport
+#ifdef HEADLESS
+#include "ma_headless.h"
+#endif
 
 
 void Core_getName(char* in_name, char* out_name) {
@@ -17,6 +20,25 @@ void Core_getName(char* in_name, char* out_name) {
 	char* tmp = strrchr(out_name, '_');
 	tmp[0] = '\0';
 }
+// Stream-mode netplay host forwards core audio to the client
+static void stream_audio_sample_callback(int16_t left, int16_t right) {
+	const int16_t frame[2] = {left, right};
+	Netplay_streamAudio(frame, 1);
+#ifdef HEADLESS
+	Headless_audioSample(left, right);
+#else
+	audio_sample_callback(left, right);
+#endif
+}
+static size_t stream_audio_sample_batch_callback(const int16_t *data, size_t frames) {
+	Netplay_streamAudio(data, frames);
+#ifdef HEADLESS
+	return Headless_audioSampleBatch(data, frames);
+#else
+	return audio_sample_batch_callback(data, frames);
+#endif
+}
+
 void Core_open(const char* core_path, const char* tag_name) {
 	LOG_info("Core_open\n");
 	core.handle = dlopen(core_path, RTLD_LAZY);
@@ -84,8 +106,8 @@ void Core_open(const char* core_path, const char* tag_name) {
 
 	set_environment_callback(environment_callback);
 	set_video_refresh_callback(video_refresh_callback);
-	set_audio_sample_callback(audio_sample_callback);
-	set_audio_sample_batch_callback(audio_sample_batch_callback);
+	set_audio_sample_callback(stream_audio_sample_callback);
+	set_audio_sample_batch_callback(stream_audio_sample_batch_callback);
 	set_input_poll_callback(input_poll_callback);
 	set_input_state_callback(input_state_callback);
 }
@@ -147,6 +169,7 @@ void Core_load(void) {
 	core.show_netplay = link_support.show_netplay;
 	core.has_netpacket = link_support.has_netpacket;
 	core.has_gblink = link_support.has_gblink;
+	Netplay_setCore(core.name);
 
 	if (Cheats_load())
 		Core_applyCheats(&cheatcodes);
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <dlfcn.h>
 
 #include "ma_internal.h"
 #include "ma_options.h"
@@ -410,6 +411,11 @@ bool environment_callback(unsigned cmd, void *data) { // copied from picoarch in
 		if (cb) {
 			core.has_netpacket = true;
 			GBALink_setCoreCallbacks(cb);
+			GBALink_setCoreQueueProbe(
+				(GBALinkCoreQueueFreeFn)dlsym(core.handle, "retro_gpsp_rfu_queue_free"),
+				(GBALinkCoreQueueStatsFn)dlsym(core.handle, "retro_gpsp_rfu_queue_stats"));
+			GBALink_setCoreReplyProbe(
+				(GBALinkCoreWaitingFn)dlsym(core.handle, "retro_gambatte_serial_waiting"));
 		}
 		return true;
 	}
@@ -0,0 +1,689 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "ma_internal.h"
+#include "ma_input.h"
+#include "ma_video.h"
+#include "ma_core.h"
+#include "ma_game.h"
+#include "ma_config.h"
+#include "ma_headless.h"
+#include "netplay.h"
+#include "gbalink.h"
+#include "gblink.h"
+#include "netplay_helper.h"
+
+// Headless minarch: the core goes through the same Core_open/Game_open/Core_load
+// and netplay/link frame loop as main(), but video stops after pixel conversion,
+// audio lands in a null sink and inputs come from a script. Used to time the
+// frontend hot paths (core.run(), pixel conversion, audio batching) on a desktop
+// without a display, a sound card or a gamepad.
+
+#define HEADLESS_DEFAULT_FRAMES 3600
+#define HEADLESS_CONNECT_TIMEOUT_MS 30000
+#define HEADLESS_AUDIO_RING 8192 // stereo frames
+
+typedef struct {
+	uint32_t run_us; // excludes convert_us and audio_us
+	uint32_t convert_us;
+	uint32_t audio_us;
+	uint32_t audio_frames;
+} HeadlessFrame;
+
+typedef struct {
+	int frame;
+	uint32_t buttons;
+} HeadlessInput;
+
+static struct {
+	int frame; // frames the core has run
+	int frame_count;
+	HeadlessFrame* frames;
+	int stalls; // loop iterations spent waiting on a netplay/link peer
+
+	HeadlessInput* inputs;
+	int input_count;
+	int input_index;
+	uint32_t buttons;
+
+	int16_t audio_ring[HEADLESS_AUDIO_RING * 2];
+	int audio_pos;
+} headless;
+
+uint64_t Headless_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static HeadlessFrame* current_frame(void) {
+	if (!headless.frames || headless.frame>=headless.frame_count) return NULL;
+	return &headless.frames[headless.frame];
+}
+
+///////////////////////////////
+// Scripted input
+
+static const struct {
+	const char* name;
+	int id;
+} button_names[] = {
+	{"B",      RETRO_DEVICE_ID_JOYPAD_B},
+	{"Y",      RETRO_DEVICE_ID_JOYPAD_Y},
+	{"SELECT", RETRO_DEVICE_ID_JOYPAD_SELECT},
+	{"START",  RETRO_DEVICE_ID_JOYPAD_START},
+	{"UP",     RETRO_DEVICE_ID_JOYPAD_UP},
+	{"DOWN",   RETRO_DEVICE_ID_JOYPAD_DOWN},
+	{"LEFT",   RETRO_DEVICE_ID_JOYPAD_LEFT},
+	{"RIGHT",  RETRO_DEVICE_ID_JOYPAD_RIGHT},
+	{"A",      RETRO_DEVICE_ID_JOYPAD_A},
+	{"X",      RETRO_DEVICE_ID_JOYPAD_X},
+	{"L",      RETRO_DEVICE_ID_JOYPAD_L},
+	{"R",      RETRO_DEVICE_ID_JOYPAD_R},
+	{"L2",     RETRO_DEVICE_ID_JOYPAD_L2},
+	{"R2",     RETRO_DEVICE_ID_JOYPAD_R2},
+	{"L3",     RETRO_DEVICE_ID_JOYPAD_L3},
+	{"R3",     RETRO_DEVICE_ID_JOYPAD_R3},
+};
+
+// "A+RIGHT", "0x0101" or "-" (nothing held)
+static int parse_buttons(char* spec, uint32_t* out) {
+	if (!strcmp(spec, "-")) {
+		*out = 0;
+		return 0;
+	}
+	if (spec[0]=='0' && (spec[1]=='x' || spec[1]=='X')) {
+		char* end;
+		*out = strtoul(spec, &end, 16);
+		return *end ? -1 : 0;
+	}
+
+	uint32_t mask = 0;
+	for (char* name=strtok(spec, "+"); name; name=strtok(NULL, "+")) {
+		int found = 0;
+		for (int i=0; i<(int)(sizeof(button_names)/sizeof(button_names[0])); i++) {
+			if (!strcasecmp(name, button_names[i].name)) {
+				mask |= 1 << button_names[i].id;
+				found = 1;
+				break;
+			}
+		}
+		if (!found) return -1;
+	}
+	*out = mask;
+	return 0;
+}
+
+// One "<frame> <buttons>" per line, held until the next line; # starts a comment
+static int load_inputs(const char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		LOG_error("headless: can't open input script %s\n", path);
+		return -1;
+	}
+
+	int capacity = 0;
+	int last_frame = -1;
+	char line[256];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), file)) {
+		line_number += 1;
+		char* comment = strchr(line, '#');
+		if (comment) *comment = '\0';
+
+		int frame;
+		char spec[128];
+		int fields = sscanf(line, "%d %127s", &frame, spec);
+		if (fields<=0) continue;
+
+		uint32_t mask;
+		if (fields!=2 || frame<=last_frame || parse_buttons(spec, &mask)) {
+			LOG_error("headless: %s:%i: expected \"<frame> <buttons>\" in frame order\n", path, line_number);
+			fclose(file);
+			return -1;
+		}
+		last_frame = frame;
+
+		if (headless.input_count==capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			headless.inputs = realloc(headless.inputs, capacity * sizeof(HeadlessInput));
+		}
+		headless.inputs[headless.input_count++] = (HeadlessInput){frame, mask};
+	}
+	fclose(file);
+
+	LOG_info("headless: %i input events from %s\n", headless.input_count, path);
+	return 0;
+}
+
+uint32_t Headless_pollButtons(void) {
+	while (headless.input_index<headless.input_count && headless.inputs[headless.input_index].frame<=headless.frame) {
+		headless.buttons = headless.inputs[headless.input_index++].buttons;
+	}
+	return headless.buttons;
+}
+
+static void rewind_inputs(void) {
+	headless.frame = 0;
+	headless.input_index = 0;
+	headless.buttons = 0;
+}
+
+///////////////////////////////
+// Null video/audio
+
+void Headless_addConvertTime(uint64_t us) {
+	HeadlessFrame* frame = current_frame();
+	if (frame) frame->convert_us += us;
+}
+
+// Stands in for the SND batching the device does: copy into a ring and count
+size_t Headless_audioSampleBatch(const int16_t* data, size_t frames) {
+	uint64_t start = Headless_now();
+	for (size_t i=0; i<frames; i++) {
+		headless.audio_ring[headless.audio_pos * 2 + 0] = data[i * 2 + 0];
+		headless.audio_ring[headless.audio_pos * 2 + 1] = data[i * 2 + 1];
+		headless.audio_pos = (headless.audio_pos + 1) % HEADLESS_AUDIO_RING;
+	}
+
+	HeadlessFrame* frame = current_frame();
+	if (frame) {
+		frame->audio_us += Headless_now() - start;
+		frame->audio_frames += frames;
+	}
+	return frames;
+}
+void Headless_audioSample(int16_t left, int16_t right) {
+	const int16_t frame[2] = {left, right};
+	Headless_audioSampleBatch(frame, 1);
+}
+
+///////////////////////////////
+// Report
+
+static int compare_u32(const void* a, const void* b) {
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	return (x>y) - (x<y);
+}
+
+static void report_timing(const char* label, size_t offset, int frames) {
+	uint32_t* values = malloc(frames * sizeof(uint32_t));
+	if (!values) return;
+
+	uint64_t total = 0;
+	for (int i=0; i<frames; i++) {
+		values[i] = *(uint32_t*)((uint8_t*)&headless.frames[i] + offset);
+		total += values[i];
+	}
+	qsort(values, frames, sizeof(uint32_t), compare_u32);
+
+	printf("  %-10s avg %7.3fms  p50 %7.3fms  p99 %7.3fms  max %7.3fms\n", label,
+		total / (double)frames / 1000.0,
+		values[frames / 2] / 1000.0,
+		values[(frames * 99) / 100] / 1000.0,
+		values[frames - 1] / 1000.0);
+	free(values);
+}
+
+static void write_csv(const char* path, int frames) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		LOG_error("headless: can't write %s\n", path);
+		return;
+	}
+	fprintf(file, "frame,run_us,convert_us,audio_us,audio_frames\n");
+	for (int i=0; i<frames; i++) {
+		HeadlessFrame* frame = &headless.frames[i];
+		fprintf(file, "%i,%u,%u,%u,%u\n", i, frame->run_us, frame->convert_us, frame->audio_us, frame->audio_frames);
+	}
+	fclose(file);
+	LOG_info("headless: per-frame timing written to %s\n", path);
+}
+
+static void report(uint64_t elapsed_us) {
+	int frames = headless.frame;
+	if (!frames) {
+		printf("headless: no frames ran\n");
+		return;
+	}
+
+	uint64_t audio_frames = 0;
+	for (int i=0; i<frames; i++) audio_frames += headless.frames[i].audio_frames;
+
+	printf("headless: %s (%s), %i frames in %.2fs (%.1f fps, core %.2f fps)\n",
+		core.name, core.tag, frames, elapsed_us / 1000000.0, frames * 1000000.0 / elapsed_us, core.fps);
+	report_timing("core.run", offsetof(HeadlessFrame, run_us), frames);
+	report_timing("convert", offsetof(HeadlessFrame, convert_us), frames);
+	report_timing("audio", offsetof(HeadlessFrame, audio_us), frames);
+	printf("  audio      %.1f samples/frame (%.0fHz)\n", audio_frames / (double)frames, core.sample_rate);
+	if (headless.stalls) printf("  stalls     %i waits on the netplay/link peer\n", headless.stalls);
+}
+
+///////////////////////////////
+// Determinism check
+//
+// Replays the same inputs from the same savestate and compares the core's
+// serialized state after every frame. Any core whose state diverges can't be
+// used for lockstep netplay or rollback; serialize size and timings give the
+// state-sync cost for the ones that can.
+
+#define VERIFY_MAX_RANGES 16
+#define VERIFY_ROUNDTRIPS 60
+
+// Same mix as netplay.c's state_hash
+static uint64_t verify_hash(const uint8_t* p, size_t len) {
+	uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)len;
+	while (len>=8) {
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		h ^= v * 0xC2B2AE3D27D4EB4FULL;
+		h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ULL;
+		p += 8;
+		len -= 8;
+	}
+	while (len>0) {
+		h ^= (uint64_t)(*p++) * 0x165667B19E3779F9ULL;
+		h = ((h << 23) | (h >> 41)) * 0x9E3779B97F4A7C15ULL;
+		len--;
+	}
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static struct {
+	size_t size;
+	uint8_t* start; // state every pass starts from
+	uint8_t* scratch;
+	uint64_t serialize_us;
+	uint64_t serialize_max_us;
+	int serialize_count;
+	uint64_t unserialize_us;
+	uint64_t unserialize_max_us;
+	int unserialize_count;
+} verify;
+
+static int verify_serialize(void* data) {
+	uint64_t start = Headless_now();
+	int ok = core.serialize(data, verify.size);
+	uint64_t us = Headless_now() - start;
+	verify.serialize_us += us;
+	verify.serialize_count += 1;
+	if (us>verify.serialize_max_us) verify.serialize_max_us = us;
+	return ok;
+}
+
+static int verify_unserialize(const void* data) {
+	uint64_t start = Headless_now();
+	int ok = core.unserialize(data, verify.size);
+	uint64_t us = Headless_now() - start;
+	verify.unserialize_us += us;
+	verify.unserialize_count += 1;
+	if (us>verify.unserialize_max_us) verify.unserialize_max_us = us;
+	return ok;
+}
+
+// Runs frames [0, frames) from the start state, hashing the state after each.
+// Stops early at the first hash that differs from expected (if given). The
+// state after the last frame run is left in verify.scratch. Returns the number
+// of frames run or -1 if the core failed to (un)serialize.
+static int verify_pass(int frames, uint64_t* hashes, const uint64_t* expected) {
+	if (!verify_unserialize(verify.start)) {
+		LOG_error("headless: unserialize failed\n");
+		return -1;
+	}
+	rewind_inputs();
+	memset(headless.frames, 0, headless.frame_count * sizeof(HeadlessFrame));
+
+	for (int i=0; i<frames; i++) {
+		headless.frame = i;
+		core.run();
+		if (core.serialize_size()!=verify.size) {
+			LOG_error("headless: serialize size changed from %zu to %zu at frame %i\n", verify.size, core.serialize_size(), i);
+			return -1;
+		}
+		if (!verify_serialize(verify.scratch)) {
+			LOG_error("headless: serialize failed at frame %i\n", i);
+			return -1;
+		}
+		hashes[i] = verify_hash(verify.scratch, verify.size);
+		if (expected && hashes[i]!=expected[i]) return i + 1;
+	}
+	return frames;
+}
+
+// Prints the byte ranges where two states differ, merging ranges less than 16 bytes apart
+static void verify_report_ranges(const uint8_t* a, const uint8_t* b, size_t size) {
+	size_t differing = 0;
+	int ranges = 0;
+	size_t i = 0;
+	while (i<size) {
+		if (a[i]==b[i]) {
+			i += 1;
+			continue;
+		}
+		size_t first = i;
+		size_t last = i;
+		while (i<size && i - last<16) {
+			if (a[i]!=b[i]) {
+				last = i;
+				differing += 1;
+			}
+			i += 1;
+		}
+		if (ranges<VERIFY_MAX_RANGES) printf("    0x%08zx-0x%08zx (%zu bytes)\n", first, last, last - first + 1);
+		ranges += 1;
+	}
+	if (ranges>VERIFY_MAX_RANGES) printf("    ... %i more ranges\n", ranges - VERIFY_MAX_RANGES);
+	printf("    %zu of %zu bytes differ in %i ranges\n", differing, size, ranges);
+}
+
+static int verify_write_hashes(const char* path, const uint64_t* hashes, int frames) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		LOG_error("headless: can't write %s\n", path);
+		return -1;
+	}
+	fprintf(file, "# %s %s %zu\n", core.name, game.name, verify.size);
+	for (int i=0; i<frames; i++) fprintf(file, "%i %016llx\n", i, (unsigned long long)hashes[i]);
+	fclose(file);
+	LOG_info("headless: state hashes written to %s\n", path);
+	return 0;
+}
+
+// Returns the first frame whose hash differs from the file (frames if none), -1 on error
+static int verify_compare_hashes(const char* path, const uint64_t* hashes, int frames) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		LOG_error("headless: can't open %s\n", path);
+		return -1;
+	}
+	int compared = 0;
+	int divergent = frames;
+	char line[256];
+	while (fgets(line, sizeof(line), file) && compared<frames) {
+		int frame;
+		unsigned long long hash;
+		if (line[0]=='#' || sscanf(line, "%d %llx", &frame, &hash)!=2) continue;
+		if (frame!=compared) break;
+		compared += 1;
+		if (hash!=hashes[frame]) {
+			divergent = frame;
+			break;
+		}
+	}
+	fclose(file);
+	if (divergent==frames && compared<frames) {
+		printf("  %s only has %i of %i frames\n", path, compared, frames);
+		return compared;
+	}
+	return divergent;
+}
+
+static int verify_run(int frames, const char* write_path, const char* compare_path) {
+	// Some cores only report a state size once a frame has run
+	headless.frame = 0;
+	core.run();
+	verify.size = core.serialize_size ? core.serialize_size() : 0;
+	if (!verify.size) {
+		printf("headless: %s has no savestates, not usable for netplay\n", core.name);
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_FAILURE;
+	verify.start = malloc(verify.size);
+	verify.scratch = malloc(verify.size);
+	uint8_t* diverged = malloc(verify.size);
+	uint64_t* first = malloc(frames * sizeof(uint64_t));
+	uint64_t* second = malloc(frames * sizeof(uint64_t));
+	if (!verify.start || !verify.scratch || !diverged || !first || !second) goto done;
+	if (!verify_serialize(verify.start)) {
+		LOG_error("headless: serialize failed\n");
+		goto done;
+	}
+
+	printf("headless: %s (%s), checking %i frames, %zu byte state\n", core.name, core.tag, frames, verify.size);
+	if (verify_pass(frames, first, NULL)<0) goto done;
+	if (write_path && verify_write_hashes(write_path, first, frames)) goto done;
+
+	int divergent = frames;
+	if (compare_path) {
+		// Another process (or device): only hashes to go on, no byte ranges
+		divergent = verify_compare_hashes(compare_path, first, frames);
+		if (divergent<0) goto done;
+		if (divergent<frames) printf("  DIVERGED from %s at frame %i\n", compare_path, divergent);
+	} else {
+		int ran = verify_pass(frames, second, first);
+		if (ran<0) goto done;
+		if (ran<frames || second[frames - 1]!=first[frames - 1]) {
+			divergent = ran - 1;
+			printf("  DIVERGED at frame %i\n", divergent);
+			// Keep the second pass's state, then replay once more for a state
+			// matching the first pass to diff against
+			memcpy(diverged, verify.scratch, verify.size);
+			ran = verify_pass(divergent + 1, second, NULL);
+			if (ran<0) goto done;
+			if (second[divergent]!=first[divergent]) {
+				printf("  (a third pass diverged from the first too, the core is not reproducible)\n");
+			}
+			verify_report_ranges(verify.scratch, diverged, verify.size);
+		}
+	}
+	if (divergent==frames) printf("  deterministic over %i frames\n", frames);
+
+	// Round trips: loading a state and saving it again must give the same bytes
+	int roundtrip_ok = 1;
+	uint64_t expected = verify_hash(verify.scratch, verify.size);
+	memcpy(diverged, verify.scratch, verify.size);
+	for (int i=0; i<VERIFY_ROUNDTRIPS && roundtrip_ok; i++) {
+		if (!verify_unserialize(diverged) || !verify_serialize(verify.scratch)) roundtrip_ok = 0;
+		else if (verify_hash(verify.scratch, verify.size)!=expected) roundtrip_ok = 0;
+	}
+	if (!roundtrip_ok) printf("  state changes when reloaded and saved again (unsafe for rollback)\n");
+
+	printf("  state      %zu bytes (%.1fKB)\n", verify.size, verify.size / 1024.0);
+	printf("  serialize  avg %7.3fms  max %7.3fms\n",
+		verify.serialize_us / (double)verify.serialize_count / 1000.0, verify.serialize_max_us / 1000.0);
+	printf("  unserialize avg %6.3fms  max %7.3fms\n",
+		verify.unserialize_us / (double)verify.unserialize_count / 1000.0, verify.unserialize_max_us / 1000.0);
+
+	if (divergent==frames && roundtrip_ok) status = EXIT_SUCCESS;
+
+done:
+	free(verify.start);
+	free(verify.scratch);
+	free(diverged);
+	free(first);
+	free(second);
+	return status;
+}
+
+///////////////////////////////
+
+static void usage(const char* name) {
+	fprintf(stderr,
+		"usage: %s <core.so> <rom> [options]\n"
+		"  -n FRAMES   frames to run (default %i)\n"
+		"  -i FILE     input script, \"<frame> <buttons>\" per line (eg. \"120 A+RIGHT\")\n"
+		"  -o FILE     write per-frame timing as CSV\n"
+		"  -p          pace to the core's fps instead of running flat out\n"
+		"  -N host|IP  host or join a netplay session\n"
+		"  -G host|IP  host or join a GBA Link session\n"
+		"  -V          determinism check: replay the inputs twice from one state and\n"
+		"              compare the serialized state every frame\n"
+		"  -H FILE     with -V, write the per-frame state hashes\n"
+		"  -c FILE     with -V, compare against hashes written by another run\n",
+		name, HEADLESS_DEFAULT_FRAMES);
+}
+
+static int start_link(LinkType type, const char* target) {
+	int hosting = !strcmp(target, "host");
+	int result;
+	if (type==LINK_TYPE_NETPLAY) {
+		result = hosting ? Netplay_startHost(game.name, calculateGameCRC(), NULL) : Netplay_connectToHost(target, NETPLAY_DEFAULT_PORT);
+	} else {
+		const char* link_mode = minarch_getCoreOptionValue("gpsp_serial");
+		result = hosting ? GBALink_startHost(game.name, calculateGameCRC(), NULL, link_mode) : GBALink_connectToHost(target, GBALINK_DEFAULT_PORT);
+	}
+	if (result!=0) {
+		LOG_error("headless: failed to %s %s\n", hosting ? "host" : "connect to", type==LINK_TYPE_NETPLAY ? "netplay" : "GBA Link");
+		return -1;
+	}
+
+	// Only time frames once the peer is in (hosts otherwise run alone until it joins)
+	LOG_info("headless: waiting for peer...\n");
+	uint32_t start = SDL_GetTicks();
+	while (!Multiplayer_isActive()) {
+		GBALink_update();
+		if (SDL_GetTicks() - start>HEADLESS_CONNECT_TIMEOUT_MS) {
+			LOG_error("headless: no peer after %is\n", HEADLESS_CONNECT_TIMEOUT_MS / 1000);
+			return -1;
+		}
+		SDL_Delay(10);
+	}
+	LOG_info("headless: peer connected\n");
+	return 0;
+}
+
+int Headless_main(int argc, char* argv[]) {
+	int frame_count = HEADLESS_DEFAULT_FRAMES;
+	char* input_path = NULL;
+	char* csv_path = NULL;
+	char* netplay_target = NULL;
+	char* gbalink_target = NULL;
+	int paced = 0;
+	int verify_mode = 0;
+	char* hashes_path = NULL;
+	char* compare_path = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:i:o:pN:G:VH:c:h"))!=-1) {
+		switch (opt) {
+			case 'n': frame_count = atoi(optarg); break;
+			case 'i': input_path = optarg; break;
+			case 'o': csv_path = optarg; break;
+			case 'p': paced = 1; break;
+			case 'N': netplay_target = optarg; break;
+			case 'G': gbalink_target = optarg; break;
+			case 'V': verify_mode = 1; break;
+			case 'H': hashes_path = optarg; break;
+			case 'c': compare_path = optarg; break;
+			default: usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind<2 || frame_count<=0 || (netplay_target && gbalink_target)
+			|| ((hashes_path || compare_path) && !verify_mode) || (verify_mode && (netplay_target || gbalink_target))) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (input_path && load_inputs(input_path)) return EXIT_FAILURE;
+
+	char core_path[MAX_PATH];
+	char rom_path[MAX_PATH];
+	char tag_name[MAX_PATH];
+	strcpy(core_path, argv[optind]);
+	strcpy(rom_path, argv[optind + 1]);
+	getEmuName(rom_path, tag_name);
+
+	// Cores only see the frontend through callbacks, so an offscreen surface
+	// stands in for the display
+	screen = SDL_CreateRGBSurfaceWithFormat(0, FIXED_WIDTH, FIXED_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888);
+	DEVICE_WIDTH = screen->w;
+	DEVICE_HEIGHT = screen->h;
+	DEVICE_PITCH = screen->pitch;
+
+	headless.frame_count = frame_count;
+	headless.frames = calloc(frame_count, sizeof(HeadlessFrame));
+
+	int status = EXIT_FAILURE;
+	Core_open(core_path, tag_name);
+	Game_open(rom_path);
+	if (!game.is_open) goto finish;
+
+	Config_load();
+	Config_init();
+	Config_readOptions();
+	Core_init();
+	Core_load();
+	Input_init(NULL);
+	Config_readOptions();
+	Config_readControls();
+	Config_free();
+
+	if (verify_mode) {
+		status = verify_run(frame_count, hashes_path, compare_path);
+		goto finish;
+	}
+
+	if (netplay_target && start_link(LINK_TYPE_NETPLAY, netplay_target)) goto finish;
+	if (gbalink_target && start_link(LINK_TYPE_GBALINK, gbalink_target)) goto finish;
+
+	LOG_info("headless: running %i frames%s\n", frame_count, paced ? " (paced)" : "");
+	uint64_t frame_us = core.fps>0 ? (uint64_t)(1000000.0 / core.fps) : 16667;
+	uint64_t start = Headless_now();
+	uint64_t next_frame = start;
+	while (!quit && headless.frame<frame_count) {
+		// Same ordering as main(): peer sync before the core runs
+		if (!Netplay_update((uint16_t)Input_getButtons(), core.serialize_size, core.serialize, core.unserialize)) {
+			input_poll_callback();
+			headless.stalls += 1;
+			continue;
+		}
+
+		GBALink_update();
+		if (!GBALink_pollAndDeliverPackets()) {
+			input_poll_callback();
+			headless.stalls += 1;
+			continue;
+		}
+		GBLink_pollConnectionState();
+
+		uint64_t run_start = Headless_now();
+		if (Netplay_isStreamClient()) {
+			input_poll_callback();
+			Netplay_presentStream(video_refresh_callback, Headless_audioSampleBatch);
+		} else {
+			core.run();
+		}
+		// Conversion and audio run inside core.run() via the callbacks, report them apart
+		HeadlessFrame* frame = &headless.frames[headless.frame];
+		uint32_t elapsed = Headless_now() - run_start;
+		uint32_t callbacks = frame->convert_us + frame->audio_us;
+		frame->run_us = elapsed>callbacks ? elapsed - callbacks : 0;
+
+		if (Netplay_isActive()) {
+			Netplay_postFrame();
+		}
+		GBALink_flushSend();
+		headless.frame += 1;
+
+		if (paced) {
+			next_frame += frame_us;
+			uint64_t now = Headless_now();
+			if (next_frame>now) usleep(next_frame - now);
+			else next_frame = now; // don't try to catch up after a slow frame
+		}
+	}
+	report(Headless_now() - start);
+	if (csv_path) write_csv(csv_path, headless.frame);
+	status = EXIT_SUCCESS;
+
+finish:
+	Netplay_quitAll();
+	if (game.is_open) {
+		Game_close();
+		Core_unload();
+	}
+	Core_quit();
+	Core_close();
+	Config_quit();
+	Video_cleanup();
+	SDL_FreeSurface(screen);
+	free(headless.frames);
+	free(headless.inputs);
+	return status;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Headless minarch (HEADLESS=1 builds only): null video, audio and input,
+// inputs from a script file and per-frame timing of the frontend hot paths.
+//
+//   minarch_headless.elf <core.so> <rom> [-n frames] [-i inputs] [-o timing.csv]
+//                        [-p] [-N host|ip] [-G host|ip]
+//                        [-V [-H hashes] [-c hashes]]
+
+// Replaces main() - runs the core through Core_open/Game_open/Core_load and
+// the same netplay/link frame loop as minarch, then prints the timings
+int Headless_main(int argc, char* argv[]);
+
+// Scripted RETRO_DEVICE_ID_JOYPAD_* buttons for the current frame (input_poll_callback)
+uint32_t Headless_pollButtons(void);
+
+// Timing hooks
+uint64_t Headless_now(void); // Monotonic microseconds
+void Headless_addConvertTime(uint64_t us); // Pixel conversion in video_refresh_callback
+
+// Null audio sink (registered by Core_open)
+void Headless_audioSample(int16_t left, int16_t right);
+size_t Headless_audioSampleBatch(const int16_t* data, size_t frames);
@@ -1,6 +1,9 @@
 #include "ma_internal.h"
 #include "ma_input.h"
 #include "netplay_helper.h" // Netplay_*/Multiplayer_*/NETPLAY_* used in input callbacks
+#ifdef HEADLESS
+#include "ma_headless.h"
+#endif
 
 #include <string.h>
 
@@ -19,6 +22,10 @@ static int ignore_menu = 0;
 // Expose the current local button bitmask to minarch.c's netplay input sync.
 uint32_t Input_getButtons(void) { return buttons; }
 void input_poll_callback(void) {
+#ifdef HEADLESS
+	buttons = Headless_pollButtons(); // scripted, no pad or shortcuts
+	return;
+#endif
 	PAD_poll();
 
 	int show_setting = 0;
@@ -4,6 +4,10 @@
 #include "ma_internal.h"
 #include "scaler.h"
 #include "ma_video.h"
+#include "netplay.h"
+#ifdef HEADLESS
+#include "ma_headless.h"
+#endif
 
 // When set, video_refresh_callback drops the frame. minarch_forceCoreOptionUpdate()
 // uses this to run one core frame purely to trigger check_variables() without flashing.
@@ -957,6 +961,9 @@ void video_refresh_callback(const void* data, unsigned width, unsigned height, s
 	// Suppress output for forced option-update frames (minarch_forceCoreOptionUpdate)
 	if (skip_video_output) return;
 
+	// Stream-mode netplay host: forward the native frame before conversion
+	Netplay_streamVideo(data, width, height, pitch, fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2);
+
 	// Allocate RGBA buffer if needed
 	if (!rgbaData || rgbaDataSize != width * height) {
 		if (rgbaData) free(rgbaData);
@@ -974,17 +981,27 @@ void video_refresh_callback(const void* data, unsigned width, unsigned height, s
 		if (!data) return;
 	} else {
 		// Convert pixel format to RGBA
+#ifdef HEADLESS
+		uint64_t convert_start = Headless_now();
+#endif
 		if (fmt == RETRO_PIXEL_FORMAT_XRGB8888) {
 			convert_xrgb8888_to_rgba(data, rgbaData, width, height, pitch);
 		} else {
 			convert_rgb565_to_rgba(data, rgbaData, width, height, pitch);
 		}
+#ifdef HEADLESS
+		Headless_addConvertTime(Headless_now() - convert_start);
+#endif
 		
 		data = rgbaData;
 		lastframe = data;
 	}
 	pitch = width * sizeof(Uint32);
 
+#ifdef HEADLESS
+	return; // null video: nothing to present
+#endif
+
 	// Set ambient lighting color (if enabled)
 	if (ambient_mode && !fast_forward && data) {
 		GFX_setAmbientColor(data, width, height, pitch, ambient_mode);
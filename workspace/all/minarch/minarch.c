@@ -25,6 +25,9 @@
 #include "ma_environment.h"
 #include "ma_config.h"
 #include "ma_runframe.h"
+#ifdef HEADLESS
+#include "ma_headless.h"
+#endif
 
 ///////////////////////////////////////
 
@@ -142,6 +145,10 @@ int main(int argc , char* argv[]) {
 	//else 
 	//	LOG_info("asoundrc does not exist at %s\n", asoundpath);
 
+#ifdef HEADLESS
+	return Headless_main(argc, argv); // null video/audio/input benchmark build
+#endif
+
 	if(argc < 2)
 		return EXIT_FAILURE;
 
@@ -271,10 +278,17 @@ int main(int argc , char* argv[]) {
 		}
 
 		GBALink_update();
-		GBALink_pollAndDeliverPackets();
+		if (!GBALink_pollAndDeliverPackets()) {
+			input_poll_callback(); // GBA Link frame lock: peer is behind, wait for it
+			continue;
+		}
 		GBLink_pollConnectionState(); // GB Link: detect connect/disconnect from the socket table
 
-		if (Multiplayer_isActive()) {
+		if (Netplay_isStreamClient()) {
+			// Stream mode: the host runs the core, we only present its output
+			input_poll_callback();
+			Netplay_presentStream(video_refresh_callback, audio_sample_batch_callback);
+		} else if (Multiplayer_isActive()) {
 			core.run(); // link/netplay drives timing; rewind & FF are disabled
 		} else {
 			run_frame();
@@ -282,6 +296,7 @@ int main(int argc , char* argv[]) {
 		if (Netplay_isActive()) {
 			Netplay_postFrame();
 		}
+		GBALink_flushSend(); // GBA Link: send whatever the core queued this frame
 
 		// Process RetroAchievements for this frame
 		RA_doFrame();
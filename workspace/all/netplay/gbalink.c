@@ -3,7 +3,8 @@
  * Implements GBA Wireless Adapter (RFU) emulation over WiFi
  *
  * This module provides a transport layer for the libretro netpacket interface,
- * allowing gpSP to use its built-in Wireless Adapter (RFU) emulation over TCP.
+ * allowing gpSP to use its built-in Wireless Adapter (RFU) emulation over TCP
+ * (or, when the host picks it, a reliable UDP channel - see RUDP_WINDOW).
  *
  * gpSP has complete RFU support (rfu.c - 937 lines) that handles the complex
  * wireless adapter protocol used by Pokemon games for trading and battles.
@@ -15,17 +16,23 @@
  *
  * Supported features via gpSP:
  * - Pokemon trading (FireRed/LeafGreen/Ruby/Sapphire/Emerald)
- * - Pokemon battles (Union Room)
+ * - Pokemon battles (Union Room, including 4-player multi battles)
+ *
+ * Topology is a star: the host accepts up to GBALINK_MAX_CLIENTS clients and
+ * relays client-to-client packets, so every device only keeps one connection
+ * per peer it actually talks to (clients: one, host: one per client).
  */
 
 #define _GNU_SOURCE  // For strcasestr
 
 #include "gbalink.h"
+#include "gbalink_trace.h"
 #include "minarch.h"
 #include "netplay_helper.h"
 #include "network_common.h"
 #include "defines.h"  // Must come before api.h for BTN_ID_COUNT
 #include "api.h"
+#include "utils.h"
 #ifdef HAS_WIFIMG
 #include "wifi_direct.h"
 #endif
@@ -40,6 +47,9 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -50,9 +60,11 @@
 #define GL_DISCOVERY_QUERY  0x47424451  // "GBDQ" - GBA Link Discovery Query
 #define GL_DISCOVERY_RESP   0x47424452  // "GBDR" - GBA Link Discovery Response
 
-// Discovery broadcast interval
+// Discovery broadcast interval (backs off once hosting for a while)
 #define DISCOVERY_BROADCAST_INTERVAL_US 500000  // 500ms
 
+_Static_assert(sizeof(GBALinkHostInfo) == sizeof(NET_HostInfo), "GBALinkHostInfo must match NET_HostInfo");
+
 // Network commands
 enum {
     CMD_SIO_DATA   = 0x01,  // SIO packet data from core
@@ -61,6 +73,10 @@ enum {
     CMD_DISCONNECT = 0x04,
     CMD_READY      = 0x05,  // Signal ready for SIO exchange
     CMD_HEARTBEAT  = 0x06,  // Keepalive during idle periods
+    CMD_SIO_FRAME  = 0x07,  // SIO packet tagged with the sender's frame (frame lock)
+    CMD_FRAME_END  = 0x08,  // Sender finished a frame (frame lock)
+    CMD_FRAME_LOCK = 0x09,  // Host sets the frame lock delay (handshake and adaptation)
+    CMD_TRANSPORT  = 0x0A,  // Host switches the session to reliable UDP (handshake)
 };
 
 // Heartbeat interval - RFU protocol requires host to send data so clients can respond
@@ -68,6 +84,10 @@ enum {
 // (100ms was too aggressive and could overwhelm slow receivers)
 #define HEARTBEAT_INTERVAL_MS 500
 
+// Packet capture: create this file to trace every session to SHARED_USERDATA_PATH
+// (replay with workspace/all/gbalink_replay)
+#define GBALINK_TRACE_FLAG_PATH SHARED_USERDATA_PATH "/.gbalink_trace"
+
 // Connection timeout - disconnect if no packets received for this long
 // 60 seconds provides headroom for:
 // - WiFi latency spikes and packet loss
@@ -76,6 +96,32 @@ enum {
 // Real disconnections are still detected via TCP errors and heartbeat failures
 #define GBALINK_CONNECTION_TIMEOUT_MS 60000
 
+// Frame-locked delivery (optional, chosen by the host): every SIO packet carries
+// the sender's frame number and is handed to the receiving core at exactly
+// sender_frame + delay, so both cores see the same wireless timing regardless of
+// network jitter. A device that would get more than delay frames ahead of its
+// peer waits for it, like netplay. The host adapts delay to the measured RTT.
+#define FRAME_LOCK_DEFAULT_DELAY     4     // Frames, until RTT samples come in
+#define FRAME_LOCK_MIN_DELAY         2
+#define FRAME_LOCK_MAX_DELAY         30    // ~500ms
+#define FRAME_LOCK_FRAME_MS          17    // GBA runs at ~59.73fps
+#define FRAME_LOCK_ADAPT_INTERVAL_MS 2000  // How often the host re-evaluates delay
+
+// Reliable UDP transport (optional, chosen by the host): after the TCP handshake
+// the packet stream moves to a UDP socket. The stream is cut into numbered
+// segments; every datagram acks the contiguous segments received plus a SACK
+// bitmap of the ones after them, a gap is resent as soon as later segments are
+// SACKed instead of after a TCP retransmit timeout, and segments are put back in
+// order into stream_buf, so packet parsing is the same as over TCP. The TCP
+// connection stays open to detect the peer leaving.
+#define RUDP_WINDOW           32    // Segments in flight, and reorder slots
+#define RUDP_SEGMENT_PAYLOAD  1200  // Stream bytes per datagram (below WiFi MTU)
+#define RUDP_INITIAL_RTO_MS   100
+#define RUDP_MIN_RTO_MS       20
+#define RUDP_MAX_RTO_MS       200   // Small packets on a LAN: cap backoff for latency
+#define RUDP_FAST_RETX_SACKS  2     // Later segments SACKed before a gap is resent
+#define RUDP_FLAG_DATA        0x01  // Datagram carries a segment (else ack only)
+
 // Packet header for TCP communication
 typedef struct __attribute__((packed)) {
     uint8_t  cmd;
@@ -83,20 +129,160 @@ typedef struct __attribute__((packed)) {
     uint16_t client_id;  // Source client ID
 } PacketHeader;
 
+// CMD_FRAME_END payload (network byte order). The echo fields return the
+// peer's last sent_ms so each side can measure RTT without extra packets.
+typedef struct __attribute__((packed)) {
+    uint32_t frame;         // Frame the sender just finished
+    uint32_t sent_ms;       // Sender's monotonic clock
+    uint32_t echo_ms;       // Latest sent_ms received from the peer (0 = none yet)
+    uint32_t echo_hold_ms;  // Time echo_ms was held before this reply
+} FrameEndPayload;
+
+// CMD_FRAME_LOCK payload (network byte order)
+typedef struct __attribute__((packed)) {
+    uint16_t delay;         // Frames between sending and delivery
+    uint32_t from_frame;    // First frame the delay applies to
+} FrameLockPayload;
+
+// Client CMD_READY and host CMD_TRANSPORT payload (network byte order): the
+// sender's UDP port for the reliable UDP transport
+typedef struct __attribute__((packed)) {
+    uint16_t udp_port;
+} TransportPayload;
+
+// Reliable UDP datagram header (network byte order), followed by the segment
+typedef struct __attribute__((packed)) {
+    uint8_t  flags;
+    uint32_t seq;           // Segment number (RUDP_FLAG_DATA only)
+    uint32_t ack;           // Every segment before this one was received
+    uint32_t sack;          // Bit n: segment ack + 1 + n was received
+} RudpHeader;
+
 // Receive buffer for incoming packets
 // GBA wireless packets vary in size: trades ~32 bytes, battles ~200 bytes max
 // 2048 bytes is sufficient headroom while reducing memory usage
 #define RECV_BUFFER_SIZE 2048
+
+// A client must send READY within this long after the host accepts it
+#define HOST_HANDSHAKE_TIMEOUT_MS 5000
+
+// Receive ring - single-producer/single-consumer byte ring holding variable-length
+// records back to back. The network side only advances rx_head and core delivery
+// only advances rx_tail, so the per-packet path needs no lock. 16KB holds several
+// hundred typical RFU packets (vs 32 fixed 2KB slots before).
+#define RX_RING_SIZE     16384  // Must be a power of two
+#define RX_RING_MASK     (RX_RING_SIZE - 1)
+#define RX_RECORD_ALIGN  4
+#define RX_RECORD_WRAP   0xFFFF // Record length marker: skip to start of ring
+
 typedef struct {
-    uint8_t data[RECV_BUFFER_SIZE];
-    size_t len;
+    uint16_t len;
     uint16_t client_id;
-} ReceivedPacket;
+    uint32_t arrival_ms;  // Monotonic time the packet was parsed off the socket
+    uint32_t frame;       // Sender's frame (frame lock only)
+} RxRecordHeader;
+
+#define RX_RECORD_SIZE(len) \
+    ((sizeof(RxRecordHeader) + (len) + RX_RECORD_ALIGN - 1) & ~(size_t)(RX_RECORD_ALIGN - 1))
+
+// Free space required before reading another packet off the socket
+// (largest record plus worst-case wrap padding)
+#define RX_RING_PUSH_RESERVE (2 * RX_RECORD_SIZE(RECV_BUFFER_SIZE))
+
+// Transmit batch - SIO packets the core sends during core.run() are packed
+// (header + payload) back to back and written with one send on the core's
+// flush hint, when it polls for a reply, or at the end of the frame
+#define TX_BATCH_SIZE 8192
+
+// Transmit queue - bytes the kernel's send buffer couldn't take yet. Sends never
+// block or spin: the remainder is queued and the I/O thread writes it out when
+// epoll reports the socket writable. Overflowing it means the peer stopped
+// reading for far longer than any RFU timeout, so the link is treated as dead.
+#define TX_QUEUE_SIZE 65536
+
+// Streaming receive buffer - one maximum-size packet plus its header
+#define STREAM_BUF_SIZE (RECV_BUFFER_SIZE + sizeof(PacketHeader))
+
+// Connection buffers live in one allocation per peer, made when its slot is
+// reserved and released on disconnect, so idle slots cost nothing
+#define PEER_BUFFERS_SIZE (STREAM_BUF_SIZE + TX_BATCH_SIZE + TX_QUEUE_SIZE)
+
+// One reliable UDP segment (send window slot or receive reorder slot)
+typedef struct {
+    uint8_t data[RUDP_SEGMENT_PAYLOAD];
+    uint16_t len;                  // 0 = free slot
+    uint16_t offset;               // Receive: bytes already moved into stream_buf
+    uint32_t seq;
+    uint32_t sent_ms;              // Send: last (re)transmission
+    uint8_t retries;               // Send: retransmissions so far
+    bool sacked;                   // Send: peer has it, cumulative ack pending
+    bool fast_retx;                // Send: already resent for a SACK gap
+} RudpSegment;
+
+// Reliable UDP state of one peer (protected by mutex), slots indexed by seq % RUDP_WINDOW.
+// Allocated only once the handshake switches the peer to UDP.
+typedef struct {
+    RudpSegment tx[RUDP_WINDOW];
+    uint32_t tx_next;              // Next segment number to send
+    uint32_t tx_una;               // Oldest segment not acked yet
+    RudpSegment rx[RUDP_WINDOW];
+    uint32_t rx_next;              // Next segment to move into stream_buf
+    bool ack_pending;              // Received data since our last datagram
+    bool has_rtt;
+    uint32_t srtt_ms;
+    uint32_t rttvar_ms;
+    uint32_t rto_ms;
+    uint32_t sent;                 // Stats, logged when the socket closes
+    uint32_t retransmits;
+    uint32_t fast_retransmits;
+} RudpState;
+
+// One TCP connection. A client has a single peer (the host); the host has one
+// per client, in slot (client_id - 1).
+typedef struct {
+    int fd;
+    uint16_t client_id;            // Remote's netpacket client ID (0 = host)
+    char ip[16];
+
+    // Lifecycle: fd >= 0 && !ready means the slot is reserved for a handshake
+    // and owned by the thread running it (host: the event loop); ready means
+    // the I/O thread owns it
+    bool ready;
+    uint32_t handshake_deadline_ms;  // Host: client READY due (monotonic_ms)
+    bool announced;                // Core told via connected() (main thread)
+    volatile bool pending_disconnect;  // Lost after announce, main thread tells core
+
+    // Streaming receive buffer for handling partial TCP reads
+    // Uses read/write indices to avoid memmove on every packet
+    uint8_t* stream_buf;          // STREAM_BUF_SIZE, start of the peer's buffer block
+    size_t stream_buf_read_idx;   // Where to read next packet from
+    size_t stream_buf_write_idx;  // Where to write incoming data
+
+    // Outbound SIO batch (main thread only)
+    uint8_t* tx_batch;            // TX_BATCH_SIZE
+    size_t tx_batch_len;
+
+    // Unsent bytes waiting for EPOLLOUT, or for window space over reliable UDP
+    // (protected by mutex)
+    uint8_t* tx_queue;            // TX_QUEUE_SIZE
+    size_t tx_queue_head;
+    size_t tx_queue_len;
+    bool tx_watch_writable;        // EPOLLOUT currently armed
+
+    // Heartbeat/keepalive tracking - critical for RFU protocol
+    // The host must send data (even dummy) so clients can respond
+    struct timeval last_packet_sent;
+    struct timeval last_packet_received;
 
+    // Frame lock (written by the I/O thread under mutex)
+    uint32_t remote_frame;         // Last frame the peer finished
+    uint32_t echo_ms;              // Peer's latest FrameEndPayload.sent_ms
+    uint32_t echo_received_ms;     // When it arrived
 
-// Pending packet queue - needs enough slots to handle burst traffic during
-// trade/battle setup. 32 slots with 2KB buffers = 64KB (reduced from 256KB)
-#define MAX_PENDING_PACKETS 32
+    // Reliable UDP transport (rudp == NULL: the stream runs over TCP)
+    int udp_fd;
+    RudpState* rudp;
+} GBALinkPeer;
 
 // Main GBA Link state
 static struct {
@@ -104,16 +290,17 @@ static struct {
     GBALinkState state;
 
     // Sockets
-    int tcp_fd;         // Main TCP connection
     int listen_fd;      // Server listen socket
     int udp_fd;         // Discovery UDP broadcast socket (for sending)
     int udp_listen_fd;  // Discovery UDP listen socket (for receiving queries)
 
     // Connection info
     char local_ip[16];
-    char remote_ip[16];
     uint16_t port;
 
+    // Connections (see GBALinkPeer)
+    GBALinkPeer peers[GBALINK_MAX_CLIENTS];
+
     // Hotspot mode
     GBALinkConnMethod conn_method;
     bool using_hotspot;           // True if hotspot was started for this session
@@ -129,19 +316,33 @@ static struct {
     retro_netpacket_send_t core_send_fn;        // Stored but we provide our own to core
     retro_netpacket_poll_receive_t core_poll_fn;
 
-    // Receive buffer for delivering to core
-    ReceivedPacket pending_packets[MAX_PENDING_PACKETS];
-    int pending_count;
-    int pending_read_idx;
-    int pending_write_idx;
+    // Receive ring for delivering to core (see RX_RING_SIZE)
+    uint8_t rx_ring[RX_RING_SIZE] __attribute__((aligned(RX_RECORD_ALIGN)));
+    uint32_t rx_head;              // Bytes written (producer only)
+    uint32_t rx_tail;              // Bytes consumed (consumer only)
+    uint32_t rx_high_water;        // Peak ring usage in bytes
+    uint32_t rx_backpressure;      // Polls that stopped reading because the ring was full
+    uint32_t rx_dropped;           // Packets that could not be queued (should stay 0)
+    uint32_t rx_max_delay_ms;      // Longest time a packet waited in the ring
+
+    // Receive I/O thread - blocks in epoll on all peer sockets, parses packets
+    // into the ring and relays client-to-client traffic on the host
+    pthread_t io_thread;
+    bool io_thread_started;
+    volatile bool io_running;
+    int io_epoll_fd;
+    int io_wake_fd;                // eventfd: stop, first RUDP segment in flight, ring drained
+    bool io_reads_paused;          // Ring full: stream sockets left unread (I/O thread, mutex held)
+    bool rx_waiting;               // I/O thread wants a wake once the ring has room (atomic)
 
     // Discovery
-    GBALinkHostInfo discovered_hosts[GBALINK_MAX_HOSTS];
-    int num_hosts;
+    NET_DiscoveryCache discovery;
     bool discovery_active;
 
-    // Threading
-    pthread_t listen_thread;
+    // Host listen, handshake and discovery work runs on the shared event loop
+    int broadcast_timer_fd;
+    int handshake_timer_fd;       // Armed for the earliest pending handshake deadline
+    NET_BroadcastTimer broadcast_timer;
     pthread_mutex_t mutex;
     volatile bool running;
 
@@ -151,18 +352,7 @@ static struct {
     // Core support flag
     bool has_netpacket_support;
 
-    // Streaming receive buffer for handling partial TCP reads
-    // Uses read/write indices to avoid memmove on every packet
-    uint8_t stream_buf[RECV_BUFFER_SIZE + sizeof(PacketHeader)];
-    size_t stream_buf_read_idx;   // Where to read next packet from
-    size_t stream_buf_write_idx;  // Where to write incoming data
-
-    // Heartbeat/keepalive tracking - critical for RFU protocol
-    // The host must send data (even dummy) so clients can respond
-    struct timeval last_packet_sent;
-    struct timeval last_packet_received;
-
-    // Deferred connection notification (listen thread sets, main thread processes)
+    // Deferred connection notification (event loop sets, main thread processes)
     // Required because core callbacks must be called from main thread
     volatile bool pending_host_connected;
 
@@ -172,35 +362,84 @@ static struct {
     // Core netpacket callbacks (set by minarch when core registers)
     struct retro_netpacket_callback core_callbacks;
     bool has_core_callbacks;
+    GBALinkCoreQueueFreeFn core_queue_free;    // Optional, see GBALink_setCoreQueueProbe
+    GBALinkCoreQueueStatsFn core_queue_stats;
+    uint32_t core_stalls;          // Deliveries held back because the core's queue was full
+    GBALinkCoreWaitingFn core_waiting;         // Optional, see GBALink_setCoreReplyProbe
+    uint32_t reply_stalls;         // Frames held for the core's reply
 
     // Netpacket bridging state
     bool netpacket_active;
-    uint16_t remote_client_id;  // Cached: 1 if we're host, 0 if we're client
+    bool delivering;               // Inside core_callbacks.receive (re-entrancy guard)
+
+    uint32_t frame;                // Frames run since the session started
+
+    // Packet trace (main thread only, see gbalink_trace.h)
+    FILE* trace_file;
+    uint32_t trace_start_ms;
+
+    // Frame-locked delivery (see FRAME_LOCK_DEFAULT_DELAY)
+    bool frame_lock_requested;     // Host setting, applied when hosting starts
+    bool frame_lock;               // Active for this session
+    uint32_t frame_delay;          // Delay in effect (main thread)
+    uint32_t pending_delay;        // Next delay, 0 if none (mutex)
+    uint32_t pending_delay_frame;  // Frame pending_delay takes effect
+    uint32_t rtt_ms;               // Smoothed RTT from frame-end echoes (mutex)
+    uint32_t last_adapt_ms;
+    uint32_t stall_frames;         // Frames spent waiting on a peer
+
+    // Packet transport (see RUDP_WINDOW)
+    GBALinkTransport transport_requested;  // Host setting, applied when hosting starts
+    GBALinkTransport transport;            // Offered to clients this session (host)
 
     // Link mode synchronization (host's gpsp_serial value sent to client)
     char link_mode[32];
 
+    // Host doesn't answer discovery (another module advertises the session)
+    bool advertise_off;
+
     // Pending reload state (when client's link mode differs from host's)
     bool needs_reload;
     char pending_link_mode[32];   // Host's mode (what to change to)
     char client_link_mode[32];    // Client's current mode
 
-    // Performance optimization: reduce getsockopt frequency
-    int error_check_counter;
-
     // Cached frame time to avoid multiple gettimeofday() calls per frame
     struct timeval frame_time;
     bool frame_time_valid;
 
-    // Deferred disconnect notification (set by recv_packet, processed after mutex release)
+    // Deferred disconnect notification (set by the receive path, processed on main thread)
     volatile bool pending_disconnect_notify;
 } gl = {0};
 
 // Forward declarations
-static bool send_packet(uint8_t cmd, const void* data, uint16_t size, uint16_t client_id);
-static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int timeout_ms);
-static void* listen_thread_func(void* arg);
+static bool tx_write(GBALinkPeer* peer, const void* buf, size_t len);
+static bool tx_queue_flush(GBALinkPeer* peer);
+static bool tx_queue_append(GBALinkPeer* peer, const void* buf, size_t len);
+static bool send_packet(GBALinkPeer* peer, uint8_t cmd, const void* data, uint16_t size, uint16_t client_id);
+static bool recv_packet(GBALinkPeer* peer, PacketHeader* hdr, void* data, uint16_t max_size, int timeout_ms);
+static bool stream_fill(GBALinkPeer* peer);
+static bool stream_parse(GBALinkPeer* peer, PacketHeader* hdr, void* data, uint16_t max_size, const struct timeval* now);
+static void handle_remote_close(GBALinkPeer* peer, const char* client_msg);
+static void io_thread_stop(void);
+static void GBALink_restartBroadcast(void);
+static void close_discovery_sockets(void);
+static void on_listen_ready(int listen_fd, uint32_t events, void* ctx);
+static void on_discovery_query(int fd, uint32_t events, void* ctx);
+static void on_broadcast_timer(int fd, uint32_t events, void* ctx);
+static void on_handshake_data(int fd, uint32_t events, void* ctx);
+static void on_handshake_timer(int fd, uint32_t events, void* ctx);
+static void host_abort_handshakes(void);
 static void GBALink_sendHeartbeatIfNeeded(const struct timeval* now);
+static uint16_t rudp_open(GBALinkPeer* peer);
+static bool rudp_connect(GBALinkPeer* peer, uint16_t port);
+static bool rudp_activate(GBALinkPeer* peer);
+static void rudp_close(GBALinkPeer* peer);
+static bool rudp_write(GBALinkPeer* peer, const void* buf, size_t len);
+static void rudp_pump(GBALinkPeer* peer);
+static void rudp_receive(GBALinkPeer* peer, const struct timeval* now);
+static bool rudp_deliver(GBALinkPeer* peer);
+static void rudp_send_datagram(GBALinkPeer* peer, const RudpSegment* seg);
+static int rudp_service_timers(uint32_t now_ms);
 
 //////////////////////////////////////////////////////////////////////////////
 // Performance Optimization Helpers
@@ -228,21 +467,621 @@ static void invalidate_frame_time(void) {
 // Compact stream buffer if needed - consolidates fragmented buffer space
 // Only compacts when read_idx is past halfway point AND we need more space
 // This reduces memmove frequency significantly during burst traffic
-static void compact_stream_buffer_if_needed(size_t min_space_needed) {
-    size_t available = gl.stream_buf_write_idx - gl.stream_buf_read_idx;
-    size_t space_at_end = sizeof(gl.stream_buf) - gl.stream_buf_write_idx;
+static void compact_stream_buffer_if_needed(GBALinkPeer* peer, size_t min_space_needed) {
+    size_t available = peer->stream_buf_write_idx - peer->stream_buf_read_idx;
+    size_t space_at_end = STREAM_BUF_SIZE - peer->stream_buf_write_idx;
 
     // Only compact if:
     // 1. We need more space than available at end
     // 2. Read index is past halfway point (worth the memmove cost)
     // 3. There's actually data to move
     if (space_at_end < min_space_needed &&
-        gl.stream_buf_read_idx > sizeof(gl.stream_buf) / 2 &&
+        peer->stream_buf_read_idx > STREAM_BUF_SIZE / 2 &&
         available > 0) {
-        memmove(gl.stream_buf, gl.stream_buf + gl.stream_buf_read_idx, available);
-        gl.stream_buf_read_idx = 0;
-        gl.stream_buf_write_idx = available;
+        memmove(peer->stream_buf, peer->stream_buf + peer->stream_buf_read_idx, available);
+        peer->stream_buf_read_idx = 0;
+        peer->stream_buf_write_idx = available;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Peers
+//////////////////////////////////////////////////////////////////////////////
+
+// Clear per-connection buffers (socket already closed or about to be opened)
+static void peer_reset(GBALinkPeer* peer) {
+    peer->fd = -1;
+    peer->ready = false;
+    peer->stream_buf_read_idx = 0;
+    peer->stream_buf_write_idx = 0;
+    peer->tx_batch_len = 0;
+    peer->tx_queue_head = 0;
+    peer->tx_queue_len = 0;
+    peer->tx_watch_writable = false;
+    peer->udp_fd = -1;
+    peer->rudp = NULL;  // Freed by rudp_close
+}
+
+// Give a reserved slot its connection buffers (mutex held or slot owned). Kept across
+// reconnects of the same slot until peer_free_buffers.
+static bool peer_alloc_buffers(GBALinkPeer* peer) {
+    if (peer->stream_buf) return true;
+    uint8_t* block = malloc(PEER_BUFFERS_SIZE);
+    if (!block) {
+        LOG_error("GBALink: out of memory for connection buffers\n");
+        return false;
+    }
+    peer->stream_buf = block;
+    peer->tx_batch = block + STREAM_BUF_SIZE;
+    peer->tx_queue = peer->tx_batch + TX_BATCH_SIZE;
+    return true;
+}
+
+// Release a closed slot's connection buffers (mutex held, no thread using the slot)
+static void peer_free_buffers(GBALinkPeer* peer) {
+    free(peer->stream_buf);
+    peer->stream_buf = NULL;
+    peer->tx_batch = NULL;
+    peer->tx_queue = NULL;
+}
+
+static int count_ready_peers(void) {
+    int count = 0;
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        if (gl.peers[i].ready) count++;
+    }
+    return count;
+}
+
+// Host: a slot is free once its socket is gone and the core has been told
+static GBALinkPeer* find_free_slot(void) {
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (peer->fd < 0 && !peer->announced && !peer->pending_disconnect) {
+            return peer;
+        }
+    }
+    return NULL;
+}
+
+// Host: still advertising and accepting clients (mutex held)
+static bool host_accepting(void) {
+    if (gl.mode != GBALINK_HOST ||
+        (gl.state != GBALINK_STATE_WAITING && gl.state != GBALINK_STATE_CONNECTED)) {
+        return false;
+    }
+    // Frame lock keeps one delivery schedule per session, so it stays two-player
+    if (gl.frame_lock) {
+        for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+            if (gl.peers[i].fd >= 0 || gl.peers[i].announced) return false;
+        }
+    }
+    return find_free_slot() != NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Receive Ring (SPSC)
+//////////////////////////////////////////////////////////////////////////////
+
+// Only call while neither side is active (connect/disconnect under gl.mutex)
+static void rx_ring_reset(void) {
+    __atomic_store_n(&gl.rx_head, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&gl.rx_tail, 0, __ATOMIC_RELEASE);
+    gl.rx_high_water = 0;
+    gl.rx_backpressure = 0;
+    gl.rx_dropped = 0;
+    gl.rx_max_delay_ms = 0;
+    gl.core_stalls = 0;
+    gl.reply_stalls = 0;
+    __atomic_store_n(&gl.rx_waiting, false, __ATOMIC_RELEASE);
+}
+
+static uint32_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static size_t rx_ring_free(void) {
+    uint32_t tail = __atomic_load_n(&gl.rx_tail, __ATOMIC_ACQUIRE);
+    return RX_RING_SIZE - (gl.rx_head - tail);
+}
+
+// Producer: append a record, returns false if it doesn't fit
+static bool rx_ring_push(const void* data, uint16_t len, uint16_t client_id, uint32_t arrival_ms,
+                         uint32_t frame) {
+    uint32_t head = gl.rx_head;
+    uint32_t tail = __atomic_load_n(&gl.rx_tail, __ATOMIC_ACQUIRE);
+    uint32_t need = RX_RECORD_SIZE(len);
+    uint32_t offset = head & RX_RING_MASK;
+    uint32_t to_end = RX_RING_SIZE - offset;
+
+    // Records never straddle the end - pad with a wrap marker instead
+    uint32_t pad = (to_end < need) ? to_end : 0;
+    if (need + pad > RX_RING_SIZE - (head - tail)) {
+        return false;
+    }
+    if (pad) {
+        ((RxRecordHeader*)(gl.rx_ring + offset))->len = RX_RECORD_WRAP;
+        head += pad;
+        offset = 0;
+    }
+
+    RxRecordHeader* rec = (RxRecordHeader*)(gl.rx_ring + offset);
+    rec->len = len;
+    rec->client_id = client_id;
+    rec->arrival_ms = arrival_ms;
+    rec->frame = frame;
+    if (len > 0) memcpy(rec + 1, data, len);
+    head += need;
+
+    // Publish record contents before the new head
+    __atomic_store_n(&gl.rx_head, head, __ATOMIC_RELEASE);
+
+    uint32_t used = head - tail;
+    if (used > gl.rx_high_water) gl.rx_high_water = used;
+    return true;
+}
+
+// Consumer: look at the oldest record without removing it
+// The returned pointer stays valid until rx_ring_consume()
+static bool rx_ring_peek(const uint8_t** data, size_t* len, uint16_t* client_id, uint32_t* arrival_ms,
+                         uint32_t* frame) {
+    uint32_t tail = gl.rx_tail;
+    uint32_t head = __atomic_load_n(&gl.rx_head, __ATOMIC_ACQUIRE);
+
+    while (tail != head) {
+        RxRecordHeader* rec = (RxRecordHeader*)(gl.rx_ring + (tail & RX_RING_MASK));
+        if (rec->len == RX_RECORD_WRAP) {
+            tail += RX_RING_SIZE - (tail & RX_RING_MASK);
+            __atomic_store_n(&gl.rx_tail, tail, __ATOMIC_RELEASE);
+            continue;
+        }
+        *data = (const uint8_t*)(rec + 1);
+        *len = rec->len;
+        if (client_id) *client_id = rec->client_id;
+        if (arrival_ms) *arrival_ms = rec->arrival_ms;
+        if (frame) *frame = rec->frame;
+        return true;
+    }
+    return false;
+}
+
+// Consumer: drop the record returned by the last successful rx_ring_peek()
+static void rx_ring_consume(void) {
+    uint32_t tail = gl.rx_tail;
+    RxRecordHeader* rec = (RxRecordHeader*)(gl.rx_ring + (tail & RX_RING_MASK));
+    __atomic_store_n(&gl.rx_tail, tail + (uint32_t)RX_RECORD_SIZE(rec->len), __ATOMIC_RELEASE);
+
+    // The I/O thread paused its stream reads on a full ring: wake it once
+    // there is room again (pairs with the re-check in io_wait_for_ring)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&gl.rx_waiting, __ATOMIC_RELAXED) && rx_ring_free() >= RX_RING_PUSH_RESERVE &&
+        __atomic_exchange_n(&gl.rx_waiting, false, __ATOMIC_ACQ_REL)) {
+        uint64_t value = 1;
+        write(gl.io_wake_fd, &value, sizeof(value));
+    }
+}
+
+void GBALink_getRxStats(GBALinkRxStats* stats) {
+    if (!stats) return;
+    uint32_t head = __atomic_load_n(&gl.rx_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&gl.rx_tail, __ATOMIC_ACQUIRE);
+    stats->capacity = RX_RING_SIZE;
+    stats->used = head - tail;
+    stats->high_water = gl.rx_high_water;
+    stats->backpressure = gl.rx_backpressure;
+    stats->dropped = gl.rx_dropped;
+    stats->max_delay_ms = gl.rx_max_delay_ms;
+    stats->frame_delay = gl.frame_lock ? gl.frame_delay : 0;
+    stats->stall_frames = gl.stall_frames;
+    stats->core_stalls = gl.core_stalls;
+    stats->reply_stalls = gl.reply_stalls;
+}
+
+static void log_rx_stats(void) {
+    if (gl.rx_high_water == 0) return;
+    LOG_info("GBALink: rx ring peak %u/%u bytes, %u backpressure stalls, %u dropped, max delay %ums\n",
+             gl.rx_high_water, RX_RING_SIZE, gl.rx_backpressure, gl.rx_dropped, gl.rx_max_delay_ms);
+    if (gl.core_queue_stats) {
+        unsigned depth = 0, high_water = 0, overflows = 0;
+        gl.core_queue_stats(&depth, &high_water, &overflows);
+        LOG_info("GBALink: core queue peak %u/%u packets, %u overflows, %u delivery stalls\n",
+                 high_water, depth, overflows, gl.core_stalls);
+    }
+    if (gl.core_waiting) {
+        LOG_info("GBALink: %u frames held for the core's reply\n", gl.reply_stalls);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Frame Lock
+//////////////////////////////////////////////////////////////////////////////
+
+// Peer finished a frame (mutex held). Also takes an RTT sample from the echo.
+static void frame_lock_handle_frame_end(GBALinkPeer* peer, const FrameEndPayload* payload, uint32_t arrival_ms) {
+    peer->remote_frame = ntohl(payload->frame);
+    peer->echo_ms = ntohl(payload->sent_ms);
+    peer->echo_received_ms = arrival_ms;
+
+    uint32_t echo_ms = ntohl(payload->echo_ms);
+    if (echo_ms == 0) return;
+    int32_t rtt = (int32_t)(arrival_ms - echo_ms - ntohl(payload->echo_hold_ms));
+    if (rtt < 0) rtt = 0;
+    gl.rtt_ms = gl.rtt_ms ? (gl.rtt_ms * 7 + (uint32_t)rtt) / 8 : (uint32_t)rtt;
+}
+
+// Host announced a delay (mutex held). Applied by frame_lock_advance.
+static void frame_lock_schedule(const FrameLockPayload* payload) {
+    uint32_t delay = ntohs(payload->delay);
+    if (delay < FRAME_LOCK_MIN_DELAY || delay > FRAME_LOCK_MAX_DELAY) return;
+    gl.frame_lock = true;
+    gl.pending_delay = delay;
+    gl.pending_delay_frame = ntohl(payload->from_frame);
+}
+
+// Main thread, before each frame: move to the next frame unless a peer hasn't
+// finished the frame whose packets become due. Returns false to skip the frame.
+static bool frame_lock_advance(void) {
+    uint32_t next = gl.frame + 1;
+
+    // The delay change and the peer's frame progress are read under one lock so
+    // a FRAME_LOCK is never missed when its following FRAME_END is already seen
+    pthread_mutex_lock(&gl.mutex);
+    if (gl.pending_delay && next >= gl.pending_delay_frame) {
+        LOG_info("GBALink: frame lock delay %u -> %u frames at frame %u\n",
+                 gl.frame_delay, gl.pending_delay, next);
+        gl.frame_delay = gl.pending_delay;
+        gl.pending_delay = 0;
     }
+
+    bool ready = true;
+    if (next > gl.frame_delay) {
+        for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+            GBALinkPeer* peer = &gl.peers[i];
+            if (peer->ready && peer->remote_frame < next - gl.frame_delay) {
+                ready = false;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&gl.mutex);
+
+    if (!ready) {
+        gl.stall_frames++;
+        return false;
+    }
+    gl.frame = next;
+    return true;
+}
+
+// Tell peers this frame is complete (mutex held, after the frame's batch)
+static bool frame_lock_send_frame_end(GBALinkPeer* peer, uint32_t now_ms) {
+    FrameEndPayload payload = {
+        .frame = htonl(gl.frame),
+        .sent_ms = htonl(now_ms ? now_ms : 1),
+        .echo_ms = htonl(peer->echo_ms),
+        .echo_hold_ms = htonl(peer->echo_ms ? now_ms - peer->echo_received_ms : 0)
+    };
+    return send_packet(peer, CMD_FRAME_END, &payload, sizeof(payload), 0);
+}
+
+// Host: follow the measured RTT (main thread). Raises right away, lowers only
+// once well clear of the current delay so it doesn't flap on jitter.
+static void frame_lock_adapt(void) {
+    uint32_t now_ms = monotonic_ms();
+    if (now_ms - gl.last_adapt_ms < FRAME_LOCK_ADAPT_INTERVAL_MS) return;
+    gl.last_adapt_ms = now_ms;
+
+    pthread_mutex_lock(&gl.mutex);
+    if (gl.rtt_ms == 0 || gl.pending_delay) {
+        pthread_mutex_unlock(&gl.mutex);
+        return;
+    }
+
+    uint32_t target = (gl.rtt_ms + FRAME_LOCK_FRAME_MS - 1) / FRAME_LOCK_FRAME_MS + 1;
+    if (target < FRAME_LOCK_MIN_DELAY) target = FRAME_LOCK_MIN_DELAY;
+    if (target > FRAME_LOCK_MAX_DELAY) target = FRAME_LOCK_MAX_DELAY;
+
+    if (target > gl.frame_delay || target + 2 < gl.frame_delay) {
+        // The client can run at most frame_delay frames past our next FRAME_END,
+        // and this message reaches it first, so both sides switch on the same frame
+        FrameLockPayload payload = {
+            .delay = htons((uint16_t)target),
+            .from_frame = htonl(gl.frame + 1 + gl.frame_delay)
+        };
+        for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+            GBALinkPeer* peer = &gl.peers[i];
+            if (peer->ready && !send_packet(peer, CMD_FRAME_LOCK, &payload, sizeof(payload), 0)) {
+                handle_remote_close(peer, "Connection lost");
+            }
+        }
+        gl.pending_delay = target;
+        gl.pending_delay_frame = gl.frame + 1 + gl.frame_delay;
+        LOG_info("GBALink: rtt %ums, frame lock delay -> %u frames\n", gl.rtt_ms, target);
+    }
+    pthread_mutex_unlock(&gl.mutex);
+}
+
+void GBALink_setFrameLock(bool enabled) {
+    gl.frame_lock_requested = enabled;
+}
+
+bool GBALink_getFrameLock(void) {
+    return gl.frame_lock_requested;
+}
+
+// Queue a packet for the core (mutex held)
+static void queue_for_core(const uint8_t* data, uint16_t size, uint16_t client_id, uint32_t arrival_ms,
+                           uint32_t frame) {
+    if (!rx_ring_push(data, size, client_id, arrival_ms, frame)) {
+        gl.rx_dropped++;
+        LOG_warn("GBALink: rx ring full, dropped %u byte packet\n", size);
+    }
+}
+
+// Host: route a client's packet by its destination (mutex held). Packets for
+// other clients are forwarded with the sender's ID on their own transmit queue,
+// so the host's core only sees what is addressed to it.
+static void host_route_packet(GBALinkPeer* src, uint16_t dest, const uint8_t* data,
+                              uint16_t size, uint32_t arrival_ms) {
+    bool broadcast = dest == RETRO_NETPACKET_BROADCAST;
+
+    if (broadcast || dest == gl.local_client_id) {
+        queue_for_core(data, size, src->client_id, arrival_ms, 0);
+        if (!broadcast) return;
+    }
+
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (peer == src || !peer->ready) continue;
+        if (!broadcast && peer->client_id != dest) continue;
+
+        if (!send_packet(peer, CMD_SIO_DATA, data, size, src->client_id)) {
+            LOG_warn("GBALink: relay to client %u failed, dropping it\n", peer->client_id);
+            handle_remote_close(peer, "Connection lost");
+        }
+    }
+}
+
+// Parse every complete packet in a peer's stream_buf (called with mutex held)
+static void io_dispatch_packets(GBALinkPeer* peer, const struct timeval* now) {
+    PacketHeader hdr;
+    uint8_t data[RECV_BUFFER_SIZE];
+    uint32_t arrival_ms = monotonic_ms();
+
+    while (peer->ready) {
+        // Backpressure: leave unparsed data in stream_buf (and the socket) until
+        // the core drains the ring - TCP flow control then slows the sender
+        if (rx_ring_free() < RX_RING_PUSH_RESERVE) {
+            gl.rx_backpressure++;
+            break;
+        }
+        if (!stream_parse(peer, &hdr, data, RECV_BUFFER_SIZE, now)) {
+            // Reliable UDP: segments may be waiting for stream_buf space
+            if (peer->rudp && rudp_deliver(peer)) continue;
+            break;
+        }
+
+        if (hdr.cmd == CMD_SIO_DATA) {
+            // Note: hdr.size is validated by stream_parse to be <= RECV_BUFFER_SIZE
+            if (gl.mode == GBALINK_HOST) {
+                // From a client: client_id is the destination
+                host_route_packet(peer, hdr.client_id, data, hdr.size, arrival_ms);
+            } else {
+                // From the host: client_id is the original sender (host or relayed client)
+                queue_for_core(data, hdr.size, hdr.client_id, arrival_ms, 0);
+            }
+        } else if (hdr.cmd == CMD_SIO_FRAME && hdr.size >= sizeof(uint32_t)) {
+            // Frame lock sessions are two-player, so there is nothing to relay
+            uint32_t frame;
+            memcpy(&frame, data, sizeof(frame));
+            uint16_t source = gl.mode == GBALINK_HOST ? peer->client_id : hdr.client_id;
+            queue_for_core(data + sizeof(frame), hdr.size - sizeof(frame), source, arrival_ms, ntohl(frame));
+        } else if (hdr.cmd == CMD_FRAME_END && hdr.size == sizeof(FrameEndPayload)) {
+            frame_lock_handle_frame_end(peer, (const FrameEndPayload*)data, arrival_ms);
+        } else if (hdr.cmd == CMD_FRAME_LOCK && hdr.size == sizeof(FrameLockPayload)) {
+            frame_lock_schedule((const FrameLockPayload*)data);
+        } else if (hdr.cmd == CMD_HEARTBEAT) {
+            // Heartbeat received - timestamp already updated in stream_parse
+        } else if (hdr.cmd == CMD_DISCONNECT) {
+            // Remote sent explicit disconnect command
+            handle_remote_close(peer, "Host disconnected");
+        }
+    }
+}
+
+// Service one peer after an epoll event or a backpressure wait (mutex held)
+static void io_service_peer(GBALinkPeer* peer, uint32_t events, const struct timeval* now) {
+    if (!peer->ready) return;  // Closed since the event was queued
+
+    if ((events & EPOLLOUT) && !tx_queue_flush(peer)) {
+        handle_remote_close(peer, "Connection lost");
+        return;
+    }
+    // EPOLLIN, EPOLLRDHUP, EPOLLHUP and EPOLLERR all end up in recv():
+    // remaining data is read first, then the close/error is handled
+    if ((events & ~EPOLLOUT) && !stream_fill(peer)) {
+        return;
+    }
+    io_dispatch_packets(peer, now);
+}
+
+// Service a peer's reliable UDP socket after an epoll event (mutex held)
+static void io_service_udp(GBALinkPeer* peer, const struct timeval* now) {
+    if (!peer->ready || !peer->rudp) return;
+
+    rudp_receive(peer, now);
+    io_dispatch_packets(peer, now);
+    // Nothing went out with the ack piggybacked, so send it on its own
+    if (peer->rudp && peer->rudp->ack_pending) {
+        rudp_send_datagram(peer, NULL);
+    }
+}
+
+// epoll data for peer sockets: slot + 1, with IO_EVENT_UDP set for the UDP
+// socket (0 is the wake eventfd)
+#define IO_EVENT_UDP (1ULL << 32)
+
+static uint64_t io_event_data(GBALinkPeer* peer, bool udp) {
+    return (uint64_t)(peer - gl.peers + 1) | (udp ? IO_EVENT_UDP : 0);
+}
+
+// epoll events for a peer's stream socket (mutex held)
+static uint32_t io_stream_events(GBALinkPeer* peer) {
+    return (gl.io_reads_paused ? 0 : EPOLLIN | EPOLLRDHUP) | (peer->tx_watch_writable ? EPOLLOUT : 0);
+}
+
+// Stop or resume reading the peers' stream sockets (I/O thread, mutex held)
+static void io_pause_reads(bool paused) {
+    if (gl.io_reads_paused == paused) return;
+    gl.io_reads_paused = paused;
+
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (!peer->ready || peer->fd < 0) continue;
+        struct epoll_event ev = {0};
+        ev.events = io_stream_events(peer);
+        ev.data.u64 = io_event_data(peer, false);
+        epoll_ctl(gl.io_epoll_fd, EPOLL_CTL_MOD, peer->fd, &ev);
+    }
+}
+
+// True while the ring is too full to parse into. Arms rx_waiting first so
+// rx_ring_consume() can't drain it in between without waking us.
+static bool io_wait_for_ring(void) {
+    if (rx_ring_free() >= RX_RING_PUSH_RESERVE) return false;
+    __atomic_store_n(&gl.rx_waiting, true, __ATOMIC_SEQ_CST);
+    if (rx_ring_free() >= RX_RING_PUSH_RESERVE) {
+        __atomic_store_n(&gl.rx_waiting, false, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+}
+
+static void* io_thread_func(void* arg) {
+    (void)arg;
+    struct epoll_event events[2 * GBALINK_MAX_CLIENTS + 1];
+
+    while (gl.io_running) {
+        // Ring full: leave the stream sockets unread until rx_ring_consume()
+        // wakes us, so TCP flow control slows the sender. Reliable UDP keeps
+        // receiving, acking and retransmitting - its segments wait in the
+        // receive window, and a stalled ack would only bring retransmits.
+        bool full = io_wait_for_ring();
+
+        // Reliable UDP retransmissions also run here, so wake up for the next one
+        pthread_mutex_lock(&gl.mutex);
+        if (full != gl.io_reads_paused) {
+            io_pause_reads(full);
+            if (!full) {
+                // Parse what stayed in stream_buf and the RUDP window meanwhile
+                struct timeval now;
+                gettimeofday(&now, NULL);
+                for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+                    io_service_peer(&gl.peers[i], 0, &now);
+                }
+            }
+        }
+        int timeout_ms = rudp_service_timers(monotonic_ms());
+        pthread_mutex_unlock(&gl.mutex);
+
+        int n = epoll_wait(gl.io_epoll_fd, events, 2 * GBALINK_MAX_CLIENTS + 1, timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_error("GBALink: epoll_wait failed errno=%d\n", errno);
+            break;
+        }
+
+        struct timeval now;
+        gettimeofday(&now, NULL);
+
+        for (int i = 0; i < n; i++) {
+            uint64_t data = events[i].data.u64;
+            if (!data) {
+                uint64_t value;
+                read(gl.io_wake_fd, &value, sizeof(value));
+                continue;
+            }
+            GBALinkPeer* peer = &gl.peers[(data & ~IO_EVENT_UDP) - 1];
+
+            pthread_mutex_lock(&gl.mutex);
+            if (data & IO_EVENT_UDP) {
+                io_service_udp(peer, &now);
+            } else {
+                io_service_peer(peer, events[i].events, &now);
+            }
+            pthread_mutex_unlock(&gl.mutex);
+        }
+    }
+
+    return NULL;
+}
+
+// Start receive thread for the session (main thread). Peers are added as they
+// finish their handshake via io_add_peer
+static bool io_thread_start(void) {
+    io_thread_stop();
+
+    gl.io_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    gl.io_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (gl.io_epoll_fd < 0 || gl.io_wake_fd < 0) {
+        LOG_error("GBALink: failed to create epoll/eventfd errno=%d\n", errno);
+        io_thread_stop();
+        return false;
+    }
+
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    epoll_ctl(gl.io_epoll_fd, EPOLL_CTL_ADD, gl.io_wake_fd, &ev);
+
+    gl.io_reads_paused = false;
+    __atomic_store_n(&gl.rx_waiting, false, __ATOMIC_RELEASE);
+    gl.io_running = true;
+    if (pthread_create(&gl.io_thread, NULL, io_thread_func, NULL) != 0) {
+        gl.io_running = false;
+        io_thread_stop();
+        return false;
+    }
+    gl.io_thread_started = true;
+    return true;
+}
+
+// Hand a ready peer's sockets to the I/O thread (mutex held)
+static void io_add_peer(GBALinkPeer* peer) {
+    if (gl.io_epoll_fd < 0 || peer->fd < 0) return;
+
+    struct epoll_event ev = {0};
+    peer->tx_watch_writable = !peer->rudp && peer->tx_queue_len > 0;  // Leftovers from the handshake
+    ev.events = io_stream_events(peer);
+    ev.data.u64 = io_event_data(peer, false);
+    epoll_ctl(gl.io_epoll_fd, EPOLL_CTL_ADD, peer->fd, &ev);
+
+    if (peer->rudp) {
+        ev.events = EPOLLIN;
+        ev.data.u64 = io_event_data(peer, true);
+        epoll_ctl(gl.io_epoll_fd, EPOLL_CTL_ADD, peer->udp_fd, &ev);
+    }
+}
+
+// Stop receive thread (main thread, must not hold gl.mutex)
+static void io_thread_stop(void) {
+    gl.io_running = false;
+    if (gl.io_thread_started) {
+        uint64_t value = 1;
+        write(gl.io_wake_fd, &value, sizeof(value));
+        pthread_join(gl.io_thread, NULL);
+        gl.io_thread_started = false;
+    }
+    if (gl.io_epoll_fd >= 0) {
+        close(gl.io_epoll_fd);
+    }
+    if (gl.io_wake_fd >= 0) {
+        close(gl.io_wake_fd);
+    }
+    gl.io_epoll_fd = -1;
+    gl.io_wake_fd = -1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -257,6 +1096,9 @@ void GBALink_init(void) {
     struct retro_netpacket_callback saved_callbacks = gl.core_callbacks;
     bool saved_has_callbacks = gl.has_core_callbacks;
     bool saved_has_netpacket = gl.has_netpacket_support;
+    GBALinkCoreQueueFreeFn saved_queue_free = gl.core_queue_free;
+    GBALinkCoreQueueStatsFn saved_queue_stats = gl.core_queue_stats;
+    GBALinkCoreWaitingFn saved_waiting = gl.core_waiting;
 
     memset(&gl, 0, sizeof(gl));
 
@@ -264,13 +1106,22 @@ void GBALink_init(void) {
     gl.core_callbacks = saved_callbacks;
     gl.has_core_callbacks = saved_has_callbacks;
     gl.has_netpacket_support = saved_has_netpacket;
+    gl.core_queue_free = saved_queue_free;
+    gl.core_queue_stats = saved_queue_stats;
+    gl.core_waiting = saved_waiting;
 
     gl.mode = GBALINK_OFF;
     gl.state = GBALINK_STATE_IDLE;
-    gl.tcp_fd = -1;
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        peer_reset(&gl.peers[i]);
+    }
     gl.listen_fd = -1;
     gl.udp_fd = -1;
     gl.udp_listen_fd = -1;
+    gl.io_epoll_fd = -1;
+    gl.io_wake_fd = -1;
+    gl.broadcast_timer_fd = -1;
+    gl.handshake_timer_fd = -1;
     gl.port = GBALINK_DEFAULT_PORT;
     pthread_mutex_init(&gl.mutex, NULL);
     NET_getLocalIP(gl.local_ip, sizeof(gl.local_ip));
@@ -301,6 +1152,13 @@ void GBALink_quit(void) {
         gbalink_connected_to_hotspot = 0;
     }
 
+    NET_quitEventLoop();
+
+    // Slots a handshake still held during disconnect
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        peer_free_buffers(&gl.peers[i]);
+    }
+
     pthread_mutex_destroy(&gl.mutex);
     gl.initialized = false;
 }
@@ -329,6 +1187,14 @@ const char* GBALink_getLinkMode(void) {
     return gl.link_mode[0] ? gl.link_mode : NULL;
 }
 
+// Turn discovery broadcasts and query replies on/off for the hosting session
+void GBALink_setAdvertise(bool enabled) {
+    gl.advertise_off = !enabled;
+    if (enabled) {
+        GBALink_restartBroadcast();
+    }
+}
+
 // Get pending link mode (host's mode to change to) after GBALINK_CONNECT_NEEDS_RELOAD
 const char* GBALink_getPendingLinkMode(void) {
     return gl.needs_reload && gl.pending_link_mode[0] ? gl.pending_link_mode : NULL;
@@ -348,7 +1214,8 @@ void GBALink_clearPendingReload(void) {
 
 // Apply pending link mode to config (called when user confirms before reload)
 // Note: gpsp ignores runtime option changes, so we just set the option here
-// and the caller must reload the game for gpsp to pick it up
+// and the caller must reload the game for gpsp to pick it up, then call
+// GBALink_finishPendingJoin - the connection to the host stays open meanwhile
 void GBALink_applyPendingLinkMode(void) {
     if (gl.needs_reload && gl.pending_link_mode[0]) {
         minarch_setCoreOptionValue("gpsp_serial", gl.pending_link_mode);
@@ -428,14 +1295,30 @@ int GBALink_startHost(const char* game_name, uint32_t game_crc, const char* hots
     strncpy(gl.game_name, game_name, GBALINK_MAX_GAME_NAME - 1);
     gl.game_crc = game_crc;
 
-    // Start listen thread
-    gl.running = true;
-    pthread_create(&gl.listen_thread, NULL, listen_thread_func, NULL);
+    // Frame lock is fixed for the whole hosting session
+    gl.frame_lock = gl.frame_lock_requested;
+    gl.frame_delay = FRAME_LOCK_DEFAULT_DELAY;
+    gl.pending_delay = 0;
+    gl.transport = gl.transport_requested;
 
     gl.mode = GBALINK_HOST;
     gl.state = GBALINK_STATE_WAITING;
     gl.local_client_id = 0;  // Host is always client 0
 
+    // Accept, answer queries and broadcast from the shared event loop
+    gl.running = true;
+    gl.broadcast_timer_fd = NET_createTimer(on_broadcast_timer, NULL);
+    gl.handshake_timer_fd = NET_createTimer(on_handshake_timer, NULL);
+    if (NET_watchSocket(gl.listen_fd, on_listen_ready, NULL) < 0 ||
+        gl.broadcast_timer_fd < 0 || gl.handshake_timer_fd < 0) {
+        GBALink_stopHostFast();
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "Failed to start listener");
+        return -1;
+    }
+    NET_watchSocket(gl.udp_listen_fd, on_discovery_query, NULL);
+    NET_initBroadcastTimer(&gl.broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+    NET_setTimer(gl.broadcast_timer_fd, 1, DISCOVERY_BROADCAST_INTERVAL_US / 1000);
+
     snprintf(gl.status_msg, sizeof(gl.status_msg), "Hosting on %s:%d", gl.local_ip, gl.port);
     LOG_info("GBALink: HOST listening on %s:%d has_callbacks=%d\n", gl.local_ip, gl.port, gl.has_core_callbacks);
     return 0;
@@ -447,28 +1330,27 @@ static int GBALink_stopHostInternal(bool skip_hotspot_cleanup) {
 
     gl.running = false;
 
-    // Close listen socket to unblock accept() in listen thread
+    // Unwatch before closing - waits out a callback already running. Callbacks
+    // re-arm the timers under the mutex, so they see -1 once the fds go away.
+    pthread_mutex_lock(&gl.mutex);
+    int broadcast_timer_fd = gl.broadcast_timer_fd;
+    int handshake_timer_fd = gl.handshake_timer_fd;
+    gl.broadcast_timer_fd = -1;
+    gl.handshake_timer_fd = -1;
+    pthread_mutex_unlock(&gl.mutex);
+    NET_unwatch(broadcast_timer_fd);
     if (gl.listen_fd >= 0) {
+        NET_unwatch(gl.listen_fd);
         close(gl.listen_fd);
         gl.listen_fd = -1;
     }
+    NET_unwatch(handshake_timer_fd);
+    host_abort_handshakes();
 
-    if (gl.listen_thread) {
-        // Thread will exit via gl.running check - no pthread_cancel needed
-        // (pthread_cancel can leave mutex/fd in undefined state)
-        pthread_join(gl.listen_thread, NULL);
-        gl.listen_thread = 0;
-    }
-
-    if (gl.udp_fd >= 0) {
-        close(gl.udp_fd);
-        gl.udp_fd = -1;
-    }
-
-    if (gl.udp_listen_fd >= 0) {
-        close(gl.udp_listen_fd);
-        gl.udp_listen_fd = -1;
-    }
+    NET_unwatch(gl.udp_listen_fd);  // Its callback takes the mutex
+    pthread_mutex_lock(&gl.mutex);
+    close_discovery_sockets();
+    pthread_mutex_unlock(&gl.mutex);
 
     GBALink_disconnect();
 
@@ -499,11 +1381,20 @@ int GBALink_stopHostFast(void) {
     return GBALink_stopHostInternal(true);
 }
 
-// Restart UDP broadcast when going back to waiting state
-// Called when client disconnects but host wants to accept new clients
+// Restart UDP broadcast when a client slot frees up
+// Called when a client disconnects but host wants to accept new clients
 static void GBALink_restartBroadcast(void) {
+    if (gl.mode != GBALINK_HOST || !gl.running) return;  // Only for a live host
+
+    if (gl.udp_listen_fd < 0) {
+        gl.udp_listen_fd = NET_createDiscoveryListenSocket(GBALINK_DISCOVERY_PORT);
+        NET_watchSocket(gl.udp_listen_fd, on_discovery_query, NULL);
+    }
+
+    // Back to the fast rate so new clients find us quickly
+    NET_initBroadcastTimer(&gl.broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+    NET_setTimer(gl.broadcast_timer_fd, 1, DISCOVERY_BROADCAST_INTERVAL_US / 1000);
     if (gl.udp_fd >= 0) return;  // Already running
-    if (gl.mode != GBALINK_HOST) return;  // Only for host
 
     gl.udp_fd = NET_createBroadcastSocket();
     if (gl.udp_fd < 0) {
@@ -511,171 +1402,313 @@ static void GBALink_restartBroadcast(void) {
     }
 }
 
-static void* listen_thread_func(void* arg) {
-    (void)arg;
+// Host side of the READY handshake, once the client's READY arrived (event
+// loop, mutex held). Never blocks: whatever the socket can't take yet stays in
+// the transmit queue.
+static bool host_handshake_reply(GBALinkPeer* peer, uint16_t client_udp_port) {
+    // Frame lock goes first so the client knows before its session starts
+    if (gl.frame_lock) {
+        FrameLockPayload payload = {
+            .delay = htons((uint16_t)gl.frame_delay),
+            .from_frame = htonl(0)
+        };
+        if (!send_packet(peer, CMD_FRAME_LOCK, &payload, sizeof(payload), 0)) return false;
+    }
 
-    // Use shared broadcast timer for rate limiting
-    NET_BroadcastTimer broadcast_timer;
-    NET_initBroadcastTimer(&broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
-
-    while (gl.running && gl.listen_fd >= 0) {
-        // Rate-limited discovery broadcast using shared timer
-        if (gl.udp_fd >= 0 && gl.state == GBALINK_STATE_WAITING) {
-            if (NET_shouldBroadcast(&broadcast_timer)) {
-                NET_sendDiscoveryBroadcast(gl.udp_fd, GL_DISCOVERY_RESP, GBALINK_PROTOCOL_VERSION,
-                                           gl.game_crc, gl.port, GBALINK_DISCOVERY_PORT,
-                                           gl.game_name, gl.link_mode);
-            }
+    // Same for reliable UDP. Both sides switch after READY, which still goes over TCP.
+    if (gl.transport == GBALINK_TRANSPORT_UDP && client_udp_port) {
+        TransportPayload payload = {.udp_port = htons(rudp_open(peer))};
+        if (payload.udp_port && rudp_connect(peer, client_udp_port)) {
+            if (!send_packet(peer, CMD_TRANSPORT, &payload, sizeof(payload), 0)) return false;
+        } else {
+            LOG_warn("GBALink: HOST UDP setup for client %u failed, staying on TCP\n", peer->client_id);
+            rudp_close(peer);
         }
+    }
 
-        // Handle incoming UDP discovery queries (for hotspot mode where broadcasts may not work)
-        // Protect UDP socket access with mutex to prevent race with socket closure
-        pthread_mutex_lock(&gl.mutex);
-        int udp_fd = gl.udp_listen_fd;
-        bool in_waiting = (gl.state == GBALINK_STATE_WAITING);
+    // Send READY back with the client's assigned ID in the header and our link
+    // mode as payload, so the client can match host's gpsp_serial setting
+    uint16_t mode_len = gl.link_mode[0] ? (uint16_t)(strlen(gl.link_mode) + 1) : 0;
+    return send_packet(peer, CMD_READY, gl.link_mode, mode_len, peer->client_id);
+}
+
+// Close the discovery sockets (mutex held). Off the event loop thread, unwatch
+// the query socket before taking the mutex - unwatching waits for a callback
+// that may be blocked on it.
+static void close_discovery_sockets(void) {
+    NET_setTimer(gl.broadcast_timer_fd, 0, 0);
+    if (gl.udp_fd >= 0) {
+        close(gl.udp_fd);
+        gl.udp_fd = -1;
+    }
+    if (gl.udp_listen_fd >= 0) {
+        NET_unwatch(gl.udp_listen_fd);
+        close(gl.udp_listen_fd);
+        gl.udp_listen_fd = -1;
+    }
+}
+
+// Event loop: discovery broadcast while there are free client slots. Disarms
+// itself while not advertising - GBALink_restartBroadcast re-arms it.
+static void on_broadcast_timer(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+
+    pthread_mutex_lock(&gl.mutex);
+    bool advertising = host_accepting() && !gl.advertise_off && gl.udp_fd >= 0;
+    if (advertising) {
+        NET_sendDiscoveryBroadcast(gl.udp_fd, GL_DISCOVERY_RESP, GBALINK_PROTOCOL_VERSION,
+                                   gl.game_crc, gl.port, GBALINK_DISCOVERY_PORT,
+                                   gl.game_name, gl.link_mode);
+    }
+    pthread_mutex_unlock(&gl.mutex);
+
+    if (!advertising) {
+        NET_setTimer(fd, 0, 0);
+        return;
+    }
+
+    // Follow the backoff - re-arm only when the interval changed
+    int prev_us = gl.broadcast_timer.interval_us;
+    int next_us = NET_markBroadcast(&gl.broadcast_timer);
+    if (next_us != prev_us) {
+        NET_setTimer(fd, next_us / 1000, next_us / 1000);
+    }
+}
+
+// Event loop: discovery query - clients query when they open the join
+// screen, and in hotspot mode where broadcasts may not work
+static void on_discovery_query(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+
+    // Mutex keeps the socket from being closed under us
+    pthread_mutex_lock(&gl.mutex);
+    if (host_accepting() && !gl.advertise_off) {
+        NET_answerDiscoveryQueries(fd, GL_DISCOVERY_QUERY, GL_DISCOVERY_RESP,
+                                   GBALINK_PROTOCOL_VERSION, gl.game_crc, gl.port,
+                                   gl.game_name, gl.link_mode);
+    } else {
+        char drain[sizeof(NET_DiscoveryPacket)];
+        while (recv(fd, drain, sizeof(drain), MSG_DONTWAIT) >= 0) {}
+    }
+    pthread_mutex_unlock(&gl.mutex);
+}
+
+// Arm the handshake timer for the earliest pending deadline (mutex held)
+static void handshake_timer_update(void) {
+    uint32_t now_ms = monotonic_ms();
+    int first_ms = 0;
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (peer->fd < 0 || peer->ready) continue;
+        int32_t left = (int32_t)(peer->handshake_deadline_ms - now_ms);
+        if (left < 1) left = 1;
+        if (first_ms == 0 || left < first_ms) first_ms = left;
+    }
+    NET_setTimer(gl.handshake_timer_fd, first_ms, 0);
+}
+
+// End a host handshake (event loop, mutex held): publish the client to the main
+// and I/O threads, or free the slot again
+static void host_handshake_finish(GBALinkPeer* peer, bool ok) {
+    NET_unwatch(peer->fd);  // From the loop thread itself, so no wait
+
+    // Handshake bytes still queued for TCP can't follow the switch to UDP,
+    // which also needs its reliable UDP state
+    bool udp_stuck = ok && peer->udp_fd >= 0 && (peer->tx_queue_len > 0 || !rudp_activate(peer));
+    if (!ok || udp_stuck || gl.mode != GBALINK_HOST || !gl.running) {
+        close(peer->fd);
+        rudp_close(peer);
+        peer_reset(peer);
+        handshake_timer_update();
+        return;
+    }
+
+    // Publish: from here the main and I/O threads own the peer
+    peer->ready = true;
+    handshake_timer_update();
+    gl.state = GBALINK_STATE_CONNECTED;
+    int clients = count_ready_peers();
+    if (clients == 1) {
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "Client connected: %s", peer->ip);
+    } else {
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "%d clients connected", clients);
+    }
+
+    // Set flag for main thread to process (core callbacks must run on main thread)
+    // Memory barrier ensures all state writes are visible before flag is set
+    __sync_synchronize();
+    gl.pending_host_connected = true;
+    LOG_info("GBALink: HOST client %u handshake complete, pending_host_connected=true\n",
+             peer->client_id);
+
+    // Close UDP sockets once every slot is taken - reopened when one frees up
+    if (!find_free_slot()) {
+        close_discovery_sockets();
+    }
+}
+
+// Event loop: data from a client that hasn't sent READY yet. Reads only what is
+// there, so a slow client never holds up the other links on the loop.
+static void on_handshake_data(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    GBALinkPeer* peer = ctx;
+
+    pthread_mutex_lock(&gl.mutex);
+    // Taken over by host_abort_handshakes, which closes it after unwatching
+    if (peer->fd != fd || peer->ready) {
         pthread_mutex_unlock(&gl.mutex);
+        return;
+    }
 
-        if (udp_fd >= 0 && in_waiting) {
-            NET_DiscoveryPacket query_pkt;
-            struct sockaddr_in sender;
-            socklen_t sender_len = sizeof(sender);
-            ssize_t recv_len = recvfrom(udp_fd, &query_pkt, sizeof(query_pkt), MSG_DONTWAIT,
-                                        (struct sockaddr*)&sender, &sender_len);
-            if (recv_len >= (ssize_t)sizeof(query_pkt) && ntohl(query_pkt.magic) == GL_DISCOVERY_QUERY) {
-                // Respond directly to the sender with our info
-                pthread_mutex_lock(&gl.mutex);
-                NET_DiscoveryPacket resp_pkt = {0};
-                resp_pkt.magic = htonl(GL_DISCOVERY_RESP);
-                resp_pkt.protocol_version = htonl(GBALINK_PROTOCOL_VERSION);
-                resp_pkt.game_crc = htonl(gl.game_crc);
-                resp_pkt.port = htons(gl.port);
-                strncpy(resp_pkt.game_name, gl.game_name, NET_MAX_GAME_NAME - 1);
-                strncpy(resp_pkt.link_mode, gl.link_mode, NET_MAX_LINK_MODE - 1);
-                int send_fd = gl.udp_listen_fd;  // Re-check under mutex
-                pthread_mutex_unlock(&gl.mutex);
-                if (send_fd >= 0) {
-                    sendto(send_fd, &resp_pkt, sizeof(resp_pkt), 0,
-                           (struct sockaddr*)&sender, sender_len);
-                }
-            }
+    // Not stream_fill: a close there would free the fd before it is unwatched
+    compact_stream_buffer_if_needed(peer, 1024);
+    size_t space_at_end = STREAM_BUF_SIZE - peer->stream_buf_write_idx;
+    ssize_t ret = recv(fd, peer->stream_buf + peer->stream_buf_write_idx, space_at_end, MSG_DONTWAIT);
+    if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        LOG_info("GBALink: HOST client %u closed during handshake\n", peer->client_id);
+        host_handshake_finish(peer, false);
+        pthread_mutex_unlock(&gl.mutex);
+        return;
+    }
+    if (ret > 0) {
+        peer->stream_buf_write_idx += ret;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    PacketHeader hdr;
+    uint8_t data[64];
+    while (stream_parse(peer, &hdr, data, sizeof(data), &now)) {
+        if (hdr.cmd != CMD_READY) continue;
+
+        // Clients able to run reliable UDP offer their port
+        uint16_t client_udp_port = 0;
+        if (hdr.size == sizeof(TransportPayload)) {
+            TransportPayload offer;
+            memcpy(&offer, data, sizeof(offer));
+            client_udp_port = ntohs(offer.udp_port);
         }
+        LOG_info("GBALink: HOST client %u client_ready=1\n", peer->client_id);
+        host_handshake_finish(peer, host_handshake_reply(peer, client_udp_port));
+        break;
+    }
+    pthread_mutex_unlock(&gl.mutex);
+}
 
-        // Check for incoming connection
-        if (gl.state == GBALINK_STATE_WAITING && gl.listen_fd >= 0) {
-            fd_set fds;
-            FD_ZERO(&fds);
-            FD_SET(gl.listen_fd, &fds);
-
-            struct timeval tv = {.tv_sec = 0, .tv_usec = 100000};  // 100ms timeout
-            int sel_result = select(gl.listen_fd + 1, &fds, NULL, NULL, &tv);
-            if (sel_result < 0 || !gl.running) break;  // Socket closed or stopping
-            if (sel_result > 0) {
-                struct sockaddr_in client_addr;
-                socklen_t len = sizeof(client_addr);
-
-                int fd = accept(gl.listen_fd, (struct sockaddr*)&client_addr, &len);
-                if (fd >= 0) {
-                    char client_ip[16];
-                    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-                    LOG_info("GBALink: HOST accept() got connection from %s\n", client_ip);
-
-                    pthread_mutex_lock(&gl.mutex);
-
-                    if (gl.state != GBALINK_STATE_WAITING) {
-                        LOG_info("GBALink: HOST rejecting - not in WAITING state\n");
-                        close(fd);
-                        pthread_mutex_unlock(&gl.mutex);
-                        continue;
-                    }
+// Event loop: reject clients that didn't send READY in time
+static void on_handshake_timer(int fd, uint32_t events, void* ctx) {
+    (void)fd;
+    (void)events;
+    (void)ctx;
 
-                    // Configure TCP socket using GBALink-specific settings
-                    NET_configureTCPSocket(fd, &GBALINK_TCP_CONFIG);
-
-                    gl.tcp_fd = fd;
-                    inet_ntop(AF_INET, &client_addr.sin_addr, gl.remote_ip, sizeof(gl.remote_ip));
-
-                    gl.state = GBALINK_STATE_CONNECTED;
-                    gl.pending_count = 0;
-                    gl.pending_read_idx = 0;
-                    gl.pending_write_idx = 0;
-                    gl.stream_buf_read_idx = 0;
-                    gl.stream_buf_write_idx = 0;
-                    struct timeval now;
-                    gettimeofday(&now, NULL);
-                    gl.last_packet_sent = now;
-                    gl.last_packet_received = now;
-
-                    snprintf(gl.status_msg, sizeof(gl.status_msg), "Client connected: %s", gl.remote_ip);
-                    LOG_info("GBALink: HOST waiting for client READY signal...\n");
-
-                    // Wait for client's READY signal
-                    bool client_ready = false;
-                    for (int attempts = 0; attempts < 100 && gl.running; attempts++) {  // 5 second timeout
-                        PacketHeader hdr;
-                        uint8_t data[64];
-                        bool got_packet = recv_packet(&hdr, data, sizeof(data), 50);
-                        if (got_packet && hdr.cmd == CMD_READY) {
-                            client_ready = true;
-                            break;
-                        }
-                    }
+    pthread_mutex_lock(&gl.mutex);
+    uint32_t now_ms = monotonic_ms();
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (peer->fd < 0 || peer->ready) continue;
+        if ((int32_t)(peer->handshake_deadline_ms - now_ms) > 0) continue;
+
+        LOG_error("GBALink: HOST timeout waiting for client %u READY\n", peer->client_id);
+        // Send DISCONNECT so client knows we rejected them
+        send_packet(peer, CMD_DISCONNECT, NULL, 0, 0);
+        host_handshake_finish(peer, false);
+    }
+    handshake_timer_update();
+    pthread_mutex_unlock(&gl.mutex);
+}
 
-                    LOG_info("GBALink: HOST client_ready=%d\n", client_ready);
-                    if (!client_ready) {
-                        LOG_error("GBALink: HOST timeout waiting for client READY\n");
-                        // Send DISCONNECT so client knows we rejected them
-                        send_packet(CMD_DISCONNECT, NULL, 0, 0);
-                        close(gl.tcp_fd);
-                        gl.tcp_fd = -1;
-                        gl.state = GBALINK_STATE_WAITING;
-                        pthread_mutex_unlock(&gl.mutex);
-                        continue;
-                    }
+// Close handshakes still pending when hosting stops (not on the event loop,
+// mutex not held). Each fd is taken from its slot first so a running
+// on_handshake_data leaves it alone, then unwatched before it is closed.
+static void host_abort_handshakes(void) {
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
 
-                    // Send READY back to client with link mode for synchronization
-                    // Link mode is sent so client can match host's gpsp_serial setting
-                    uint16_t mode_len = gl.link_mode[0] ? (uint16_t)(strlen(gl.link_mode) + 1) : 0;
-                    send_packet(CMD_READY, gl.link_mode, mode_len, 0);
-
-                    // Verify state hasn't changed during handshake
-                    // (main thread could have disconnected during mutex release in send_packet)
-                    if (gl.tcp_fd < 0 || gl.state != GBALINK_STATE_CONNECTED) {
-                        // Connection was interrupted during handshake
-                        pthread_mutex_unlock(&gl.mutex);
-                        continue;
-                    }
+        pthread_mutex_lock(&gl.mutex);
+        int fd = (peer->fd >= 0 && !peer->ready) ? peer->fd : -1;
+        if (fd >= 0) peer->fd = -1;
+        pthread_mutex_unlock(&gl.mutex);
+        if (fd < 0) continue;
+
+        NET_unwatch(fd);
+        close(fd);
+        pthread_mutex_lock(&gl.mutex);
+        rudp_close(peer);
+        peer_reset(peer);
+        pthread_mutex_unlock(&gl.mutex);
+    }
+}
 
-                    // Set flag for main thread to process (core callbacks must run on main thread)
-                    // Memory barrier ensures all state writes are visible before flag is set
-                    __sync_synchronize();
-                    gl.pending_host_connected = true;
-                    LOG_info("GBALink: HOST handshake complete, pending_host_connected=true\n");
+// Event loop: incoming connection. Only reserves a slot - the READY handshake
+// continues in on_handshake_data as the client's packets arrive.
+static void on_listen_ready(int listen_fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
 
-                    // Close UDP sockets - no longer needed after connection
-                    if (gl.udp_fd >= 0) {
-                        close(gl.udp_fd);
-                        gl.udp_fd = -1;
-                    }
-                    if (gl.udp_listen_fd >= 0) {
-                        close(gl.udp_listen_fd);
-                        gl.udp_listen_fd = -1;
-                    }
+    struct sockaddr_in client_addr;
+    socklen_t len = sizeof(client_addr);
 
-                    pthread_mutex_unlock(&gl.mutex);
-                }
-            }
-        } else {
-            usleep(50000);  // 50ms
-        }
+    int fd = accept(listen_fd, (struct sockaddr*)&client_addr, &len);
+    if (fd < 0 || !gl.running) {
+        if (fd >= 0) close(fd);
+        return;
     }
 
-    return NULL;
+    char client_ip[16];
+    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
+    LOG_info("GBALink: HOST accept() got connection from %s\n", client_ip);
+
+    pthread_mutex_lock(&gl.mutex);
+
+    GBALinkPeer* peer = host_accepting() ? find_free_slot() : NULL;
+    if (!peer) {
+        LOG_info("GBALink: HOST rejecting - no free client slot\n");
+        close(fd);
+        pthread_mutex_unlock(&gl.mutex);
+        return;
+    }
+
+    // Configure TCP socket using GBALink-specific settings
+    NET_configureTCPSocket(fd, &GBALINK_TCP_CONFIG);
+
+    if (!peer_alloc_buffers(peer) || NET_watchSocket(fd, on_handshake_data, peer) < 0) {
+        close(fd);
+        pthread_mutex_unlock(&gl.mutex);
+        return;
+    }
+
+    // Reserve the slot - client IDs follow the slot (host is 0)
+    peer_reset(peer);
+    peer->fd = fd;
+    peer->client_id = (uint16_t)(peer - gl.peers) + 1;
+    strncpy(peer->ip, client_ip, sizeof(peer->ip) - 1);
+    peer->ip[sizeof(peer->ip) - 1] = '\0';
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    peer->last_packet_sent = now;
+    peer->last_packet_received = now;
+    peer->handshake_deadline_ms = monotonic_ms() + HOST_HANDSHAKE_TIMEOUT_MS;
+    handshake_timer_update();
+    pthread_mutex_unlock(&gl.mutex);
+
+    LOG_info("GBALink: HOST waiting for client %u READY signal...\n", peer->client_id);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 // Client Mode
 //////////////////////////////////////////////////////////////////////////////
 
+// Both sides are ready - notify minarch to start the netpacket session
+static void client_start_session(GBALinkPeer* peer) {
+    pthread_mutex_lock(&gl.mutex);
+    peer->ready = true;
+    pthread_mutex_unlock(&gl.mutex);
+    LOG_info("GBALink: CLIENT joined as client %u\n", gl.local_client_id);
+    GBALink_notifyConnected(0);
+}
+
 int GBALink_connectToHost(const char* ip, uint16_t port) {
     LOG_info("GBALink: CLIENT connectToHost(%s:%d) called\n", ip, port);
     GBALink_init();  // Lazy init
@@ -689,8 +1722,17 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
     NET_getLocalIP(gl.local_ip, sizeof(gl.local_ip));
     LOG_info("GBALink: CLIENT local_ip=%s\n", gl.local_ip);
 
-    gl.tcp_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (gl.tcp_fd < 0) {
+    // A client's only peer is the host
+    GBALinkPeer* peer = &gl.peers[0];
+    peer_reset(peer);
+    peer->client_id = 0;
+    if (!peer_alloc_buffers(peer)) {
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "Out of memory");
+        return -1;
+    }
+
+    peer->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (peer->fd < 0) {
         LOG_info("GBALink: CLIENT socket() failed errno=%d\n", errno);
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Socket creation failed");
         return -1;
@@ -701,8 +1743,8 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
     addr.sin_port = htons(port);
 
     if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
-        close(gl.tcp_fd);
-        gl.tcp_fd = -1;
+        close(peer->fd);
+        peer->fd = -1;
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Invalid IP address");
         return -1;
     }
@@ -712,12 +1754,12 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
 
     // Connect with timeout
     struct timeval tv = {.tv_sec = 5, .tv_usec = 0};
-    setsockopt(gl.tcp_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(peer->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 
-    if (connect(gl.tcp_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    if (connect(peer->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         LOG_info("GBALink: CLIENT connect() failed errno=%d\n", errno);
-        close(gl.tcp_fd);
-        gl.tcp_fd = -1;
+        close(peer->fd);
+        peer->fd = -1;
         gl.state = GBALINK_STATE_ERROR;
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Connection failed");
         return -1;
@@ -726,48 +1768,55 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
     LOG_info("GBALink: CLIENT TCP connected to %s:%d\n", ip, port);
 
     // Configure TCP socket using GBALink-specific settings
-    NET_configureTCPSocket(gl.tcp_fd, &GBALINK_TCP_CONFIG);
+    NET_configureTCPSocket(peer->fd, &GBALINK_TCP_CONFIG);
 
-    strncpy(gl.remote_ip, ip, sizeof(gl.remote_ip) - 1);
+    strncpy(peer->ip, ip, sizeof(peer->ip) - 1);
+    peer->ip[sizeof(peer->ip) - 1] = '\0';
     gl.port = port;
     gl.mode = GBALINK_CLIENT;
     gl.state = GBALINK_STATE_CONNECTED;
-    gl.local_client_id = 1;  // Client is always client 1
+    gl.local_client_id = 1;  // Until the host assigns one in its READY
+    gl.frame_lock = false;   // Until the host sends CMD_FRAME_LOCK
+    gl.pending_delay = 0;
 
-    gl.pending_count = 0;
-    gl.pending_read_idx = 0;
-    gl.pending_write_idx = 0;
-    gl.stream_buf_read_idx = 0;
-    gl.stream_buf_write_idx = 0;
+    rx_ring_reset();
     struct timeval now;
     gettimeofday(&now, NULL);
-    gl.last_packet_sent = now;
-    gl.last_packet_received = now;
+    peer->last_packet_sent = now;
+    peer->last_packet_received = now;
 
     snprintf(gl.status_msg, sizeof(gl.status_msg), "Connected to %s", ip);
 
-    // Send READY signal to host and wait for host's READY
+    // Send READY signal to host and wait for host's READY. It offers our UDP
+    // port; the host answers with CMD_TRANSPORT if it wants reliable UDP.
     pthread_mutex_lock(&gl.mutex);
-    send_packet(CMD_READY, NULL, 0, gl.local_client_id);
+    TransportPayload offer = {.udp_port = htons(rudp_open(peer))};
+    send_packet(peer, CMD_READY, &offer, offer.udp_port ? sizeof(offer) : 0, 0);
     pthread_mutex_unlock(&gl.mutex);
 
     // Set socket receive timeout for handshake (5 seconds)
     // This helps detect dead connections during handshake
     struct timeval handshake_timeout = {.tv_sec = 5, .tv_usec = 0};
-    setsockopt(gl.tcp_fd, SOL_SOCKET, SO_RCVTIMEO, &handshake_timeout, sizeof(handshake_timeout));
+    setsockopt(peer->fd, SOL_SOCKET, SO_RCVTIMEO, &handshake_timeout, sizeof(handshake_timeout));
 
     // Wait for host's READY signal (with timeout - 5 seconds = 100 x 50ms)
     bool host_ready = false;
     bool needs_reload = false;
+    bool use_udp = false;
     for (int attempts = 0; attempts < 100; attempts++) {
         PacketHeader hdr;
         uint8_t data[64];
         pthread_mutex_lock(&gl.mutex);
-        bool got_packet = recv_packet(&hdr, data, sizeof(data), 50);
+        bool got_packet = recv_packet(peer, &hdr, data, sizeof(data), 50);
         pthread_mutex_unlock(&gl.mutex);
 
         if (got_packet) {
             if (hdr.cmd == CMD_READY) {
+                // Header carries the client ID the host assigned to us
+                if (hdr.client_id >= 1 && hdr.client_id <= GBALINK_MAX_CLIENTS) {
+                    gl.local_client_id = hdr.client_id;
+                }
+
                 // Extract link mode from payload and check if it differs from client
                 if (hdr.size > 0 && hdr.size < sizeof(data)) {
                     data[hdr.size] = '\0';  // Ensure null-terminated
@@ -791,11 +1840,24 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
                 }
                 host_ready = true;
                 break;
+            } else if (hdr.cmd == CMD_FRAME_LOCK && hdr.size == sizeof(FrameLockPayload)) {
+                pthread_mutex_lock(&gl.mutex);
+                frame_lock_schedule((const FrameLockPayload*)data);
+                gl.frame_delay = gl.pending_delay;
+                gl.pending_delay = 0;
+                pthread_mutex_unlock(&gl.mutex);
+                LOG_info("GBALink: CLIENT frame lock on, delay %u frames\n", gl.frame_delay);
+            } else if (hdr.cmd == CMD_TRANSPORT && hdr.size == sizeof(TransportPayload)) {
+                TransportPayload payload;
+                memcpy(&payload, data, sizeof(payload));
+                use_udp = rudp_connect(peer, ntohs(payload.udp_port));
+                LOG_info("GBALink: CLIENT host chose reliable UDP (%s)\n", use_udp ? "ok" : "connect failed");
             } else if (hdr.cmd == CMD_DISCONNECT) {
                 // Host rejected us during handshake
                 LOG_error("GBALink: Host sent DISCONNECT during handshake\n");
-                close(gl.tcp_fd);
-                gl.tcp_fd = -1;
+                close(peer->fd);
+                peer->fd = -1;
+                rudp_close(peer);
                 gl.mode = GBALINK_OFF;
                 gl.state = GBALINK_STATE_ERROR;
                 snprintf(gl.status_msg, sizeof(gl.status_msg), "Host rejected connection");
@@ -806,8 +1868,9 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
 
     if (!host_ready) {
         LOG_error("GBALink: CLIENT timeout waiting for host READY\n");
-        close(gl.tcp_fd);
-        gl.tcp_fd = -1;
+        close(peer->fd);
+        peer->fd = -1;
+        rudp_close(peer);
         gl.mode = GBALINK_OFF;
         gl.state = GBALINK_STATE_ERROR;
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Host not responding");
@@ -816,17 +1879,60 @@ int GBALink_connectToHost(const char* ip, uint16_t port) {
 
     // Restore normal timeout after successful handshake
     struct timeval normal_timeout = {.tv_sec = 0, .tv_usec = GBALINK_TCP_CONFIG.recv_timeout_us};
-    setsockopt(gl.tcp_fd, SOL_SOCKET, SO_RCVTIMEO, &normal_timeout, sizeof(normal_timeout));
+    setsockopt(peer->fd, SOL_SOCKET, SO_RCVTIMEO, &normal_timeout, sizeof(normal_timeout));
+
+    // Everything after READY uses the transport the host picked
+    pthread_mutex_lock(&gl.mutex);
+    if (use_udp && !rudp_activate(peer)) {
+        close(peer->fd);
+        peer->fd = -1;
+        rudp_close(peer);
+        gl.mode = GBALINK_OFF;
+        gl.state = GBALINK_STATE_ERROR;
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "Out of memory");
+        pthread_mutex_unlock(&gl.mutex);
+        return GBALINK_CONNECT_ERROR;
+    }
+    if (!use_udp) {
+        rudp_close(peer);
+    }
+    pthread_mutex_unlock(&gl.mutex);
 
     // If link modes differ, return special code so UI can confirm with user
-    // Don't start netpacket session yet - wait for user confirmation and reload
+    // Don't start netpacket session yet - the connection stays open while the
+    // game reloads, then GBALink_finishPendingJoin starts it
     if (needs_reload) {
         return GBALINK_CONNECT_NEEDS_RELOAD;
     }
 
-    // Now both sides are ready - notify minarch to start netpacket session
-    GBALink_notifyConnected(0);
+    client_start_session(peer);
+    return GBALINK_CONNECT_OK;
+}
+
+// Finish a join that returned GBALINK_CONNECT_NEEDS_RELOAD, once the caller has
+// applied the host's mode and reloaded the game. The handshake is already done,
+// so the session starts on the existing connection instead of reconnecting.
+int GBALink_finishPendingJoin(void) {
+    GBALinkPeer* peer = &gl.peers[0];
+
+    pthread_mutex_lock(&gl.mutex);
+    bool pending = gl.mode == GBALINK_CLIENT && peer->fd >= 0 && !peer->ready;
+    pthread_mutex_unlock(&gl.mutex);
+
+    if (!pending) {
+        // Host went away while we reloaded (GBALink_update already cleaned up)
+        LOG_warn("GBALink: CLIENT connection lost during reload\n");
+        return GBALINK_CONNECT_ERROR;
+    }
+    if (!gl.has_core_callbacks) {
+        // Reloaded core didn't register netpacket - the new mode isn't a link mode
+        LOG_error("GBALink: CLIENT core has no netpacket interface after reload\n");
+        GBALink_disconnect();
+        return GBALINK_CONNECT_ERROR;
+    }
 
+    GBALink_clearPendingReload();
+    client_start_session(peer);
     return GBALINK_CONNECT_OK;
 }
 
@@ -835,14 +1941,26 @@ void GBALink_disconnect(void) {
 
     // Notify minarch to stop netpacket session first
     GBALink_notifyDisconnected();
+    io_thread_stop();
 
     pthread_mutex_lock(&gl.mutex);
-    if (gl.tcp_fd >= 0) {
-        send_packet(CMD_DISCONNECT, NULL, 0, 0);
-        // send_packet re-acquires mutex, so we still hold it here
-        close(gl.tcp_fd);
-        gl.tcp_fd = -1;
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        // Host slots mid-handshake belong to the event loop
+        if (peer->fd < 0 || (prev_mode == GBALINK_HOST && !peer->ready)) continue;
+
+        // Best effort - whatever the kernel won't take right now is dropped
+        send_packet(peer, CMD_DISCONNECT, NULL, 0, 0);
+        close(peer->fd);
+        rudp_close(peer);
+        peer_reset(peer);
+        peer->announced = false;
+        peer->pending_disconnect = false;
     }
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        if (gl.peers[i].fd < 0) peer_free_buffers(&gl.peers[i]);
+    }
+    gl.pending_disconnect_notify = false;
 
     // Always clear core_registered to prevent timeout checks
     gl.core_registered = false;
@@ -859,15 +1977,15 @@ void GBALink_disconnect(void) {
     } else if (prev_mode == GBALINK_HOST) {
         gl.state = GBALINK_STATE_WAITING;
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Client left, waiting on %s:%d", gl.local_ip, gl.port);
+        GBALink_restartBroadcast();
     } else {
         gl.mode = GBALINK_OFF;
         gl.state = GBALINK_STATE_DISCONNECTED;
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Disconnected");
     }
 
-    gl.pending_count = 0;
-    gl.stream_buf_read_idx = 0;
-    gl.stream_buf_write_idx = 0;
+    log_rx_stats();
+    rx_ring_reset();
     pthread_mutex_unlock(&gl.mutex);
 }
 
@@ -881,7 +1999,10 @@ int GBALink_startDiscovery(void) {
     gl.udp_fd = NET_createDiscoveryListenSocket(GBALINK_DISCOVERY_PORT);
     if (gl.udp_fd < 0) return -1;
 
-    gl.num_hosts = 0;
+    // Ask hosts right away instead of waiting for their next broadcast
+    NET_initDiscoveryCache(&gl.discovery, GL_DISCOVERY_QUERY, GL_DISCOVERY_RESP,
+                           GBALINK_PROTOCOL_VERSION, GBALINK_DISCOVERY_PORT);
+    NET_sendDiscoveryQuery(gl.udp_fd, &gl.discovery);
     gl.discovery_active = true;
     return 0;
 }
@@ -900,15 +2021,8 @@ void GBALink_stopDiscovery(void) {
 int GBALink_getDiscoveredHosts(GBALinkHostInfo* hosts, int max_hosts) {
     if (!gl.discovery_active || gl.udp_fd < 0) return 0;
 
-    // Poll for discovery responses using shared function
     // GBALinkHostInfo and NET_HostInfo have identical layouts
-    NET_receiveDiscoveryResponses(gl.udp_fd, GL_DISCOVERY_RESP,
-                                   (NET_HostInfo*)gl.discovered_hosts, &gl.num_hosts,
-                                   GBALINK_MAX_HOSTS);
-
-    int count = (gl.num_hosts < max_hosts) ? gl.num_hosts : max_hosts;
-    memcpy(hosts, gl.discovered_hosts, count * sizeof(GBALinkHostInfo));
-    return count;
+    return NET_updateDiscoveryCache(gl.udp_fd, &gl.discovery, (NET_HostInfo*)hosts, max_hosts);
 }
 
 int GBALink_queryHostLinkMode(const char* host_ip, char* link_mode_out, size_t size) {
@@ -980,8 +2094,10 @@ void GBALink_onNetpacketStart(uint16_t client_id,
     // Reset packet timestamps to start fresh timeout window after handshake
     struct timeval now;
     gettimeofday(&now, NULL);
-    gl.last_packet_sent = now;
-    gl.last_packet_received = now;
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        gl.peers[i].last_packet_sent = now;
+        gl.peers[i].last_packet_received = now;
+    }
     pthread_mutex_unlock(&gl.mutex);
 }
 
@@ -1002,29 +2118,106 @@ void GBALink_onNetpacketPoll(void) {
 // Packet Sending (called by core via netpacket send function)
 //////////////////////////////////////////////////////////////////////////////
 
+// Write out a peer's pending batch - caller must hold mutex
+static bool tx_batch_flush(GBALinkPeer* peer) {
+    if (peer->tx_batch_len == 0) return true;
+
+    bool ok = tx_write(peer, peer->tx_batch, peer->tx_batch_len);
+    peer->tx_batch_len = 0;
+    if (!ok) {
+        return false;
+    }
+
+    // Update last_packet_sent to prevent unnecessary heartbeats during active communication
+    peer->last_packet_sent = *get_frame_time();
+    return true;
+}
+
+// Append one SIO packet to a peer's batch - caller must hold mutex
+// With frame lock on, the packet is prefixed with the current frame (CMD_SIO_FRAME)
+static bool tx_batch_append(GBALinkPeer* peer, uint16_t client_id, const void* buf, size_t len) {
+    size_t tag_len = gl.frame_lock ? sizeof(uint32_t) : 0;
+    size_t record = sizeof(PacketHeader) + tag_len + len;
+    if (peer->tx_batch_len + record > TX_BATCH_SIZE && !tx_batch_flush(peer)) {
+        return false;
+    }
+
+    PacketHeader hdr = {
+        .cmd = gl.frame_lock ? CMD_SIO_FRAME : CMD_SIO_DATA,
+        .size = htons((uint16_t)(tag_len + len)),
+        .client_id = htons(client_id)
+    };
+    uint8_t* out = peer->tx_batch + peer->tx_batch_len;
+    memcpy(out, &hdr, sizeof(hdr));
+    if (tag_len) {
+        uint32_t frame = htonl(gl.frame);
+        memcpy(out + sizeof(hdr), &frame, sizeof(frame));
+    }
+    memcpy(out + sizeof(hdr) + tag_len, buf, len);
+    peer->tx_batch_len += record;
+    return true;
+}
+
+// Send to a netpacket destination. The host routes by client_id (one peer, or
+// all for RETRO_NETPACKET_BROADCAST) and stamps its own ID as sender; a client
+// always sends to the host with the destination in the header for relaying.
 void GBALink_sendPacket(int flags, const void* buf, size_t len, uint16_t client_id) {
     if (!GBALink_isConnected()) return;
 
-    // Handle empty flush request (flush only, no data)
-    // We use TCP_NODELAY so packets are already flushed immediately
-    if (!buf || len == 0) return;
+    if (len + (gl.frame_lock ? sizeof(uint32_t) : 0) > RECV_BUFFER_SIZE) {
+        // Remote would reject it and resync its stream buffer
+        LOG_warn("GBALink: dropping oversized SIO packet (%zu bytes)\n", len);
+        return;
+    }
 
-    // Send to remote via TCP
     pthread_mutex_lock(&gl.mutex);
-    bool sent_ok = send_packet(CMD_SIO_DATA, buf, (uint16_t)len, client_id);
-    if (!sent_ok) {
-        LOG_warn("GBALink: SIO_DATA send failed, disconnecting\n");
-        pthread_mutex_unlock(&gl.mutex);
-        GBALink_disconnect();
-        return;
+    bool is_host = gl.mode == GBALINK_HOST;
+    uint16_t header_id = is_host ? gl.local_client_id : client_id;
+
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (!peer->ready) continue;
+        if (is_host && client_id != RETRO_NETPACKET_BROADCAST && client_id != peer->client_id) continue;
+
+        // Empty buf is a flush-only request
+        bool sent_ok = true;
+        if (buf && len > 0) {
+            sent_ok = tx_batch_append(peer, header_id, buf, len);
+        }
+        if (sent_ok && (flags & RETRO_NETPACKET_FLUSH_HINT)) {
+            sent_ok = tx_batch_flush(peer);
+        }
+
+        if (!sent_ok) {
+            LOG_warn("GBALink: SIO_DATA send to client %u failed, disconnecting it\n", peer->client_id);
+            handle_remote_close(peer, "Connection lost");
+        }
+    }
+    pthread_mutex_unlock(&gl.mutex);
+}
+
+// Write out every peer's batch. end_of_frame also marks the frame complete
+// for frame lock peers (only once per frame, from GBALink_flushSend).
+static void flush_batches(bool end_of_frame) {
+    if (!GBALink_isConnected()) return;
+
+    bool frame_end = end_of_frame && gl.frame_lock && gl.netpacket_active;
+    uint32_t now_ms = frame_end ? monotonic_ms() : 0;
+
+    pthread_mutex_lock(&gl.mutex);
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (!peer->ready) continue;
+        if (!tx_batch_flush(peer) || (frame_end && !frame_lock_send_frame_end(peer, now_ms))) {
+            LOG_warn("GBALink: SIO_DATA send to client %u failed, disconnecting it\n", peer->client_id);
+            handle_remote_close(peer, "Connection lost");
+        }
     }
-    // Update last_packet_sent to prevent unnecessary heartbeats during active communication
-    gettimeofday(&gl.last_packet_sent, NULL);
     pthread_mutex_unlock(&gl.mutex);
+}
 
-    // FLUSH_HINT: Since we use TCP_NODELAY and send immediately,
-    // packets are already flushed. No additional action needed.
-    (void)flags;
+void GBALink_flushSend(void) {
+    flush_batches(true);
 }
 
 // Limit packets per poll to prevent frame stalls during high traffic
@@ -1040,23 +2233,27 @@ static void GBALink_sendHeartbeatIfNeeded(const struct timeval* now) {
     // Only host sends heartbeats - clients respond to host packets
     if (gl.mode != GBALINK_HOST || !GBALink_isConnected()) return;
 
-    long elapsed_ms = (now->tv_sec - gl.last_packet_sent.tv_sec) * 1000 +
-                      (now->tv_usec - gl.last_packet_sent.tv_usec) / 1000;
+    pthread_mutex_lock(&gl.mutex);
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (!peer->ready) continue;
 
-    if (elapsed_ms >= HEARTBEAT_INTERVAL_MS) {
-        pthread_mutex_lock(&gl.mutex);
-        bool sent_ok = send_packet(CMD_HEARTBEAT, NULL, 0, 0);
-        if (sent_ok) {
-            gl.last_packet_sent = *now;
+        long elapsed_ms = (now->tv_sec - peer->last_packet_sent.tv_sec) * 1000 +
+                          (now->tv_usec - peer->last_packet_sent.tv_usec) / 1000;
+        if (elapsed_ms < HEARTBEAT_INTERVAL_MS) continue;
+
+        if (send_packet(peer, CMD_HEARTBEAT, NULL, 0, 0)) {
+            peer->last_packet_sent = *now;
         } else {
             // Heartbeat send failed - connection is dead
-            GBALink_disconnect();
-            return;
+            handle_remote_close(peer, "Connection lost");
         }
-        pthread_mutex_unlock(&gl.mutex);
     }
+    pthread_mutex_unlock(&gl.mutex);
 }
 
+// Receiving happens on the I/O thread - this only keeps the link alive from the
+// main thread (heartbeat) and never touches the socket's receive side
 void GBALink_pollReceive(void) {
     if (!GBALink_isConnected()) return;
 
@@ -1065,80 +2262,6 @@ void GBALink_pollReceive(void) {
 
     // Send heartbeat if needed (host only, keeps clients alive)
     GBALink_sendHeartbeatIfNeeded(get_frame_time());
-
-    pthread_mutex_lock(&gl.mutex);
-
-    // Check for incoming packets with short timeout
-    PacketHeader hdr;
-    uint8_t data[RECV_BUFFER_SIZE];
-    // RECV_BUFFER_SIZE is 2048, well within uint16_t range
-    uint16_t max_recv = RECV_BUFFER_SIZE;
-    int packets_this_poll = 0;
-
-    while (packets_this_poll < MAX_PACKETS_PER_POLL && recv_packet(&hdr, data, max_recv, 0)) {
-        if (hdr.cmd == CMD_SIO_DATA) {
-            // Queue packet for delivery to core
-            // Note: hdr.size is validated by recv_packet to be <= RECV_BUFFER_SIZE
-            if (gl.pending_count < MAX_PENDING_PACKETS && hdr.size <= RECV_BUFFER_SIZE) {
-                ReceivedPacket* pkt = &gl.pending_packets[gl.pending_write_idx];
-                memcpy(pkt->data, data, hdr.size);
-                pkt->len = hdr.size;
-                pkt->client_id = hdr.client_id;
-                gl.pending_write_idx = (gl.pending_write_idx + 1) % MAX_PENDING_PACKETS;
-                gl.pending_count++;
-            }
-            packets_this_poll++;
-        } else if (hdr.cmd == CMD_HEARTBEAT) {
-            // Heartbeat received - timestamp already updated in recv_packet
-        } else if (hdr.cmd == CMD_DISCONNECT) {
-            // Remote sent explicit disconnect command
-            GBALinkMode prev_mode = gl.mode;
-            close(gl.tcp_fd);
-            gl.tcp_fd = -1;
-
-            if (prev_mode == GBALINK_CLIENT) {
-                // Client fully disconnects
-                gl.mode = GBALINK_OFF;
-                gl.state = GBALINK_STATE_DISCONNECTED;
-                gl.core_registered = false;  // Ensure this is cleared
-                strncpy(gl.local_ip, "0.0.0.0", sizeof(gl.local_ip) - 1);
-                gl.connected_to_hotspot = false;
-                snprintf(gl.status_msg, sizeof(gl.status_msg), "Host disconnected");
-                // Notify minarch that connection is lost
-                pthread_mutex_unlock(&gl.mutex);
-                GBALink_notifyDisconnected();
-                pthread_mutex_lock(&gl.mutex);
-                // Verify state wasn't corrupted during callback
-                if (gl.mode != GBALINK_OFF || gl.state != GBALINK_STATE_DISCONNECTED) {
-                    // Force correct state
-                    gl.mode = GBALINK_OFF;
-                    gl.state = GBALINK_STATE_DISCONNECTED;
-                }
-            } else if (prev_mode == GBALINK_HOST) {
-                // Host goes back to waiting and restarts broadcast
-                gl.state = GBALINK_STATE_WAITING;
-                gl.core_registered = false;  // Core session is over
-                // Notify minarch before restarting broadcast
-                pthread_mutex_unlock(&gl.mutex);
-                GBALink_notifyDisconnected();
-                pthread_mutex_lock(&gl.mutex);
-                GBALink_restartBroadcast();
-                snprintf(gl.status_msg, sizeof(gl.status_msg), "Client left, waiting on %s:%d", gl.local_ip, gl.port);
-            }
-            break;
-        }
-    }
-
-    // Check for deferred disconnect notification (set by recv_packet)
-    bool need_disconnect_notify = gl.pending_disconnect_notify;
-    gl.pending_disconnect_notify = false;
-
-    pthread_mutex_unlock(&gl.mutex);
-
-    // Process deferred notification after mutex release to avoid holding lock during callbacks
-    if (need_disconnect_notify) {
-        GBALink_notifyDisconnected();
-    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1164,7 +2287,8 @@ GBALinkState GBALink_getState(void) {
 bool GBALink_isConnected(void) {
     if (!gl.initialized) return false;
     pthread_mutex_lock(&gl.mutex);
-    bool connected = gl.tcp_fd >= 0 && gl.state == GBALINK_STATE_CONNECTED;
+    bool connected = gl.state == GBALINK_STATE_CONNECTED &&
+                     (gl.mode == GBALINK_HOST ? count_ready_peers() > 0 : gl.peers[0].fd >= 0);
     pthread_mutex_unlock(&gl.mutex);
     return connected;
 }
@@ -1218,16 +2342,46 @@ bool GBALink_hasNetworkConnection(void) {
     return NET_hasConnection();
 }
 
-void GBALink_update(void) {
-    if (!gl.initialized) return;
-    pthread_mutex_lock(&gl.mutex);
+// Main thread: tell the core about peers that dropped, and end the session
+// once nobody is left (host) or the host is gone (client)
+static void process_disconnects(void) {
+    uint16_t lost[GBALINK_MAX_CLIENTS];
+    int num_lost = 0;
 
-    // Process pending host connection notification (must run on main thread)
-    // The listen thread sets this flag, we process it here to ensure
-    // core callbacks are called from the main thread
-    if (gl.pending_host_connected) {
+    pthread_mutex_lock(&gl.mutex);
+    gl.pending_disconnect_notify = false;
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (!peer->pending_disconnect) continue;
+        peer->pending_disconnect = false;
+        if (peer->announced) {
+            peer->announced = false;
+            lost[num_lost++] = peer->client_id;
+        }
+    }
+    bool session_over = gl.mode != GBALINK_HOST || count_ready_peers() == 0;
+    pthread_mutex_unlock(&gl.mutex);
+
+    if (gl.netpacket_active && gl.core_callbacks.disconnected) {
+        for (int i = 0; i < num_lost; i++) {
+            gl.core_callbacks.disconnected(lost[i]);
+        }
+    }
+    if (session_over) {
+        GBALink_notifyDisconnected();
+    }
+}
+
+void GBALink_update(void) {
+    if (!gl.initialized) return;
+    pthread_mutex_lock(&gl.mutex);
+
+    // Process pending host connection notification (must run on main thread)
+    // The event loop sets this flag, we process it here to ensure
+    // core callbacks are called from the main thread
+    if (gl.pending_host_connected) {
         LOG_info("GBALink: HOST update() processing pending_host_connected\n");
-        // Memory barrier ensures we see all state from listen thread
+        // Memory barrier ensures we see all state from the event loop
         __sync_synchronize();
         gl.pending_host_connected = false;
         pthread_mutex_unlock(&gl.mutex);
@@ -1235,177 +2389,149 @@ void GBALink_update(void) {
         pthread_mutex_lock(&gl.mutex);
     }
 
-    // Check for connection errors via socket error state
-    // Optimization: only check every 10 frames to reduce syscall overhead
-    // TCP errors are still caught quickly by recv/send operations
-    if (gl.tcp_fd >= 0 && ++gl.error_check_counter >= 10) {
-        gl.error_check_counter = 0;
-        int fd = gl.tcp_fd;  // Cache fd under mutex
+    // Before the I/O thread owns the socket (pending reload) nothing waits for
+    // EPOLLOUT, so push out anything a client still has queued from here
+    GBALinkPeer* host_peer = &gl.peers[0];
+    if (!gl.io_running && gl.mode == GBALINK_CLIENT && host_peer->fd >= 0 &&
+        host_peer->tx_queue_len > 0 && !tx_queue_flush(host_peer)) {
         pthread_mutex_unlock(&gl.mutex);
-
-        int error = 0;
-        socklen_t len = sizeof(error);
-        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
-            GBALink_disconnect();
-            return;
-        }
-        pthread_mutex_lock(&gl.mutex);
+        GBALink_disconnect();
+        return;
     }
 
-    // Check for connection timeout - disconnect if no packets for too long
+    // Check for connection timeout - drop peers that sent nothing for too long
     // This detects dead connections that TCP keepalive may miss
     // Only check AFTER handshake is complete (core_registered is set by GBALink_notifyConnected)
-    if (gl.tcp_fd >= 0 && gl.state == GBALINK_STATE_CONNECTED && gl.core_registered) {
-        struct timeval last_recv = gl.last_packet_received;
-        pthread_mutex_unlock(&gl.mutex);
-
+    if (gl.state == GBALINK_STATE_CONNECTED && gl.core_registered) {
         // Use cached frame time if available, otherwise get fresh time
         const struct timeval* now = get_frame_time();
 
-        long elapsed_ms = (now->tv_sec - last_recv.tv_sec) * 1000 +
-                          (now->tv_usec - last_recv.tv_usec) / 1000;
+        for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+            GBALinkPeer* peer = &gl.peers[i];
+            if (!peer->ready) continue;
 
-        if (elapsed_ms > GBALINK_CONNECTION_TIMEOUT_MS) {
-            GBALink_disconnect();
-            return;
+            long elapsed_ms = (now->tv_sec - peer->last_packet_received.tv_sec) * 1000 +
+                              (now->tv_usec - peer->last_packet_received.tv_usec) / 1000;
+            if (elapsed_ms > GBALINK_CONNECTION_TIMEOUT_MS) {
+                LOG_warn("GBALink: client %u timed out\n", peer->client_id);
+                send_packet(peer, CMD_DISCONNECT, NULL, 0, 0);
+                handle_remote_close(peer, "Connection timed out");
+            }
         }
-    } else {
-        pthread_mutex_unlock(&gl.mutex);
     }
-}
 
-bool GBALink_getPendingPacket(void** buf, size_t* len, uint16_t* client_id) {
-    pthread_mutex_lock(&gl.mutex);
-    if (gl.pending_count == 0) {
-        pthread_mutex_unlock(&gl.mutex);
-        return false;
-    }
-    ReceivedPacket* pkt = &gl.pending_packets[gl.pending_read_idx];
-    *buf = pkt->data;
-    *len = pkt->len;
-    if (client_id) *client_id = pkt->client_id;
+    // Connection loss is detected by the I/O thread (EPOLLRDHUP/recv errors) and
+    // the send paths; the core callbacks for it must run here on the main thread
+    bool disconnects = gl.pending_disconnect_notify;
+    bool adapt = gl.frame_lock && gl.mode == GBALINK_HOST && gl.netpacket_active;
     pthread_mutex_unlock(&gl.mutex);
-    return true;
-}
 
-void GBALink_consumePendingPacket(void) {
-    pthread_mutex_lock(&gl.mutex);
-    if (gl.pending_count > 0) {
-        gl.pending_read_idx = (gl.pending_read_idx + 1) % MAX_PENDING_PACKETS;
-        gl.pending_count--;
+    if (adapt) {
+        frame_lock_adapt();
     }
-    pthread_mutex_unlock(&gl.mutex);
-}
 
-// Atomic get-and-consume: reduces mutex cycles in hot path (single lock instead of two)
-bool GBALink_popPendingPacket(void** buf, size_t* len, uint16_t* client_id) {
-    pthread_mutex_lock(&gl.mutex);
-    if (gl.pending_count == 0) {
-        pthread_mutex_unlock(&gl.mutex);
-        return false;
+    if (disconnects) {
+        process_disconnects();
     }
-    ReceivedPacket* pkt = &gl.pending_packets[gl.pending_read_idx];
-    *buf = pkt->data;
-    *len = pkt->len;
-    if (client_id) *client_id = pkt->client_id;
-    // Consume immediately
-    gl.pending_read_idx = (gl.pending_read_idx + 1) % MAX_PENDING_PACKETS;
-    gl.pending_count--;
-    pthread_mutex_unlock(&gl.mutex);
-    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 // Network Helper Functions
 //////////////////////////////////////////////////////////////////////////////
 
-// Forward declaration for drain function
-static void drain_receive_buffer(void);
+// Arm/disarm EPOLLOUT on the I/O thread's epoll set (mutex held)
+static void tx_watch_writable(GBALinkPeer* peer, bool enable) {
+    if (peer->tx_watch_writable == enable) return;
+    peer->tx_watch_writable = enable;
+    if (gl.io_epoll_fd < 0 || !peer->ready) return;
 
-// Send all bytes with retry logic for reliability
-// Retries up to 500ms total to handle WiFi latency and buffer pressure
-// Critical: RFU protocol breaks if packets are dropped - must deliver all packets
-// Returns false only on real errors or extended blocking
-// NOTE: This function does NOT hold the mutex - caller must NOT hold mutex either
-static bool send_all(int fd, const void* buf, size_t len) {
-    const uint8_t* p = buf;
-    int total_wait_us = 0;
-    const int max_wait_us = 2000000;  // 2 seconds - needs to be long enough to survive TCP deadlocks
+    struct epoll_event ev = {0};
+    ev.events = io_stream_events(peer);
+    ev.data.u64 = io_event_data(peer, false);
+    epoll_ctl(gl.io_epoll_fd, EPOLL_CTL_MOD, peer->fd, &ev);
+}
 
-    while (len > 0) {
-        ssize_t sent = send(fd, p, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+// Write as much of the transmit queue as the socket accepts (mutex held)
+// Returns false only on a real socket error
+static bool tx_queue_flush(GBALinkPeer* peer) {
+    if (peer->rudp) {
+        rudp_pump(peer);  // Window-limited, the rest goes out as acks arrive
+        return true;
+    }
+    while (peer->tx_queue_len > 0) {
+        if (peer->fd < 0) return false;
+        ssize_t sent = send(peer->fd, peer->tx_queue + peer->tx_queue_head, peer->tx_queue_len,
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
         if (sent > 0) {
-            p += sent;
-            len -= sent;
-            total_wait_us = 0;  // Reset wait time on successful send
-        } else if (sent < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Socket buffer full - wait briefly and retry
-                if (total_wait_us >= max_wait_us) {
-                    return false;
-                }
-
-                // CRITICAL: While waiting for send buffer to clear, drain our receive buffer
-                // This prevents deadlock where both sides are waiting to send but neither is receiving
-                // Safe to call without mutex since socket ops are thread-safe
-                drain_receive_buffer();
-
-                usleep(1000);  // 1ms
-                total_wait_us += 1000;
-            } else {
-                // Real error (connection closed, broken pipe, etc.)
-                return false;
-            }
+            peer->tx_queue_head += sent;
+            peer->tx_queue_len -= sent;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;  // Still full, EPOLLOUT stays armed
         } else {
-            // sent == 0 should not happen with TCP
             return false;
         }
     }
+
+    peer->tx_queue_head = 0;
+    tx_watch_writable(peer, false);
     return true;
 }
 
-// Drain receive buffer without holding mutex - used during send retries to prevent deadlock
-// This reads from TCP socket to clear the kernel's receive buffer, allowing remote to send more
-static void drain_receive_buffer(void) {
-    int fd;
-    pthread_mutex_lock(&gl.mutex);
-    fd = gl.tcp_fd;
-
-    // Compact buffer if needed to make space for draining (uses optimized helper)
-    compact_stream_buffer_if_needed(1024);
-    size_t space = sizeof(gl.stream_buf) - gl.stream_buf_write_idx;
-    pthread_mutex_unlock(&gl.mutex);
-
-    if (fd < 0 || space == 0) return;
-
-    // Check if data is available
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(fd, &fds);
-    struct timeval tv = {0, 0};  // Non-blocking
-
-    if (select(fd + 1, &fds, NULL, NULL, &tv) > 0) {
-        // Read data into stream buffer (under mutex)
-        pthread_mutex_lock(&gl.mutex);
-        if (gl.tcp_fd >= 0) {
-            space = sizeof(gl.stream_buf) - gl.stream_buf_write_idx;
-            if (space > 0) {
-                ssize_t ret = recv(gl.tcp_fd, gl.stream_buf + gl.stream_buf_write_idx, space, MSG_DONTWAIT);
-                if (ret > 0) {
-                    gl.stream_buf_write_idx += ret;
-                }
+// Send bytes without blocking (mutex held). Writes directly when nothing is
+// queued so ordering is kept; any remainder goes to the transmit queue.
+// Returns false on socket error or queue overflow.
+static bool tx_write(GBALinkPeer* peer, const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    if (peer->fd < 0) return false;
+    if (peer->rudp) return rudp_write(peer, buf, len);
+
+    if (peer->tx_queue_len == 0) {
+        while (len > 0) {
+            ssize_t sent = send(peer->fd, p, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent > 0) {
+                p += sent;
+                len -= sent;
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                return false;  // Connection closed, broken pipe, etc.
             }
         }
-        pthread_mutex_unlock(&gl.mutex);
+        if (len == 0) return true;
     }
+
+    if (!tx_queue_append(peer, p, len)) {
+        return false;
+    }
+    tx_watch_writable(peer, true);
+    return true;
 }
 
-// Send packet - NOTE: caller must hold mutex for shared state, but we release during I/O
-static bool send_packet(uint8_t cmd, const void* data, uint16_t size, uint16_t client_id) {
-    if (gl.tcp_fd < 0) return false;
+// Add bytes to the end of the transmit queue (mutex held)
+// Returns false on overflow
+static bool tx_queue_append(GBALinkPeer* peer, const void* buf, size_t len) {
+    // Make room at the end of the queue
+    if (peer->tx_queue_head + peer->tx_queue_len + len > TX_QUEUE_SIZE && peer->tx_queue_head > 0) {
+        memmove(peer->tx_queue, peer->tx_queue + peer->tx_queue_head, peer->tx_queue_len);
+        peer->tx_queue_head = 0;
+    }
+    if (peer->tx_queue_len + len > TX_QUEUE_SIZE) {
+        LOG_warn("GBALink: transmit queue overflow (%zu queued), peer not reading\n", peer->tx_queue_len);
+        return false;
+    }
+
+    memcpy(peer->tx_queue + peer->tx_queue_head + peer->tx_queue_len, buf, len);
+    peer->tx_queue_len += len;
+    return true;
+}
 
-    // Get fd before releasing mutex
-    int fd = gl.tcp_fd;
+// Send packet - caller must hold mutex (or own a reserved slot). Never blocks: see tx_write
+static bool send_packet(GBALinkPeer* peer, uint8_t cmd, const void* data, uint16_t size, uint16_t client_id) {
+    if (peer->fd < 0) return false;
 
     PacketHeader hdr = {
         .cmd = cmd,
@@ -1413,108 +2539,82 @@ static bool send_packet(uint8_t cmd, const void* data, uint16_t size, uint16_t c
         .client_id = htons(client_id)
     };
 
-    // Release mutex during actual I/O to allow receive processing
-    pthread_mutex_unlock(&gl.mutex);
-
-    bool ok = send_all(fd, &hdr, sizeof(hdr));
-    if (ok && size > 0 && data) {
-        ok = send_all(fd, data, size);
-    }
-
-    // Re-acquire mutex before returning
-    pthread_mutex_lock(&gl.mutex);
-
-    // Validate fd is still valid (another thread could have disconnected)
-    if (gl.tcp_fd < 0 || gl.tcp_fd != fd) {
+    if (!tx_write(peer, &hdr, sizeof(hdr))) {
         return false;
     }
-
-    if (!ok) {
+    if (size > 0 && data && !tx_write(peer, data, size)) {
         return false;
     }
-
     return true;
 }
 
-static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int timeout_ms) {
-    if (gl.tcp_fd < 0) return false;
+// Connection closed or reset by remote (called with mutex held). Core callbacks
+// can't run here, the main thread picks up pending_disconnect_notify in GBALink_update
+static void handle_remote_close(GBALinkPeer* peer, const char* client_msg) {
+    bool was_ready = peer->ready;
+    if (peer->fd >= 0) {
+        close(peer->fd);
+    }
+    rudp_close(peer);
+    peer_reset(peer);
 
-    // Calculate available data in buffer
-    size_t available = gl.stream_buf_write_idx - gl.stream_buf_read_idx;
+    if (gl.mode == GBALINK_CLIENT) {
+        // Client fully disconnects
+        gl.core_registered = false;  // Prevent timeout check from firing
+        gl.mode = GBALINK_OFF;
+        gl.state = GBALINK_STATE_DISCONNECTED;
+        strncpy(gl.local_ip, "0.0.0.0", sizeof(gl.local_ip) - 1);
+        gl.connected_to_hotspot = false;
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "%s", client_msg);
+        peer->pending_disconnect = true;
+        gl.pending_disconnect_notify = true;
+    } else if (gl.mode == GBALINK_HOST && was_ready) {
+        // Host drops this client and reopens its slot to new ones
+        LOG_info("GBALink: HOST client %u left\n", peer->client_id);
+        peer->pending_disconnect = true;
+        gl.pending_disconnect_notify = true;
+        if (count_ready_peers() == 0) {
+            gl.core_registered = false;  // Prevent timeout check from firing
+            gl.state = GBALINK_STATE_WAITING;
+            snprintf(gl.status_msg, sizeof(gl.status_msg), "Client left, waiting on %s:%d", gl.local_ip, gl.port);
+        } else {
+            snprintf(gl.status_msg, sizeof(gl.status_msg), "%d clients connected", count_ready_peers());
+        }
+        GBALink_restartBroadcast();
+    }
+    // Host slot that never finished its handshake: just freed
+}
 
-    // Try to read more data into our stream buffer (non-blocking)
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(gl.tcp_fd, &fds);
+// Read whatever is available on the peer's socket into stream_buf (non-blocking, mutex held)
+// Returns false if the connection was closed
+static bool stream_fill(GBALinkPeer* peer) {
+    if (peer->fd < 0) return false;
 
-    struct timeval tv = {
-        .tv_sec = timeout_ms / 1000,
-        .tv_usec = (timeout_ms % 1000) * 1000
-    };
+    // Compact buffer if needed (optimized: only when read_idx past halfway)
+    compact_stream_buffer_if_needed(peer, 1024);
+    size_t space_at_end = STREAM_BUF_SIZE - peer->stream_buf_write_idx;
+    if (space_at_end == 0) return true;
 
-    // Only try to recv if there's data available (non-blocking check)
-    if (select(gl.tcp_fd + 1, &fds, NULL, NULL, &tv) > 0) {
-        // Compact buffer if needed (optimized: only when read_idx past halfway)
-        compact_stream_buffer_if_needed(1024);
-        size_t space_at_end = sizeof(gl.stream_buf) - gl.stream_buf_write_idx;
-
-        if (space_at_end > 0) {
-            ssize_t ret = recv(gl.tcp_fd, gl.stream_buf + gl.stream_buf_write_idx, space_at_end, MSG_DONTWAIT);
-            if (ret == 0) {
-                // Connection closed by remote
-                GBALinkMode prev_mode = gl.mode;
-                close(gl.tcp_fd);
-                gl.tcp_fd = -1;
-                gl.core_registered = false;  // Prevent timeout check from firing
-
-                if (prev_mode == GBALINK_CLIENT) {
-                    // Client fully disconnects
-                    gl.mode = GBALINK_OFF;
-                    gl.state = GBALINK_STATE_DISCONNECTED;
-                    strncpy(gl.local_ip, "0.0.0.0", sizeof(gl.local_ip) - 1);
-                    gl.connected_to_hotspot = false;
-                    snprintf(gl.status_msg, sizeof(gl.status_msg), "Host disconnected");
-                    gl.pending_disconnect_notify = true;  // Defer notification until mutex released
-                } else if (prev_mode == GBALINK_HOST) {
-                    // Host goes back to waiting and restarts broadcast
-                    gl.state = GBALINK_STATE_WAITING;
-                    snprintf(gl.status_msg, sizeof(gl.status_msg), "Client left, waiting on %s:%d", gl.local_ip, gl.port);
-                    gl.pending_disconnect_notify = true;  // Defer notification until mutex released
-                    GBALink_restartBroadcast();
-                }
-                return false;
-            }
-            if (ret < 0) {
-                if (errno == ECONNRESET || errno == EPIPE || errno == ENOTCONN) {
-                    GBALinkMode prev_mode = gl.mode;
-                    close(gl.tcp_fd);
-                    gl.tcp_fd = -1;
-                    gl.core_registered = false;  // Prevent timeout check from firing
-
-                    if (prev_mode == GBALINK_CLIENT) {
-                        // Client fully disconnects
-                        gl.mode = GBALINK_OFF;
-                        gl.state = GBALINK_STATE_DISCONNECTED;
-                        strncpy(gl.local_ip, "0.0.0.0", sizeof(gl.local_ip) - 1);
-                        gl.connected_to_hotspot = false;
-                        snprintf(gl.status_msg, sizeof(gl.status_msg), "Connection lost");
-                        gl.pending_disconnect_notify = true;  // Defer notification until mutex released
-                    } else if (prev_mode == GBALINK_HOST) {
-                        // Host goes back to waiting and restarts broadcast
-                        gl.state = GBALINK_STATE_WAITING;
-                        snprintf(gl.status_msg, sizeof(gl.status_msg), "Client left, waiting on %s:%d", gl.local_ip, gl.port);
-                        gl.pending_disconnect_notify = true;  // Defer notification until mutex released
-                        GBALink_restartBroadcast();
-                    }
-                    return false;
-                }
-                // EAGAIN/EWOULDBLOCK is ok, just no data right now
-            } else {
-                gl.stream_buf_write_idx += ret;
-                available += ret;
-            }
+    ssize_t ret = recv(peer->fd, peer->stream_buf + peer->stream_buf_write_idx, space_at_end, MSG_DONTWAIT);
+    if (ret == 0) {
+        // Connection closed by remote
+        handle_remote_close(peer, "Host disconnected");
+        return false;
+    }
+    if (ret < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return true;  // No data right now
         }
+        handle_remote_close(peer, "Connection lost");
+        return false;
     }
+    peer->stream_buf_write_idx += ret;
+    return true;
+}
+
+// Extract one complete packet from the peer's stream_buf (mutex held)
+static bool stream_parse(GBALinkPeer* peer, PacketHeader* hdr, void* data, uint16_t max_size, const struct timeval* now) {
+    size_t available = peer->stream_buf_write_idx - peer->stream_buf_read_idx;
 
     // Check if we have a complete header
     if (available < sizeof(PacketHeader)) {
@@ -1522,7 +2622,7 @@ static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int ti
     }
 
     // Parse header from buffer
-    PacketHeader* buf_hdr = (PacketHeader*)(gl.stream_buf + gl.stream_buf_read_idx);
+    PacketHeader* buf_hdr = (PacketHeader*)(peer->stream_buf + peer->stream_buf_read_idx);
     hdr->cmd = buf_hdr->cmd;
     hdr->size = ntohs(buf_hdr->size);
     hdr->client_id = ntohs(buf_hdr->client_id);
@@ -1531,8 +2631,8 @@ static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int ti
     // Check both against max_size (caller's buffer) and RECV_BUFFER_SIZE (our buffer)
     if (hdr->size > max_size || hdr->size > RECV_BUFFER_SIZE) {
         // Invalid packet size - protocol error, reset buffer
-        gl.stream_buf_read_idx = 0;
-        gl.stream_buf_write_idx = 0;
+        peer->stream_buf_read_idx = 0;
+        peer->stream_buf_write_idx = 0;
         return false;
     }
 
@@ -1544,30 +2644,418 @@ static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int ti
 
     // Copy payload to output (bounds already validated above)
     if (hdr->size > 0 && data) {
-        memcpy(data, gl.stream_buf + gl.stream_buf_read_idx + sizeof(PacketHeader), hdr->size);
+        memcpy(data, peer->stream_buf + peer->stream_buf_read_idx + sizeof(PacketHeader), hdr->size);
     }
 
     // Advance read index instead of memmove - O(1) instead of O(n)
-    gl.stream_buf_read_idx += total_size;
+    peer->stream_buf_read_idx += total_size;
 
     // If buffer is now empty, reset indices to avoid accumulating offset
-    if (gl.stream_buf_read_idx == gl.stream_buf_write_idx) {
-        gl.stream_buf_read_idx = 0;
-        gl.stream_buf_write_idx = 0;
+    if (peer->stream_buf_read_idx == peer->stream_buf_write_idx) {
+        peer->stream_buf_read_idx = 0;
+        peer->stream_buf_write_idx = 0;
+    }
+
+    peer->last_packet_received = *now;
+    return true;
+}
+
+// Blocking receive with timeout - only used for the client handshake, before
+// the I/O thread owns the socket
+static bool recv_packet(GBALinkPeer* peer, PacketHeader* hdr, void* data, uint16_t max_size, int timeout_ms) {
+    if (peer->fd < 0) return false;
+
+    // Handshakes run before the frame loop, so don't use the frame time cache
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    // A complete packet may already be buffered
+    if (stream_parse(peer, hdr, data, max_size, &now)) {
+        return true;
+    }
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(peer->fd, &fds);
+
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000
+    };
+
+    if (select(peer->fd + 1, &fds, NULL, NULL, &tv) > 0) {
+        if (!stream_fill(peer)) return false;
+    }
+
+    gettimeofday(&now, NULL);
+    return stream_parse(peer, hdr, data, max_size, &now);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Reliable UDP Transport
+//////////////////////////////////////////////////////////////////////////////
+
+void GBALink_setTransport(GBALinkTransport transport) {
+    gl.transport_requested = transport;
+}
+
+GBALinkTransport GBALink_getTransport(void) {
+    return gl.transport_requested;
+}
+
+// Create the peer's UDP socket on an ephemeral port (handshake)
+// Returns the port, 0 on failure
+static uint16_t rudp_open(GBALinkPeer* peer) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return 0;
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &addr_len) < 0) {
+        LOG_warn("GBALink: UDP socket setup failed errno=%d\n", errno);
+        close(fd);
+        return 0;
     }
 
-    // Update last packet received timestamp - use cached time if available
-    const struct timeval* now = get_frame_time();
-    gl.last_packet_received = *now;
+    peer->udp_fd = fd;
+    return ntohs(addr.sin_port);
+}
+
+// Only accept datagrams from the peer's UDP port, and send there
+static bool rudp_connect(GBALinkPeer* peer, uint16_t port) {
+    if (peer->udp_fd < 0 || port == 0) return false;
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    return inet_pton(AF_INET, peer->ip, &addr.sin_addr) > 0 &&
+           connect(peer->udp_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+}
 
+// Switch the peer's stream to the UDP socket (mutex held, or handshake)
+static bool rudp_activate(GBALinkPeer* peer) {
+    RudpState* r = calloc(1, sizeof(*r));
+    if (!r) {
+        LOG_error("GBALink: out of memory for reliable UDP state\n");
+        return false;
+    }
+    r->rto_ms = RUDP_INITIAL_RTO_MS;
+    peer->rudp = r;
+    LOG_info("GBALink: peer %u using reliable UDP\n", peer->client_id);
     return true;
 }
 
+// Close the UDP socket, wherever the peer's TCP socket is closed
+static void rudp_close(GBALinkPeer* peer) {
+    RudpState* r = peer->rudp;
+    if (r) {
+        LOG_info("GBALink: UDP link to peer %u: %u segments, %u retransmits (%u fast), srtt %ums\n",
+                 peer->client_id, r->sent, r->retransmits + r->fast_retransmits, r->fast_retransmits,
+                 r->srtt_ms);
+        free(r);
+        peer->rudp = NULL;
+    }
+    if (peer->udp_fd >= 0) {
+        close(peer->udp_fd);
+        peer->udp_fd = -1;
+    }
+}
+
+// Receive slot holding segment seq, if it arrived
+static RudpSegment* rudp_rx_slot(RudpState* r, uint32_t seq) {
+    RudpSegment* seg = &r->rx[seq % RUDP_WINDOW];
+    return (seg->len && seg->seq == seq) ? seg : NULL;
+}
+
+// Send one datagram: a segment, or just the ack fields when seg is NULL
+static void rudp_send_datagram(GBALinkPeer* peer, const RudpSegment* seg) {
+    RudpState* r = peer->rudp;
+
+    // Cumulative ack: first segment not received; SACK: the ones after it
+    uint32_t ack = r->rx_next;
+    while (ack - r->rx_next < RUDP_WINDOW && rudp_rx_slot(r, ack)) ack++;
+    uint32_t sack = 0;
+    for (uint32_t n = 0; n < 32 && ack + 1 + n - r->rx_next < RUDP_WINDOW; n++) {
+        if (rudp_rx_slot(r, ack + 1 + n)) sack |= 1u << n;
+    }
+
+    uint8_t dgram[sizeof(RudpHeader) + RUDP_SEGMENT_PAYLOAD];
+    RudpHeader hdr = {
+        .flags = seg ? RUDP_FLAG_DATA : 0,
+        .seq = htonl(seg ? seg->seq : 0),
+        .ack = htonl(ack),
+        .sack = htonl(sack)
+    };
+    size_t len = sizeof(hdr);
+    memcpy(dgram, &hdr, sizeof(hdr));
+    if (seg) {
+        memcpy(dgram + len, seg->data, seg->len);
+        len += seg->len;
+    }
+
+    // A full socket buffer or ICMP error is just loss: retransmission covers it
+    send(peer->udp_fd, dgram, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    r->ack_pending = false;
+}
+
+// Cut queued stream bytes into segments while the window has room (mutex held)
+static void rudp_pump(GBALinkPeer* peer) {
+    RudpState* r = peer->rudp;
+    bool was_idle = r->tx_next == r->tx_una;
+    uint32_t now_ms = monotonic_ms();
+
+    while (peer->tx_queue_len > 0 && r->tx_next - r->tx_una < RUDP_WINDOW) {
+        RudpSegment* seg = &r->tx[r->tx_next % RUDP_WINDOW];
+        seg->len = (uint16_t)(peer->tx_queue_len < RUDP_SEGMENT_PAYLOAD ? peer->tx_queue_len : RUDP_SEGMENT_PAYLOAD);
+        memcpy(seg->data, peer->tx_queue + peer->tx_queue_head, seg->len);
+        peer->tx_queue_head += seg->len;
+        peer->tx_queue_len -= seg->len;
+        seg->seq = r->tx_next++;
+        seg->sent_ms = now_ms;
+        seg->retries = 0;
+        seg->sacked = false;
+        seg->fast_retx = false;
+        rudp_send_datagram(peer, seg);
+        r->sent++;
+    }
+    if (peer->tx_queue_len == 0) {
+        peer->tx_queue_head = 0;
+    }
+
+    // First segment in flight: the I/O thread may be sleeping without a timeout
+    if (was_idle && r->tx_next != r->tx_una && gl.io_wake_fd >= 0) {
+        uint64_t value = 1;
+        write(gl.io_wake_fd, &value, sizeof(value));
+    }
+}
+
+// Queue stream bytes and send what the window allows (mutex held)
+static bool rudp_write(GBALinkPeer* peer, const void* buf, size_t len) {
+    if (!tx_queue_append(peer, buf, len)) {
+        return false;
+    }
+    rudp_pump(peer);
+    return true;
+}
+
+static void rudp_rtt_sample(RudpState* r, uint32_t rtt_ms) {
+    if (!r->has_rtt) {
+        r->srtt_ms = rtt_ms;
+        r->rttvar_ms = rtt_ms / 2;
+        r->has_rtt = true;
+    } else {
+        uint32_t err = rtt_ms > r->srtt_ms ? rtt_ms - r->srtt_ms : r->srtt_ms - rtt_ms;
+        r->rttvar_ms = (r->rttvar_ms * 3 + err) / 4;
+        r->srtt_ms = (r->srtt_ms * 7 + rtt_ms) / 8;
+    }
+    r->rto_ms = r->srtt_ms + 4 * r->rttvar_ms;
+    if (r->rto_ms < RUDP_MIN_RTO_MS) r->rto_ms = RUDP_MIN_RTO_MS;
+    if (r->rto_ms > RUDP_MAX_RTO_MS) r->rto_ms = RUDP_MAX_RTO_MS;
+}
+
+// Apply the ack fields of a received datagram (mutex held)
+static void rudp_handle_ack(GBALinkPeer* peer, uint32_t ack, uint32_t sack, uint32_t now_ms) {
+    RudpState* r = peer->rudp;
+    if (ack - r->tx_una > r->tx_next - r->tx_una) return;  // Stale or bogus
+
+    // RTT samples only from segments sent once (Karn)
+    while (r->tx_una != ack) {
+        RudpSegment* seg = &r->tx[r->tx_una % RUDP_WINDOW];
+        if (!seg->retries && !seg->sacked) rudp_rtt_sample(r, now_ms - seg->sent_ms);
+        seg->len = 0;
+        r->tx_una++;
+    }
+    for (uint32_t n = 0; n < 32; n++) {
+        uint32_t seq = ack + 1 + n;
+        if (seq - r->tx_una >= r->tx_next - r->tx_una) break;
+        RudpSegment* seg = &r->tx[seq % RUDP_WINDOW];
+        if (!(sack & (1u << n)) || seg->sacked) continue;
+        if (!seg->retries) rudp_rtt_sample(r, now_ms - seg->sent_ms);
+        seg->sacked = true;
+    }
+
+    // Fast retransmit: a gap with enough later segments SACKed was lost
+    uint32_t later = 0;
+    for (uint32_t seq = r->tx_next; seq != r->tx_una;) {
+        seq--;
+        RudpSegment* seg = &r->tx[seq % RUDP_WINDOW];
+        if (seg->sacked) {
+            later++;
+        } else if (later >= RUDP_FAST_RETX_SACKS && !seg->fast_retx) {
+            seg->fast_retx = true;
+            seg->retries++;
+            seg->sent_ms = now_ms;
+            rudp_send_datagram(peer, seg);
+            r->fast_retransmits++;
+        }
+    }
+
+    // Acks free window space for whatever is still queued
+    rudp_pump(peer);
+}
+
+// Read every pending datagram off the peer's UDP socket (mutex held)
+static void rudp_receive(GBALinkPeer* peer, const struct timeval* now) {
+    RudpState* r = peer->rudp;
+    uint8_t dgram[sizeof(RudpHeader) + RUDP_SEGMENT_PAYLOAD];
+    uint32_t now_ms = monotonic_ms();
+
+    while (true) {
+        ssize_t len = recv(peer->udp_fd, dgram, sizeof(dgram), MSG_DONTWAIT);
+        if (len < 0 && errno == EINTR) continue;
+        if (len < 0) break;  // Drained, or an ICMP error - the TCP side reports real closes
+        if ((size_t)len < sizeof(RudpHeader)) continue;
+
+        RudpHeader hdr;
+        memcpy(&hdr, dgram, sizeof(hdr));
+        peer->last_packet_received = *now;
+        rudp_handle_ack(peer, ntohl(hdr.ack), ntohl(hdr.sack), now_ms);
+        if (!(hdr.flags & RUDP_FLAG_DATA) || (size_t)len == sizeof(hdr)) continue;
+
+        // Ack duplicates too, our previous ack may have been lost
+        r->ack_pending = true;
+        uint32_t seq = ntohl(hdr.seq);
+        if (seq - r->rx_next >= RUDP_WINDOW || rudp_rx_slot(r, seq)) continue;
+
+        RudpSegment* seg = &r->rx[seq % RUDP_WINDOW];
+        seg->len = (uint16_t)(len - sizeof(hdr));
+        seg->offset = 0;
+        seg->seq = seq;
+        memcpy(seg->data, dgram + sizeof(hdr), seg->len);
+    }
+
+    rudp_deliver(peer);
+}
+
+// Move in-order segments into stream_buf as space allows (mutex held)
+// Returns true if any bytes moved
+static bool rudp_deliver(GBALinkPeer* peer) {
+    RudpState* r = peer->rudp;
+    bool moved = false;
+
+    RudpSegment* seg;
+    while ((seg = rudp_rx_slot(r, r->rx_next)) != NULL) {
+        size_t remaining = seg->len - seg->offset;
+        compact_stream_buffer_if_needed(peer, remaining);
+        size_t space = STREAM_BUF_SIZE - peer->stream_buf_write_idx;
+        size_t n = remaining < space ? remaining : space;
+        if (n == 0) break;  // Core is behind, the segment waits for stream_parse
+
+        memcpy(peer->stream_buf + peer->stream_buf_write_idx, seg->data + seg->offset, n);
+        peer->stream_buf_write_idx += n;
+        seg->offset += n;
+        moved = true;
+        if (seg->offset < seg->len) break;
+
+        seg->len = 0;
+        r->rx_next++;
+    }
+    return moved;
+}
+
+// Retransmit segments whose timer ran out (I/O thread, mutex held)
+// Returns ms until the next retransmit deadline, -1 if nothing is in flight
+static int rudp_service_timers(uint32_t now_ms) {
+    int timeout_ms = -1;
+
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        RudpState* r = peer->rudp;
+        if (!peer->ready || !r) continue;
+
+        for (uint32_t seq = r->tx_una; seq != r->tx_next; seq++) {
+            RudpSegment* seg = &r->tx[seq % RUDP_WINDOW];
+            if (seg->sacked) continue;
+
+            // Exponential backoff per segment
+            uint32_t rto = r->rto_ms << (seg->retries < 5 ? seg->retries : 5);
+            if (rto > RUDP_MAX_RTO_MS) rto = RUDP_MAX_RTO_MS;
+            int32_t left = (int32_t)(seg->sent_ms + rto - now_ms);
+            if (left <= 0) {
+                seg->retries++;
+                seg->sent_ms = now_ms;
+                rudp_send_datagram(peer, seg);
+                r->retransmits++;
+                left = (int32_t)rto;
+            }
+            if (timeout_ms < 0 || left < timeout_ms) timeout_ms = left;
+        }
+    }
+    return timeout_ms;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Packet Trace
+//////////////////////////////////////////////////////////////////////////////
+
+bool GBALink_startTrace(const char* path) {
+    GBALink_stopTrace();
+
+    gl.trace_file = fopen(path, "wb");
+    if (!gl.trace_file) {
+        LOG_error("GBALink: failed to open trace %s errno=%d\n", path, errno);
+        return false;
+    }
+
+    GBALinkTraceHeader hdr = {0};
+    hdr.magic = GBALINK_TRACE_MAGIC;
+    hdr.version = GBALINK_TRACE_VERSION;
+    hdr.local_client_id = gl.local_client_id;
+    hdr.game_crc = gl.game_crc;
+    strncpy(hdr.link_mode, gl.link_mode, sizeof(hdr.link_mode) - 1);
+    fwrite(&hdr, sizeof(hdr), 1, gl.trace_file);
+
+    gl.trace_start_ms = monotonic_ms();
+    LOG_info("GBALink: tracing packets to %s\n", path);
+    return true;
+}
+
+void GBALink_stopTrace(void) {
+    if (!gl.trace_file) return;
+    fclose(gl.trace_file);
+    gl.trace_file = NULL;
+    LOG_info("GBALink: trace closed after %u frames\n", gl.frame);
+}
+
+static void trace_packet(uint8_t dir, int flags, uint16_t client_id, uint32_t time_ms,
+                         const void* buf, size_t len) {
+    if (!gl.trace_file) return;
+
+    GBALinkTraceRecord rec = {
+        .frame = gl.frame,
+        .time_ms = time_ms - gl.trace_start_ms,
+        .client_id = client_id,
+        .dir = dir,
+        .flags = (uint8_t)flags,
+        .size = (uint16_t)len
+    };
+    fwrite(&rec, sizeof(rec), 1, gl.trace_file);
+    fwrite(buf, 1, len, gl.trace_file);
+}
+
+// Start a capture for this session if the trace flag file exists
+static void trace_start_if_requested(void) {
+    if (!exists(GBALINK_TRACE_FLAG_PATH)) return;
+
+    char path[256];
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_now);
+    snprintf(path, sizeof(path), SHARED_USERDATA_PATH "/gbalink-%s-%u.trace",
+             stamp, gl.local_client_id);
+    GBALink_startTrace(path);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Core Netpacket Bridging
 //////////////////////////////////////////////////////////////////////////////
 
-// Maximum packets to deliver per frame - matches minarch's constant
+// Maximum packets to deliver per call - matches minarch's constant
 #define GBALINK_MAX_PACKETS_PER_FRAME 64
 
 // Set core netpacket callbacks (called by minarch when core registers)
@@ -1586,40 +3074,143 @@ void GBALink_setCoreCallbacks(const struct retro_netpacket_callback* callbacks)
     }
 }
 
+// True while the loaded core has registered a netpacket interface
+bool GBALink_hasCoreNetpacket(void) {
+    return gl.has_core_callbacks;
+}
+
+// Set the core's queue probe (called by minarch next to setCoreCallbacks)
+void GBALink_setCoreQueueProbe(GBALinkCoreQueueFreeFn queue_free, GBALinkCoreQueueStatsFn queue_stats) {
+    gl.core_queue_free = queue_free;
+    gl.core_queue_stats = queue_stats;
+    if (queue_free) {
+        LOG_info("GBALink: Core exposes its packet queue, delivery follows its free space\n");
+    }
+}
+
+// Set the core's reply probe (called by minarch next to setCoreQueueProbe)
+void GBALink_setCoreReplyProbe(GBALinkCoreWaitingFn waiting) {
+    gl.core_waiting = waiting;
+    if (waiting) {
+        LOG_info("GBALink: Core waits on replies, frames are held until they arrive\n");
+    }
+}
+
 // Send function provided to core - bridges to gbalink network
 static void gbalink_netpacket_send(int flags, const void* buf, size_t len, uint16_t client_id) {
     if (gl.netpacket_active) {
+        if (buf && len > 0) {
+            trace_packet(GBALINK_TRACE_TX, flags, client_id, monotonic_ms(), buf, len);
+        }
         GBALink_sendPacket(flags, buf, len, client_id);
     }
 }
 
-// Poll receive function provided to core
+// Hand queued packets to the core straight out of the ring (no lock, no copy)
+// Main thread only. The core may send or poll again from inside receive(); the
+// guard keeps nested polls from delivering while its RFU state is mid-update.
+static void deliver_packets(void) {
+    if (gl.delivering || !gl.core_callbacks.receive) return;
+    gl.delivering = true;
+
+    const uint8_t* pkt_buf;
+    size_t pkt_len;
+    uint16_t source_id;
+    uint32_t arrival_ms;
+    uint32_t frame;
+    uint32_t now_ms = monotonic_ms();
+
+    int packets_delivered = 0;
+    while (gl.netpacket_active && packets_delivered < GBALINK_MAX_PACKETS_PER_FRAME &&
+           rx_ring_peek(&pkt_buf, &pkt_len, &source_id, &arrival_ms, &frame)) {
+        // Frame lock: hold the packet until exactly sender_frame + delay
+        if (gl.frame_lock && frame + gl.frame_delay > gl.frame) break;
+        // Core queue full: leave the packet in the ring until the game reads
+        if (gl.core_queue_free && gl.core_queue_free() == 0) {
+            gl.core_stalls++;
+            break;
+        }
+
+        uint32_t delay_ms = now_ms - arrival_ms;
+        if ((int32_t)delay_ms > 0 && delay_ms > gl.rx_max_delay_ms) {
+            gl.rx_max_delay_ms = delay_ms;
+        }
+        trace_packet(GBALINK_TRACE_RX, 0, source_id, arrival_ms, pkt_buf, pkt_len);
+        gl.core_callbacks.receive(pkt_buf, pkt_len, source_id);
+        if (!gl.netpacket_active) break;  // Session torn down from inside receive(), ring was reset
+        rx_ring_consume();
+        packets_delivered++;
+    }
+
+    gl.delivering = false;
+}
+
+// Poll receive function provided to core - the core calls this when it wants
+// data now (e.g. gpSP waiting on an RFU response), so deliver mid-frame rather
+// than making the packet wait for the next GBALink_pollAndDeliverPackets
 static void gbalink_netpacket_poll_receive(void) {
     if (!gl.netpacket_active) return;
-    GBALink_pollReceive();
+    // The core is waiting on a reply, so whatever it sent so far must go out now
+    flush_batches(false);
+    // Frame lock delivers only at frame start, where the schedule is fixed
+    if (!gl.frame_lock) {
+        deliver_packets();
+    }
 }
 
-// Start netpacket session - called when gbalink connects
+// Start netpacket session on the first connection, then announce every peer
+// that finished its handshake since (host: one call per joining client)
 void GBALink_notifyConnected(int is_host) {
-    if (!gl.has_core_callbacks || gl.netpacket_active) {
+    if (!gl.has_core_callbacks) {
         return;
     }
 
     // Call core's start callback with our bridge functions
-    if (gl.core_callbacks.start) {
-        uint16_t client_id = is_host ? 0 : 1;  // 0 = host, 1 = client
+    if (!gl.netpacket_active) {
+        if (!gl.core_callbacks.start) return;
+
+        uint16_t client_id = is_host ? 0 : gl.local_client_id;  // Host is always 0
         gl.local_client_id = client_id;
-        gl.remote_client_id = is_host ? 1 : 0;
+        rx_ring_reset();
+        gl.frame = 0;
+        gl.stall_frames = 0;
+        gl.rtt_ms = 0;
+        gl.last_adapt_ms = monotonic_ms();
+        for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+            gl.peers[i].remote_frame = 0;
+            gl.peers[i].echo_ms = 0;
+        }
+        trace_start_if_requested();
         gl.core_callbacks.start(client_id, gbalink_netpacket_send, gbalink_netpacket_poll_receive);
         gl.netpacket_active = true;
 
+        // Receiving runs on the I/O thread from here on
+        if (!io_thread_start()) {
+            LOG_error("GBALink: failed to start receive thread\n");
+        }
+
         // Register for timeout detection
         GBALink_onNetpacketStart(client_id, NULL, NULL);
     }
 
-    // Notify core that remote player connected
+    // Hand newly ready peers to the I/O thread
+    uint16_t joined[GBALINK_MAX_CLIENTS];
+    int num_joined = 0;
+    pthread_mutex_lock(&gl.mutex);
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (!peer->ready || peer->announced) continue;
+        io_add_peer(peer);
+        peer->announced = true;
+        joined[num_joined++] = peer->client_id;
+    }
+    pthread_mutex_unlock(&gl.mutex);
+
+    // Notify core that remote players connected
     if (gl.core_callbacks.connected) {
-        gl.core_callbacks.connected(gl.remote_client_id);
+        for (int i = 0; i < num_joined; i++) {
+            gl.core_callbacks.connected(joined[i]);
+        }
     }
 }
 
@@ -1627,9 +3218,24 @@ void GBALink_notifyConnected(int is_host) {
 void GBALink_notifyDisconnected(void) {
     if (!gl.netpacket_active) return;
 
-    // Notify core that remote player disconnected
+    // Notify core that remaining players disconnected
+    uint16_t lost[GBALINK_MAX_CLIENTS];
+    int num_lost = 0;
+    pthread_mutex_lock(&gl.mutex);
+    for (int i = 0; i < GBALINK_MAX_CLIENTS; i++) {
+        GBALinkPeer* peer = &gl.peers[i];
+        if (peer->announced) {
+            peer->announced = false;
+            peer->pending_disconnect = false;
+            lost[num_lost++] = peer->client_id;
+        }
+    }
+    pthread_mutex_unlock(&gl.mutex);
+
     if (gl.core_callbacks.disconnected) {
-        gl.core_callbacks.disconnected(gl.remote_client_id);
+        for (int i = 0; i < num_lost; i++) {
+            gl.core_callbacks.disconnected(lost[i]);
+        }
     }
 
     // Call core's stop callback
@@ -1641,6 +3247,10 @@ void GBALink_notifyDisconnected(void) {
     GBALink_onNetpacketStop();
 
     gl.netpacket_active = false;
+    gl.delivering = false;
+    gl.pending_delay = 0;  // A schedule change never outlives its session
+    io_thread_stop();
+    GBALink_stopTrace();
 }
 
 // Check if netpacket bridging is active
@@ -1649,24 +3259,31 @@ bool GBALink_isNetpacketActive(void) {
 }
 
 // Poll network and deliver packets to core (call each frame before core.run())
-void GBALink_pollAndDeliverPackets(void) {
-    if (!gl.netpacket_active) return;
+bool GBALink_pollAndDeliverPackets(void) {
+    if (!gl.netpacket_active) return true;
 
-    // Poll for incoming TCP data
+    // Heartbeat (receiving itself happens on the I/O thread)
     GBALink_pollReceive();
 
-    // Deliver pending packets to core
-    // Use atomic pop to reduce mutex cycles (single lock instead of get+consume)
-    void* pkt_buf;
-    size_t pkt_len;
+    if (gl.frame_lock) {
+        if (!frame_lock_advance()) return false;
+    } else {
+        gl.frame++;
+    }
+    deliver_packets();
 
-    int packets_delivered = 0;
-    while (packets_delivered < GBALINK_MAX_PACKETS_PER_FRAME &&
-           GBALink_popPendingPacket(&pkt_buf, &pkt_len, NULL)) {
-        // In direct 2-player TCP, any received packet is from the remote peer
-        if (gl.core_callbacks.receive) {
-            gl.core_callbacks.receive(pkt_buf, pkt_len, gl.remote_client_id);
-        }
-        packets_delivered++;
+    // Once per frame, as RetroArch does: cores flush what they queued while running
+    if (gl.netpacket_active && gl.core_callbacks.poll) {
+        gl.core_callbacks.poll();
     }
+
+    // The core clocked a transfer and needs the peer's reply first. The frame
+    // still ends here (no core.run, so no GBALink_flushSend) so a frame-locked
+    // peer keeps running and can answer.
+    if (gl.netpacket_active && gl.core_waiting && gl.core_waiting()) {
+        gl.reply_stalls++;
+        flush_batches(true);
+        return false;
+    }
+    return true;
 }
@@ -20,16 +20,24 @@
 #define GBALINK_DEFAULT_PORT 55437
 #define GBALINK_DISCOVERY_PORT 55438
 #define GBALINK_MAGIC "GBLK"
-#define GBALINK_PROTOCOL_VERSION 1
+#define GBALINK_PROTOCOL_VERSION 4
 #define GBALINK_MAX_GAME_NAME 64
 #define GBALINK_MAX_HOSTS 8
 
+// Clients per host - the wireless adapter links up to four GBAs (host + 3)
+#define GBALINK_MAX_CLIENTS 3
+
 typedef enum {
     GBALINK_OFF = 0,
     GBALINK_HOST,
     GBALINK_CLIENT
 } GBALinkMode;
 
+typedef enum {
+    GBALINK_TRANSPORT_TCP = 0,  // One TCP connection per peer
+    GBALINK_TRANSPORT_UDP       // Reliable UDP: SACK, fast retransmit, in-order delivery
+} GBALinkTransport;
+
 typedef enum {
     GBALINK_CONN_WIFI = 0,    // Use existing WiFi network
     GBALINK_CONN_HOTSPOT      // Create/connect to hotspot
@@ -37,9 +45,9 @@ typedef enum {
 
 typedef enum {
     GBALINK_STATE_IDLE = 0,
-    GBALINK_STATE_WAITING,      // Host waiting for client
+    GBALINK_STATE_WAITING,      // Host waiting for first client
     GBALINK_STATE_CONNECTING,   // Client connecting to host
-    GBALINK_STATE_CONNECTED,    // Connected and ready for SIO packets
+    GBALINK_STATE_CONNECTED,    // Connected and ready for SIO packets (host: 1+ clients)
     GBALINK_STATE_DISCONNECTED,
     GBALINK_STATE_ERROR
 } GBALinkState;
@@ -47,7 +55,7 @@ typedef enum {
 // Return codes for GBALink_connectToHost
 #define GBALINK_CONNECT_OK           0   // Connected successfully
 #define GBALINK_CONNECT_ERROR       -1   // Connection failed
-#define GBALINK_CONNECT_NEEDS_RELOAD 1   // Connected but link mode differs, needs game reload
+#define GBALINK_CONNECT_NEEDS_RELOAD 1   // Connected but link mode differs, reload then GBALink_finishPendingJoin
 
 typedef struct {
     char game_name[GBALINK_MAX_GAME_NAME];
@@ -55,6 +63,9 @@ typedef struct {
     uint16_t port;
     uint32_t game_crc;
     char link_mode[32];  // Host's link mode for compatibility check (e.g., "mul_poke", "rfu")
+    uint32_t rtt_ms;     // Median probe round trip (discovery round trip until probed), 0 if not measured
+    uint8_t loss_pct;    // Probes lost, valid once probed
+    bool probed;
 } GBALinkHostInfo;
 
 // Initialize/cleanup
@@ -71,12 +82,18 @@ bool GBALink_checkCoreSupport(const char* core_name);
 void GBALink_setLinkMode(const char* mode);
 const char* GBALink_getLinkMode(void);
 
+// Discovery broadcasts and query replies while hosting (on by default). GB Link
+// turns them off when it runs gambatte's link cable over this transport and
+// advertises the session on its own discovery port instead.
+void GBALink_setAdvertise(bool enabled);
+
 // Pending link mode after GBALINK_CONNECT_NEEDS_RELOAD
 // Client's current mode and host's mode that differs
 const char* GBALink_getPendingLinkMode(void);    // Returns host's mode (what to change to)
 const char* GBALink_getClientLinkMode(void);     // Returns client's current mode
 void GBALink_clearPendingReload(void);           // Clear pending reload state
 void GBALink_applyPendingLinkMode(void);         // Apply pending mode to config
+int GBALink_finishPendingJoin(void);             // After reload: start session on the open connection
 
 // Connection management
 // If hotspot_ip is NULL, uses WiFi mode. Otherwise, uses hotspot mode with given IP.
@@ -118,8 +135,10 @@ void GBALink_onNetpacketStop(void);
 void GBALink_onNetpacketPoll(void);
 
 // Called by frontend to provide send/poll functions to core
-// These wrap the network transport layer
+// These wrap the network transport layer. Receiving runs on a dedicated I/O
+// thread; pollReceive only services the heartbeat from the main thread.
 void GBALink_sendPacket(int flags, const void* buf, size_t len, uint16_t client_id);
+void GBALink_flushSend(void);    // Send batched SIO packets - call after core.run()
 void GBALink_pollReceive(void);
 
 // Update function (call periodically for connection handling)
@@ -127,13 +146,64 @@ void GBALink_update(void);
 
 // Set core netpacket callbacks (called by minarch when core registers RETRO_ENVIRONMENT_SET_NETPACKET_INTERFACE)
 void GBALink_setCoreCallbacks(const struct retro_netpacket_callback* callbacks);
+bool GBALink_hasCoreNetpacket(void);
+
+// Optional core packet queue probe (exported by gpSP's RFU patch). Delivery
+// pauses while queue_free() returns 0 so packets wait in the receive ring
+// instead of overflowing the core's queue. Either function may be NULL.
+typedef unsigned (*GBALinkCoreQueueFreeFn)(void);
+typedef void (*GBALinkCoreQueueStatsFn)(unsigned* depth, unsigned* high_water, unsigned* overflows);
+void GBALink_setCoreQueueProbe(GBALinkCoreQueueFreeFn queue_free, GBALinkCoreQueueStatsFn queue_stats);
+
+// Optional core reply probe (exported by gambatte's netpacket serial patch).
+// While waiting() returns true the core has clocked a transfer and needs the
+// peer's reply before it runs again, so the frame is held at its boundary.
+typedef bool (*GBALinkCoreWaitingFn)(void);
+void GBALink_setCoreReplyProbe(GBALinkCoreWaitingFn waiting);
 
 // Connection state change notifications (called internally by gbalink)
+// notifyConnected starts the session once and announces each newly joined client
 void GBALink_notifyConnected(int is_host);
 void GBALink_notifyDisconnected(void);
 
 // Netpacket bridging
 bool GBALink_isNetpacketActive(void);
-void GBALink_pollAndDeliverPackets(void);  // Call each frame before core.run()
+// Call each frame before core.run() (core polls also deliver mid-frame).
+// Returns false when frame-locked and waiting on the peer, or when the core is
+// waiting on a reply (see GBALink_setCoreReplyProbe) - skip core.run() then.
+bool GBALink_pollAndDeliverPackets(void);
+
+// Frame-locked delivery: SIO packets reach the peer's core exactly N frames
+// after they were sent, N adapted to RTT. Host setting, applied on the next
+// startHost; clients follow the host. Limits the session to two players.
+void GBALink_setFrameLock(bool enabled);
+bool GBALink_getFrameLock(void);
+
+// Packet transport. Reliable UDP avoids a lost TCP segment stalling every later
+// packet for a retransmit timeout on lossy WiFi. Host setting, applied on the
+// next startHost; clients follow the host (TCP if the client can't do UDP).
+void GBALink_setTransport(GBALinkTransport transport);
+GBALinkTransport GBALink_getTransport(void);
+
+// Receive queue statistics (ring usage in bytes)
+typedef struct {
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t high_water;    // Peak usage since connect
+    uint32_t backpressure;  // Polls that left data in the socket because the ring was full
+    uint32_t dropped;       // Packets lost (should always be 0)
+    uint32_t max_delay_ms;  // Longest arrival-to-delivery time
+    uint32_t frame_delay;   // Frame lock delay in frames (0 = off)
+    uint32_t stall_frames;  // Frames skipped waiting on the peer (frame lock)
+    uint32_t reply_stalls;  // Frames held because the core was waiting on a reply
+    uint32_t core_stalls;   // Deliveries held back because the core's queue was full
+} GBALinkRxStats;
+
+void GBALink_getRxStats(GBALinkRxStats* stats);
+
+// Packet trace capture (see gbalink_trace.h). Sessions are traced automatically
+// while SHARED_USERDATA_PATH/.gbalink_trace exists; the trace closes on disconnect.
+bool GBALink_startTrace(const char* path);
+void GBALink_stopTrace(void);
 
 #endif /* GBALINK_H */
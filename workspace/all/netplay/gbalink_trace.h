@@ -0,0 +1,43 @@
+/*
+ * NextUI GBA Link Packet Trace Format
+ * Binary capture of the SIO packets exchanged with the core's netpacket
+ * interface, written by gbalink.c and read back by the gbalink_replay tool
+ *
+ * Layout: one GBALinkTraceHeader, then GBALinkTraceRecord + payload repeated
+ * until EOF. Fields are little-endian (all supported devices and the desktop
+ * build are little-endian, so they are written as-is).
+ */
+
+#ifndef GBALINK_TRACE_H
+#define GBALINK_TRACE_H
+
+#include <stdint.h>
+
+#define GBALINK_TRACE_MAGIC   0x52544C47  // "GLTR"
+#define GBALINK_TRACE_VERSION 1
+
+// Packet direction, relative to the capturing device's core
+#define GBALINK_TRACE_TX 0  // Core sent it (client_id = destination)
+#define GBALINK_TRACE_RX 1  // Delivered to the core (client_id = source)
+
+// Highest netpacket client ID in a session (host 0 + GBALINK_MAX_CLIENTS)
+#define GBALINK_TRACE_MAX_CLIENT_ID 3
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t local_client_id;  // Capturing core's netpacket client ID
+    uint32_t game_crc;
+    char link_mode[32];        // gpsp_serial value in use during capture
+} GBALinkTraceHeader;
+
+typedef struct __attribute__((packed)) {
+    uint32_t frame;      // Emulated frames since the session started
+    uint32_t time_ms;    // Monotonic ms since the session started (RX: network arrival)
+    uint16_t client_id;
+    uint8_t dir;         // GBALINK_TRACE_TX or GBALINK_TRACE_RX
+    uint8_t flags;       // TX: netpacket send flags (low 8 bits), RX: 0
+    uint16_t size;       // Payload bytes that follow
+} GBALinkTraceRecord;
+
+#endif /* GBALINK_TRACE_H */
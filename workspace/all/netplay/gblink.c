@@ -7,6 +7,11 @@
  * TCP directly, gambatte manages its own TCP connection - we just configure
  * the core options and provide UDP discovery.
  *
+ * When gambatte registers a netpacket interface (cores/patches/gambatte),
+ * the cable runs over GBA Link's transport instead: gbalink.c owns the
+ * connection and the core only sees serial bytes. Discovery and the UI stay
+ * here either way.
+ *
  * Supported features:
  * - Pokemon trading (Red/Blue/Yellow/Gold/Silver/Crystal)
  * - Tetris 2-player
@@ -16,6 +21,7 @@
 #define _GNU_SOURCE  // For strcasestr
 
 #include "gblink.h"
+#include "gbalink.h"
 #include "netplay_helper.h"
 #include "network_common.h"
 #include "defines.h"
@@ -35,15 +41,19 @@
 #include <sys/select.h>
 #include <sys/time.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 
 // Protocol constants for UDP discovery
 #define GL_DISCOVERY_MAGIC   0x47424C43  // "GBLC"
+#define GL_DISCOVERY_QUERY   0x47424C51  // "GBLQ" - GB Link Discovery Query
 #define GL_DISCOVERY_RESP    0x47424C52  // "GBLR" - GB Link Discovery Response
 
-// Discovery broadcast interval
+// Discovery broadcast interval (backs off once hosting for a while)
 #define DISCOVERY_BROADCAST_INTERVAL_US 500000  // 500ms
 
+_Static_assert(sizeof(GBLinkHostInfo) == sizeof(NET_HostInfo), "GBLinkHostInfo must match NET_HostInfo");
+
 // Main GB Link state
 static struct {
     GBLinkMode mode;
@@ -51,6 +61,7 @@ static struct {
 
     // UDP sockets (separate to avoid race conditions)
     int udp_fd;   // UDP socket for discovery broadcasts
+    int query_fd;       // Host: discovery queries from clients
     int discovery_fd;   // For client discovery
 
     // Connection info
@@ -61,20 +72,21 @@ static struct {
     // Hotspot mode
     bool using_hotspot;
 
+    // Session runs over GBA Link's transport (core has a netpacket interface)
+    bool netpacket;
+
     // Game info
     char game_name[GBLINK_MAX_GAME_NAME];
     uint32_t game_crc;
 
     // Discovery
-    GBLinkHostInfo discovered_hosts[GBLINK_MAX_HOSTS];
-    int num_hosts;
+    NET_DiscoveryCache discovery;
     bool discovery_active;
 
-    // Host broadcast thread
-    pthread_t broadcast_thread;
-    volatile bool broadcast_thread_active;  // Track if thread was created (portable)
+    // Host discovery runs on the shared event loop
+    int broadcast_timer_fd;  // -1 when not advertising
+    NET_BroadcastTimer broadcast_timer;
     pthread_mutex_t mutex;
-    volatile bool running;
 
     // Status message
     char status_msg[128];
@@ -90,7 +102,9 @@ static struct {
 } gl = {0};
 
 // Forward declarations
-static void* broadcast_thread_func(void* arg);
+static void on_broadcast_timer(int fd, uint32_t events, void* ctx);
+static void on_discovery_query(int fd, uint32_t events, void* ctx);
+static void gblink_start_advertising(void);
 static void GBLink_disconnect(void);
 
 //////////////////////////////////////////////////////////////////////////////
@@ -106,7 +120,9 @@ void GBLink_init(void) {
     gl.mode = GBLINK_OFF;
     gl.state = GBLINK_STATE_IDLE;
     gl.udp_fd = -1;
+    gl.query_fd = -1;
     gl.discovery_fd = -1;
+    gl.broadcast_timer_fd = -1;
     gl.port = GBLINK_DEFAULT_PORT;
 
     // Use recursive mutex to prevent deadlock if functions re-acquire lock
@@ -145,6 +161,9 @@ void GBLink_quit(void) {
         gblink_connected_to_hotspot = 0;
     }
 
+    NET_closeSockDiag();
+    NET_quitEventLoop();
+
     gl.initialized = false;  // Mark as quit BEFORE destroying mutex
     pthread_mutex_destroy(&gl.mutex);
 }
@@ -251,6 +270,32 @@ void GBLink_setCoreOptionsDisconnect(void) {
     minarch_endOptionsBatch();
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Netpacket Transport
+//////////////////////////////////////////////////////////////////////////////
+
+// gambatte with the netpacket serial patch registers the interface on load
+static bool gblink_netpacket_available(void) {
+    return gl.has_gambatte_support && GBALink_hasCoreNetpacket();
+}
+
+// Host the cable on GBA Link's listener, always frame locked: after each byte
+// it clocks the core waits for the peer's reply, and GBALink holds the frame
+// at its boundary until the reply is delivered, so both Game Boys see every
+// transfer on the same frames. Our own broadcast advertises the session.
+static int gblink_netpacket_startHost(void) {
+    GBALink_init();
+    bool frame_lock = GBALink_getFrameLock();
+    GBALink_setFrameLock(true);
+    GBALink_setAdvertise(false);
+    int result = GBALink_startHost(gl.game_name, gl.game_crc, NULL, NULL);
+    GBALink_setFrameLock(frame_lock);
+    if (result != 0) {
+        GBALink_setAdvertise(true);
+    }
+    return result;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Host Mode
 //////////////////////////////////////////////////////////////////////////////
@@ -281,19 +326,43 @@ int GBLink_startHost(const char* game_name, uint32_t game_crc, const char* hotsp
         return -1;
     }
 
+    // Answer client queries so the join screen lists us without waiting for a broadcast
+    gl.query_fd = NET_createDiscoveryListenSocket(GBLINK_DISCOVERY_PORT);
+    if (gl.query_fd < 0) {
+        LOG_warn("GBLink: Could not create UDP query listener (non-fatal)\n");
+    }
+
     strncpy(gl.game_name, game_name, GBLINK_MAX_GAME_NAME - 1);
     gl.game_crc = game_crc;
 
-    // Start broadcast thread for discovery
-    gl.running = true;
-    pthread_create(&gl.broadcast_thread, NULL, broadcast_thread_func, NULL);
-    gl.broadcast_thread_active = true;
+    gl.netpacket = gblink_netpacket_available();
+    if (gl.netpacket) {
+        gl.port = GBALINK_DEFAULT_PORT;
+        if (gblink_netpacket_startHost() != 0) {
+            close(gl.udp_fd);
+            gl.udp_fd = -1;
+            if (gl.query_fd >= 0) {
+                close(gl.query_fd);
+                gl.query_fd = -1;
+            }
+            gl.using_hotspot = false;
+            gl.netpacket = false;
+            gl.port = GBLINK_DEFAULT_PORT;
+            snprintf(gl.status_msg, sizeof(gl.status_msg), "%s", GBALink_getStatusMessage());
+            return -1;
+        }
+    }
 
     gl.mode = GBLINK_HOST;
     gl.state = GBLINK_STATE_WAITING;
 
+    // Broadcast and answer discovery queries from the shared event loop
+    gblink_start_advertising();
+
     // Set gambatte core options to start TCP server
-    GBLink_setCoreOptionsForHost();
+    if (!gl.netpacket) {
+        GBLink_setCoreOptionsForHost();
+    }
 
     snprintf(gl.status_msg, sizeof(gl.status_msg), "Hosting on %s:%d", gl.local_ip, gl.port);
     return 0;
@@ -330,26 +399,42 @@ int GBLink_stopHostFast(void) {
     return GBLink_stopHostInternal(true);
 }
 
+// Register the broadcast timer and query socket with the event loop
+static void gblink_start_advertising(void) {
+    NET_watchSocket(gl.query_fd, on_discovery_query, NULL);
+    gl.broadcast_timer_fd = NET_createTimer(on_broadcast_timer, NULL);
+    NET_initBroadcastTimer(&gl.broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+    NET_setTimer(gl.broadcast_timer_fd, 1, DISCOVERY_BROADCAST_INTERVAL_US / 1000);
+}
+
 void GBLink_stopBroadcast(void) {
-    // Stop broadcast thread (but keep host session active)
-    gl.running = false;
-    if (gl.broadcast_thread_active) {
-        pthread_join(gl.broadcast_thread, NULL);
-        gl.broadcast_thread_active = false;
-    }
+    // Stop advertising (but keep host session active). Unwatching waits out a
+    // callback already running, so the sockets can be closed afterwards.
+    NET_unwatch(gl.broadcast_timer_fd);
+    gl.broadcast_timer_fd = -1;
+    NET_unwatch(gl.query_fd);
 
-    // Close UDP socket - no longer needed after connection
+    // Close UDP sockets - no longer needed after connection
     if (gl.udp_fd >= 0) {
         close(gl.udp_fd);
         gl.udp_fd = -1;
     }
+    if (gl.query_fd >= 0) {
+        close(gl.query_fd);
+        gl.query_fd = -1;
+    }
 }
 
 // Restart UDP broadcast when going back to waiting state
 // Called when client disconnects but host wants to accept new clients
 static void GBLink_restartBroadcast(void) {
-    if (gl.broadcast_thread_active) return;  // Already running
     if (gl.mode != GBLINK_HOST) return;  // Only for host
+    if (gl.broadcast_timer_fd >= 0) {
+        // Still set up, but the timer may have disarmed itself - back to the fast rate
+        NET_initBroadcastTimer(&gl.broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+        NET_setTimer(gl.broadcast_timer_fd, 1, DISCOVERY_BROADCAST_INTERVAL_US / 1000);
+        return;
+    }
 
     // Create UDP socket for discovery broadcasts
     gl.udp_fd = NET_createBroadcastSocket();
@@ -357,32 +442,46 @@ static void GBLink_restartBroadcast(void) {
         snprintf(gl.status_msg, sizeof(gl.status_msg), "Failed to restart broadcast");
         return;
     }
+    gl.query_fd = NET_createDiscoveryListenSocket(GBLINK_DISCOVERY_PORT);
 
-    // Start broadcast thread
-    gl.running = true;
-    pthread_create(&gl.broadcast_thread, NULL, broadcast_thread_func, NULL);
-    gl.broadcast_thread_active = true;
+    gblink_start_advertising();
 }
 
-// Broadcast thread - sends discovery packets for clients to find
-static void* broadcast_thread_func(void* arg) {
-    (void)arg;
+// Event loop: send discovery packets for clients to find. Disarms itself
+// while there is nothing to advertise.
+static void on_broadcast_timer(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
 
-    NET_BroadcastTimer broadcast_timer;
-    NET_initBroadcastTimer(&broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
-
-    while (gl.running && gl.udp_fd >= 0) {
-        if (gl.state == GBLINK_STATE_WAITING || gl.state == GBLINK_STATE_CONNECTED) {
-            if (NET_shouldBroadcast(&broadcast_timer)) {
-                NET_sendDiscoveryBroadcast(gl.udp_fd, GL_DISCOVERY_RESP, GBLINK_PROTOCOL_VERSION,
-                                           gl.game_crc, gl.port, GBLINK_DISCOVERY_PORT,
-                                           gl.game_name, NULL);  // GBLink doesn't use link_mode
-            }
-        }
-        usleep(100000);  // 100ms sleep
+    if (gl.udp_fd < 0 || (gl.state != GBLINK_STATE_WAITING && gl.state != GBLINK_STATE_CONNECTED)) {
+        NET_setTimer(fd, 0, 0);  // Nothing to advertise - GBLink_restartBroadcast re-arms
+        return;
     }
+    NET_sendDiscoveryBroadcast(gl.udp_fd, GL_DISCOVERY_RESP, GBLINK_PROTOCOL_VERSION,
+                               gl.game_crc, gl.port, GBLINK_DISCOVERY_PORT,
+                               gl.game_name, NULL);  // GBLink doesn't use link_mode
+
+    // Follow the backoff - re-arm only when the interval changed
+    int prev_us = gl.broadcast_timer.interval_us;
+    int next_us = NET_markBroadcast(&gl.broadcast_timer);
+    if (next_us != prev_us) {
+        NET_setTimer(fd, next_us / 1000, next_us / 1000);
+    }
+}
+
+// Event loop: discovery query from a client opening the join screen
+static void on_discovery_query(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
 
-    return NULL;
+    if (gl.state == GBLINK_STATE_WAITING || gl.state == GBLINK_STATE_CONNECTED) {
+        NET_answerDiscoveryQueries(fd, GL_DISCOVERY_QUERY, GL_DISCOVERY_RESP,
+                                   GBLINK_PROTOCOL_VERSION, gl.game_crc, gl.port,
+                                   gl.game_name, NULL);
+    } else {
+        char drain[sizeof(NET_DiscoveryPacket)];
+        while (recv(fd, drain, sizeof(drain), MSG_DONTWAIT) >= 0) {}
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -401,6 +500,23 @@ int GBLink_connectToHost(const char* ip, uint16_t port) {
     strncpy(gl.remote_ip, ip, sizeof(gl.remote_ip) - 1);
     gl.port = port;
 
+    gl.netpacket = gblink_netpacket_available();
+    if (gl.netpacket) {
+        // Netpacket hosts always listen on GBA Link's port (the hotspot join
+        // passes GB Link's default, which only the socket mode uses)
+        gl.port = GBALINK_DEFAULT_PORT;
+        if (GBALink_connectToHost(ip, gl.port) != GBALINK_CONNECT_OK) {
+            gl.netpacket = false;
+            gl.port = GBLINK_DEFAULT_PORT;
+            snprintf(gl.status_msg, sizeof(gl.status_msg), "%s", GBALink_getStatusMessage());
+            return -1;
+        }
+        gl.mode = GBLINK_CLIENT;
+        gl.state = GBLINK_STATE_CONNECTED;
+        snprintf(gl.status_msg, sizeof(gl.status_msg), "Connected to %s", ip);
+        return 0;
+    }
+
     // Set mode BEFORE setCoreOptionsForClient so log messages during
     // minarch_forceCoreOptionUpdate() are processed correctly
     gl.mode = GBLINK_CLIENT;
@@ -437,10 +553,22 @@ static void GBLink_disconnect(void) {
 
     pthread_mutex_lock(&gl.mutex);
 
-    // Reset core options and force gambatte to process them
-    GBLink_setCoreOptionsDisconnect();
-    if (!gl.quitting) {
-        minarch_forceCoreOptionUpdate();
+    if (gl.netpacket) {
+        // Hotspot cleanup is ours, not GBA Link's (it never saw the hotspot IP)
+        if (gl.mode == GBLINK_HOST) {
+            GBALink_stopHostFast();
+        } else {
+            GBALink_disconnect();
+        }
+        GBALink_setAdvertise(true);
+        gl.netpacket = false;
+        gl.port = GBLINK_DEFAULT_PORT;
+    } else {
+        // Reset core options and force gambatte to process them
+        GBLink_setCoreOptionsDisconnect();
+        if (!gl.quitting) {
+            minarch_forceCoreOptionUpdate();
+        }
     }
 
     // Reset state
@@ -483,7 +611,10 @@ int GBLink_startDiscovery(void) {
     gl.discovery_fd = NET_createDiscoveryListenSocket(GBLINK_DISCOVERY_PORT);
     if (gl.discovery_fd < 0) return -1;
 
-    gl.num_hosts = 0;
+    // Ask hosts right away instead of waiting for their next broadcast
+    NET_initDiscoveryCache(&gl.discovery, GL_DISCOVERY_QUERY, GL_DISCOVERY_RESP,
+                           GBLINK_PROTOCOL_VERSION, GBLINK_DISCOVERY_PORT);
+    NET_sendDiscoveryQuery(gl.discovery_fd, &gl.discovery);
     gl.discovery_active = true;
     return 0;
 }
@@ -502,15 +633,8 @@ void GBLink_stopDiscovery(void) {
 int GBLink_getDiscoveredHosts(GBLinkHostInfo* hosts, int max_hosts) {
     if (!gl.discovery_active || gl.discovery_fd < 0) return 0;
 
-    // Poll for discovery responses using shared function
     // GBLinkHostInfo and NET_HostInfo have identical layouts
-    NET_receiveDiscoveryResponses(gl.discovery_fd, GL_DISCOVERY_RESP,
-                                   (NET_HostInfo*)gl.discovered_hosts, &gl.num_hosts,
-                                   GBLINK_MAX_HOSTS);
-
-    int count = (gl.num_hosts < max_hosts) ? gl.num_hosts : max_hosts;
-    memcpy(hosts, gl.discovered_hosts, count * sizeof(GBLinkHostInfo));
-    return count;
+    return NET_updateDiscoveryCache(gl.discovery_fd, &gl.discovery, (NET_HostInfo*)hosts, max_hosts);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -591,10 +715,17 @@ void GBLink_notifyConnectionFromCore(bool connected) {
 // Connection State Polling
 //////////////////////////////////////////////////////////////////////////////
 
-// gambatte owns the GB Link TCP socket (we only set its mode/port via core
-// options), so we observe the connection by inspecting the kernel socket table
-// for an ESTABLISHED connection on `port` instead of scraping core log output.
-static bool gblink_tcp_established_on_port(uint16_t port) {
+// Connection poll interval. A sock_diag query is one small netlink round trip,
+// so this only needs to keep disconnect detection prompt, not the cost down.
+// The /proc fallback reads the whole socket table and stays at the old rate.
+#define GBLINK_POLL_INTERVAL_US       100000  // 100ms
+#define GBLINK_PROC_POLL_INTERVAL_US  500000  // 500ms
+
+// Set once sock_diag fails - the kernel won't grow inet_diag support later
+static bool gblink_no_sock_diag = false;
+
+// Fallback for kernels built without inet_diag: scan the whole socket table
+static bool gblink_proc_established_on_port(uint16_t port) {
     const char* files[] = { "/proc/net/tcp", "/proc/net/tcp6" };
     for (int f = 0; f < 2; f++) {
         FILE* fp = fopen(files[f], "r");
@@ -620,8 +751,22 @@ static bool gblink_tcp_established_on_port(uint16_t port) {
     return false;
 }
 
-// Poll gambatte's link socket and feed the state machine. Throttled (~0.5s) so
-// it is cheap to call every frame and from the menu/wait loops. Drives the same
+// gambatte owns the GB Link TCP socket (we only set its mode/port via core
+// options), so we observe the connection by asking the kernel for an
+// ESTABLISHED connection on `port` instead of scraping core log output.
+// Host: local port == our port; client: remote port == our port.
+static bool gblink_tcp_established_on_port(uint16_t port) {
+    if (!gblink_no_sock_diag) {
+        int count = NET_countTCPSockets(port, 1u << TCP_ESTABLISHED);
+        if (count >= 0) return count > 0;
+        LOG_warn("GBLink: sock_diag unavailable, polling /proc/net/tcp\n");
+        gblink_no_sock_diag = true;
+    }
+    return gblink_proc_established_on_port(port);
+}
+
+// Poll gambatte's link socket and feed the state machine. Throttled so it is
+// cheap to call every frame and from the menu/wait loops. Drives the same
 // GBLink_notifyConnectionFromCore() transitions the old log scraper did.
 void GBLink_pollConnectionState(void) {
     if (!gl.initialized || gl.mode == GBLINK_OFF) return;
@@ -630,8 +775,13 @@ void GBLink_pollConnectionState(void) {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     uint64_t now = (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
-    if (last_us && (now - last_us) < 500000ULL) return; // ~0.5s throttle
+    uint64_t interval = gblink_no_sock_diag ? GBLINK_PROC_POLL_INTERVAL_US : GBLINK_POLL_INTERVAL_US;
+    if (last_us && (now - last_us) < interval) return;
     last_us = now;
 
+    if (gl.netpacket) {
+        GBLink_notifyConnectionFromCore(GBALink_isConnected());
+        return;
+    }
     GBLink_notifyConnectionFromCore(gblink_tcp_established_on_port(gl.port));
 }
@@ -13,6 +13,10 @@
  * - Gambatte manages TCP connection internally (port 56400)
  * - We set gambatte_gb_link_mode and IP digit options
  * - Each device runs its own save file
+ *
+ * A gambatte built with the netpacket serial patch registers a netpacket
+ * interface instead; sessions then run over GBA Link's transport (port 55437,
+ * frame locked) and the core options above are left alone.
  */
 
 #ifndef GBLINK_H
@@ -48,6 +52,10 @@ typedef struct {
     char host_ip[16];
     uint16_t port;
     uint32_t game_crc;
+    char link_mode[32];  // Unused by GB Link - keeps the NET_HostInfo layout
+    uint32_t rtt_ms;     // Median probe round trip (discovery round trip until probed), 0 if not measured
+    uint8_t loss_pct;    // Probes lost, valid once probed
+    bool probed;
 } GBLinkHostInfo;
 
 // Initialize/cleanup
@@ -7,6 +7,10 @@
  * - Frame buffer: circular buffer storing input history
  * - Host = Player 1, Client = Player 2 (always)
  * - Both devices run identical emulation with identical inputs
+ *
+ * Stream mode (cores without bit-exact determinism):
+ * - Only the host runs the core, the client sends inputs and presents the
+ *   host's video/audio (tile-delta + LZ4, see netstream.c)
  */
 
 #define _GNU_SOURCE  // For strcasestr
@@ -14,6 +18,7 @@
 #include "netplay.h"
 #include "netplay_helper.h"  // For stopHotspotAndRestoreWiFiAsync, netplay_connected_to_hotspot
 #include "network_common.h"
+#include "netstream.h"
 #include "defines.h"  // Must come before api.h for BTN_ID_COUNT
 #include "api.h"
 #ifdef HAS_WIFIMG
@@ -30,19 +35,25 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#ifdef __linux__
+#include <linux/sockios.h>  // SIOCOUTQ
+#endif
 
 // Protocol constants (internal)
 #define NP_PROTOCOL_MAGIC   0x4E585550  // "NXUP" - NextUI Protocol
 #define NP_DISCOVERY_QUERY  0x4E584451  // "NXDQ" - NextUI Discovery Query
 #define NP_DISCOVERY_RESP   0x4E584452  // "NXDR" - NextUI Discovery Response
 
-// Optimization: Discovery broadcast interval (microseconds)
+// Optimization: Discovery broadcast interval (microseconds), backs off after a few seconds
 #define DISCOVERY_BROADCAST_INTERVAL_US 500000  // 500ms
 
+_Static_assert(sizeof(NetplayHostInfo) == sizeof(NET_HostInfo), "NetplayHostInfo must match NET_HostInfo");
+
 // Network commands
 enum {
     CMD_INPUT      = 0x01,  // Input data for a frame
@@ -57,8 +68,49 @@ enum {
     CMD_PAUSE      = 0x0A,  // Player paused (menu opened)
     CMD_RESUME     = 0x0B,  // Player resumed (menu closed)
     CMD_KEEPALIVE  = 0x0C,  // Keepalive during stall to prevent timeout
+    CMD_STATE_HASH = 0x0D,  // State chunk hashes (frame = first chunk index)
+    CMD_STREAM_START = 0x0E,  // Host starts a stream-mode session (replaces state sync)
+    CMD_STREAM_VIDEO = 0x0F,  // Encoded video fragment (frame = video sequence)
+    CMD_STREAM_AUDIO = 0x10,  // Interleaved stereo int16 samples
 };
 
+// State sync: the serialized state is split into fixed-size chunks that are
+// content-addressed by a 64-bit hash. The host sends the chunk hashes first, the
+// client answers with a bitmap of chunks it can't find locally (CMD_STATE_REQ,
+// frame = bitmap byte offset) and only those are sent (CMD_STATE_DATA, frame = chunk index).
+#define STATE_CHUNK_SIZE        4096
+#define STATE_HASHES_PER_PACKET (STATE_CHUNK_SIZE / sizeof(uint64_t))
+#define STATE_SYNC_TIMEOUT_MS   10000
+#define STATE_SYNC_RETRIES      1       // Full resends after a failed verification
+
+// Stream mode: encoded frames are split into fragments that fit a packet.
+// Video is skipped (never partially sent) while the socket still holds more
+// than STREAM_MAX_QUEUED_BYTES, and after an encode that overran
+// STREAM_ENCODE_BUDGET_US the following frames are skipped until the overrun
+// is paid back, keeping the host inside its frame budget.
+#define STREAM_PACKET_SIZE          4096
+#define STREAM_FRAGMENT_DATA        (STREAM_PACKET_SIZE - sizeof(StreamFragmentHeader))
+#define STREAM_MAX_QUEUED_BYTES     32768
+#define STREAM_MAX_AUDIO_QUEUED     49152  // Above the video limit, well inside the 64KB send buffer
+#define STREAM_AUDIO_MAX_FRAMES     (STREAM_PACKET_SIZE / (2 * sizeof(int16_t)))
+#define STREAM_MAX_PACKETS_PER_POLL 128
+#define STREAM_ENCODE_BUDGET_US     8000
+#define STREAM_MAX_FRAME_SIZE       (4 * 1024 * 1024)  // Reassembly cap for untrusted sizes
+
+// Video fragment payload header
+typedef struct __attribute__((packed)) {
+    uint32_t total_size;  // Size of the whole encoded frame
+    uint32_t offset;      // Offset of this fragment within it
+} StreamFragmentHeader;
+
+// State header payload
+typedef struct __attribute__((packed)) {
+    uint32_t state_size;
+    uint32_t num_chunks;
+    uint32_t hash_hi;     // Hash of the whole state, used to verify the assembled result
+    uint32_t hash_lo;
+} StateHeaderPacket;
+
 // Frame input entry
 typedef struct {
     uint32_t frame;
@@ -89,6 +141,7 @@ static struct {
     int tcp_fd;         // Main TCP connection
     int listen_fd;      // Server listen socket
     int udp_fd;         // Discovery UDP socket
+    int udp_listen_fd;  // Host: discovery queries from clients
 
     // Connection info
     char local_ip[16];
@@ -115,14 +168,13 @@ static struct {
     bool state_sync_complete;
 
     // Discovery
-    NetplayHostInfo discovered_hosts[NETPLAY_MAX_HOSTS];
-    int num_hosts;
+    NET_DiscoveryCache discovery;
     bool discovery_active;
 
-    // Threading
-    pthread_t listen_thread;
+    // Host listen and discovery work runs on the shared event loop
+    int broadcast_timer_fd;
+    NET_BroadcastTimer broadcast_timer;
     pthread_mutex_t mutex;
-    volatile bool running;
 
     // Status
     char status_msg[128];
@@ -138,17 +190,51 @@ static struct {
     bool local_paused;   // We have paused (menu open)
     bool remote_paused;  // Remote player has paused
 
+    // Stream mode
+    bool stream_session;          // Current session streams instead of lockstep
+    uint16_t stream_remote_input; // Host: latest client input
+    uint16_t stream_sent_input;   // Client: last input sent to host
+    uint32_t stream_video_seq;
+    uint32_t stream_skipped;      // Host: frames dropped due to send backlog or encode cost
+    uint32_t stream_audio_dropped; // Host: audio packets dropped due to send backlog
+    uint32_t stream_skip_frames;  // Host: frames left to skip after an over-budget encode
+    NetstreamEncoder encoder;
+    NetstreamDecoder decoder;
+    uint8_t* stream_frame;        // Client: encoded frame being reassembled
+    size_t stream_frame_cap;
+    size_t stream_frame_size;
+    uint32_t stream_frame_seq;    // Client: video sequence being reassembled
+    bool stream_have_frame;       // Client: at least one frame decoded
+    int16_t stream_audio[STREAM_AUDIO_MAX_FRAMES * 2];
+    size_t stream_audio_frames;
+
     // Initialization flag
     bool initialized;
 
 } np = {0};
 
+// Snapshot cache: last state synced by either role. Kept across sessions (not
+// cleared by Netplay_quit) so a reconnect or rematch only transfers changed chunks.
+// Only the client reads it, but the host stores it too: roles are picked per
+// session, and a host that joins the next one has the last agreed state ready.
+static struct {
+    uint8_t* data;
+    size_t size;
+} snapshot_cache = {0};
+
+// Set by Netplay_setCore: loaded core isn't deterministic enough for lockstep
+static bool stream_core = false;
+
 // Forward declarations
 static bool send_packet(uint8_t cmd, uint32_t frame, const void* data, uint16_t size);
 static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int timeout_ms);
-static void* listen_thread_func(void* arg);
+static void on_listen_ready(int fd, uint32_t events, void* ctx);
+static void on_discovery_query(int fd, uint32_t events, void* ctx);
+static void on_broadcast_timer(int fd, uint32_t events, void* ctx);
 static FrameInput* get_frame_slot(uint32_t frame);
 static void init_frame_buffer(void);
+static void handle_recv_disconnect(void);
+static int stream_update(uint16_t local_input);
 
 //////////////////////////////////////////////////////////////////////////////
 // Initialization
@@ -163,6 +249,8 @@ void Netplay_init(void) {
     np.tcp_fd = -1;
     np.listen_fd = -1;
     np.udp_fd = -1;
+    np.udp_listen_fd = -1;
+    np.broadcast_timer_fd = -1;
     np.port = NETPLAY_DEFAULT_PORT;
     pthread_mutex_init(&np.mutex, NULL);
     NET_getLocalIP(np.local_ip, sizeof(np.local_ip));
@@ -187,6 +275,14 @@ void Netplay_quit(void) {
         netplay_connected_to_hotspot = 0;
     }
 
+    Netstream_freeEncoder(&np.encoder);
+    Netstream_freeDecoder(&np.decoder);
+    free(np.stream_frame);
+    np.stream_frame = NULL;
+    np.stream_frame_cap = 0;
+
+    NET_quitEventLoop();
+
     pthread_mutex_destroy(&np.mutex);
     np.initialized = false;
 }
@@ -194,15 +290,28 @@ void Netplay_quit(void) {
 bool Netplay_checkCoreSupport(const char* core_name) {
     // These cores have been tested and work with frame-synchronized netplay
     // core_name is derived from the .so filename (e.g., "fbneo" from "fbneo_libretro.so")
-    if (strcasecmp(core_name, "fbneo") == 0 ||
-        strcasecmp(core_name, "fceumm") == 0 ||
-        strcasecmp(core_name, "snes9x") == 0 ||
-        strcasecmp(core_name, "mednafen_supafaust") == 0 ||
-        strcasecmp(core_name, "picodrive") == 0 ||
-        strcasecmp(core_name, "pcsx_rearmed") == 0) {
-        return true;
-    }
-    return false;
+    return strcasecmp(core_name, "fbneo") == 0 ||
+           strcasecmp(core_name, "fceumm") == 0 ||
+           strcasecmp(core_name, "snes9x") == 0 ||
+           strcasecmp(core_name, "mednafen_supafaust") == 0 ||
+           strcasecmp(core_name, "picodrive") == 0 ||
+           strcasecmp(core_name, "pcsx_rearmed") == 0;
+}
+
+bool Netplay_isStreamCore(const char* core_name) {
+    // Not deterministic enough for lockstep, but tested in stream mode
+    // (the host runs the core alone)
+    return strcasecmp(core_name, "mgba") == 0 ||
+           strcasecmp(core_name, "gpsp") == 0 ||
+           strcasecmp(core_name, "gambatte") == 0;
+}
+
+void Netplay_setCore(const char* core_name) {
+    stream_core = !Netplay_checkCoreSupport(core_name) && Netplay_isStreamCore(core_name);
+}
+
+bool Netplay_isStreamMode(void) {
+    return stream_core;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -267,34 +376,77 @@ int Netplay_startHost(const char* game_name, uint32_t game_crc, const char* hots
         return -1;
     }
 
+    // Answer client queries so the join screen lists us without waiting for a broadcast
+    np.udp_listen_fd = NET_createDiscoveryListenSocket(NETPLAY_DISCOVERY_PORT);
+    if (np.udp_listen_fd < 0) {
+        LOG_warn("Netplay: Could not create UDP query listener (non-fatal)\n");
+    }
+
     strncpy(np.game_name, game_name, NETPLAY_MAX_GAME_NAME - 1);
     np.game_crc = game_crc;
 
-    // Start listen thread
-    np.running = true;
-    pthread_create(&np.listen_thread, NULL, listen_thread_func, NULL);
-
     np.mode = NETPLAY_HOST;
     np.state = NETPLAY_STATE_WAITING;
     np.needs_state_sync = true;
 
+    // Accept, answer queries and broadcast from the shared event loop
+    np.broadcast_timer_fd = NET_createTimer(on_broadcast_timer, NULL);
+    if (NET_watchSocket(np.listen_fd, on_listen_ready, NULL) < 0 || np.broadcast_timer_fd < 0) {
+        NET_unwatch(np.listen_fd);
+        NET_unwatch(np.broadcast_timer_fd);
+        np.broadcast_timer_fd = -1;
+        close(np.listen_fd);
+        np.listen_fd = -1;
+        Netplay_stopBroadcast();
+        np.mode = NETPLAY_OFF;
+        np.state = NETPLAY_STATE_IDLE;
+        if (hotspot_ip) {
+            np.using_hotspot = false;
+        }
+        snprintf(np.status_msg, sizeof(np.status_msg), "Failed to start listener");
+        return -1;
+    }
+    NET_watchSocket(np.udp_listen_fd, on_discovery_query, NULL);
+    NET_initBroadcastTimer(&np.broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+    NET_setTimer(np.broadcast_timer_fd, 1, DISCOVERY_BROADCAST_INTERVAL_US / 1000);
+
     snprintf(np.status_msg, sizeof(np.status_msg), "Hosting on %s:%d", np.local_ip, np.port);
     return 0;
 }
 
 void Netplay_stopBroadcast(void) {
-    // Close UDP socket - no longer needed after connection
+    // Close UDP socket - no longer needed after connection. The broadcast timer
+    // sends under the mutex, so the fd can't be closed (or reused) mid-send.
+    pthread_mutex_lock(&np.mutex);
+    NET_setTimer(np.broadcast_timer_fd, 0, 0);
     if (np.udp_fd >= 0) {
         close(np.udp_fd);
         np.udp_fd = -1;
     }
+    int udp_listen_fd = np.udp_listen_fd;
+    np.udp_listen_fd = -1;
+    pthread_mutex_unlock(&np.mutex);
+
+    // Unwatch outside the mutex - it waits for a query callback, which takes it
+    if (udp_listen_fd >= 0) {
+        NET_unwatch(udp_listen_fd);
+        close(udp_listen_fd);
+    }
 }
 
-// Restart UDP broadcast when going back to waiting state
+// Restart UDP broadcast when going back to waiting state (mutex held)
 // Called when client disconnects but host wants to accept new clients
 static void Netplay_restartBroadcast(void) {
-    if (np.udp_fd >= 0) return;  // Already running
     if (np.mode != NETPLAY_HOST) return;  // Only for host
+    if (np.udp_listen_fd < 0) {
+        np.udp_listen_fd = NET_createDiscoveryListenSocket(NETPLAY_DISCOVERY_PORT);
+        NET_watchSocket(np.udp_listen_fd, on_discovery_query, NULL);
+    }
+
+    // Back to the fast rate so a returning client finds us quickly
+    NET_initBroadcastTimer(&np.broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+    NET_setTimer(np.broadcast_timer_fd, 1, DISCOVERY_BROADCAST_INTERVAL_US / 1000);
+    if (np.udp_fd >= 0) return;  // Already running
 
     np.udp_fd = NET_createBroadcastSocket();
     if (np.udp_fd < 0) {
@@ -306,20 +458,15 @@ static void Netplay_restartBroadcast(void) {
 static int Netplay_stopHostInternal(bool skip_hotspot_cleanup) {
     if (np.mode != NETPLAY_HOST) return -1;
 
-    np.running = false;
-
-    // Wake up listen thread by closing listen socket (causes select to return)
-    // This is safer than pthread_cancel which may leave resources inconsistent
-    if (np.listen_fd >= 0) {
-        shutdown(np.listen_fd, SHUT_RDWR);
-    }
-
-    if (np.listen_thread) {
-        pthread_join(np.listen_thread, NULL);
-        np.listen_thread = 0;
-    }
-
+    // Unwatch before closing - waits out a callback already running. Taken
+    // under the mutex so Netplay_restartBroadcast can't re-arm a closed timer.
+    pthread_mutex_lock(&np.mutex);
+    int broadcast_timer_fd = np.broadcast_timer_fd;
+    np.broadcast_timer_fd = -1;
+    pthread_mutex_unlock(&np.mutex);
+    NET_unwatch(broadcast_timer_fd);
     if (np.listen_fd >= 0) {
+        NET_unwatch(np.listen_fd);
         close(np.listen_fd);
         np.listen_fd = -1;
     }
@@ -351,76 +498,90 @@ int Netplay_stopHostFast(void) {
     return Netplay_stopHostInternal(true);
 }
 
-static void* listen_thread_func(void* arg) {
-    (void)arg;
+// Event loop: incoming connection on the listen socket
+static void on_listen_ready(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
 
-    // Use shared broadcast timer for rate limiting
-    NET_BroadcastTimer broadcast_timer;
-    NET_initBroadcastTimer(&broadcast_timer, DISCOVERY_BROADCAST_INTERVAL_US);
+    struct sockaddr_in client_addr;
+    socklen_t len = sizeof(client_addr);
 
-    while (np.running && np.listen_fd >= 0) {
-        // Check state under mutex protection to avoid race conditions
-        pthread_mutex_lock(&np.mutex);
-        bool is_waiting = (np.state == NETPLAY_STATE_WAITING);
-        int udp_fd = np.udp_fd;
+    int client_fd = accept(fd, (struct sockaddr*)&client_addr, &len);
+    if (client_fd < 0) return;
+
+    pthread_mutex_lock(&np.mutex);
+
+    // Only one client - anyone connecting outside the waiting state is turned away
+    if (np.state != NETPLAY_STATE_WAITING) {
+        close(client_fd);
         pthread_mutex_unlock(&np.mutex);
+        return;
+    }
 
-        // Rate-limited discovery broadcast using shared timer
-        if (udp_fd >= 0 && is_waiting) {
-            if (NET_shouldBroadcast(&broadcast_timer)) {
-                NET_sendDiscoveryBroadcast(udp_fd, NP_DISCOVERY_RESP, NETPLAY_PROTOCOL_VERSION,
-                                           np.game_crc, np.port, NETPLAY_DISCOVERY_PORT,
-                                           np.game_name, NULL);  // Netplay doesn't use link_mode
-            }
-        }
+    // Configure TCP socket using shared utility (default: 64KB buffers)
+    NET_configureTCPSocket(client_fd, NULL);
 
-        // Check for incoming connection (only accept when waiting)
-        if (is_waiting) {
-            fd_set fds;
-            FD_ZERO(&fds);
-            FD_SET(np.listen_fd, &fds);
-
-            struct timeval tv = {.tv_sec = 0, .tv_usec = 100000};  // 100ms timeout
-            if (select(np.listen_fd + 1, &fds, NULL, NULL, &tv) > 0) {
-                struct sockaddr_in client_addr;
-                socklen_t len = sizeof(client_addr);
-
-                int fd = accept(np.listen_fd, (struct sockaddr*)&client_addr, &len);
-                if (fd >= 0) {
-                    pthread_mutex_lock(&np.mutex);
-
-                    // Double-check we're still waiting (state could have changed)
-                    if (np.state != NETPLAY_STATE_WAITING) {
-                        close(fd);
-                        pthread_mutex_unlock(&np.mutex);
-                        continue;
-                    }
+    np.tcp_fd = client_fd;
+    inet_ntop(AF_INET, &client_addr.sin_addr, np.remote_ip, sizeof(np.remote_ip));
+
+    np.state = NETPLAY_STATE_SYNCING;
+    np.needs_state_sync = true;
+    np.self_frame = 0;
+    np.run_frame = 0;
+    np.other_frame = 0;
 
-                    // Configure TCP socket using shared utility (default: 64KB buffers)
-                    NET_configureTCPSocket(fd, NULL);
+    init_frame_buffer();
 
-                    np.tcp_fd = fd;
-                    inet_ntop(AF_INET, &client_addr.sin_addr, np.remote_ip, sizeof(np.remote_ip));
+    snprintf(np.status_msg, sizeof(np.status_msg), "Client connected: %s", np.remote_ip);
+    pthread_mutex_unlock(&np.mutex);
+}
 
-                    np.state = NETPLAY_STATE_SYNCING;
-                    np.needs_state_sync = true;
-                    np.self_frame = 0;
-                    np.run_frame = 0;
-                    np.other_frame = 0;
+// Event loop: discovery query from a client opening the join screen
+static void on_discovery_query(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
 
-                    init_frame_buffer();
+    pthread_mutex_lock(&np.mutex);
+    bool is_waiting = (np.state == NETPLAY_STATE_WAITING);
+    pthread_mutex_unlock(&np.mutex);
 
-                    snprintf(np.status_msg, sizeof(np.status_msg), "Client connected: %s", np.remote_ip);
-                    pthread_mutex_unlock(&np.mutex);
-                }
-            }
-        } else {
-            // Not waiting, just sleep briefly to avoid busy loop
-            usleep(50000);  // 50ms (reduced from 100ms)
-        }
+    if (is_waiting) {
+        NET_answerDiscoveryQueries(fd, NP_DISCOVERY_QUERY, NP_DISCOVERY_RESP,
+                                   NETPLAY_PROTOCOL_VERSION, np.game_crc, np.port,
+                                   np.game_name, NULL);
+    } else {
+        char drain[sizeof(NET_DiscoveryPacket)];
+        while (recv(fd, drain, sizeof(drain), MSG_DONTWAIT) >= 0) {}
     }
+}
 
-    return NULL;
+// Event loop: discovery broadcast while waiting for a client. Disarms itself
+// once a client connects, Netplay_restartBroadcast re-arms it.
+static void on_broadcast_timer(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+
+    // Send under the mutex - Netplay_stopBroadcast closes udp_fd under it
+    pthread_mutex_lock(&np.mutex);
+    bool advertising = (np.state == NETPLAY_STATE_WAITING) && np.udp_fd >= 0;
+    if (advertising) {
+        NET_sendDiscoveryBroadcast(np.udp_fd, NP_DISCOVERY_RESP, NETPLAY_PROTOCOL_VERSION,
+                                   np.game_crc, np.port, NETPLAY_DISCOVERY_PORT,
+                                   np.game_name, NULL);  // Netplay doesn't use link_mode
+    }
+    pthread_mutex_unlock(&np.mutex);
+
+    if (!advertising) {
+        NET_setTimer(fd, 0, 0);
+        return;
+    }
+
+    // Follow the backoff - re-arm only when the interval changed
+    int prev_us = np.broadcast_timer.interval_us;
+    int next_us = NET_markBroadcast(&np.broadcast_timer);
+    if (next_us != prev_us) {
+        NET_setTimer(fd, next_us / 1000, next_us / 1000);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -527,7 +688,10 @@ int Netplay_startDiscovery(void) {
         return -1;
     }
 
-    np.num_hosts = 0;
+    // Ask hosts right away instead of waiting for their next broadcast
+    NET_initDiscoveryCache(&np.discovery, NP_DISCOVERY_QUERY, NP_DISCOVERY_RESP,
+                           NETPLAY_PROTOCOL_VERSION, NETPLAY_DISCOVERY_PORT);
+    NET_sendDiscoveryQuery(np.udp_fd, &np.discovery);
     np.discovery_active = true;
     return 0;
 }
@@ -546,15 +710,8 @@ void Netplay_stopDiscovery(void) {
 int Netplay_getDiscoveredHosts(NetplayHostInfo* hosts, int max_hosts) {
     if (!np.discovery_active || np.udp_fd < 0) return 0;
 
-    // Poll for discovery responses using shared function
     // NetplayHostInfo and NET_HostInfo have identical layouts
-    NET_receiveDiscoveryResponses(np.udp_fd, NP_DISCOVERY_RESP,
-                                   (NET_HostInfo*)np.discovered_hosts, &np.num_hosts,
-                                   NETPLAY_MAX_HOSTS);
-
-    int count = (np.num_hosts < max_hosts) ? np.num_hosts : max_hosts;
-    memcpy(hosts, np.discovered_hosts, count * sizeof(NetplayHostInfo));
-    return count;
+    return NET_updateDiscoveryCache(np.udp_fd, &np.discovery, (NET_HostInfo*)hosts, max_hosts);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -734,6 +891,11 @@ uint32_t Netplay_getPlayerButtons(unsigned port, uint32_t local_buttons) {
     // Host = Player 1, Client = Player 2 (always)
     // Both devices see identical inputs for same frame
     if (np.mode != NETPLAY_OFF && Netplay_isConnected()) {
+        // Stream mode: only the host runs the core, its own input isn't delayed
+        if (np.stream_session) {
+            if (port == 0) return local_buttons;
+            return (port == 1) ? np.stream_remote_input : 0;
+        }
         return Netplay_getInputState(port);
     }
     // Local play - only P1 has input
@@ -766,92 +928,361 @@ bool Netplay_shouldSilenceAudio(void) {
 // State Synchronization
 //////////////////////////////////////////////////////////////////////////////
 
+// Fast 64-bit hash for state chunks (word-at-a-time multiply/rotate mix)
+static uint64_t state_hash(const uint8_t* p, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)len;
+
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        h ^= v * 0xC2B2AE3D27D4EB4FULL;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ULL;
+        p += 8;
+        len -= 8;
+    }
+    while (len > 0) {
+        h ^= (uint64_t)(*p++) * 0x165667B19E3779F9ULL;
+        h = ((h << 23) | (h >> 41)) * 0x9E3779B97F4A7C15ULL;
+        len--;
+    }
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint32_t state_num_chunks(size_t size) {
+    return (uint32_t)((size + STATE_CHUNK_SIZE - 1) / STATE_CHUNK_SIZE);
+}
+
+static size_t state_chunk_len(size_t size, uint32_t index) {
+    size_t offset = (size_t)index * STATE_CHUNK_SIZE;
+    size_t len = size - offset;
+    return (len > STATE_CHUNK_SIZE) ? STATE_CHUNK_SIZE : len;
+}
+
+static void put_u64(uint8_t* out, uint64_t v) {
+    uint32_t hi = htonl((uint32_t)(v >> 32));
+    uint32_t lo = htonl((uint32_t)v);
+    memcpy(out, &hi, sizeof(hi));
+    memcpy(out + 4, &lo, sizeof(lo));
+}
+
+static uint64_t get_u64(const uint8_t* in) {
+    uint32_t hi, lo;
+    memcpy(&hi, in, sizeof(hi));
+    memcpy(&lo, in + 4, sizeof(lo));
+    return ((uint64_t)ntohl(hi) << 32) | ntohl(lo);
+}
+
+// Remember the last synced state so the next sync can reuse its chunks
+static void snapshot_cache_store(const void* data, size_t size) {
+    if (snapshot_cache.size != size) {
+        free(snapshot_cache.data);
+        snapshot_cache.data = malloc(size);
+        snapshot_cache.size = snapshot_cache.data ? size : 0;
+    }
+    if (snapshot_cache.data) {
+        memcpy(snapshot_cache.data, data, size);
+    }
+}
+
+static void snapshot_cache_clear(void) {
+    free(snapshot_cache.data);
+    snapshot_cache.data = NULL;
+    snapshot_cache.size = 0;
+}
+
+// Open-addressed hash -> chunk lookup over the chunks the client already has
+typedef struct {
+    uint64_t hash;
+    const uint8_t* ptr;
+    uint32_t len;
+} ChunkIndexEntry;
+
+typedef struct {
+    ChunkIndexEntry* entries;
+    uint32_t mask;
+} ChunkIndex;
+
+static bool chunk_index_init(ChunkIndex* idx, uint32_t max_chunks) {
+    uint32_t cap = 64;
+    while (cap < max_chunks * 2) cap <<= 1;
+    idx->entries = calloc(cap, sizeof(ChunkIndexEntry));
+    idx->mask = cap - 1;
+    return idx->entries != NULL;
+}
+
+static void chunk_index_add_buffer(ChunkIndex* idx, const uint8_t* buf, size_t size) {
+    if (!buf) return;
+    uint32_t count = state_num_chunks(size);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* ptr = buf + (size_t)i * STATE_CHUNK_SIZE;
+        uint32_t len = (uint32_t)state_chunk_len(size, i);
+        uint64_t hash = state_hash(ptr, len);
+
+        uint32_t slot = (uint32_t)hash & idx->mask;
+        while (idx->entries[slot].ptr) {
+            if (idx->entries[slot].hash == hash && idx->entries[slot].len == len) break;
+            slot = (slot + 1) & idx->mask;
+        }
+        if (!idx->entries[slot].ptr) {
+            idx->entries[slot].hash = hash;
+            idx->entries[slot].ptr = ptr;
+            idx->entries[slot].len = len;
+        }
+    }
+}
+
+static const uint8_t* chunk_index_find(const ChunkIndex* idx, uint64_t hash, uint32_t len) {
+    uint32_t slot = (uint32_t)hash & idx->mask;
+    while (idx->entries[slot].ptr) {
+        if (idx->entries[slot].hash == hash && idx->entries[slot].len == len) {
+            return idx->entries[slot].ptr;
+        }
+        slot = (slot + 1) & idx->mask;
+    }
+    return NULL;
+}
+
 int Netplay_sendState(const void* data, size_t size) {
     if (!Netplay_isConnected() || !data || size == 0) return -1;
 
+    const uint8_t* state = (const uint8_t*)data;
+    uint32_t num_chunks = state_num_chunks(size);
+    uint32_t bitmap_size = (num_chunks + 7) / 8;
+    uint8_t packet[STATE_CHUNK_SIZE];
+    uint8_t* missing = NULL;
+    int result = -1;
+
     // Send state header
-    uint32_t state_size = (uint32_t)size;
-    state_size = htonl(state_size);
-    if (!send_packet(CMD_STATE_HDR, 0, &state_size, sizeof(state_size))) {
+    uint64_t whole_hash = state_hash(state, size);
+    StateHeaderPacket shdr = {
+        .state_size = htonl((uint32_t)size),
+        .num_chunks = htonl(num_chunks),
+        .hash_hi = htonl((uint32_t)(whole_hash >> 32)),
+        .hash_lo = htonl((uint32_t)whole_hash)
+    };
+    if (!send_packet(CMD_STATE_HDR, 0, &shdr, sizeof(shdr))) {
         return -1;
     }
 
-    // Send state data in chunks
-    const uint8_t* ptr = (const uint8_t*)data;
-    size_t remaining = size;
-
-    while (remaining > 0) {
-        size_t chunk = (remaining > 4096) ? 4096 : remaining;
-        ssize_t sent = send(np.tcp_fd, ptr, chunk, MSG_NOSIGNAL);
-        if (sent <= 0) {
+    // Send chunk hashes
+    for (uint32_t first = 0; first < num_chunks; first += STATE_HASHES_PER_PACKET) {
+        uint32_t count = num_chunks - first;
+        if (count > STATE_HASHES_PER_PACKET) count = STATE_HASHES_PER_PACKET;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = first + i;
+            const uint8_t* chunk = state + (size_t)index * STATE_CHUNK_SIZE;
+            put_u64(packet + i * sizeof(uint64_t), state_hash(chunk, state_chunk_len(size, index)));
+        }
+        if (!send_packet(CMD_STATE_HASH, first, packet, (uint16_t)(count * sizeof(uint64_t)))) {
             return -1;
         }
-        ptr += sent;
-        remaining -= sent;
     }
 
-    // Wait for client ACK
-    PacketHeader hdr;
-    if (!recv_packet(&hdr, NULL, 0, 10000) || hdr.cmd != CMD_STATE_ACK) {
-        return -1;
+    missing = calloc(bitmap_size, 1);
+    if (!missing) return -1;
+
+    // Serve the client's missing-chunk bitmaps until it ACKs. Another bitmap
+    // instead of the ACK means the assembled state failed verification (a bad
+    // chunk reused from its side) and it is asking again, for every chunk.
+    for (int round = 0;; round++) {
+        PacketHeader hdr;
+        if (!recv_packet(&hdr, packet, sizeof(packet), STATE_SYNC_TIMEOUT_MS)) {
+            goto done;
+        }
+        if (hdr.cmd == CMD_STATE_ACK && round > 0) {
+            break;
+        }
+        if (round > STATE_SYNC_RETRIES) {
+            goto done;
+        }
+
+        uint32_t bitmap_received = 0;
+        for (;;) {
+            if (hdr.cmd != CMD_STATE_REQ ||
+                hdr.frame != bitmap_received ||
+                hdr.size == 0 || hdr.size > bitmap_size - bitmap_received) {
+                goto done;
+            }
+            memcpy(missing + bitmap_received, packet, hdr.size);
+            bitmap_received += hdr.size;
+            if (bitmap_received == bitmap_size) break;
+            if (!recv_packet(&hdr, packet, sizeof(packet), STATE_SYNC_TIMEOUT_MS)) {
+                goto done;
+            }
+        }
+
+        // Send only the chunks the client asked for
+        uint32_t sent_chunks = 0;
+        for (uint32_t index = 0; index < num_chunks; index++) {
+            if (!(missing[index / 8] & (1 << (index % 8)))) continue;
+            const uint8_t* chunk = state + (size_t)index * STATE_CHUNK_SIZE;
+            if (!send_packet(CMD_STATE_DATA, index, chunk, (uint16_t)state_chunk_len(size, index))) {
+                goto done;
+            }
+            sent_chunks++;
+        }
+
+        LOG_info("Netplay: state sync sent %u/%u chunks (%zu bytes total)\n",
+                 sent_chunks, num_chunks, size);
     }
 
     // Send READY signal
     if (!send_packet(CMD_READY, 0, NULL, 0)) {
-        return -1;
+        goto done;
     }
 
-    return 0;
+    snapshot_cache_store(state, size);
+    result = 0;
+
+done:
+    free(missing);
+    return result;
 }
 
+// data may be pre-filled with the client's own serialized state; its chunks are
+// used alongside the snapshot cache to avoid transferring data we already have
 int Netplay_receiveState(void* data, size_t size) {
     if (!Netplay_isConnected() || !data || size == 0) return -1;
 
+    uint8_t* state = (uint8_t*)data;
+    uint8_t packet[STATE_CHUNK_SIZE];
+    uint64_t* hashes = NULL;
+    uint8_t* missing = NULL;
+    uint8_t* local = NULL;
+    ChunkIndex index = {0};
+    int result = -1;
+
     // Receive state header
     PacketHeader hdr;
-    uint32_t state_size;
+    StateHeaderPacket shdr;
 
-    if (!recv_packet(&hdr, &state_size, sizeof(state_size), 10000) ||
-        hdr.cmd != CMD_STATE_HDR) {
+    if (!recv_packet(&hdr, &shdr, sizeof(shdr), STATE_SYNC_TIMEOUT_MS) ||
+        hdr.cmd != CMD_STATE_HDR || hdr.size != sizeof(shdr)) {
         return -1;
     }
 
-    state_size = ntohl(state_size);
+    uint32_t state_size = ntohl(shdr.state_size);
+    uint32_t num_chunks = ntohl(shdr.num_chunks);
+    uint64_t whole_hash = ((uint64_t)ntohl(shdr.hash_hi) << 32) | ntohl(shdr.hash_lo);
 
     if (state_size != size) {
         snprintf(np.status_msg, sizeof(np.status_msg),
                  "State size mismatch: %u vs %zu", state_size, size);
         return -1;
     }
+    if (num_chunks != state_num_chunks(size)) {
+        return -1;
+    }
+
+    uint32_t bitmap_size = (num_chunks + 7) / 8;
+    hashes = malloc(num_chunks * sizeof(uint64_t));
+    missing = calloc(bitmap_size, 1);
+    local = malloc(size);
+    if (!hashes || !missing || !local || !chunk_index_init(&index, num_chunks * 2)) {
+        goto done;
+    }
+
+    // Receive chunk hashes
+    uint32_t hashes_received = 0;
+    while (hashes_received < num_chunks) {
+        if (!recv_packet(&hdr, packet, sizeof(packet), STATE_SYNC_TIMEOUT_MS) ||
+            hdr.cmd != CMD_STATE_HASH ||
+            hdr.frame != hashes_received ||
+            hdr.size == 0 || (hdr.size % sizeof(uint64_t)) != 0 ||
+            hdr.size / sizeof(uint64_t) > num_chunks - hashes_received) {
+            goto done;
+        }
+        uint32_t count = hdr.size / sizeof(uint64_t);
+        for (uint32_t i = 0; i < count; i++) {
+            hashes[hashes_received + i] = get_u64(packet + i * sizeof(uint64_t));
+        }
+        hashes_received += count;
+    }
+
+    // Index what we already have: our own current state and the last synced snapshot.
+    // The local state is copied out first since the assembled result overwrites data.
+    memcpy(local, state, size);
+    chunk_index_add_buffer(&index, local, size);
+    chunk_index_add_buffer(&index, snapshot_cache.data, snapshot_cache.size);
+
+    uint32_t missing_chunks = 0;
+    for (uint32_t i = 0; i < num_chunks; i++) {
+        uint32_t len = (uint32_t)state_chunk_len(size, i);
+        const uint8_t* found = chunk_index_find(&index, hashes[i], len);
+        if (found) {
+            memcpy(state + (size_t)i * STATE_CHUNK_SIZE, found, len);
+        } else {
+            missing[i / 8] |= (1 << (i % 8));
+            missing_chunks++;
+        }
+    }
 
-    // Receive state data
-    uint8_t* ptr = (uint8_t*)data;
-    size_t remaining = size;
+    for (int attempt = 0;; attempt++) {
+        // Request missing chunks
+        for (uint32_t offset = 0; offset < bitmap_size; offset += STATE_CHUNK_SIZE) {
+            uint32_t len = bitmap_size - offset;
+            if (len > STATE_CHUNK_SIZE) len = STATE_CHUNK_SIZE;
+            if (!send_packet(CMD_STATE_REQ, offset, missing + offset, (uint16_t)len)) {
+                goto done;
+            }
+        }
 
-    while (remaining > 0) {
-        ssize_t received = recv(np.tcp_fd, ptr, remaining, 0);
-        if (received <= 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                usleep(1000);
-                continue;
+        // Receive missing chunks straight into place
+        for (uint32_t received = 0; received < missing_chunks; received++) {
+            if (!recv_packet(&hdr, packet, sizeof(packet), STATE_SYNC_TIMEOUT_MS) ||
+                hdr.cmd != CMD_STATE_DATA || hdr.frame >= num_chunks ||
+                !(missing[hdr.frame / 8] & (1 << (hdr.frame % 8))) ||
+                hdr.size != state_chunk_len(size, hdr.frame)) {
+                goto done;
             }
-            return -1;
+            memcpy(state + (size_t)hdr.frame * STATE_CHUNK_SIZE, packet, hdr.size);
         }
-        ptr += received;
-        remaining -= received;
+
+        LOG_info("Netplay: state sync received %u/%u chunks (%zu bytes total)\n",
+                 missing_chunks, num_chunks, size);
+
+        // Verify the assembled state - a bad cache hit would desync the session
+        if (state_hash(state, size) == whole_hash) {
+            break;
+        }
+        LOG_error("Netplay: assembled state hash mismatch\n");
+        snapshot_cache_clear();
+        if (attempt == STATE_SYNC_RETRIES) {
+            snprintf(np.status_msg, sizeof(np.status_msg), "State verification failed");
+            goto done;
+        }
+
+        // The host is waiting for our ACK: ask it for every chunk instead
+        memset(missing, 0, bitmap_size);
+        for (uint32_t i = 0; i < num_chunks; i++) {
+            missing[i / 8] |= (1 << (i % 8));
+        }
+        missing_chunks = num_chunks;
     }
 
     // Send ACK to host
     if (!send_packet(CMD_STATE_ACK, 0, NULL, 0)) {
-        return -1;
+        goto done;
     }
 
     // Wait for READY signal from host
-    if (!recv_packet(&hdr, NULL, 0, 10000) || hdr.cmd != CMD_READY) {
-        return -1;
+    if (!recv_packet(&hdr, NULL, 0, STATE_SYNC_TIMEOUT_MS) || hdr.cmd != CMD_READY) {
+        goto done;
     }
 
-    return 0;
+    snapshot_cache_store(state, size);
+    result = 0;
+
+done:
+    free(index.entries);
+    free(local);
+    free(missing);
+    free(hashes);
+    return result;
 }
 
 bool Netplay_needsStateSync(void) {
@@ -969,6 +1400,260 @@ void Netplay_pollWhilePaused(void) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Stream Mode
+//////////////////////////////////////////////////////////////////////////////
+
+bool Netplay_isStreamClient(void) {
+    return np.stream_session && np.mode == NETPLAY_CLIENT && Netplay_isConnected();
+}
+
+static bool stream_is_host(void) {
+    return np.stream_session && np.mode == NETPLAY_HOST && Netplay_isConnected();
+}
+
+// Host: bytes written to the socket but not yet acknowledged by the client
+static int stream_queued_bytes(void) {
+#ifdef SIOCOUTQ
+    int queued = 0;
+    if (ioctl(np.tcp_fd, SIOCOUTQ, &queued) == 0) return queued;
+#endif
+    return 0;
+}
+
+static void stream_flush_audio(void) {
+    if (np.stream_audio_frames == 0) return;
+
+    // The socket blocks once its send buffer is full, which would stall the
+    // core. Audio outlasts video (dropped from STREAM_MAX_QUEUED_BYTES), but
+    // with the client this far behind a gap beats a frozen host.
+    if (stream_queued_bytes() > STREAM_MAX_AUDIO_QUEUED) {
+        np.stream_audio_dropped++;
+        LOG_debug("Netplay: stream send backlog, dropped %zu audio frames\n", np.stream_audio_frames);
+    } else {
+        send_packet(CMD_STREAM_AUDIO, np.self_frame, np.stream_audio,
+                    (uint16_t)(np.stream_audio_frames * 2 * sizeof(int16_t)));
+    }
+    np.stream_audio_frames = 0;
+}
+
+void Netplay_streamVideo(const void* data, unsigned width, unsigned height, size_t pitch, unsigned bpp) {
+    if (!data || !stream_is_host()) return;
+
+    // Client hasn't drained previous frames yet - drop this one. The encoder
+    // reference stays at the last frame actually sent, so deltas remain valid.
+    if (stream_queued_bytes() > STREAM_MAX_QUEUED_BYTES) {
+        np.stream_skipped++;
+        return;
+    }
+
+    // Paying back an over-budget encode - skipped frames aren't encoded, so
+    // the reference stays valid here too
+    if (np.stream_skip_frames > 0) {
+        np.stream_skip_frames--;
+        np.stream_skipped++;
+        return;
+    }
+
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    int ret = Netstream_encode(&np.encoder, data, width, height, pitch, bpp);
+
+    gettimeofday(&end, NULL);
+    long encode_us = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec);
+    if (encode_us > STREAM_ENCODE_BUDGET_US) {
+        // Averaged over the skipped frames the encoder stays within budget
+        np.stream_skip_frames = (uint32_t)(encode_us / STREAM_ENCODE_BUDGET_US);
+        LOG_debug("Netplay: stream encode took %ldus, skipping %u frame(s)\n",
+                  encode_us, np.stream_skip_frames);
+    }
+    if (ret != NETSTREAM_FRAME) return;
+
+    uint8_t packet[STREAM_PACKET_SIZE];
+    uint32_t seq = np.stream_video_seq++;
+    size_t total = np.encoder.out_size;
+
+    for (size_t offset = 0; offset < total; offset += STREAM_FRAGMENT_DATA) {
+        size_t len = total - offset;
+        if (len > STREAM_FRAGMENT_DATA) len = STREAM_FRAGMENT_DATA;
+
+        StreamFragmentHeader frag = {
+            .total_size = htonl((uint32_t)total),
+            .offset = htonl((uint32_t)offset)
+        };
+        memcpy(packet, &frag, sizeof(frag));
+        memcpy(packet + sizeof(frag), np.encoder.out + offset, len);
+        if (!send_packet(CMD_STREAM_VIDEO, seq, packet, (uint16_t)(sizeof(frag) + len))) {
+            Netstream_resetEncoder(&np.encoder);
+            return;
+        }
+    }
+}
+
+void Netplay_streamAudio(const int16_t* data, size_t frames) {
+    if (!data || !stream_is_host()) return;
+
+    while (frames > 0) {
+        size_t space = STREAM_AUDIO_MAX_FRAMES - np.stream_audio_frames;
+        size_t count = (frames < space) ? frames : space;
+        memcpy(np.stream_audio + np.stream_audio_frames * 2, data, count * 2 * sizeof(int16_t));
+        np.stream_audio_frames += count;
+        data += count * 2;
+        frames -= count;
+        if (np.stream_audio_frames == STREAM_AUDIO_MAX_FRAMES) {
+            stream_flush_audio();
+        }
+    }
+}
+
+// Client: reassemble a video fragment, returns true when a frame was decoded
+static bool stream_receive_fragment(const PacketHeader* hdr, const uint8_t* payload) {
+    if (hdr->size < sizeof(StreamFragmentHeader)) return false;
+
+    StreamFragmentHeader frag;
+    memcpy(&frag, payload, sizeof(frag));
+    size_t total = ntohl(frag.total_size);
+    size_t offset = ntohl(frag.offset);
+    size_t len = hdr->size - sizeof(frag);
+
+    // A frame start always begins reassembly, even over an incomplete frame
+    if (offset == 0) {
+        np.stream_frame_size = 0;
+        np.stream_frame_seq = hdr->frame;
+    }
+    if (hdr->frame != np.stream_frame_seq || offset != np.stream_frame_size ||
+        offset + len > total || total > STREAM_MAX_FRAME_SIZE) {
+        np.stream_frame_size = 0;  // Out of order, wait for the next frame start
+        return false;
+    }
+    if (np.stream_frame_cap < total) {
+        uint8_t* grown = realloc(np.stream_frame, total);
+        if (!grown) return false;
+        np.stream_frame = grown;
+        np.stream_frame_cap = total;
+    }
+
+    memcpy(np.stream_frame + offset, payload + sizeof(frag), len);
+    np.stream_frame_size += len;
+    if (np.stream_frame_size < total) return false;
+
+    np.stream_frame_size = 0;
+    if (!Netstream_decode(&np.decoder, np.stream_frame, total)) {
+        LOG_warn("Netplay: failed to decode stream frame %u\n", hdr->frame);
+        return false;
+    }
+    np.stream_have_frame = true;
+    return true;
+}
+
+void Netplay_presentStream(Netplay_VideoFn video_fn, Netplay_AudioFn audio_fn) {
+    if (!Netplay_isStreamClient()) return;
+
+    static uint8_t payload[STREAM_PACKET_SIZE];
+    bool new_frame = false;
+
+    for (int i = 0; i < STREAM_MAX_PACKETS_PER_POLL; i++) {
+        PacketHeader hdr;
+        if (!recv_packet(&hdr, payload, sizeof(payload), 0)) break;
+
+        if (hdr.cmd == CMD_STREAM_VIDEO) {
+            if (stream_receive_fragment(&hdr, payload)) new_frame = true;
+        } else if (hdr.cmd == CMD_STREAM_AUDIO) {
+            if (audio_fn) audio_fn((const int16_t*)payload, hdr.size / (2 * sizeof(int16_t)));
+        } else if (hdr.cmd == CMD_PAUSE) {
+            np.remote_paused = true;
+            snprintf(np.status_msg, sizeof(np.status_msg), "Remote player paused");
+        } else if (hdr.cmd == CMD_RESUME) {
+            np.remote_paused = false;
+            snprintf(np.status_msg, sizeof(np.status_msg), "Netplay active");
+        } else if (hdr.cmd == CMD_DISCONNECT) {
+            handle_recv_disconnect();
+            return;
+        }
+    }
+
+    // NULL repeats the last converted frame in video_refresh_callback
+    if (video_fn && np.stream_have_frame) {
+        video_fn(new_frame ? np.decoder.frame : NULL, np.decoder.width, np.decoder.height,
+                 (size_t)np.decoder.width * np.decoder.bpp);
+    }
+}
+
+static int stream_update(uint16_t local_input) {
+    if (Netplay_needsStateSync()) {
+        if (np.mode == NETPLAY_HOST) {
+            if (!send_packet(CMD_STREAM_START, 0, NULL, 0)) {
+                Netplay_disconnect();
+                return 1;
+            }
+            Netstream_resetEncoder(&np.encoder);
+            np.stream_video_seq = 0;
+            np.stream_skipped = 0;
+            np.stream_audio_dropped = 0;
+            np.stream_skip_frames = 0;
+            np.stream_remote_input = 0;
+            np.stream_audio_frames = 0;
+        } else {
+            PacketHeader hdr;
+            if (!recv_packet(&hdr, NULL, 0, STATE_SYNC_TIMEOUT_MS) || hdr.cmd != CMD_STREAM_START) {
+                snprintf(np.status_msg, sizeof(np.status_msg), "Host is not streaming");
+                Netplay_disconnect();
+                return 1;
+            }
+            Netstream_resetDecoder(&np.decoder);
+            np.stream_frame_size = 0;
+            np.stream_have_frame = false;
+            np.stream_sent_input = 0;
+        }
+        np.stream_session = true;
+        Netplay_completeStateSync();
+        LOG_info("Netplay: stream mode session started (%s)\n", np.mode == NETPLAY_HOST ? "host" : "client");
+        return 0;  // Skip this frame
+    }
+
+    if (!Netplay_isConnected()) {
+        np.stream_session = false;
+        if (np.state == NETPLAY_STATE_DISCONNECTED) {
+            Netplay_disconnect();
+        }
+        return 1;
+    }
+
+    if (np.mode == NETPLAY_HOST) {
+        // Audio produced while running the previous frame
+        stream_flush_audio();
+
+        // Apply whatever inputs arrived since the last frame - the host never stalls
+        for (int i = 0; i < STREAM_MAX_PACKETS_PER_POLL; i++) {
+            PacketHeader hdr;
+            InputPacket pkt;
+            if (!recv_packet(&hdr, &pkt, sizeof(pkt), 0)) break;
+
+            if (hdr.cmd == CMD_INPUT && hdr.size == sizeof(pkt)) {
+                np.stream_remote_input = ntohs(pkt.input);
+            } else if (hdr.cmd == CMD_PAUSE) {
+                np.remote_paused = true;
+                snprintf(np.status_msg, sizeof(np.status_msg), "Remote player paused");
+            } else if (hdr.cmd == CMD_RESUME) {
+                np.remote_paused = false;
+                snprintf(np.status_msg, sizeof(np.status_msg), "Netplay active");
+            } else if (hdr.cmd == CMD_DISCONNECT) {
+                handle_recv_disconnect();
+                np.stream_session = false;
+                break;
+            }
+        }
+    } else if (local_input != np.stream_sent_input) {
+        InputPacket pkt = { .input = htons(local_input) };
+        if (send_packet(CMD_INPUT, np.self_frame, &pkt, sizeof(pkt))) {
+            np.stream_sent_input = local_input;
+        }
+    }
+
+    return 1;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Main Loop Update
 //////////////////////////////////////////////////////////////////////////////
@@ -977,6 +1662,11 @@ int Netplay_update(uint16_t local_input,
                    Netplay_SerializeSizeFn serialize_size_fn,
                    Netplay_SerializeFn serialize_fn,
                    Netplay_UnserializeFn unserialize_fn) {
+    // Stream mode replaces state sync and lockstep entirely
+    if (stream_core && (Netplay_needsStateSync() || np.stream_session)) {
+        return stream_update(local_input);
+    }
+
     // Handle state sync when connection is established
     if (Netplay_needsStateSync()) {
         if (!serialize_size_fn || !serialize_fn || !unserialize_fn) {
@@ -998,7 +1688,11 @@ int Netplay_update(uint16_t local_input,
                         }
                     }
                 } else {
-                    // Client receives state from host
+                    // Client receives state from host. Seed the buffer with our own
+                    // state so chunks we already hold don't need to be transferred.
+                    if (!serialize_fn(state_data, state_size)) {
+                        memset(state_data, 0, state_size);
+                    }
                     if (Netplay_receiveState(state_data, state_size) == 0) {
                         if (unserialize_fn(state_data, state_size)) {
                             sync_success = true;
@@ -1081,8 +1775,8 @@ static void handle_recv_disconnect(void) {
         np.needs_state_sync = true;
         np.stall_frames = 0;
         snprintf(np.status_msg, sizeof(np.status_msg), "Client left, waiting on %s:%d", np.local_ip, np.port);
+        Netplay_restartBroadcast();
         pthread_mutex_unlock(&np.mutex);
-        Netplay_restartBroadcast();  // Can be called without mutex
     } else {
         np.state = NETPLAY_STATE_DISCONNECTED;
         snprintf(np.status_msg, sizeof(np.status_msg), "Remote disconnected");
@@ -1106,7 +1800,7 @@ static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int ti
         return false;  // Timeout or error
     }
 
-    ssize_t ret = recv(np.tcp_fd, hdr, sizeof(*hdr), 0);
+    ssize_t ret = recv(np.tcp_fd, hdr, sizeof(*hdr), MSG_WAITALL);
     if (ret == 0) {
         // Connection closed by remote end
         handle_recv_disconnect();
@@ -1129,7 +1823,8 @@ static bool recv_packet(PacketHeader* hdr, void* data, uint16_t max_size, int ti
     }
 
     if (hdr->size > 0 && data && hdr->size <= max_size) {
-        ret = recv(np.tcp_fd, data, hdr->size, 0);
+        // MSG_WAITALL: 4KB state chunks are often split across TCP segments
+        ret = recv(np.tcp_fd, data, hdr->size, MSG_WAITALL);
         if (ret == 0) {
             handle_recv_disconnect();
             return false;
@@ -15,7 +15,7 @@
 #define NETPLAY_DEFAULT_PORT 55435
 #define NETPLAY_DISCOVERY_PORT 55436
 #define NETPLAY_MAGIC "NXNP"
-#define NETPLAY_PROTOCOL_VERSION 2
+#define NETPLAY_PROTOCOL_VERSION 4
 #define NETPLAY_MAX_GAME_NAME 64
 #define NETPLAY_MAX_HOSTS 8
 
@@ -63,16 +63,26 @@ typedef struct {
     char host_ip[16];
     uint16_t port;
     uint32_t game_crc;
+    char link_mode[32];  // Unused by netplay - keeps the NET_HostInfo layout
+    uint32_t rtt_ms;     // Median probe round trip (discovery round trip until probed), 0 if not measured
+    uint8_t loss_pct;    // Probes lost, valid once probed
+    bool probed;
 } NetplayHostInfo;
 
 // Initialize/cleanup
 void Netplay_init(void);
 void Netplay_quit(void);
 
-// Check if a core supports netplay (frame-sync)
+// Check if a core supports netplay
 // core_name is derived from the .so filename (e.g., "fbneo" from "fbneo_libretro.so")
-// Returns true if supported
+// Returns true for the tested deterministic (frame-sync) cores
 bool Netplay_checkCoreSupport(const char* core_name);
+// Returns true for cores that can only play in stream mode
+bool Netplay_isStreamCore(const char* core_name);
+// Picks frame-sync or stream mode for the loaded core (call from Core_load)
+void Netplay_setCore(const char* core_name);
+// True when the loaded core plays netplay in stream mode
+bool Netplay_isStreamMode(void);
 
 // Connection management
 // If hotspot_ip is NULL, uses WiFi mode. Otherwise, uses hotspot mode with given IP.
@@ -124,6 +134,8 @@ bool Netplay_shouldStall(void);
 bool Netplay_shouldSilenceAudio(void);
 
 // State synchronization
+// Only chunks the client can't find in its own state or the snapshot cache are
+// transferred. For receiveState, data may be pre-filled with the local state.
 int Netplay_sendState(const void* data, size_t size);
 int Netplay_receiveState(void* data, size_t size);
 bool Netplay_needsStateSync(void);
@@ -147,4 +159,15 @@ int Netplay_update(uint16_t local_input,
                    Netplay_SerializeFn serialize_fn,
                    Netplay_UnserializeFn unserialize_fn);
 
+// Stream mode - host runs the core alone, client presents its video/audio
+// Host: forward core output (call from the video/audio callbacks, no-op otherwise)
+void Netplay_streamVideo(const void* data, unsigned width, unsigned height, size_t pitch, unsigned bpp);
+void Netplay_streamAudio(const int16_t* data, size_t frames);
+
+// Client: call instead of running the core while Netplay_isStreamClient()
+typedef void (*Netplay_VideoFn)(const void* data, unsigned width, unsigned height, size_t pitch);
+typedef size_t (*Netplay_AudioFn)(const int16_t* data, size_t frames);
+bool Netplay_isStreamClient(void);
+void Netplay_presentStream(Netplay_VideoFn video_fn, Netplay_AudioFn audio_fn);
+
 #endif /* NETPLAY_H */
@@ -33,6 +33,9 @@
 static struct { SDL_Surface* bitmap; } _menu_accessor;
 #define menu (_menu_accessor.bitmap = minarch_getMenuBitmap(), _menu_accessor)
 
+// Join screen discovery poll interval
+#define DISCOVERY_POLL_MS 100
+
 // String utility functions (defined in utils.c)
 extern int exactMatch(char* str1, char* str2);
 extern int containsString(char* haystack, char* needle);
@@ -362,27 +365,23 @@ static bool showWiFiNetworkSelection(void) {
         }
     }
 
-    // Network list - continuously updated
+    // Network list - rendered from the background scan cache, so a list seen
+    // while the Netplay menu was open shows up on the first frame
     WIFI_direct_network_t networks[16];
     int count = 0;
     int selected = 0;
     int dirty = 1;
     bool first_selection_done = false;
-
-    // Scan timing - separate trigger from reading to avoid blocking UI
-    uint32_t last_scan_trigger_time = 0;
-    uint32_t scan_trigger_interval_ms = 4000;  // Trigger new scan every 4 seconds
-    uint32_t scan_read_delay_ms = 1500;        // Wait 1.5s after trigger before reading
-    bool scan_pending = false;
+    bool first_render_logged = false;
+    uint32_t cache_generation = 0;
+    bool cache_read = false;
 
     // Overall timeout to prevent hanging
     uint32_t start_time = SDL_GetTicks();
     uint32_t max_duration_ms = 120000;  // 120 seconds (2 minutes) max on this screen
 
-    // Trigger initial scan immediately (non-blocking)
-    WIFI_direct_triggerScan();
-    last_scan_trigger_time = SDL_GetTicks();
-    scan_pending = true;
+    // No-op if the Netplay menu already started it
+    WIFI_direct_startScanCache();
 
     while (1) {
         uint32_t now = SDL_GetTicks();
@@ -394,56 +393,62 @@ static bool showWiFiNetworkSelection(void) {
             return false;
         }
 
-        // Read scan results after delay (non-blocking read of cached results)
-        if (scan_pending && (now - last_scan_trigger_time >= scan_read_delay_ms)) {
-            scan_pending = false;
+        // Merge cache updates (the scanner refreshes every few seconds)
+        uint32_t generation = WIFI_direct_getScanCacheGeneration();
+        if (!cache_read || generation != cache_generation) {
+            cache_read = true;
+            cache_generation = generation;
 
-            int new_count = WIFI_direct_scanNetworks(networks, 16);
+            // Keep the cursor on the same network as rows move around
+            char selected_ssid[WIFI_DIRECT_SSID_MAX] = {0};
+            if (count > 0) {
+                strncpy(selected_ssid, networks[selected].ssid, sizeof(selected_ssid) - 1);
+            }
 
-            if (new_count != count || new_count > 0) {
-                count = new_count;
-                dirty = 1;
+            count = WIFI_direct_getCachedNetworks(networks, 16);
+            dirty = 1;
 
-                // Auto-select best network on first successful scan
-                if (count > 0 && !first_selection_done) {
-                    first_selection_done = true;
+            if (selected_ssid[0]) {
+                for (int i = 0; i < count; i++) {
+                    if (strcmp(networks[i].ssid, selected_ssid) == 0) {
+                        selected = i;
+                        break;
+                    }
+                }
+            }
 
-                    // Find the best network to pre-select
-                    int preselect_idx = -1;
-                    int best_saved_idx = -1;
-                    int best_rssi = -999;
+            // Auto-select best network on first non-empty list
+            if (count > 0 && !first_selection_done) {
+                first_selection_done = true;
 
-                    for (int i = 0; i < count; i++) {
-                        if (connected_ssid && strcmp(networks[i].ssid, connected_ssid) == 0) {
-                            preselect_idx = i;
-                        }
-                        if (networks[i].has_saved_creds && networks[i].rssi > best_rssi) {
-                            best_rssi = networks[i].rssi;
-                            best_saved_idx = i;
-                        }
-                    }
+                // Find the best network to pre-select
+                int preselect_idx = -1;
+                int best_saved_idx = -1;
+                int best_rssi = -999;
 
-                    if (preselect_idx >= 0) {
-                        selected = preselect_idx;
-                    } else if (best_saved_idx >= 0) {
-                        selected = best_saved_idx;
-                    } else {
-                        selected = 0;
+                for (int i = 0; i < count; i++) {
+                    if (connected_ssid && strcmp(networks[i].ssid, connected_ssid) == 0) {
+                        preselect_idx = i;
+                    }
+                    if (networks[i].has_saved_creds && networks[i].rssi > best_rssi) {
+                        best_rssi = networks[i].rssi;
+                        best_saved_idx = i;
                     }
                 }
 
-                // Keep selection in bounds
-                if (selected >= count && count > 0) {
-                    selected = count - 1;
+                if (preselect_idx >= 0) {
+                    selected = preselect_idx;
+                } else if (best_saved_idx >= 0) {
+                    selected = best_saved_idx;
+                } else {
+                    selected = 0;
                 }
             }
-        }
 
-        // Trigger periodic rescan (non-blocking)
-        if (!scan_pending && (now - last_scan_trigger_time >= scan_trigger_interval_ms)) {
-            WIFI_direct_triggerScan();
-            last_scan_trigger_time = now;
-            scan_pending = true;
+            // Keep selection in bounds
+            if (selected >= count && count > 0) {
+                selected = count - 1;
+            }
         }
 
         GFX_startFrame();
@@ -541,10 +546,9 @@ static bool showWiFiNetworkSelection(void) {
                                      (char*[]){ "A","OKAY", NULL });
                     }
                     dirty = 1;
-                    // Force rescan
+                    // Force rescan (the failed connect stopped the scanner)
+                    WIFI_direct_startScanCache();
                     WIFI_direct_triggerScan();
-                    last_scan_trigger_time = SDL_GetTicks();
-                    scan_pending = true;
                 } else {
                     // Need password - launch keyboard
                     char* password = launchKeyboard();
@@ -582,10 +586,9 @@ static bool showWiFiNetworkSelection(void) {
                         }
                     }
                     dirty = 1;
-                    // Force rescan
+                    // Force rescan (the failed connect stopped the scanner)
+                    WIFI_direct_startScanCache();
                     WIFI_direct_triggerScan();
-                    last_scan_trigger_time = SDL_GetTicks();
-                    scan_pending = true;
                 }
             }
         }
@@ -595,6 +598,12 @@ static bool showWiFiNetworkSelection(void) {
         if (dirty) {
             renderWiFiNetworkList(networks, count, selected, connected_ssid);
             dirty = 0;
+
+            if (count > 0 && !first_render_logged) {
+                first_render_logged = true;
+                LOG_info("WiFi list: first render %ums after open, %d network(s)\n",
+                         SDL_GetTicks() - start_time, count);
+            }
         }
 
         minarch_hdmimon();
@@ -657,7 +666,16 @@ bool ensureNetworkConnected(LinkType type, const char* action) {
     // Always show WiFi selection so user can confirm or change network
     // If already connected, that network will be pre-selected
     // User can either confirm current connection or switch to another
-    if (!showWiFiNetworkSelection()) {
+#ifdef HAS_WIFIMG
+    uint32_t scans_before = WIFI_direct_getScanCount();
+#endif
+    bool selected = showWiFiNetworkSelection();
+#ifdef HAS_WIFIMG
+    LOG_info("WiFi join: %u scan(s) while selecting\n", WIFI_direct_getScanCount() - scans_before);
+    // Stop scanning once a network is picked, scans would disturb the session setup
+    if (selected) WIFI_direct_stopScanCache();
+#endif
+    if (!selected) {
         return false;  // User cancelled
     }
 
@@ -887,6 +905,35 @@ const char* getHostIP(LinkType type, int index) {
     return "";
 }
 
+void getHostQuality(LinkType type, int index, char* buf, size_t size) {
+    uint32_t rtt_ms = 0;
+    int loss_pct = 0;
+    bool probed = false;
+    switch (type) {
+        case LINK_TYPE_NETPLAY:
+            rtt_ms = netplay_hosts[index].rtt_ms;
+            loss_pct = netplay_hosts[index].loss_pct;
+            probed = netplay_hosts[index].probed;
+            break;
+        case LINK_TYPE_GBALINK:
+            rtt_ms = gbalink_hosts[index].rtt_ms;
+            loss_pct = gbalink_hosts[index].loss_pct;
+            probed = gbalink_hosts[index].probed;
+            break;
+        case LINK_TYPE_GBLINK:
+            rtt_ms = gblink_hosts[index].rtt_ms;
+            loss_pct = gblink_hosts[index].loss_pct;
+            probed = gblink_hosts[index].probed;
+            break;
+    }
+
+    if (probed && loss_pct >= 100) snprintf(buf, size, "no reply");
+    else if (probed && loss_pct > 0) snprintf(buf, size, "%ums, %d%% loss", rtt_ms, loss_pct);
+    else if (probed) snprintf(buf, size, "%ums", rtt_ms);
+    else if (rtt_ms) snprintf(buf, size, "~%ums", rtt_ms);  // Discovery reply only, still probing
+    else if (size) buf[0] = '\0';
+}
+
 int getHostPort(LinkType type, int index) {
     switch (type) {
         case LINK_TYPE_NETPLAY: return netplay_hosts[index].port;
@@ -945,7 +992,7 @@ int Multiplayer_isActive(void) {
 CoreLinkSupport checkCoreLinkSupport(const char* core_name) {
     CoreLinkSupport support = {false, false, false};
 
-    if (Netplay_checkCoreSupport(core_name)) {
+    if (Netplay_checkCoreSupport(core_name) || Netplay_isStreamCore(core_name)) {
         support.show_netplay = true;
     }
     if (GBALink_checkCoreSupport(core_name)) {
@@ -989,6 +1036,31 @@ void showConnectingScreen(const char* host_ip) {
     GFX_setMode(MODE_MENU);
 }
 
+// "Game Name (IP) - quality", as shown in the host list
+static void formatHostLabel(LinkType type, int index, char* buf, size_t size) {
+    char quality[32];
+    getHostQuality(type, index, quality, sizeof(quality));
+    if (quality[0]) {
+        snprintf(buf, size, "%s (%s) - %s", getHostGameName(type, index), getHostIP(type, index), quality);
+    } else {
+        snprintf(buf, size, "%s (%s)", getHostGameName(type, index), getHostIP(type, index));
+    }
+}
+
+// Changes whenever the rendered host list would (FNV-1a over the labels)
+static uint32_t hostListSignature(LinkType type) {
+    uint32_t hash = 2166136261u;
+    for (int j = 0; j < getHostCount(type); j++) {
+        char label[128];
+        formatHostLabel(type, j, label, sizeof(label));
+        for (const char* c = label; ; c++) {
+            hash = (hash ^ (uint8_t)*c) * 16777619u;
+            if (!*c) break;
+        }
+    }
+    return hash;
+}
+
 void renderHostSelectionList(LinkType type, int selected, int host_count) {
     GFX_clear(screen);
     GFX_drawOnLayer(menu.bitmap, 0, 0, DEVICE_WIDTH, DEVICE_HEIGHT, 0.15f, 1, 0);
@@ -1007,10 +1079,9 @@ void renderHostSelectionList(LinkType type, int selected, int host_count) {
     // Host list with pills
     int list_start_y = title_y + SCALE1(40);
     for (int j = 0; j < host_count; j++) {
-        // Format: "Game Name (IP)"
+        // Format: "Game Name (IP) - 12ms", best link first
         char host_label[128];
-        snprintf(host_label, sizeof(host_label), "%s (%s)",
-                 getHostGameName(type, j), getHostIP(type, j));
+        formatHostLabel(type, j, host_label, sizeof(host_label));
 
         SDL_Color text_color = COLOR_WHITE;
         if (j == selected) {
@@ -1967,9 +2038,10 @@ int joinGameWiFi_common(LinkType type) {
             break;
         }
 
-        // Poll for hosts periodically (every 500ms)
+        // Poll for hosts periodically - hosts answer our discovery query
+        // within a round trip, so a short interval lists them right away
         uint32_t now = SDL_GetTicks();
-        if (now - last_poll >= 500) {
+        if (now - last_poll >= DISCOVERY_POLL_MS) {
             last_poll = now;
             int new_count = 0;
             switch (type) {
@@ -2016,6 +2088,7 @@ int joinGameWiFi_common(LinkType type) {
 
     // Show host selection with pills (continue polling for new hosts)
     int selected = 0;
+    uint32_t list_signature = hostListSignature(type);
     dirty = 1;
     last_poll = SDL_GetTicks();
 
@@ -2043,24 +2116,41 @@ int joinGameWiFi_common(LinkType type) {
             if (selected >= getHostCount(type)) selected = 0;
             dirty = 1;
         }
-        else if (PAD_justPressed(BTN_A)) {
+        else if (PAD_justPressed(BTN_A) && getHostCount(type) > 0) {
             // Host selected - proceed to connect
             break;
         }
 
-        // Continue polling for new hosts in the background
+        // Continue polling in the background - hosts that stop answering drop off
         uint32_t now = SDL_GetTicks();
-        if (now - last_poll >= 500) {
+        if (now - last_poll >= DISCOVERY_POLL_MS) {
             last_poll = now;
+
+            // Hosts re-sort as probe results come in - keep the cursor on the same host
+            char selected_ip[16] = "";
+            if (selected < getHostCount(type)) {
+                strncpy(selected_ip, getHostIP(type, selected), sizeof(selected_ip) - 1);
+            }
+
             int new_count = 0;
             switch (type) {
                 case LINK_TYPE_NETPLAY: new_count = Netplay_getDiscoveredHosts(netplay_hosts, NETPLAY_MAX_HOSTS); break;
                 case LINK_TYPE_GBALINK: new_count = GBALink_getDiscoveredHosts(gbalink_hosts, GBALINK_MAX_HOSTS); break;
                 case LINK_TYPE_GBLINK:  new_count = GBLink_getDiscoveredHosts(gblink_hosts, GBLINK_MAX_HOSTS); break;
             }
-            if (new_count != getHostCount(type)) {
-                setHostCount(type, new_count);
-                if (selected >= getHostCount(type)) selected = getHostCount(type) - 1;
+            setHostCount(type, new_count);
+            for (int j = 0; j < new_count; j++) {
+                if (strcmp(getHostIP(type, j), selected_ip) == 0) {
+                    selected = j;
+                    break;
+                }
+            }
+            if (selected >= getHostCount(type)) selected = getHostCount(type) - 1;
+            if (selected < 0) selected = 0;
+
+            uint32_t signature = hostListSignature(type);
+            if (signature != list_signature) {
+                list_signature = signature;
                 dirty = 1;
             }
         }
@@ -2092,11 +2182,10 @@ int joinGameWiFi_common(LinkType type) {
         if (host_mode && host_mode[0] && (!client_mode || strcmp(client_mode, host_mode) != 0)) {
             if (showLinkModeRestartDialog(getGBALinkModeName(host_mode), false)) {
                 // User confirmed - apply mode, save config, reload (no TCP connection was made)
+                // then carry on and join the selected host in the new mode
                 minarch_setCoreOptionValue("gpsp_serial", host_mode);
                 minarch_saveConfig();
-                minarch_reloadGame();  // Deferred to avoid segfault
-                gbalink_force_resume = 1;
-                return MENU_CALLBACK_EXIT;
+                minarch_reloadGame();
             } else {
                 // User cancelled - return without connecting
                 return MENU_CALLBACK_NOP;
@@ -2128,14 +2217,16 @@ int joinGameWiFi_common(LinkType type) {
         const char* host_mode = GBALink_getPendingLinkMode();
 
         if (showLinkModeRestartDialog(getGBALinkModeName(host_mode), false)) {
-            // User confirmed - apply mode, save config, disconnect, reload, return to game
+            // User confirmed - apply mode, save config, reload, then start the session
+            // on the connection that stayed open through the reload
             GBALink_applyPendingLinkMode();
             minarch_saveConfig();
-            GBALink_disconnect();
-            minarch_reloadGame();  // Deferred to avoid segfault
-            // Set force_resume to close all menus
-            gbalink_force_resume = 1;
-            return MENU_CALLBACK_EXIT;
+            minarch_reloadGame();
+            if (GBALink_finishPendingJoin() != GBALINK_CONNECT_OK) {
+                minarch_menuMessage("Connection lost during reload.", (char*[]){ "A","OKAY", NULL });
+                gbalink_force_resume = 1;
+                return MENU_CALLBACK_EXIT;
+            }
         } else {
             // User cancelled - clear state and disconnect
             GBALink_clearPendingReload();
@@ -2204,8 +2295,13 @@ int joinGame_Hotspot_common(LinkType type) {
     char hotspots[8][33];
     memset(hotspots, 0, sizeof(hotspots));  // Zero-initialize to prevent garbage
 
-    // Use wifi_direct for more reliable scanning (bypasses wifi_daemon)
+    // Answered from the scan cache when the Netplay menu's scanner already saw
+    // a host, otherwise scans until one shows up
+    uint32_t scan_start = SDL_GetTicks();
+    uint32_t scans_before = WIFI_direct_getScanCount();
     int hotspot_count = WIFI_direct_scanForHotspots(LINK_HOTSPOT_SSID_PREFIX, hotspots, 8);
+    LOG_info("Hotspot join: %d host(s) in %ums, %u scan(s)\n", hotspot_count,
+             SDL_GetTicks() - scan_start, WIFI_direct_getScanCount() - scans_before);
 
     if (hotspot_count == 0) {
         char no_host_msg[128];
@@ -2371,14 +2467,11 @@ int joinGame_Hotspot_common(LinkType type) {
             // Check if modes differ
             if (!client_mode || strcmp(client_mode, host_mode) != 0) {
                 if (showLinkModeRestartDialog(getGBALinkModeName(host_mode), false)) {
-                    // User confirmed - apply mode, save config, disconnect from hotspot, reload
+                    // User confirmed - apply mode, save config, reload, then stay on the
+                    // hotspot and join in the new mode (no TCP connection was made yet)
                     minarch_setCoreOptionValue("gpsp_serial", host_mode);
                     minarch_saveConfig();
-                    WIFI_direct_restorePreviousConnection();
-                    *connected_to_hotspot_flag = 0;
-                    minarch_reloadGame();  // Deferred to avoid segfault
-                    gbalink_force_resume = 1;
-                    return MENU_CALLBACK_EXIT;
+                    minarch_reloadGame();
                 } else {
                     // User cancelled - disconnect from hotspot
                     WIFI_direct_restorePreviousConnection();
@@ -2468,14 +2561,18 @@ int joinGame_Hotspot_common(LinkType type) {
         const char* host_mode = GBALink_getPendingLinkMode();
 
         if (showLinkModeRestartDialog(getGBALinkModeName(host_mode), false)) {
-            // User confirmed - apply mode, save config, disconnect, reload, return to game
+            // User confirmed - apply mode, save config, reload, then start the session
+            // on the connection that stayed open through the reload
             GBALink_applyPendingLinkMode();
             minarch_saveConfig();
-            GBALink_disconnect();
-            minarch_reloadGame();  // Deferred to avoid segfault
-            // Set force_resume to close all menus
-            gbalink_force_resume = 1;
-            return MENU_CALLBACK_EXIT;
+            minarch_reloadGame();
+            if (GBALink_finishPendingJoin() != GBALINK_CONNECT_OK) {
+                minarch_menuMessage("Connection lost during reload.", (char*[]){ "A","OKAY", NULL });
+                WIFI_direct_restorePreviousConnection();
+                *connected_to_hotspot_flag = 0;
+                gbalink_force_resume = 1;
+                return MENU_CALLBACK_EXIT;
+            }
         } else {
             // User cancelled - clear state and disconnect
             GBALink_clearPendingReload();
@@ -2749,6 +2846,19 @@ int OptionGBALink_status(void* list, int i) {
     return status_common(LINK_TYPE_GBALINK);
 }
 
+int OptionGBALink_toggleFrameLock(void* list, int i) {
+    (void)list; (void)i;
+    GBALink_setFrameLock(!GBALink_getFrameLock());
+    return MENU_CALLBACK_NOP;
+}
+
+int OptionGBALink_toggleTransport(void* list, int i) {
+    (void)list; (void)i;
+    GBALink_setTransport(GBALink_getTransport() == GBALINK_TRANSPORT_UDP ? GBALINK_TRANSPORT_TCP
+                                                                         : GBALINK_TRANSPORT_UDP);
+    return MENU_CALLBACK_NOP;
+}
+
 int OptionGBLink_hostGame(void* list, int i) {
     return hostGame_common(LINK_TYPE_GBLINK, list, i);
 }
@@ -2806,22 +2916,60 @@ static NetplayLinkCallbacks getNetplayLinkCallbacks(LinkType type) {
     return (NetplayLinkCallbacks){NULL, NULL, NULL, NULL};
 }
 
-int Netplay_menu_link(LinkType type) {
-    int* force_resume = getForceResumeFlag(type);
-    *force_resume = 0;
+// Link cores that also stream (gpSP, Gambatte): Host/Join start a stream
+// netplay session instead of a link cable one
+static bool link_menu_stream = false;
+
+static int OptionLink_toggleStream(void* list, int i) {
+    (void)list; (void)i;
+    link_menu_stream = !link_menu_stream;
+    return MENU_CALLBACK_NOP;
+}
+
+int Netplay_menu_link(LinkType link_type) {
+    // A session already running decides the mode the menu opens in
+    bool can_stream = link_type != LINK_TYPE_NETPLAY && Netplay_isStreamMode();
+    if (!can_stream || isLinkConnected(link_type)) {
+        link_menu_stream = false;
+    } else if (isLinkConnected(LINK_TYPE_NETPLAY)) {
+        link_menu_stream = true;
+    }
+    *getForceResumeFlag(link_type) = 0;
+    *getForceResumeFlag(LINK_TYPE_NETPLAY) = 0;
 
-    NetplayLinkCallbacks callbacks = getNetplayLinkCallbacks(type);
-    const char* (*getHint)(void) = getLinkMenuHint(type);
+    LinkType type = link_type;
+    int* force_resume = getForceResumeFlag(type);
 
     int dirty = 1;
     int show_menu = 1;
     int selected = 0;
+    int refresh_scan_cache = 1;
 
     while (show_menu) {
+        type = link_menu_stream ? LINK_TYPE_NETPLAY : link_type;
+        force_resume = getForceResumeFlag(type);
+        NetplayLinkCallbacks callbacks = getNetplayLinkCallbacks(type);
+        const char* (*getHint)(void) = getLinkMenuHint(type);
         int is_connected = isLinkConnected(type);
 
-        char* items[5];
-        NetplayMenuCallback item_callbacks[5];
+#ifdef HAS_WIFIMG
+        // Keep a warm scan cache for the join screens while not in a session of
+        // any link type (a host waiting for its client counts, scans would take
+        // its radio off-channel). Re-checked after every action, which may have
+        // started or ended one.
+        if (refresh_scan_cache) {
+            refresh_scan_cache = 0;
+            if (isLinkConnected(LINK_TYPE_NETPLAY) || isLinkConnected(LINK_TYPE_GBALINK) ||
+                isLinkConnected(LINK_TYPE_GBLINK)) {
+                WIFI_direct_stopScanCache();
+            } else {
+                WIFI_direct_startScanCache();
+            }
+        }
+#endif
+
+        char* items[6];
+        NetplayMenuCallback item_callbacks[6];
         int item_count = 0;
 
         if (!is_connected) {
@@ -2831,6 +2979,21 @@ int Netplay_menu_link(LinkType type) {
             items[item_count] = "Join Game";
             item_callbacks[item_count] = callbacks.join;
             item_count++;
+            if (can_stream) {
+                items[item_count] = link_menu_stream ? "Mode: Stream" : "Mode: Link Cable";
+                item_callbacks[item_count] = OptionLink_toggleStream;
+                item_count++;
+            }
+            if (type == LINK_TYPE_GBALINK) {
+                // Applies to the next hosted session; clients follow the host
+                items[item_count] = GBALink_getFrameLock() ? "Frame Lock: On" : "Frame Lock: Off";
+                item_callbacks[item_count] = OptionGBALink_toggleFrameLock;
+                item_count++;
+                items[item_count] = GBALink_getTransport() == GBALINK_TRANSPORT_UDP ? "Transport: UDP"
+                                                                                     : "Transport: TCP";
+                item_callbacks[item_count] = OptionGBALink_toggleTransport;
+                item_count++;
+            }
         } else {
             items[item_count] = "Disconnect";
             item_callbacks[item_count] = callbacks.disconnect;
@@ -2859,10 +3022,16 @@ int Netplay_menu_link(LinkType type) {
             show_menu = 0;
         }
         else if (PAD_justPressed(BTN_A)) {
+#ifdef HAS_WIFIMG
+            // Nothing scans behind an action except the WiFi list, which restarts
+            // the scanner itself. Cached results stay readable for hotspot joins.
+            WIFI_direct_stopScanCache();
+#endif
             int result = item_callbacks[selected](NULL, selected);
             if (result == MENU_CALLBACK_EXIT || *force_resume) {
                 show_menu = 0;
             }
+            refresh_scan_cache = 1;
             dirty = 1;
         }
 
@@ -2880,6 +3049,9 @@ int Netplay_menu_link(LinkType type) {
         minarch_hdmimon();
     }
 
+#ifdef HAS_WIFIMG
+    WIFI_direct_stopScanCache();
+#endif
     return *force_resume;
 }
 
@@ -104,6 +104,8 @@ int Menu_selectConnectionMode(const char* title);
 
 const char* getHostGameName(LinkType type, int index);
 const char* getHostIP(LinkType type, int index);
+// Link quality for the host list: "12ms", "12ms, 20% loss", "" if unknown
+void getHostQuality(LinkType type, int index, char* buf, size_t size);
 int getHostPort(LinkType type, int index);
 int getHostCount(LinkType type);
 void setHostCount(LinkType type, int count);
@@ -292,6 +294,8 @@ int OptionGBALink_hostGame(void* list, int i);
 int OptionGBALink_joinGame(void* list, int i);
 int OptionGBALink_disconnect(void* list, int i);
 int OptionGBALink_status(void* list, int i);
+int OptionGBALink_toggleFrameLock(void* list, int i);
+int OptionGBALink_toggleTransport(void* list, int i);
 
 int OptionGBLink_hostGame(void* list, int i);
 int OptionGBLink_joinGame(void* list, int i);
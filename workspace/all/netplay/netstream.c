@@ -0,0 +1,233 @@
+/*
+ * NextUI Netplay Stream Codec
+ * Tile-delta + LZ4 video codec for stream-mode netplay
+ */
+
+#include "netstream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <lz4.h>
+
+// LZ4 acceleration - favour speed, the tile delta already removes most redundancy
+#define NETSTREAM_LZ4_ACCELERATION 2
+
+//////////////////////////////////////////////////////////////////////////////
+// Helpers
+//////////////////////////////////////////////////////////////////////////////
+
+static unsigned tiles_across(unsigned width) {
+    return (width + NETSTREAM_TILE_SIZE - 1) / NETSTREAM_TILE_SIZE;
+}
+
+static unsigned tiles_down(unsigned height) {
+    return (height + NETSTREAM_TILE_SIZE - 1) / NETSTREAM_TILE_SIZE;
+}
+
+static bool ensure_capacity(uint8_t** buf, size_t* cap, size_t needed) {
+    if (*cap >= needed) return true;
+    uint8_t* grown = realloc(*buf, needed);
+    if (!grown) return false;
+    *buf = grown;
+    *cap = needed;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Encoder
+//////////////////////////////////////////////////////////////////////////////
+
+void Netstream_resetEncoder(NetstreamEncoder* enc) {
+    enc->force_keyframe = true;
+    enc->out_size = 0;
+}
+
+void Netstream_freeEncoder(NetstreamEncoder* enc) {
+    free(enc->prev);
+    free(enc->raw);
+    free(enc->out);
+    memset(enc, 0, sizeof(*enc));
+}
+
+int Netstream_encode(NetstreamEncoder* enc, const void* data,
+                     unsigned width, unsigned height, size_t pitch, unsigned bpp) {
+    if (!data || width == 0 || height == 0 || width > 0xFFFF || height > 0xFFFF) {
+        return NETSTREAM_ERROR;
+    }
+
+    unsigned tx_count = tiles_across(width);
+    unsigned ty_count = tiles_down(height);
+    unsigned tile_count = tx_count * ty_count;
+    if (tile_count > 0xFFFF) return NETSTREAM_ERROR;
+
+    size_t stride = (size_t)width * bpp;
+    size_t frame_size = stride * height;
+    size_t index_size = tile_count * sizeof(uint16_t);
+
+    // Geometry change invalidates the reference
+    bool keyframe = enc->force_keyframe || !enc->prev ||
+                    enc->width != width || enc->height != height || enc->bpp != bpp;
+    if (keyframe) {
+        uint8_t* prev = realloc(enc->prev, frame_size);
+        if (!prev) return NETSTREAM_ERROR;
+        enc->prev = prev;
+        enc->width = width;
+        enc->height = height;
+        enc->bpp = bpp;
+    }
+
+    if (!ensure_capacity(&enc->raw, &enc->raw_cap, index_size + frame_size)) {
+        return NETSTREAM_ERROR;
+    }
+
+    // Pixels are written after the worst-case index table, then moved down
+    const uint8_t* src = (const uint8_t*)data;
+    uint16_t* indices = (uint16_t*)enc->raw;
+    uint8_t* pixels = enc->raw + index_size;
+    size_t pixel_bytes = 0;
+    unsigned dirty = 0;
+
+    for (unsigned ty = 0; ty < ty_count; ty++) {
+        unsigned y0 = ty * NETSTREAM_TILE_SIZE;
+        unsigned th = (height - y0 < NETSTREAM_TILE_SIZE) ? height - y0 : NETSTREAM_TILE_SIZE;
+
+        for (unsigned tx = 0; tx < tx_count; tx++) {
+            unsigned x0 = tx * NETSTREAM_TILE_SIZE;
+            unsigned tw = (width - x0 < NETSTREAM_TILE_SIZE) ? width - x0 : NETSTREAM_TILE_SIZE;
+            size_t row_bytes = (size_t)tw * bpp;
+            size_t x_offset = (size_t)x0 * bpp;
+
+            bool changed = keyframe;
+            for (unsigned y = y0; !changed && y < y0 + th; y++) {
+                changed = memcmp(src + y * pitch + x_offset, enc->prev + y * stride + x_offset, row_bytes) != 0;
+            }
+            if (!changed) continue;
+
+            indices[dirty++] = htons((uint16_t)(ty * tx_count + tx));
+            for (unsigned y = y0; y < y0 + th; y++) {
+                const uint8_t* row = src + y * pitch + x_offset;
+                memcpy(pixels + pixel_bytes, row, row_bytes);
+                memcpy(enc->prev + y * stride + x_offset, row, row_bytes);
+                pixel_bytes += row_bytes;
+            }
+        }
+    }
+
+    enc->force_keyframe = false;
+    enc->out_size = 0;
+    if (dirty == 0) return NETSTREAM_UNCHANGED;
+
+    size_t dirty_index_size = dirty * sizeof(uint16_t);
+    memmove(enc->raw + dirty_index_size, pixels, pixel_bytes);
+    size_t raw_size = dirty_index_size + pixel_bytes;
+
+    size_t bound = sizeof(NetstreamFrameHeader) + LZ4_compressBound((int)raw_size);
+    if (!ensure_capacity(&enc->out, &enc->out_cap, bound)) {
+        enc->force_keyframe = true;  // Reference already advanced, resync next frame
+        return NETSTREAM_ERROR;
+    }
+
+    int compressed = LZ4_compress_fast((const char*)enc->raw,
+                                       (char*)enc->out + sizeof(NetstreamFrameHeader),
+                                       (int)raw_size,
+                                       (int)(enc->out_cap - sizeof(NetstreamFrameHeader)),
+                                       NETSTREAM_LZ4_ACCELERATION);
+    if (compressed <= 0) {
+        enc->force_keyframe = true;
+        return NETSTREAM_ERROR;
+    }
+
+    NetstreamFrameHeader hdr = {
+        .width = htons((uint16_t)width),
+        .height = htons((uint16_t)height),
+        .bpp = (uint8_t)bpp,
+        .keyframe = keyframe ? 1 : 0,
+        .dirty_tiles = htons((uint16_t)dirty),
+        .raw_size = htonl((uint32_t)raw_size)
+    };
+    memcpy(enc->out, &hdr, sizeof(hdr));
+    enc->out_size = sizeof(hdr) + (size_t)compressed;
+    return NETSTREAM_FRAME;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Decoder
+//////////////////////////////////////////////////////////////////////////////
+
+void Netstream_resetDecoder(NetstreamDecoder* dec) {
+    dec->width = 0;
+    dec->height = 0;
+    dec->bpp = 0;
+}
+
+void Netstream_freeDecoder(NetstreamDecoder* dec) {
+    free(dec->frame);
+    free(dec->raw);
+    memset(dec, 0, sizeof(*dec));
+}
+
+bool Netstream_decode(NetstreamDecoder* dec, const void* data, size_t size) {
+    if (!data || size < sizeof(NetstreamFrameHeader)) return false;
+
+    NetstreamFrameHeader hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    unsigned width = ntohs(hdr.width);
+    unsigned height = ntohs(hdr.height);
+    unsigned bpp = hdr.bpp;
+    unsigned dirty = ntohs(hdr.dirty_tiles);
+    size_t raw_size = ntohl(hdr.raw_size);
+
+    if (width == 0 || height == 0 || (bpp != 2 && bpp != 4)) return false;
+
+    size_t stride = (size_t)width * bpp;
+    size_t frame_size = stride * height;
+    unsigned tx_count = tiles_across(width);
+    unsigned tile_count = tx_count * tiles_down(height);
+
+    if (hdr.keyframe) {
+        if (dec->width != width || dec->height != height || dec->bpp != bpp || !dec->frame) {
+            uint8_t* frame = realloc(dec->frame, frame_size);
+            if (!frame) return false;
+            dec->frame = frame;
+            dec->width = width;
+            dec->height = height;
+            dec->bpp = bpp;
+        }
+    } else if (!dec->frame || dec->width != width || dec->height != height || dec->bpp != bpp) {
+        return false;  // Delta against a frame we don't have
+    }
+
+    if (dirty > tile_count || raw_size > tile_count * sizeof(uint16_t) + frame_size) return false;
+    if (dirty * sizeof(uint16_t) > raw_size) return false;  // Index table must fit the payload
+    if (!ensure_capacity(&dec->raw, &dec->raw_cap, raw_size)) return false;
+
+    int decompressed = LZ4_decompress_safe((const char*)data + sizeof(hdr), (char*)dec->raw,
+                                           (int)(size - sizeof(hdr)), (int)raw_size);
+    if (decompressed < 0 || (size_t)decompressed != raw_size) return false;
+
+    const uint8_t* indices = dec->raw;
+    const uint8_t* pixels = dec->raw + dirty * sizeof(uint16_t);
+    const uint8_t* end = dec->raw + raw_size;
+
+    for (unsigned i = 0; i < dirty; i++) {
+        uint16_t index;
+        memcpy(&index, indices + i * sizeof(uint16_t), sizeof(index));
+        index = ntohs(index);
+        if (index >= tile_count) return false;
+
+        unsigned x0 = (index % tx_count) * NETSTREAM_TILE_SIZE;
+        unsigned y0 = (index / tx_count) * NETSTREAM_TILE_SIZE;
+        unsigned tw = (width - x0 < NETSTREAM_TILE_SIZE) ? width - x0 : NETSTREAM_TILE_SIZE;
+        unsigned th = (height - y0 < NETSTREAM_TILE_SIZE) ? height - y0 : NETSTREAM_TILE_SIZE;
+        size_t row_bytes = (size_t)tw * bpp;
+
+        if (pixels + row_bytes * th > end) return false;
+        for (unsigned y = y0; y < y0 + th; y++) {
+            memcpy(dec->frame + y * stride + (size_t)x0 * bpp, pixels, row_bytes);
+            pixels += row_bytes;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * NextUI Netplay Stream Codec
+ * Tile-delta + LZ4 video codec for stream-mode netplay
+ *
+ * In stream mode only the host runs the core. Each video frame is split into
+ * fixed-size tiles, compared against the last frame sent to the client, and
+ * only the changed tiles are packed and LZ4-compressed. Static screens encode
+ * to nothing at all, so the cost scales with how much of the screen moves.
+ */
+
+#ifndef NETSTREAM_H
+#define NETSTREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Tile edge in pixels (16x16 keeps the dirty index small at 240p)
+#define NETSTREAM_TILE_SIZE 16
+
+// Return codes for Netstream_encode
+#define NETSTREAM_ERROR     -1   // Allocation failure or unsupported frame
+#define NETSTREAM_UNCHANGED  0   // Frame identical to the reference, nothing to send
+#define NETSTREAM_FRAME      1   // Encoded frame available in out/out_size
+
+// Encoded frame header (wire format, followed by an LZ4 block of the tile payload)
+typedef struct __attribute__((packed)) {
+    uint16_t width;
+    uint16_t height;
+    uint8_t  bpp;          // Bytes per pixel (2 = RGB565/0RGB1555, 4 = XRGB8888)
+    uint8_t  keyframe;     // All tiles present, decoder may (re)allocate
+    uint16_t dirty_tiles;  // Number of tile indices in the payload
+    uint32_t raw_size;     // Tile payload size before compression
+} NetstreamFrameHeader;
+
+typedef struct {
+    uint8_t* prev;         // Reference frame (what the client currently shows)
+    unsigned width;
+    unsigned height;
+    unsigned bpp;
+    bool force_keyframe;
+
+    uint8_t* raw;          // Scratch: dirty tile indices followed by tile pixels
+    size_t raw_cap;
+    uint8_t* out;          // Encoded frame (header + LZ4 block)
+    size_t out_cap;
+    size_t out_size;
+} NetstreamEncoder;
+
+typedef struct {
+    uint8_t* frame;        // Current frame, packed rows (pitch = width * bpp)
+    unsigned width;
+    unsigned height;
+    unsigned bpp;
+
+    uint8_t* raw;
+    size_t raw_cap;
+} NetstreamDecoder;
+
+// Encoder: call reset at the start of each session so the first frame is a keyframe
+void Netstream_resetEncoder(NetstreamEncoder* enc);
+void Netstream_freeEncoder(NetstreamEncoder* enc);
+int Netstream_encode(NetstreamEncoder* enc, const void* data,
+                     unsigned width, unsigned height, size_t pitch, unsigned bpp);
+
+// Decoder: applies an encoded frame on top of the current one
+void Netstream_resetDecoder(NetstreamDecoder* dec);
+void Netstream_freeDecoder(NetstreamDecoder* dec);
+bool Netstream_decode(NetstreamDecoder* dec, const void* data, size_t size);
+
+#endif /* NETSTREAM_H */
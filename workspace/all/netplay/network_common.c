@@ -10,11 +10,21 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
 
 // Default TCP configuration
 static const NET_TCPConfig DEFAULT_TCP_CONFIG = {
@@ -27,6 +37,10 @@ static const NET_TCPConfig DEFAULT_TCP_CONFIG = {
 static const char* SSID_CHARSET = "ABCDEFGHJKLMNPQRSTUVWXYZ23456789";
 static const int SSID_CHARSET_LEN = 32;
 
+// Persistent NETLINK_SOCK_DIAG socket for NET_countTCPSockets
+static int sock_diag_fd = -1;
+static uint32_t sock_diag_seq = 0;
+
 //////////////////////////////////////////////////////////////////////////////
 // IP Address Utilities
 //////////////////////////////////////////////////////////////////////////////
@@ -161,6 +175,11 @@ int NET_createDiscoveryListenSocket(uint16_t port) {
         return -1;
     }
 
+    // Clients broadcast discovery queries from this socket and time the
+    // replies by their arrival stamp
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &opt, sizeof(opt));
+
     // Set non-blocking
     int flags = fcntl(fd, F_GETFL, 0);
     fcntl(fd, F_SETFL, flags | O_NONBLOCK);
@@ -196,6 +215,7 @@ void NET_initBroadcastTimer(NET_BroadcastTimer* timer, int interval_us) {
     if (!timer) return;
     timer->last_broadcast.tv_sec = 0;
     timer->last_broadcast.tv_usec = 0;
+    gettimeofday(&timer->started, NULL);
     timer->interval_us = interval_us;
 }
 
@@ -209,34 +229,66 @@ bool NET_shouldBroadcast(NET_BroadcastTimer* timer) {
                       (now.tv_usec - timer->last_broadcast.tv_usec);
 
     if (elapsed_us >= timer->interval_us) {
-        timer->last_broadcast = now;
+        NET_markBroadcast(timer);
         return true;
     }
 
     return false;
 }
 
+int NET_markBroadcast(NET_BroadcastTimer* timer) {
+    if (!timer) return 0;
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    timer->last_broadcast = now;
+
+    // Past the fast period, double the interval up to the cap
+    long running_us = (now.tv_sec - timer->started.tv_sec) * 1000000 +
+                      (now.tv_usec - timer->started.tv_usec);
+    if (running_us >= NET_BROADCAST_FAST_PERIOD_US && timer->interval_us < NET_BROADCAST_MAX_INTERVAL_US) {
+        timer->interval_us *= 2;
+        if (timer->interval_us > NET_BROADCAST_MAX_INTERVAL_US) {
+            timer->interval_us = NET_BROADCAST_MAX_INTERVAL_US;
+        }
+    }
+    return timer->interval_us;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Discovery Utilities
 //////////////////////////////////////////////////////////////////////////////
 
+static uint32_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void fill_discovery_packet(NET_DiscoveryPacket* pkt, uint32_t magic, uint32_t protocol_version,
+                                  uint32_t game_crc, uint16_t tcp_port, const char* game_name,
+                                  const char* link_mode) {
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->magic = htonl(magic);
+    pkt->protocol_version = htonl(protocol_version);
+    pkt->game_crc = htonl(game_crc);
+    pkt->port = htons(tcp_port);
+    if (game_name) {
+        strncpy(pkt->game_name, game_name, NET_MAX_GAME_NAME - 1);
+    }
+    if (link_mode) {
+        strncpy(pkt->link_mode, link_mode, NET_MAX_LINK_MODE - 1);
+    }
+}
+
 void NET_sendDiscoveryBroadcast(int udp_fd, uint32_t magic, uint32_t protocol_version,
                                  uint32_t game_crc, uint16_t tcp_port,
                                  uint16_t discovery_port, const char* game_name,
                                  const char* link_mode) {
     if (udp_fd < 0) return;
 
-    NET_DiscoveryPacket pkt = {0};
-    pkt.magic = htonl(magic);
-    pkt.protocol_version = htonl(protocol_version);
-    pkt.game_crc = htonl(game_crc);
-    pkt.port = htons(tcp_port);
-    if (game_name) {
-        strncpy(pkt.game_name, game_name, NET_MAX_GAME_NAME - 1);
-    }
-    if (link_mode) {
-        strncpy(pkt.link_mode, link_mode, NET_MAX_LINK_MODE - 1);
-    }
+    NET_DiscoveryPacket pkt;
+    fill_discovery_packet(&pkt, magic, protocol_version, game_crc, tcp_port, game_name, link_mode);
 
     struct sockaddr_in bcast = {0};
     bcast.sin_family = AF_INET;
@@ -247,46 +299,692 @@ void NET_sendDiscoveryBroadcast(int udp_fd, uint32_t magic, uint32_t protocol_ve
            (struct sockaddr*)&bcast, sizeof(bcast));
 }
 
-int NET_receiveDiscoveryResponses(int udp_fd, uint32_t expected_magic,
-                                   NET_HostInfo* hosts, int* current_count,
-                                   int max_hosts) {
-    if (udp_fd < 0 || !hosts || !current_count) return 0;
+int NET_answerDiscoveryQueries(int udp_fd, uint32_t query_magic, uint32_t resp_magic,
+                               uint32_t protocol_version, uint32_t game_crc,
+                               uint16_t tcp_port, const char* game_name,
+                               const char* link_mode) {
+    if (udp_fd < 0) return 0;
 
+    int answered = 0;
     NET_DiscoveryPacket pkt;
     struct sockaddr_in sender;
     socklen_t sender_len = sizeof(sender);
+    ssize_t len;
+
+    while ((len = recvfrom(udp_fd, &pkt, sizeof(pkt), MSG_DONTWAIT,
+                           (struct sockaddr*)&sender, &sender_len)) >= 0) {
+        if (len == sizeof(pkt) && ntohl(pkt.magic) == query_magic) {
+            // Respond directly to the sender with our info
+            NET_DiscoveryPacket resp;
+            fill_discovery_packet(&resp, resp_magic, protocol_version, game_crc, tcp_port,
+                                  game_name, link_mode);
+            sendto(udp_fd, &resp, sizeof(resp), 0, (struct sockaddr*)&sender, sender_len);
+            answered++;
+        } else if (len == sizeof(NET_ProbePacket) && ntohl(pkt.magic) == NET_PROBE_MAGIC) {
+            // Latency probe from a join screen - echo it back as is
+            NET_ProbePacket* probe = (NET_ProbePacket*)&pkt;
+            probe->magic = htonl(NET_PROBE_REPLY);
+            sendto(udp_fd, probe, sizeof(*probe), 0, (struct sockaddr*)&sender, sender_len);
+        }
+        sender_len = sizeof(sender); // Reset for next iteration
+    }
+
+    return answered;
+}
+
+void NET_initDiscoveryCache(NET_DiscoveryCache* cache, uint32_t query_magic, uint32_t resp_magic,
+                            uint32_t protocol_version, uint16_t discovery_port) {
+    if (!cache) return;
+    memset(cache, 0, sizeof(*cache));
+    cache->query_magic = query_magic;
+    cache->resp_magic = resp_magic;
+    cache->protocol_version = protocol_version;
+    cache->discovery_port = discovery_port;
+}
+
+void NET_sendDiscoveryQuery(int udp_fd, NET_DiscoveryCache* cache) {
+    if (udp_fd < 0 || !cache) return;
+
+    NET_DiscoveryPacket pkt;
+    fill_discovery_packet(&pkt, cache->query_magic, cache->protocol_version, 0, 0, NULL, NULL);
+
+    struct sockaddr_in bcast = {0};
+    bcast.sin_family = AF_INET;
+    bcast.sin_addr.s_addr = INADDR_BROADCAST;
+    bcast.sin_port = htons(cache->discovery_port);
+
+    sendto(udp_fd, &pkt, sizeof(pkt), 0, (struct sockaddr*)&bcast, sizeof(bcast));
+
+    cache->last_query_ms = monotonic_ms();
+    if (cache->last_query_ms == 0) cache->last_query_ms = 1;  // 0 means "never queried"
+    gettimeofday(&cache->query_time, NULL);
+    memset(cache->rtt_sampled, 0, sizeof(cache->rtt_sampled));
+}
+
+// Record a response or broadcast from ip. since_query is the packet's arrival
+// time relative to our last query.
+static void discovery_cache_store(NET_DiscoveryCache* cache, const NET_DiscoveryPacket* pkt,
+                                  const char* ip, uint32_t now, uint32_t since_query) {
+    int i;
+    for (i = 0; i < cache->count; i++) {
+        if (strcmp(cache->hosts[i].host_ip, ip) == 0) break;
+    }
+    if (i == cache->count) {
+        if (cache->count >= NET_MAX_DISCOVERED_HOSTS) return;
+        cache->count++;
+        memset(&cache->hosts[i], 0, sizeof(cache->hosts[i]));
+        cache->rtt_sampled[i] = false;
+        strncpy(cache->hosts[i].host_ip, ip, sizeof(cache->hosts[i].host_ip) - 1);
+    }
+
+    // Host details can change between sessions on the same IP - keep them current
+    NET_HostInfo* h = &cache->hosts[i];
+    strncpy(h->game_name, pkt->game_name, NET_MAX_GAME_NAME - 1);
+    h->game_name[NET_MAX_GAME_NAME - 1] = '\0';
+    h->port = ntohs(pkt->port);
+    h->game_crc = ntohl(pkt->game_crc);
+    strncpy(h->link_mode, pkt->link_mode, NET_MAX_LINK_MODE - 1);
+    h->link_mode[NET_MAX_LINK_MODE - 1] = '\0';
+    cache->last_seen_ms[i] = now;
+
+    // First packet from this host since our query is (almost always) its reply.
+    // A periodic broadcast landing inside the window can only read short.
+    // Once probed, the probe median is the better figure.
+    if (!h->probed && cache->last_query_ms && !cache->rtt_sampled[i] && since_query < NET_DISCOVERY_REPLY_WINDOW_MS) {
+        uint32_t sample = since_query ? since_query : 1;
+        h->rtt_ms = h->rtt_ms ? (h->rtt_ms * 3 + sample) / 4 : sample;
+        cache->rtt_sampled[i] = true;
+    }
+}
+
+// Sort key for the host list: unprobed hosts after probed ones, lost probes
+// weighted like 10ms of latency per percent
+static uint32_t host_quality_cost(const NET_HostInfo* h) {
+    if (!h->probed) return UINT32_MAX;
+    if (h->loss_pct >= 100) return UINT32_MAX - 1;
+    return h->rtt_ms + h->loss_pct * 10;
+}
+
+int NET_updateDiscoveryCache(int udp_fd, NET_DiscoveryCache* cache,
+                             NET_HostInfo* hosts, int max_hosts) {
+    if (udp_fd < 0 || !cache) return 0;
 
-    while (recvfrom(udp_fd, &pkt, sizeof(pkt), MSG_DONTWAIT,
-                    (struct sockaddr*)&sender, &sender_len) == sizeof(pkt)) {
-        if (ntohl(pkt.magic) != expected_magic) continue;
+    NET_DiscoveryPacket pkt;
+    struct sockaddr_in sender;
+    char control[CMSG_SPACE(sizeof(struct timeval))];
+    struct iovec iov = { .iov_base = &pkt, .iov_len = sizeof(pkt) };
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    for (;;) {
+        msg.msg_name = &sender;
+        msg.msg_namelen = sizeof(sender);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(udp_fd, &msg, MSG_DONTWAIT) != sizeof(pkt)) break;
+        if (ntohl(pkt.magic) != cache->resp_magic) continue;
 
         char ip[16];
         inet_ntop(AF_INET, &sender.sin_addr, ip, sizeof(ip));
 
-        // Check for duplicates
-        bool found = false;
-        for (int i = 0; i < *current_count; i++) {
-            if (strcmp(hosts[i].host_ip, ip) == 0) {
-                found = true;
-                break;
+        // Time the reply by its kernel arrival stamp (SO_TIMESTAMP) - the
+        // caller polls on its own schedule, so reading it later adds that wait
+        uint32_t now = monotonic_ms();
+        uint32_t since_query = now - cache->last_query_ms;
+        for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMP) continue;
+            struct timeval stamp;
+            memcpy(&stamp, CMSG_DATA(c), sizeof(stamp));
+            long arrival_ms = (stamp.tv_sec - cache->query_time.tv_sec) * 1000 +
+                              (stamp.tv_usec - cache->query_time.tv_usec) / 1000;
+            if (arrival_ms >= 0 && arrival_ms < (long)since_query) {
+                since_query = (uint32_t)arrival_ms;
             }
         }
+        discovery_cache_store(cache, &pkt, ip, now, since_query);
+    }
+
+    uint32_t now = monotonic_ms();
 
-        if (!found && *current_count < max_hosts) {
-            NET_HostInfo* h = &hosts[*current_count];
-            strncpy(h->game_name, pkt.game_name, NET_MAX_GAME_NAME - 1);
-            h->game_name[NET_MAX_GAME_NAME - 1] = '\0';
-            strncpy(h->host_ip, ip, sizeof(h->host_ip) - 1);
-            h->host_ip[sizeof(h->host_ip) - 1] = '\0';
-            h->port = ntohs(pkt.port);
-            h->game_crc = ntohl(pkt.game_crc);
-            strncpy(h->link_mode, pkt.link_mode, NET_MAX_LINK_MODE - 1);
-            h->link_mode[NET_MAX_LINK_MODE - 1] = '\0';
-            (*current_count)++;
+    // Expire hosts that stopped answering, keeping the list order stable
+    int kept = 0;
+    for (int i = 0; i < cache->count; i++) {
+        if (now - cache->last_seen_ms[i] > NET_DISCOVERY_TTL_MS) continue;
+        if (kept != i) {
+            cache->hosts[kept] = cache->hosts[i];
+            cache->last_seen_ms[kept] = cache->last_seen_ms[i];
+            cache->rtt_sampled[kept] = cache->rtt_sampled[i];
         }
+        kept++;
+    }
+    cache->count = kept;
 
-        sender_len = sizeof(sender); // Reset for next iteration
+    if (now - cache->last_query_ms >= NET_DISCOVERY_QUERY_INTERVAL_MS) {
+        NET_sendDiscoveryQuery(udp_fd, cache);
+    }
+
+    // Probe new hosts in the background and pick up finished results
+    for (int i = 0; i < cache->count; i++) {
+        NET_probeHost(&cache->hosts[i], cache->discovery_port);
+    }
+
+    if (!hosts) return cache->count;
+
+    // Best link first (insertion sort - stable, at most a handful of hosts).
+    // Rank the whole cache before truncating so the best host always fits.
+    int order[NET_MAX_DISCOVERED_HOSTS];
+    for (int i = 0; i < cache->count; i++) {
+        int j = i;
+        while (j > 0 && host_quality_cost(&cache->hosts[order[j - 1]]) > host_quality_cost(&cache->hosts[i])) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    int count = cache->count < max_hosts ? cache->count : max_hosts;
+    for (int i = 0; i < count; i++) {
+        hosts[i] = cache->hosts[order[i]];
+    }
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Socket Table Queries
+//////////////////////////////////////////////////////////////////////////////
+
+// inet_diag filter: (sport == port) || (dport == port). Each comparison is a
+// GE/LE pair (EQ ops need newer kernels). Running off the end accepts the
+// socket, jumping 4 bytes past it rejects - see inet_diag_bc_run().
+typedef struct {
+    struct inet_diag_bc_op s_ge, s_ge_port;
+    struct inet_diag_bc_op s_le, s_le_port;
+    struct inet_diag_bc_op jmp_accept;
+    struct inet_diag_bc_op d_ge, d_ge_port;
+    struct inet_diag_bc_op d_le, d_le_port;
+} PortFilter;
+
+static void build_port_filter(PortFilter* f, uint16_t port) {
+    const uint16_t len = sizeof(*f);
+    memset(f, 0, sizeof(*f));
+    // Source port miss: skip to the destination port test at d_ge
+    f->s_ge = (struct inet_diag_bc_op){INET_DIAG_BC_S_GE, 8, offsetof(PortFilter, d_ge)};
+    f->s_le = (struct inet_diag_bc_op){INET_DIAG_BC_S_LE, 8, offsetof(PortFilter, d_ge) - offsetof(PortFilter, s_le)};
+    // Source port hit: unconditional jump to the end
+    f->jmp_accept = (struct inet_diag_bc_op){INET_DIAG_BC_JMP, 4, len - offsetof(PortFilter, jmp_accept)};
+    f->d_ge = (struct inet_diag_bc_op){INET_DIAG_BC_D_GE, 8, len - offsetof(PortFilter, d_ge) + 4};
+    f->d_le = (struct inet_diag_bc_op){INET_DIAG_BC_D_LE, 8, len - offsetof(PortFilter, d_le) + 4};
+    f->s_ge_port.no = f->s_le_port.no = f->d_ge_port.no = f->d_le_port.no = port;
+}
+
+// Send one filtered dump request for `family` and count the replies
+static int sock_diag_dump(uint8_t family, uint16_t port, uint32_t state_mask) {
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+        struct rtattr bc_attr;
+        PortFilter bc;
+    } msg;
+    memset(&msg, 0, sizeof(msg));
+
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    msg.nlh.nlmsg_seq = ++sock_diag_seq;
+    msg.req.sdiag_family = family;
+    msg.req.sdiag_protocol = IPPROTO_TCP;
+    msg.req.idiag_states = state_mask;
+    msg.bc_attr.rta_type = INET_DIAG_REQ_BYTECODE;
+    msg.bc_attr.rta_len = RTA_LENGTH(sizeof(msg.bc));
+    build_port_filter(&msg.bc, port);
+
+    struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+    if (sendto(sock_diag_fd, &msg, sizeof(msg), 0, (struct sockaddr*)&kernel, sizeof(kernel)) < 0) {
+        return -1;
+    }
+
+    // Replies are small (one inet_diag_msg per matching socket)
+    uint32_t buf[2048];
+    int count = 0;
+    for (;;) {
+        ssize_t n = recv(sock_diag_fd, buf, sizeof(buf), 0);
+        if (n <= 0) return -1;
+
+        for (struct nlmsghdr* h = (struct nlmsghdr*)buf; NLMSG_OK(h, (size_t)n); h = NLMSG_NEXT(h, n)) {
+            if (h->nlmsg_seq != sock_diag_seq) continue;  // Stale reply from an aborted dump
+            if (h->nlmsg_type == NLMSG_DONE) return count;
+            if (h->nlmsg_type == NLMSG_ERROR) return -1;
+            if (h->nlmsg_type == SOCK_DIAG_BY_FAMILY) count++;
+        }
+    }
+}
+
+int NET_countTCPSockets(uint16_t port, uint32_t state_mask) {
+    if (sock_diag_fd < 0) {
+        sock_diag_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+        if (sock_diag_fd < 0) return -1;
+
+        // Bound the wait so a misbehaving kernel can't stall the caller's frame
+        struct timeval tv = {.tv_sec = 0, .tv_usec = 100000};
+        setsockopt(sock_diag_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    int v4 = sock_diag_dump(AF_INET, port, state_mask);
+    int v6 = v4 < 0 ? -1 : sock_diag_dump(AF_INET6, port, state_mask);
+    if (v4 < 0) {
+        // inet_diag not built into this kernel, or the socket broke - start fresh next time
+        NET_closeSockDiag();
+        return -1;
     }
+    return v4 + (v6 > 0 ? v6 : 0);  // IPv6 diag is optional
+}
+
+void NET_closeSockDiag(void) {
+    if (sock_diag_fd >= 0) {
+        close(sock_diag_fd);
+        sock_diag_fd = -1;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Host Probing
+//////////////////////////////////////////////////////////////////////////////
+
+// Discovery replies only time one packet. Before the player picks a host,
+// every listed host gets a short burst of probes in parallel (one socket and
+// one timer on the event loop) for a median RTT and a loss rate.
+
+typedef struct {
+    char ip[16];
+    uint16_t port;
+    uint32_t token;                           // Matches replies to this run
+    int sent;
+    uint32_t sent_ms[NET_PROBE_COUNT];
+    uint32_t rtt_ms[NET_PROBE_COUNT];
+    bool replied[NET_PROBE_COUNT];
+    uint32_t done_ms;                         // 0 while probing
+} NET_ProbeRun;
+
+static struct {
+    pthread_mutex_t lock;
+    int fd;
+    int timer_fd;
+    uint32_t next_token;
+    NET_ProbeRun runs[NET_MAX_DISCOVERED_HOSTS];
+} probes = { .lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1, .timer_fd = -1 };
+
+static bool probe_run_active(const NET_ProbeRun* run) {
+    return run->ip[0] && !run->done_ms;
+}
+
+static void probe_run_finish(NET_ProbeRun* run, uint32_t now) {
+    run->done_ms = now ? now : 1;
+}
+
+// Event loop: replies to our probes (echoed by the host's discovery socket)
+static void on_probe_reply(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+
+    NET_ProbePacket pkt;
+    pthread_mutex_lock(&probes.lock);
+    while (recv(fd, &pkt, sizeof(pkt), MSG_DONTWAIT) >= 0) {
+        uint32_t seq = ntohl(pkt.seq);
+        if (ntohl(pkt.magic) != NET_PROBE_REPLY || seq >= NET_PROBE_COUNT) continue;
+
+        uint32_t now = monotonic_ms();
+        for (int i = 0; i < NET_MAX_DISCOVERED_HOSTS; i++) {
+            NET_ProbeRun* run = &probes.runs[i];
+            if (!probe_run_active(run) || run->token != ntohl(pkt.token) ||
+                (int)seq >= run->sent || run->replied[seq]) {
+                continue;
+            }
+            run->replied[seq] = true;
+            run->rtt_ms[seq] = now - run->sent_ms[seq];
+
+            // All probes answered - no need to wait for the timeout
+            int replies = 0;
+            for (int k = 0; k < NET_PROBE_COUNT; k++) replies += run->replied[k];
+            if (replies == NET_PROBE_COUNT) probe_run_finish(run, now);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&probes.lock);
+}
+
+// Event loop: send the next probe of every active run, time out finished
+// bursts, and drop the socket once nothing is left to probe
+static void on_probe_timer(int fd, uint32_t events, void* ctx) {
+    (void)fd;
+    (void)events;
+    (void)ctx;
+
+    uint32_t now = monotonic_ms();
+    bool active = false;
+
+    pthread_mutex_lock(&probes.lock);
+    for (int i = 0; i < NET_MAX_DISCOVERED_HOSTS; i++) {
+        NET_ProbeRun* run = &probes.runs[i];
+        if (!probe_run_active(run)) continue;
+
+        if (run->sent < NET_PROBE_COUNT) {
+            NET_ProbePacket pkt = {
+                .magic = htonl(NET_PROBE_MAGIC),
+                .token = htonl(run->token),
+                .seq = htonl((uint32_t)run->sent),
+            };
+            struct sockaddr_in addr = {0};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(run->port);
+            inet_pton(AF_INET, run->ip, &addr.sin_addr);
+            run->sent_ms[run->sent] = now;
+            run->sent++;
+            sendto(probes.fd, &pkt, sizeof(pkt), 0, (struct sockaddr*)&addr, sizeof(addr));
+        } else if (now - run->sent_ms[NET_PROBE_COUNT - 1] >= NET_PROBE_TIMEOUT_MS) {
+            probe_run_finish(run, now);
+            continue;
+        }
+        active = true;
+    }
+
+    if (!active) {
+        // Both callbacks run on this thread, so unwatching here can't race them
+        NET_unwatch(probes.timer_fd);
+        NET_unwatch(probes.fd);
+        close(probes.fd);
+        probes.timer_fd = -1;
+        probes.fd = -1;
+    }
+    pthread_mutex_unlock(&probes.lock);
+}
+
+// Open the probe socket and timer (lock held)
+static bool probe_start_loop(void) {
+    if (probes.fd >= 0) return true;
+
+    probes.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probes.fd < 0) return false;
+
+    probes.timer_fd = NET_createTimer(on_probe_timer, NULL);
+    if (probes.timer_fd < 0 || NET_watchSocket(probes.fd, on_probe_reply, NULL) < 0) {
+        NET_unwatch(probes.timer_fd);
+        close(probes.fd);
+        probes.fd = -1;
+        probes.timer_fd = -1;
+        return false;
+    }
+    NET_setTimer(probes.timer_fd, 1, NET_PROBE_INTERVAL_MS);
+    return true;
+}
+
+void NET_probeHost(NET_HostInfo* host, uint16_t probe_port) {
+    if (!host || !host->host_ip[0]) return;
+
+    uint32_t now = monotonic_ms();
+    NET_ProbeRun* run = NULL;
+    NET_ProbeRun* oldest = NULL;
+
+    pthread_mutex_lock(&probes.lock);
+    for (int i = 0; i < NET_MAX_DISCOVERED_HOSTS; i++) {
+        NET_ProbeRun* r = &probes.runs[i];
+        if (r->ip[0] && strcmp(r->ip, host->host_ip) == 0) {
+            run = r;
+            break;
+        }
+        if (!probe_run_active(r) && (!oldest || !r->ip[0] ||
+                                     (oldest->ip[0] && r->done_ms < oldest->done_ms))) {
+            oldest = r;
+        }
+    }
+
+    if (run && run->done_ms) {
+        // Report the finished run: median of the replies and the share lost
+        uint32_t sorted[NET_PROBE_COUNT];
+        int replies = 0;
+        for (int k = 0; k < NET_PROBE_COUNT; k++) {
+            if (!run->replied[k]) continue;
+            int j = replies++;
+            while (j > 0 && sorted[j - 1] > run->rtt_ms[k]) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = run->rtt_ms[k];
+        }
+        host->probed = true;
+        host->loss_pct = (uint8_t)((NET_PROBE_COUNT - replies) * 100 / NET_PROBE_COUNT);
+        if (replies) {
+            host->rtt_ms = sorted[replies / 2] ? sorted[replies / 2] : 1;
+        }
+
+        // Links change - re-probe a host that stays listed
+        if (now - run->done_ms < NET_PROBE_REFRESH_MS) {
+            pthread_mutex_unlock(&probes.lock);
+            return;
+        }
+    } else if (run) {
+        pthread_mutex_unlock(&probes.lock);  // Still probing
+        return;
+    } else {
+        run = oldest;
+    }
+
+    if (run && probe_start_loop()) {
+        memset(run, 0, sizeof(*run));
+        strncpy(run->ip, host->host_ip, sizeof(run->ip) - 1);
+        run->port = probe_port;
+        run->token = ++probes.next_token ^ now;
+    }
+    pthread_mutex_unlock(&probes.lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Event Loop
+//////////////////////////////////////////////////////////////////////////////
+
+#define NET_EVENT_MAX_WATCHES 16
+#define NET_EVENT_WAKE_TOKEN  UINT64_MAX
+
+typedef struct {
+    int fd;
+    bool timer;           // timerfd owned by the loop (closed on unwatch)
+    uint32_t generation;  // Bumped per use so stale epoll events are dropped
+    NET_EventFn fn;       // NULL = free slot
+    void* ctx;
+} NET_Watch;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t idle;        // Signalled after each callback returns
+    pthread_t thread;
+    bool started;
+    int epoll_fd;
+    int wake_fd;                // eventfd used to stop the thread
+    int count;
+    int dispatch_slot;          // Slot whose callback is running, -1 if none
+    uint32_t dispatch_generation;
+    NET_Watch watches[NET_EVENT_MAX_WATCHES];
+} event_loop = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+    .epoll_fd = -1,
+    .wake_fd = -1,
+    .dispatch_slot = -1,
+};
+
+static void* event_loop_thread_func(void* arg) {
+    (void)arg;
+    struct epoll_event events[NET_EVENT_MAX_WATCHES + 1];
+
+    for (;;) {
+        // No timeout: with nothing to do the thread never wakes
+        int n = epoll_wait(event_loop.epoll_fd, events, NET_EVENT_MAX_WATCHES + 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == NET_EVENT_WAKE_TOKEN) return NULL;
+
+            int slot = (int)(events[i].data.u64 & 0xFFFFFFFF);
+            uint32_t generation = (uint32_t)(events[i].data.u64 >> 32);
+
+            pthread_mutex_lock(&event_loop.lock);
+            NET_Watch* w = &event_loop.watches[slot];
+            if (!w->fn || w->generation != generation) {
+                pthread_mutex_unlock(&event_loop.lock);  // Unwatched since epoll_wait
+                continue;
+            }
+            if (w->timer) {
+                uint64_t expirations;
+                if (read(w->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                    pthread_mutex_unlock(&event_loop.lock);  // Re-armed before we got here
+                    continue;
+                }
+            }
+            NET_EventFn fn = w->fn;
+            void* ctx = w->ctx;
+            int fd = w->fd;
+            event_loop.dispatch_slot = slot;
+            event_loop.dispatch_generation = generation;
+            pthread_mutex_unlock(&event_loop.lock);
+
+            fn(fd, events[i].events, ctx);
+
+            pthread_mutex_lock(&event_loop.lock);
+            event_loop.dispatch_slot = -1;
+            pthread_cond_broadcast(&event_loop.idle);
+            pthread_mutex_unlock(&event_loop.lock);
+        }
+    }
+
+    return NULL;
+}
+
+// Start the loop thread on first use (lock held)
+static bool event_loop_start(void) {
+    if (event_loop.started) return true;
+
+    event_loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (event_loop.epoll_fd < 0) return false;
+
+    event_loop.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = NET_EVENT_WAKE_TOKEN };
+    if (event_loop.wake_fd < 0 ||
+        epoll_ctl(event_loop.epoll_fd, EPOLL_CTL_ADD, event_loop.wake_fd, &ev) < 0 ||
+        pthread_create(&event_loop.thread, NULL, event_loop_thread_func, NULL) != 0) {
+        if (event_loop.wake_fd >= 0) close(event_loop.wake_fd);
+        close(event_loop.epoll_fd);
+        event_loop.wake_fd = -1;
+        event_loop.epoll_fd = -1;
+        return false;
+    }
+
+    event_loop.started = true;
+    return true;
+}
+
+static int event_loop_add(int fd, bool timer, NET_EventFn fn, void* ctx) {
+    if (fd < 0 || !fn) return -1;
+
+    pthread_mutex_lock(&event_loop.lock);
+    if (!event_loop_start()) {
+        pthread_mutex_unlock(&event_loop.lock);
+        return -1;
+    }
+
+    for (int slot = 0; slot < NET_EVENT_MAX_WATCHES; slot++) {
+        NET_Watch* w = &event_loop.watches[slot];
+        if (w->fn) continue;
+
+        w->generation++;
+        struct epoll_event ev = {
+            .events = EPOLLIN,
+            .data.u64 = ((uint64_t)w->generation << 32) | (uint32_t)slot,
+        };
+        if (epoll_ctl(event_loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) break;
+
+        w->fd = fd;
+        w->timer = timer;
+        w->fn = fn;
+        w->ctx = ctx;
+        event_loop.count++;
+        pthread_mutex_unlock(&event_loop.lock);
+        return 0;
+    }
+
+    pthread_mutex_unlock(&event_loop.lock);
+    return -1;
+}
+
+int NET_watchSocket(int fd, NET_EventFn fn, void* ctx) {
+    return event_loop_add(fd, false, fn, ctx);
+}
+
+void NET_unwatch(int fd) {
+    if (fd < 0) return;
+
+    pthread_mutex_lock(&event_loop.lock);
+    for (int slot = 0; slot < NET_EVENT_MAX_WATCHES; slot++) {
+        NET_Watch* w = &event_loop.watches[slot];
+        if (!w->fn || w->fd != fd) continue;
+
+        epoll_ctl(event_loop.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        w->fn = NULL;
+        event_loop.count--;
+
+        // Let a running callback finish, unless it is the one unwatching
+        if (!pthread_equal(pthread_self(), event_loop.thread)) {
+            while (event_loop.dispatch_slot == slot && event_loop.dispatch_generation == w->generation) {
+                pthread_cond_wait(&event_loop.idle, &event_loop.lock);
+            }
+        }
+
+        if (w->timer) close(fd);
+        break;
+    }
+    pthread_mutex_unlock(&event_loop.lock);
+}
+
+int NET_createTimer(NET_EventFn fn, void* ctx) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) return -1;
+
+    if (event_loop_add(fd, true, fn, ctx) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void NET_setTimer(int timer_fd, int first_ms, int interval_ms) {
+    if (timer_fd < 0) return;
+
+    struct itimerspec spec = {0};
+    spec.it_value.tv_sec = first_ms / 1000;
+    spec.it_value.tv_nsec = (long)(first_ms % 1000) * 1000000;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000;
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+}
+
+void NET_quitEventLoop(void) {
+    pthread_mutex_lock(&event_loop.lock);
+    if (!event_loop.started || event_loop.count > 0 ||
+        pthread_equal(pthread_self(), event_loop.thread)) {
+        pthread_mutex_unlock(&event_loop.lock);
+        return;
+    }
+    event_loop.started = false;
+    pthread_mutex_unlock(&event_loop.lock);
+
+    uint64_t one = 1;
+    write(event_loop.wake_fd, &one, sizeof(one));
+    pthread_join(event_loop.thread, NULL);
 
-    return *current_count;
+    close(event_loop.wake_fd);
+    close(event_loop.epoll_fd);
+    event_loop.wake_fd = -1;
+    event_loop.epoll_fd = -1;
 }
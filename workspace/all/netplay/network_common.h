@@ -27,12 +27,19 @@ typedef struct {
     uint32_t seed;             // Random seed (typically game_crc ^ time)
 } NET_HotspotConfig;
 
-// Rate-limited broadcast timer
+// Rate-limited broadcast timer. Starts at the given interval, then backs off
+// to NET_BROADCAST_MAX_INTERVAL_US once NET_BROADCAST_FAST_PERIOD_US has passed
+// (clients query on entering the join screen, so broadcasts only need to
+// catch a client that missed its query)
 typedef struct {
     struct timeval last_broadcast;
+    struct timeval started;
     int interval_us;
 } NET_BroadcastTimer;
 
+#define NET_BROADCAST_FAST_PERIOD_US 3000000  // 3s at the initial rate
+#define NET_BROADCAST_MAX_INTERVAL_US 2000000 // 2s
+
 // Maximum game name length for discovery
 #define NET_MAX_GAME_NAME 64
 #define NET_MAX_DISCOVERED_HOSTS 8
@@ -50,15 +57,55 @@ typedef struct __attribute__((packed)) {
     char link_mode[NET_MAX_LINK_MODE];  // Link mode for compatibility check (e.g., "mul_poke", "rfu")
 } NET_DiscoveryPacket;
 
+// Latency probe, echoed back by the host's discovery socket (wire format)
+typedef struct __attribute__((packed)) {
+    uint32_t magic;  // NET_PROBE_MAGIC, NET_PROBE_REPLY in the echo
+    uint32_t token;  // Identifies the probe run
+    uint32_t seq;
+} NET_ProbePacket;
+
+#define NET_PROBE_MAGIC 0x4E585042  // "NXPB" - shared by all link types
+#define NET_PROBE_REPLY 0x4E585052  // "NXPR"
+
+// Probe burst timing: NET_PROBE_COUNT probes, one every NET_PROBE_INTERVAL_MS,
+// then up to NET_PROBE_TIMEOUT_MS for the last reply (~330ms worst case)
+#define NET_PROBE_COUNT       5
+#define NET_PROBE_INTERVAL_MS 20
+#define NET_PROBE_TIMEOUT_MS  250
+#define NET_PROBE_REFRESH_MS  10000  // Re-probe hosts still listed after this
+
 // Generic host info (for discovered hosts list)
+// NetplayHostInfo, GBALinkHostInfo and GBLinkHostInfo share this layout
 typedef struct {
     char game_name[NET_MAX_GAME_NAME];
     char host_ip[16];
     uint16_t port;
     uint32_t game_crc;
     char link_mode[NET_MAX_LINK_MODE];  // Host's link mode for compatibility check
+    uint32_t rtt_ms;                    // Median probe round trip (query round trip until probed), 0 = unknown
+    uint8_t loss_pct;                   // Probes lost, valid once probed
+    bool probed;
 } NET_HostInfo;
 
+// Discovery cache timing
+#define NET_DISCOVERY_QUERY_INTERVAL_MS 1000  // Re-query while the join screen is open
+#define NET_DISCOVERY_REPLY_WINDOW_MS   1000  // Responses later than this aren't timed
+#define NET_DISCOVERY_TTL_MS            4000  // Drop hosts not heard from for this long
+
+// Hosts seen by a client, with last-seen times for expiry
+typedef struct {
+    NET_HostInfo hosts[NET_MAX_DISCOVERED_HOSTS];
+    uint32_t last_seen_ms[NET_MAX_DISCOVERED_HOSTS];
+    bool rtt_sampled[NET_MAX_DISCOVERED_HOSTS];  // Already timed for the current query
+    int count;
+    uint32_t query_magic;
+    uint32_t resp_magic;
+    uint32_t protocol_version;
+    uint16_t discovery_port;
+    uint32_t last_query_ms;
+    struct timeval query_time;  // Wall clock send time, matched against SO_TIMESTAMP
+} NET_DiscoveryCache;
+
 //////////////////////////////////////////////////////////////////////////////
 // IP Address Utilities
 //////////////////////////////////////////////////////////////////////////////
@@ -146,6 +193,14 @@ void NET_initBroadcastTimer(NET_BroadcastTimer* timer, int interval_us);
  */
 bool NET_shouldBroadcast(NET_BroadcastTimer* timer);
 
+/**
+ * Record a broadcast sent now and apply the backoff
+ * For hosts that schedule broadcasts with NET_setTimer
+ * @param timer Pointer to broadcast timer
+ * @return Microseconds until the next broadcast is due
+ */
+int NET_markBroadcast(NET_BroadcastTimer* timer);
+
 //////////////////////////////////////////////////////////////////////////////
 // Discovery Utilities
 //////////////////////////////////////////////////////////////////////////////
@@ -167,16 +222,138 @@ void NET_sendDiscoveryBroadcast(int udp_fd, uint32_t magic, uint32_t protocol_ve
                                  const char* link_mode);
 
 /**
- * Receive and deduplicate discovery responses
- * @param udp_fd UDP socket file descriptor
- * @param expected_magic Expected magic number (host byte order)
- * @param hosts Array to store discovered hosts
- * @param current_count Pointer to current count (updated in place)
- * @param max_hosts Maximum hosts to store
- * @return Updated host count
- */
-int NET_receiveDiscoveryResponses(int udp_fd, uint32_t expected_magic,
-                                   NET_HostInfo* hosts, int* current_count,
-                                   int max_hosts);
+ * Answer pending discovery queries with a unicast response (host side)
+ * Drains the socket; anything that isn't a query is ignored.
+ * @param udp_fd Non-blocking socket bound to the discovery port
+ * @param query_magic Query magic number (host byte order)
+ * @param resp_magic Response magic number (host byte order)
+ * @param protocol_version Protocol version
+ * @param game_crc Game CRC for matching
+ * @param tcp_port TCP port to advertise
+ * @param game_name Game name string
+ * @param link_mode Link mode string - can be NULL
+ * @return Number of queries answered
+ */
+int NET_answerDiscoveryQueries(int udp_fd, uint32_t query_magic, uint32_t resp_magic,
+                               uint32_t protocol_version, uint32_t game_crc,
+                               uint16_t tcp_port, const char* game_name,
+                               const char* link_mode);
+
+/**
+ * Reset a discovery cache (client side)
+ * @param cache Cache to initialize
+ * @param query_magic Query magic number (host byte order)
+ * @param resp_magic Response magic number (host byte order)
+ * @param protocol_version Protocol version sent in queries
+ * @param discovery_port UDP port hosts listen on for queries
+ */
+void NET_initDiscoveryCache(NET_DiscoveryCache* cache, uint32_t query_magic, uint32_t resp_magic,
+                            uint32_t protocol_version, uint16_t discovery_port);
+
+/**
+ * Broadcast a discovery query; hosts answer right away with a unicast response
+ * @param udp_fd Discovery socket (NET_createDiscoveryListenSocket)
+ * @param cache Cache the responses go to (timestamps the query for RTT)
+ */
+void NET_sendDiscoveryQuery(int udp_fd, NET_DiscoveryCache* cache);
+
+/**
+ * Probe a host's latency and loss in the background (event loop, non-blocking)
+ * Starts a burst on first call; later calls fill in rtt_ms, loss_pct and
+ * probed once it finished. All hosts are probed in parallel.
+ * @param host Host to probe, updated with the result when available
+ * @param probe_port Host's discovery port (answers probes)
+ */
+void NET_probeHost(NET_HostInfo* host, uint16_t probe_port);
+
+/**
+ * Receive responses and broadcasts into the cache, re-query when due and
+ * drop hosts not heard from within NET_DISCOVERY_TTL_MS. Hosts are probed
+ * (NET_probeHost) and returned best link first.
+ * @param udp_fd Discovery socket
+ * @param cache Cache to update
+ * @param hosts Array receiving the current hosts (can be NULL)
+ * @param max_hosts Size of hosts
+ * @return Number of hosts copied (or cached, if hosts is NULL)
+ */
+int NET_updateDiscoveryCache(int udp_fd, NET_DiscoveryCache* cache,
+                             NET_HostInfo* hosts, int max_hosts);
+
+//////////////////////////////////////////////////////////////////////////////
+// Socket Table Queries
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Count TCP sockets (IPv4 and IPv6) with local or remote port `port` whose
+ * state is in `state_mask` (bit n = TCP state n, e.g. 1 << TCP_ESTABLISHED).
+ * Uses a NETLINK_SOCK_DIAG dump filtered in the kernel, so the cost doesn't
+ * grow with the system socket table. For watching sockets we don't own, such
+ * as a core's link connection. The netlink socket is kept open between calls;
+ * not thread safe - call from one thread.
+ * @param port Local or remote port to match
+ * @param state_mask Bitmask of TCP states to match
+ * @return Number of matching sockets, -1 if sock_diag is unavailable
+ */
+int NET_countTCPSockets(uint16_t port, uint32_t state_mask);
+
+/**
+ * Close the persistent sock_diag netlink socket (reopened on next query)
+ */
+void NET_closeSockDiag(void);
+
+//////////////////////////////////////////////////////////////////////////////
+// Event Loop
+//////////////////////////////////////////////////////////////////////////////
+
+// One thread serves the listen, discovery and beacon work of every link type.
+// It blocks in epoll_wait with no timeout, so a host with nothing to do never
+// wakes up. Callbacks run on that thread and must not block for long - every
+// other link waits on them. The thread starts with the first watch.
+
+/**
+ * Event callback
+ * @param fd Socket or timer that became readable
+ * @param events epoll event mask (EPOLLIN, EPOLLERR, EPOLLHUP)
+ * @param ctx Pointer passed when registering
+ */
+typedef void (*NET_EventFn)(int fd, uint32_t events, void* ctx);
+
+/**
+ * Call fn whenever fd is readable (level-triggered - drain it or it fires again)
+ * @param fd Socket to watch
+ * @param fn Callback
+ * @param ctx Passed to fn
+ * @return 0 on success, -1 on failure
+ */
+int NET_watchSocket(int fd, NET_EventFn fn, void* ctx);
+
+/**
+ * Stop watching a socket or timer. Waits for a running callback on it to
+ * return (unless called from that callback), so the caller can close the
+ * socket afterwards. Don't hold a lock the callback takes. Timers are closed.
+ * @param fd Socket or timer to remove
+ */
+void NET_unwatch(int fd);
+
+/**
+ * Create a disarmed timer that calls fn on the event loop thread
+ * @param fn Callback
+ * @param ctx Passed to fn
+ * @return Timer fd (for NET_setTimer/NET_unwatch), -1 on failure
+ */
+int NET_createTimer(NET_EventFn fn, void* ctx);
+
+/**
+ * Arm or disarm a timer
+ * @param timer_fd Timer from NET_createTimer
+ * @param first_ms Delay until the first expiry, 0 disarms
+ * @param interval_ms Period after that, 0 for one-shot
+ */
+void NET_setTimer(int timer_fd, int first_ms, int interval_ms);
+
+/**
+ * Stop the event loop thread if nothing is watched (call from module quit)
+ */
+void NET_quitEventLoop(void);
 
 #endif /* NETWORK_COMMON_H */
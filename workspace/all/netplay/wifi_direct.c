@@ -19,10 +19,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
 // Upper bound on networks pulled from a single platform scan (stack buffer).
 #define WD_SCAN_MAX 64
 
+// Background scan cache
+#define WD_CACHE_MAX 64                 // Distinct BSSIDs kept
+#define WD_CACHE_HOTSPOT_MAX 16
+#define WD_CACHE_SCAN_INTERVAL_MS 4000  // Between background scans
+#define WD_CACHE_MAX_AGE_MS 12000       // Drop BSSIDs missing from ~3 scans
+
 // Static state for hotspot
 static bool hotspot_active = false;
 static char hotspot_ssid[WIFI_DIRECT_SSID_MAX] = {0};
@@ -61,6 +70,304 @@ static bool wifi_acquire_dhcp(void) {
     return false;
 }
 
+//////////////////////////////////
+// Background Scan Cache
+//////////////////////////////////
+
+typedef struct {
+    char ssid[WIFI_DIRECT_SSID_MAX];
+    char bssid[18];
+    int rssi;
+    int freq;
+    WifiSecurityType security;
+    bool has_saved_creds;
+    uint32_t seen_ms;   // When a scan last reported this BSSID
+} ScanCacheEntry;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool running;       // Scanner thread alive
+    bool stop;          // Scanner exits after its current scan
+    bool wake;          // Scan now instead of at the next interval
+
+    ScanCacheEntry entries[WD_CACHE_MAX];
+    int count;
+    int hotspots[WD_CACHE_HOTSPOT_MAX]; // entries[] with LINK_HOTSPOT_SSID_PREFIX, strongest first
+    int hotspot_count;
+
+    uint32_t generation;
+    uint32_t scan_count;
+} cache = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static uint32_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+// Not seen for too long - dropped at the next merge, but readers may get there first
+static bool cache_entry_stale(const ScanCacheEntry* e, uint32_t now) {
+    return now - e->seen_ms > WD_CACHE_MAX_AGE_MS;
+}
+
+static void cache_init(void) {
+    // Monotonic, so a network time sync can't stretch the scan interval
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cache.cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Rebuild the hotspot index: one entry per SSID (strongest BSSID), strongest first
+static void cache_index_hotspots(void) {
+    size_t prefix_len = strlen(LINK_HOTSPOT_SSID_PREFIX);
+    cache.hotspot_count = 0;
+
+    for (int i = 0; i < cache.count; i++) {
+        ScanCacheEntry* e = &cache.entries[i];
+        if (strncmp(e->ssid, LINK_HOTSPOT_SSID_PREFIX, prefix_len) != 0) continue;
+
+        int dup = -1;
+        for (int j = 0; j < cache.hotspot_count; j++) {
+            if (strcmp(cache.entries[cache.hotspots[j]].ssid, e->ssid) == 0) dup = j;
+        }
+        if (dup >= 0) {
+            if (cache.entries[cache.hotspots[dup]].rssi >= e->rssi) continue;
+            // Drop the weaker BSSID, the insert below re-sorts
+            memmove(&cache.hotspots[dup], &cache.hotspots[dup + 1],
+                    (cache.hotspot_count - dup - 1) * sizeof(cache.hotspots[0]));
+            cache.hotspot_count--;
+        }
+
+        int pos = cache.hotspot_count;
+        while (pos > 0 && cache.entries[cache.hotspots[pos - 1]].rssi < e->rssi) pos--;
+        if (pos >= WD_CACHE_HOTSPOT_MAX) continue;
+        int tail = cache.hotspot_count < WD_CACHE_HOTSPOT_MAX ? cache.hotspot_count : WD_CACHE_HOTSPOT_MAX - 1;
+        memmove(&cache.hotspots[pos + 1], &cache.hotspots[pos], (tail - pos) * sizeof(cache.hotspots[0]));
+        cache.hotspots[pos] = i;
+        if (cache.hotspot_count < WD_CACHE_HOTSPOT_MAX) cache.hotspot_count++;
+    }
+}
+
+// Fold one scan into the cache. Caller holds cache.mutex.
+static void cache_merge(const struct WIFI_network* found, const bool* saved, int n, uint32_t now) {
+    bool changed = false;
+
+    for (int i = 0; i < n; i++) {
+        if (found[i].ssid[0] == '\0') continue;
+
+        ScanCacheEntry* e = NULL;
+        for (int j = 0; j < cache.count && !e; j++) {
+            if (strcmp(cache.entries[j].bssid, found[i].bssid) == 0) e = &cache.entries[j];
+        }
+        if (!e) {
+            if (cache.count < WD_CACHE_MAX) {
+                e = &cache.entries[cache.count++];
+            } else {
+                // Full: replace the BSSID seen longest ago
+                e = &cache.entries[0];
+                for (int j = 1; j < cache.count; j++) {
+                    if ((int32_t)(cache.entries[j].seen_ms - e->seen_ms) < 0) e = &cache.entries[j];
+                }
+            }
+            memset(e, 0, sizeof(*e));
+            strncpy(e->bssid, found[i].bssid, sizeof(e->bssid) - 1);
+            changed = true;
+        }
+
+        if (strncmp(e->ssid, found[i].ssid, WIFI_DIRECT_SSID_MAX - 1) != 0 || e->rssi != found[i].rssi ||
+            e->security != found[i].security || e->has_saved_creds != saved[i]) {
+            changed = true;
+        }
+        strncpy(e->ssid, found[i].ssid, WIFI_DIRECT_SSID_MAX - 1);
+        e->ssid[WIFI_DIRECT_SSID_MAX - 1] = '\0';
+        e->rssi = found[i].rssi;
+        e->freq = found[i].freq;
+        e->security = found[i].security;
+        e->has_saved_creds = saved[i];
+        e->seen_ms = now;
+    }
+
+    // Expire BSSIDs that stopped showing up (a host that stopped its hotspot)
+    for (int j = 0; j < cache.count;) {
+        if (cache_entry_stale(&cache.entries[j], now)) {
+            cache.entries[j] = cache.entries[--cache.count];
+            changed = true;
+        } else {
+            j++;
+        }
+    }
+
+    cache_index_hotspots();
+    if (changed) cache.generation++;
+}
+
+// One blocking platform scan, folded into the cache. saved[] gets whether each
+// result has stored credentials. Returns the platform result count, -1 on failure.
+static int cache_scan(struct WIFI_network* found, bool* saved, int max) {
+    int n = WIFI_scan(found, max);
+    for (int i = 0; i < n; i++) {
+        saved[i] = found[i].ssid[0] != '\0' && WIFI_isKnown(found[i].ssid, found[i].security);
+    }
+
+    pthread_mutex_lock(&cache.mutex);
+    cache.scan_count++;
+    if (n >= 0) cache_merge(found, saved, n, monotonic_ms());
+    pthread_mutex_unlock(&cache.mutex);
+    return n;
+}
+
+static void* scan_cache_thread(void* arg) {
+    (void)arg;
+    struct WIFI_network found[WD_SCAN_MAX];
+    bool saved[WD_SCAN_MAX];
+
+    pthread_mutex_lock(&cache.mutex);
+    while (!cache.stop) {
+        cache.wake = false;
+        pthread_mutex_unlock(&cache.mutex);
+
+        // PLAT_wifiScan returns when the supplicant reports results
+        cache_scan(found, saved, WD_SCAN_MAX);
+
+        pthread_mutex_lock(&cache.mutex);
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += WD_CACHE_SCAN_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (long)(WD_CACHE_SCAN_INTERVAL_MS % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!cache.stop && !cache.wake) {
+            if (pthread_cond_timedwait(&cache.cond, &cache.mutex, &deadline) == ETIMEDOUT) break;
+        }
+    }
+    cache.running = false;
+    pthread_cond_broadcast(&cache.cond);  // Wakes scan_cache_join
+    pthread_mutex_unlock(&cache.mutex);
+    return NULL;
+}
+
+void WIFI_direct_startScanCache(void) {
+    // No client stack to scan with while hosting
+    if (hotspot_active || !WIFI_enabled()) return;
+    pthread_once(&cache_once, cache_init);
+
+    pthread_mutex_lock(&cache.mutex);
+    cache.stop = false;
+    if (!cache.running) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attr, scan_cache_thread, NULL) == 0) {
+            cache.running = true;
+        } else {
+            LOG_error("WIFI_direct_startScanCache: failed to create thread\n");
+        }
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_unlock(&cache.mutex);
+}
+
+void WIFI_direct_stopScanCache(void) {
+    pthread_once(&cache_once, cache_init);
+    pthread_mutex_lock(&cache.mutex);
+    cache.stop = true;
+    pthread_cond_broadcast(&cache.cond);
+    pthread_mutex_unlock(&cache.mutex);
+}
+
+// Stop the scanner and wait out a scan in flight (a full scan takes seconds),
+// for callers about to take over the radio
+static void scan_cache_join(void) {
+    pthread_once(&cache_once, cache_init);
+    pthread_mutex_lock(&cache.mutex);
+    cache.stop = true;
+    pthread_cond_broadcast(&cache.cond);
+    // A start in the meantime hands the thread on to its caller
+    while (cache.running && cache.stop) {
+        pthread_cond_wait(&cache.cond, &cache.mutex);
+    }
+    pthread_mutex_unlock(&cache.mutex);
+}
+
+uint32_t WIFI_direct_getScanCacheGeneration(void) {
+    pthread_mutex_lock(&cache.mutex);
+    uint32_t generation = cache.generation;
+    pthread_mutex_unlock(&cache.mutex);
+    return generation;
+}
+
+int WIFI_direct_getCachedNetworks(WIFI_direct_network_t* networks, int max_count) {
+    if (!networks || max_count <= 0) return 0;
+
+    int count = 0;
+    pthread_mutex_lock(&cache.mutex);
+    uint32_t now = monotonic_ms();
+    for (int i = 0; i < cache.count; i++) {
+        const ScanCacheEntry* e = &cache.entries[i];
+        if (cache_entry_stale(e, now)) continue;  // Scanner stopped before expiring it
+
+        // One row per SSID, from its strongest BSSID
+        int row = -1;
+        for (int j = 0; j < count; j++) {
+            if (strcmp(networks[j].ssid, e->ssid) == 0) row = j;
+        }
+        if (row >= 0) {
+            if (networks[row].rssi >= e->rssi) continue;
+            memmove(&networks[row], &networks[row + 1], (count - row - 1) * sizeof(*networks));
+            count--;
+        }
+
+        // Insert sorted, strongest first
+        int pos = count;
+        while (pos > 0 && networks[pos - 1].rssi < e->rssi) pos--;
+        if (pos >= max_count) continue;
+        int tail = count < max_count ? count : max_count - 1;
+        memmove(&networks[pos + 1], &networks[pos], (tail - pos) * sizeof(*networks));
+        WIFI_direct_network_t* net = &networks[pos];
+        strncpy(net->ssid, e->ssid, WIFI_DIRECT_SSID_MAX - 1);
+        net->ssid[WIFI_DIRECT_SSID_MAX - 1] = '\0';
+        net->rssi = e->rssi;
+        net->is_secured = (e->security != SECURITY_NONE);
+        net->has_saved_creds = e->has_saved_creds;
+        if (count < max_count) count++;
+    }
+    pthread_mutex_unlock(&cache.mutex);
+    return count;
+}
+
+int WIFI_direct_getCachedHotspots(char ssids_out[][WIFI_DIRECT_SSID_MAX], int max_count) {
+    if (!ssids_out || max_count <= 0) return 0;
+
+    int count = 0;
+    pthread_mutex_lock(&cache.mutex);
+    uint32_t now = monotonic_ms();
+    for (int i = 0; i < cache.hotspot_count && count < max_count; i++) {
+        const ScanCacheEntry* e = &cache.entries[cache.hotspots[i]];
+        if (cache_entry_stale(e, now)) continue;  // Host may have stopped its hotspot
+        strncpy(ssids_out[count], e->ssid, WIFI_DIRECT_SSID_MAX - 1);
+        ssids_out[count][WIFI_DIRECT_SSID_MAX - 1] = '\0';
+        count++;
+    }
+    pthread_mutex_unlock(&cache.mutex);
+    return count;
+}
+
+uint32_t WIFI_direct_getScanCount(void) {
+    pthread_mutex_lock(&cache.mutex);
+    uint32_t scans = cache.scan_count;
+    pthread_mutex_unlock(&cache.mutex);
+    return scans;
+}
+
 //////////////////////////////////
 // WiFi Client Functions (wlan0) - thin wrappers over the platform WiFi stack
 //////////////////////////////////
@@ -76,15 +383,22 @@ bool WIFI_direct_ensureReady(void) {
 }
 
 void WIFI_direct_triggerScan(void) {
-    // No-op: PLAT_wifiScan() triggers, waits, and reads results in one blocking call.
+    // PLAT_wifiScan() triggers, waits, and reads results in one blocking call, so
+    // this only cuts the background scanner's wait short (no-op if it isn't running).
+    pthread_once(&cache_once, cache_init);
+    pthread_mutex_lock(&cache.mutex);
+    cache.wake = true;
+    pthread_cond_signal(&cache.cond);
+    pthread_mutex_unlock(&cache.mutex);
 }
 
 int WIFI_direct_scanNetworks(WIFI_direct_network_t* networks, int max_count) {
     if (!networks || max_count <= 0) return 0;
 
     struct WIFI_network found[WD_SCAN_MAX];
+    bool saved[WD_SCAN_MAX];
     int want = max_count < WD_SCAN_MAX ? max_count : WD_SCAN_MAX;
-    int n = WIFI_scan(found, want);
+    int n = cache_scan(found, saved, want);
     if (n < 0) return 0;
 
     int count = 0;
@@ -94,7 +408,7 @@ int WIFI_direct_scanNetworks(WIFI_direct_network_t* networks, int max_count) {
         networks[count].ssid[WIFI_DIRECT_SSID_MAX - 1] = '\0';
         networks[count].rssi = found[i].rssi;
         networks[count].is_secured = (found[i].security != SECURITY_NONE);
-        networks[count].has_saved_creds = WIFI_isKnown(found[i].ssid, found[i].security);
+        networks[count].has_saved_creds = saved[i];
         count++;
     }
     return count;
@@ -126,6 +440,9 @@ void WIFI_direct_saveCurrentConnection(void) {
 int WIFI_direct_connect(const char* ssid, const char* pass) {
     if (!ssid) return -1;
 
+    // Background scans take the radio off-channel and would slow the association
+    scan_cache_join();
+
     bool has_pass = (pass && pass[0] != '\0');
     WIFI_connectPass(ssid, has_pass ? SECURITY_WPA2_PSK : SECURITY_NONE, has_pass ? pass : NULL);
 
@@ -187,13 +504,20 @@ int WIFI_direct_forgetAllHotspots(void) {
 int WIFI_direct_scanForHotspots(const char* prefix, char ssids_out[][WIFI_DIRECT_SSID_MAX], int max_count) {
     if (!prefix || !ssids_out || max_count <= 0) return 0;
 
+    // The background scanner has usually seen them already
+    int count = 0;
+    if (strcmp(prefix, LINK_HOTSPOT_SSID_PREFIX) == 0) {
+        count = WIFI_direct_getCachedHotspots(ssids_out, max_count);
+        if (count > 0) return count;
+    }
+
     size_t prefix_len = strlen(prefix);
     struct WIFI_network found[WD_SCAN_MAX];
-    int count = 0;
+    bool saved[WD_SCAN_MAX];
 
     // A couple of passes since hotspots can take a moment to appear.
     for (int retry = 0; retry < 3 && count == 0; retry++) {
-        int n = WIFI_scan(found, WD_SCAN_MAX);
+        int n = cache_scan(found, saved, WD_SCAN_MAX);
         if (n < 0) continue;
         for (int i = 0; i < n && count < max_count; i++) {
             if (strncmp(found[i].ssid, prefix, prefix_len) == 0) {
@@ -254,6 +578,9 @@ int WIFI_direct_startHotspot(const char* ssid, const char* password) {
         return 0;
     }
 
+    // wpa_supplicant is about to go away, stop scanning through it
+    scan_cache_join();
+
     // Save the current client connection (while wpa_supplicant is still up) so we
     // can restore it after hosting.
     WIFI_direct_saveCurrentConnection();
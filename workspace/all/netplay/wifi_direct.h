@@ -38,11 +38,11 @@ typedef struct {
 // Returns true if WiFi is ready for operations
 bool WIFI_direct_ensureReady(void);
 
-// Trigger a WiFi scan (non-blocking, just starts the scan)
-// Call this, then wait ~1.5 seconds before calling WIFI_direct_scanNetworks
+// Trigger a WiFi scan (non-blocking). Wakes the background scanner if it's
+// running, the results then show up in the scan cache.
 void WIFI_direct_triggerScan(void);
 
-// Scan for all available WiFi networks (reads cached results from last trigger)
+// Scan for all available WiFi networks (blocking, also refreshes the scan cache)
 // Returns number of networks found
 int WIFI_direct_scanNetworks(WIFI_direct_network_t* networks, int max_count);
 
@@ -69,11 +69,42 @@ void WIFI_direct_forget(const char* ssid);
 // Returns the number of networks removed.
 int WIFI_direct_forgetAllHotspots(void);
 
-// Scan for hotspots matching a prefix
+// Scan for hotspots matching a prefix. Answers from the scan cache when it
+// already holds fresh LINK_HOTSPOT_SSID_PREFIX hotspots.
 // Returns number of hotspots found
 // ssids_out should be an array of char[WIFI_DIRECT_SSID_MAX]
 int WIFI_direct_scanForHotspots(const char* prefix, char ssids_out[][WIFI_DIRECT_SSID_MAX], int max_count);
 
+//////////////////////////////////
+// Background Scan Cache
+//////////////////////////////////
+
+// While the Netplay menu is open a background thread rescans every few seconds
+// and keeps the recent results, so the network and hotspot lists render from
+// memory instead of waiting on a scan. Entries unseen for a few scans expire.
+
+// Start the background scanner (no-op if running, WiFi is off or hosting)
+void WIFI_direct_startScanCache(void);
+
+// Stop the background scanner. Returns at once, a scan in flight finishes on
+// its own; WIFI_direct_connect and WIFI_direct_startHotspot wait for it before
+// they take over the radio. The cached results are kept.
+void WIFI_direct_stopScanCache(void);
+
+// Bumped whenever the cached list changes, so the UI can cheaply poll for updates
+uint32_t WIFI_direct_getScanCacheGeneration(void);
+
+// Recently seen networks, one per SSID (strongest BSSID), strongest first.
+// Returns the number copied.
+int WIFI_direct_getCachedNetworks(WIFI_direct_network_t* networks, int max_count);
+
+// Recently seen LINK_HOTSPOT_SSID_PREFIX hotspots (indexed separately), strongest first.
+// Returns the number copied.
+int WIFI_direct_getCachedHotspots(char ssids_out[][WIFI_DIRECT_SSID_MAX], int max_count);
+
+// Total scans run (background and on demand), for per-join scan counts
+uint32_t WIFI_direct_getScanCount(void);
+
 // Get IP address of wlan0
 // Returns 0 on success, -1 on failure
 int WIFI_direct_getIP(char* ip_out, size_t ip_size);
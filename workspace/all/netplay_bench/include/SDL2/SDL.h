@@ -0,0 +1,12 @@
+/*
+ * Netplay benchmark: stand-in for SDL2/SDL.h
+ * minarch.h (via netplay_helper.h) only names SDL_Surface in accessor
+ * prototypes the benchmark never calls.
+ */
+
+#ifndef SDL_h_
+#define SDL_h_
+
+typedef struct SDL_Surface SDL_Surface;
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Netplay benchmark: stand-in for common/api.h
+ * netplay.c only needs the logging interface, which netplay_bench.c implements
+ * (LOG_note). The real header pulls in SDL and the platform headers.
+ */
+
+#ifndef __API_H__
+#define __API_H__
+
+#include <stdbool.h>
+
+enum {
+	LOG_DEBUG = 0,
+	LOG_INFO,
+	LOG_WARN,
+	LOG_ERROR,
+};
+
+#define LOG_debug(fmt, ...) LOG_note(LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_info(fmt, ...) LOG_note(LOG_INFO, fmt, ##__VA_ARGS__)
+#define LOG_warn(fmt, ...) LOG_note(LOG_WARN, fmt, ##__VA_ARGS__)
+#define LOG_error(fmt, ...) LOG_note(LOG_ERROR, fmt, ##__VA_ARGS__)
+void LOG_note(int level, const char* fmt, ...);
+
+#endif
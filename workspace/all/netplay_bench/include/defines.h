@@ -0,0 +1,9 @@
+/*
+ * Netplay benchmark: stand-in for the platform's defines.h
+ * Nothing from it is used by netplay.c, it only has to exist.
+ */
+
+#ifndef DEFINES_H
+#define DEFINES_H
+
+#endif
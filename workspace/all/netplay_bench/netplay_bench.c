@@ -0,0 +1,427 @@
+/*
+ * NextUI Netplay Benchmark
+ * Runs a netplay host and client over loopback against a deterministic stub
+ * core, so every protocol change gets numbers without two devices.
+ *
+ * Both peers link the real netplay.c/network_common.c (the module keeps one
+ * session per process, so each peer is a forked child). The stub core is a
+ * counter state with serialize/unserialize and scripted inputs; the loop
+ * mirrors minarch's: Netplay_update, run the core, Netplay_postFrame.
+ *
+ * Reported per peer: state sync time, frames per second achieved, stalled
+ * updates, remote input latency percentiles (peer's input sent -> frame using
+ * it runs) and bytes sent/received. The final states are compared to catch
+ * desyncs. Combine with link_impair (LD_PRELOAD) for lossy-network numbers.
+ *
+ * usage: netplay_bench [options]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "netplay.h"
+
+#define BENCH_HOST 0
+#define BENCH_CLIENT 1
+#define BENCH_WARMUP_FRAMES 600       // Host "plays" this long before the client joins
+#define BENCH_CONNECT_TIMEOUT_MS 10000
+#define BENCH_TOUCH_BYTES 64          // State bytes the stub core rewrites per frame
+
+typedef struct {
+    // Timeline, indexed by frame (CLOCK_MONOTONIC us, shared across the fork)
+    uint64_t* input_sent_us;          // Our input for this frame went out
+    uint64_t* frame_run_us;           // This frame ran
+
+    uint64_t sync_start_us;
+    uint64_t sync_done_us;
+    uint64_t end_us;
+    uint32_t frames_run;
+    uint32_t stalled_updates;         // Netplay_update said skip after the sync
+    uint32_t stall_events;            // Runs of stalled updates
+    uint64_t longest_stall_us;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t state_hash;
+    bool listening;                   // Host only: ready for the client
+    bool done;
+    int error;
+} PeerResult;
+
+//////////////////////////////////////////////////////////////////////////////
+// State
+//////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    // Options
+    uint32_t frames;
+    size_t state_size;
+    bool paced;
+    bool verbose;
+
+    // Shared with the parent
+    PeerResult* peers;
+
+    // This peer
+    int side;
+    uint8_t* state;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+} bench = {
+    .frames = 3600,
+    .state_size = 256 * 1024,
+    .paced = true,
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Frontend Stubs (api.c / netplay_helper.c)
+//////////////////////////////////////////////////////////////////////////////
+
+void LOG_note(int level, const char* fmt, ...) {
+    (void)level;
+    if (!bench.verbose) return;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", bench.side == BENCH_HOST ? "host" : "client");
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+int netplay_connected_to_hotspot = 0;
+
+void stopHotspotAndRestoreWiFiAsync(bool was_host) {
+    (void)was_host;
+}
+
+// Bytes on the wire, counted at netplay.c's send()/recv() (linked with --wrap)
+ssize_t __real_send(int fd, const void* buf, size_t len, int flags);
+ssize_t __real_recv(int fd, void* buf, size_t len, int flags);
+
+ssize_t __wrap_send(int fd, const void* buf, size_t len, int flags) {
+    ssize_t ret = __real_send(fd, buf, len, flags);
+    if (ret > 0) bench.bytes_sent += ret;
+    return ret;
+}
+
+ssize_t __wrap_recv(int fd, void* buf, size_t len, int flags) {
+    ssize_t ret = __real_recv(fd, buf, len, flags);
+    if (ret > 0) bench.bytes_received += ret;
+    return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Stub Core
+//////////////////////////////////////////////////////////////////////////////
+
+// State layout: [frame u64][hash u64][pseudo RAM...]
+static void core_reset(void) {
+    uint64_t x = 0x0123456789ABCDEFULL;  // Same "boot" on both sides
+    for (size_t i = 0; i + 8 <= bench.state_size; i += 8) {
+        x = mix64(x + i);
+        memcpy(bench.state + i, &x, 8);
+    }
+    memset(bench.state, 0, 16);
+}
+
+// One frame: fold both inputs into the hash and rewrite a few RAM bytes
+static void core_run(uint16_t p1, uint16_t p2) {
+    uint64_t frame, hash;
+    memcpy(&frame, bench.state, 8);
+    memcpy(&hash, bench.state + 8, 8);
+
+    hash = mix64(hash ^ ((uint64_t)p1 << 16 | p2) ^ (frame << 32));
+    frame++;
+
+    size_t ram = bench.state_size - 16;
+    size_t offset = 16 + (size_t)(hash % (ram - BENCH_TOUCH_BYTES));
+    for (int i = 0; i < BENCH_TOUCH_BYTES; i++) {
+        bench.state[offset + i] ^= (uint8_t)(hash >> ((i & 7) * 8));
+    }
+
+    memcpy(bench.state, &frame, 8);
+    memcpy(bench.state + 8, &hash, 8);
+}
+
+static size_t core_serialize_size(void) {
+    return bench.state_size;
+}
+
+static bool core_serialize(void* data, size_t size) {
+    if (size < bench.state_size) return false;
+    memcpy(data, bench.state, bench.state_size);
+    return true;
+}
+
+static bool core_unserialize(const void* data, size_t size) {
+    if (size < bench.state_size) return false;
+    memcpy(bench.state, data, bench.state_size);
+    return true;
+}
+
+// Scripted input: held for a few frames at a time, different per player
+static uint16_t scripted_input(int side, uint32_t frame) {
+    uint64_t h = mix64(((uint64_t)side << 40) ^ (frame / 6));
+    return (uint16_t)(h & 0x0FFF);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Peer
+//////////////////////////////////////////////////////////////////////////////
+
+static int run_peer(int side) {
+    PeerResult* me = &bench.peers[side];
+    PeerResult* host = &bench.peers[BENCH_HOST];
+    bench.side = side;
+
+    bench.state = malloc(bench.state_size);
+    if (!bench.state) return 1;
+    core_reset();
+
+    Netplay_init();
+    Netplay_setCore("fceumm");  // Any lockstep core
+
+    uint64_t deadline = now_us() + BENCH_CONNECT_TIMEOUT_MS * 1000ULL;
+    if (side == BENCH_HOST) {
+        for (uint32_t f = 0; f < BENCH_WARMUP_FRAMES; f++) {
+            core_run(scripted_input(side, f), 0);
+        }
+        if (Netplay_startHost("bench", 0, NULL) != 0) {
+            fprintf(stderr, "host: %s\n", Netplay_getStatusMessage());
+            return 1;
+        }
+        __atomic_store_n(&me->listening, true, __ATOMIC_RELEASE);
+
+        // The client is accepted on the event loop thread
+        while (!Netplay_needsStateSync()) {
+            if (now_us() > deadline) {
+                fprintf(stderr, "host: no client\n");
+                return 1;
+            }
+            usleep(1000);
+        }
+        me->sync_start_us = now_us();
+    } else {
+        while (!__atomic_load_n(&host->listening, __ATOMIC_ACQUIRE)) {
+            if (now_us() > deadline) return 1;
+            usleep(1000);
+        }
+        me->sync_start_us = now_us();
+        if (Netplay_connectToHost("127.0.0.1", NETPLAY_DEFAULT_PORT) != 0) {
+            fprintf(stderr, "client: %s\n", Netplay_getStatusMessage());
+            return 1;
+        }
+    }
+
+    uint32_t frame = 0;
+    uint64_t frame_us = 1000000 / 60;
+    uint64_t next_frame = now_us();
+    uint64_t stall_start = 0;
+
+    while (frame < bench.frames) {
+        uint64_t now = now_us();
+        if (bench.paced) {
+            if (now < next_frame) {
+                usleep((useconds_t)(next_frame - now));
+                now = now_us();
+            }
+            next_frame += frame_us;
+            if (next_frame < now) next_frame = now;  // Don't catch up after a stall
+        }
+
+        // preFrame sends the input for frame + latency on the first try
+        bool synced = me->sync_done_us != 0;
+        uint32_t input_frame = frame + NETPLAY_INPUT_LATENCY_FRAMES;
+        if (synced && input_frame < bench.frames && !me->input_sent_us[input_frame]) {
+            me->input_sent_us[input_frame] = now;
+        }
+
+        int run = Netplay_update(scripted_input(side, frame), core_serialize_size,
+                                 core_serialize, core_unserialize);
+        if (!synced && Netplay_isActive()) {
+            me->sync_done_us = now_us();
+            if (!run) continue;
+        }
+        if (!Netplay_isConnected() && synced) {
+            fprintf(stderr, "%s: %s\n", side == BENCH_HOST ? "host" : "client",
+                    Netplay_getStatusMessage());
+            me->error = 1;
+            break;
+        }
+        if (!run || !me->sync_done_us) {
+            if (me->sync_done_us) {
+                me->stalled_updates++;
+                if (!stall_start) {
+                    stall_start = now;
+                    me->stall_events++;
+                }
+            }
+            continue;
+        }
+        if (stall_start) {
+            uint64_t stall = now_us() - stall_start;
+            if (stall > me->longest_stall_us) me->longest_stall_us = stall;
+            stall_start = 0;
+        }
+
+        core_run(Netplay_getInputState(0), Netplay_getInputState(1));
+        me->frame_run_us[frame] = now_us();
+        Netplay_postFrame();
+        frame++;
+    }
+
+    me->end_us = now_us();
+    me->frames_run = frame;
+    memcpy(&me->state_hash, bench.state + 8, 8);
+    me->bytes_sent = bench.bytes_sent;
+    me->bytes_received = bench.bytes_received;
+
+    // Keep the connection up until the other side has its last inputs
+    __atomic_store_n(&me->done, true, __ATOMIC_RELEASE);
+    PeerResult* other = &bench.peers[!side];
+    deadline = now_us() + BENCH_CONNECT_TIMEOUT_MS * 1000ULL;
+    while (!__atomic_load_n(&other->done, __ATOMIC_ACQUIRE) && now_us() < deadline) {
+        usleep(1000);
+    }
+
+    Netplay_quit();
+    free(bench.state);
+    return me->error;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Report
+//////////////////////////////////////////////////////////////////////////////
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report_peer(const char* name, const PeerResult* me, const PeerResult* other) {
+    double active_s = (me->end_us - me->sync_done_us) / 1000000.0;
+    printf("%s:\n", name);
+    printf("  state sync:        %.1f ms (%zu KB state)\n",
+           (me->sync_done_us - me->sync_start_us) / 1000.0, bench.state_size / 1024);
+    printf("  frames:            %u in %.2f s (%.1f fps)\n",
+           me->frames_run, active_s, active_s > 0 ? me->frames_run / active_s : 0.0);
+    printf("  stalls:            %u updates in %u stalls, longest %.1f ms\n",
+           me->stalled_updates, me->stall_events, me->longest_stall_us / 1000.0);
+    printf("  bytes:             %llu sent / %llu received\n",
+           (unsigned long long)me->bytes_sent, (unsigned long long)me->bytes_received);
+
+    // Remote input latency: other side sent its input for frame F -> we ran F
+    uint64_t* lat = malloc(bench.frames * sizeof(uint64_t));
+    size_t count = 0;
+    for (uint32_t f = NETPLAY_INPUT_LATENCY_FRAMES; lat && f < me->frames_run; f++) {
+        if (!other->input_sent_us[f] || !me->frame_run_us[f]) continue;
+        lat[count++] = me->frame_run_us[f] > other->input_sent_us[f] ?
+                       me->frame_run_us[f] - other->input_sent_us[f] : 0;
+    }
+    if (count) {
+        qsort(lat, count, sizeof(uint64_t), compare_u64);
+        printf("  input latency:     p50 %.1f / p90 %.1f / p99 %.1f / max %.1f ms\n",
+               lat[count / 2] / 1000.0, lat[count * 9 / 10] / 1000.0,
+               lat[count * 99 / 100] / 1000.0, lat[count - 1] / 1000.0);
+    }
+    free(lat);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n N     frames to run (default 3600)\n"
+            "  -s KB    stub core state size (default 256)\n"
+            "  -u       unpaced - run as fast as the link allows (default 60 fps)\n"
+            "  -v       show netplay log output\n", argv0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:uv")) != -1) {
+        switch (opt) {
+        case 'n': bench.frames = (uint32_t)atoi(optarg); break;
+        case 's': bench.state_size = (size_t)atoi(optarg) * 1024; break;
+        case 'u': bench.paced = false; break;
+        case 'v': bench.verbose = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (bench.frames == 0 || bench.state_size < 1024) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Results and per-frame timelines live in memory both children share
+    size_t timeline = (size_t)bench.frames * sizeof(uint64_t);
+    size_t total = 2 * sizeof(PeerResult) + 4 * timeline;
+    uint8_t* shared = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    bench.peers = (PeerResult*)shared;
+    uint8_t* next = shared + 2 * sizeof(PeerResult);
+    for (int side = 0; side < 2; side++) {
+        bench.peers[side].input_sent_us = (uint64_t*)next;
+        bench.peers[side].frame_run_us = (uint64_t*)(next + timeline);
+        next += 2 * timeline;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    pid_t pids[2];
+    for (int side = 0; side < 2; side++) {
+        pids[side] = fork();
+        if (pids[side] < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pids[side] == 0) _exit(run_peer(side));
+    }
+
+    int failed = 0;
+    for (int side = 0; side < 2; side++) {
+        int status = 0;
+        waitpid(pids[side], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+
+    PeerResult* host = &bench.peers[BENCH_HOST];
+    PeerResult* client = &bench.peers[BENCH_CLIENT];
+    if (!host->sync_done_us || !client->sync_done_us) {
+        fprintf(stderr, "session never started\n");
+        return 1;
+    }
+
+    printf("netplay loopback: %u frames, %s\n", bench.frames, bench.paced ? "60 fps" : "unpaced");
+    report_peer("host", host, client);
+    report_peer("client", client, host);
+
+    bool in_sync = host->frames_run == client->frames_run && host->state_hash == client->state_hash;
+    printf("final state:       %s\n", in_sync ? "match" : "DESYNC");
+    return failed || !in_sync ? 2 : 0;
+}